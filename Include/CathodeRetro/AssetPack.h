@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "CathodeRetro/GraphicsDevice.h"
+#include "CathodeRetro/Settings.h"
+
+
+namespace CathodeRetro
+{
+  // These are the assets that an asset pack can contain. New ones go at the end (an asset pack that doesn't contain a
+  //  given asset is still valid, the asset just gets generated at runtime instead).
+  enum class AssetID : uint32_t
+  {
+    SlotMask,                                       // The fully mipped mask textures for each MaskType
+    ShadowMask,
+    ApertureGrille,
+  };
+
+
+  inline AssetID MaskAssetID(MaskType type)
+  {
+    switch (type)
+    {
+    case MaskType::SlotMask: return AssetID::SlotMask;
+    case MaskType::ShadowMask: return AssetID::ShadowMask;
+    case MaskType::ApertureGrille: return AssetID::ApertureGrille;
+    }
+
+    return AssetID::SlotMask;
+  }
+
+
+  // An asset pack is a single binary blob holding textures that Cathode Retro would otherwise have to render at runtime
+  //  (like the mask textures and their mip chains), built offline (see Samples/Software-Sample/AssetPackMain.cpp) so
+  //  that they can just be uploaded instead. This class reads one out of memory without copying anything, so the
+  //  memory can come straight from a memory-mapped file (and needs to outlive the AssetPack and anything that reads
+  //  from it).
+  // The layout is a header, then a table of entries, then the texel data of each entry (16-byte aligned, with each
+  //  texture's mip levels tightly packed one after another, largest first). Everything is little-endian.
+  class AssetPack
+  {
+  public:
+    // This gets bumped whenever the layout changes or the baked assets would come out differently (for instance,
+    //  because a mask generation shader changed), so that stale packs are rejected instead of used.
+    static constexpr uint32_t k_version = 1;
+
+    struct Texture
+    {
+      TextureFormat format;
+      uint32_t width;
+      uint32_t height;
+      uint32_t mipCount;
+      const void *texels;
+    };
+
+
+    // Point this at the given pack data. Returns false (and leaves the pack empty) if the data is not a valid asset
+    //  pack of the current version.
+    bool Load(const void *dataIn, size_t byteCountIn)
+    {
+      data = nullptr;
+      entryCount = 0;
+
+      Header header;
+      if (byteCountIn < sizeof(Header))
+      {
+        return false;
+      }
+
+      memcpy(&header, dataIn, sizeof(Header));
+      if (memcmp(header.magic, k_magic, sizeof(header.magic)) != 0
+        || header.version != k_version
+        || header.entryCount > (byteCountIn - sizeof(Header)) / sizeof(Entry))
+      {
+        return false;
+      }
+
+      // Make sure that every entry's texels are actually in the data before trusting any of them.
+      auto bytes = static_cast<const uint8_t *>(dataIn);
+      for (uint32_t i = 0; i < header.entryCount; i++)
+      {
+        Entry entry;
+        memcpy(&entry, bytes + sizeof(Header) + i * sizeof(Entry), sizeof(Entry));
+        if (entry.format > uint32_t(TextureFormat::RGBA_Float16)
+          || entry.width == 0
+          || entry.height == 0
+          || entry.mipCount == 0
+          || entry.mipCount > FullMipCount(entry.width, entry.height)
+          || entry.offset % k_alignment != 0
+          || entry.offset > byteCountIn
+          || entry.byteCount > byteCountIn - entry.offset
+          || entry.byteCount
+            != RenderTargetByteCount(entry.width, entry.height, entry.mipCount, TextureFormat(entry.format)))
+        {
+          return false;
+        }
+      }
+
+      data = bytes;
+      entryCount = header.entryCount;
+      return true;
+    }
+
+
+    // Find the texture for the given asset, returning false if the pack doesn't have it.
+    bool FindTexture(AssetID id, Texture *textureOut) const
+    {
+      for (uint32_t i = 0; i < entryCount; i++)
+      {
+        Entry entry;
+        memcpy(&entry, data + sizeof(Header) + i * sizeof(Entry), sizeof(Entry));
+        if (entry.id == uint32_t(id))
+        {
+          *textureOut = { TextureFormat(entry.format), entry.width, entry.height, entry.mipCount, data + entry.offset };
+          return true;
+        }
+      }
+
+      return false;
+    }
+
+
+    // Build a pack out of the given textures (whose texels are laid out the same way that they are in a pack).
+    struct BuildEntry
+    {
+      AssetID id;
+      Texture texture;
+    };
+
+    static std::vector<uint8_t> Build(const std::vector<BuildEntry> &entries)
+    {
+      size_t offset = AlignUp(sizeof(Header) + entries.size() * sizeof(Entry));
+      std::vector<Entry> table;
+      for (auto &buildEntry : entries)
+      {
+        const Texture &texture = buildEntry.texture;
+        Entry entry = {};
+        entry.id = uint32_t(buildEntry.id);
+        entry.format = uint32_t(texture.format);
+        entry.width = texture.width;
+        entry.height = texture.height;
+        entry.mipCount = texture.mipCount;
+        entry.offset = offset;
+        entry.byteCount = RenderTargetByteCount(texture.width, texture.height, texture.mipCount, texture.format);
+        table.push_back(entry);
+
+        offset = AlignUp(offset + size_t(entry.byteCount));
+      }
+
+      std::vector<uint8_t> pack(offset, 0);
+
+      Header header = {};
+      memcpy(header.magic, k_magic, sizeof(header.magic));
+      header.version = k_version;
+      header.entryCount = uint32_t(table.size());
+      memcpy(pack.data(), &header, sizeof(Header));
+
+      for (size_t i = 0; i < table.size(); i++)
+      {
+        memcpy(pack.data() + sizeof(Header) + i * sizeof(Entry), &table[i], sizeof(Entry));
+        memcpy(pack.data() + table[i].offset, entries[i].texture.texels, size_t(table[i].byteCount));
+      }
+
+      return pack;
+    }
+
+  private:
+    static constexpr char k_magic[4] = { 'C', 'R', 'P', 'K' };
+    static constexpr size_t k_alignment = 16;
+
+    struct Header
+    {
+      char magic[4];
+      uint32_t version;
+      uint32_t entryCount;
+      uint32_t reserved;
+    };
+
+    struct Entry
+    {
+      uint32_t id;
+      uint32_t format;
+      uint32_t width;
+      uint32_t height;
+      uint32_t mipCount;
+      uint32_t reserved;
+      uint64_t offset;
+      uint64_t byteCount;
+    };
+
+
+    static size_t AlignUp(size_t value)
+      { return (value + k_alignment - 1) & ~(k_alignment - 1); }
+
+
+    const uint8_t *data = nullptr;
+    uint32_t entryCount = 0;
+  };
+}
@@ -1,28 +1,64 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
+#include "CathodeRetro/Internal/CommandListRecorder.h"
+#include "CathodeRetro/Internal/DecodedFrameCache.h"
 #include "CathodeRetro/Internal/RGBToCRT.h"
 #include "CathodeRetro/Internal/SignalDecoder.h"
 #include "CathodeRetro/Internal/SignalGenerator.h"
+#include "CathodeRetro/Internal/StreamedTexture.h"
+#include "CathodeRetro/Internal/TransientRenderTargets.h"
 #include "CathodeRetro/GraphicsDevice.h"
+#include "CathodeRetro/ScreenTextureStore.h"
+#include "CathodeRetro/SignalRecorder.h"
 #include "CathodeRetro/Settings.h"
+#include "CathodeRetro/SharedResources.h"
 
 
 namespace CathodeRetro
 {
+  // The band of rows of the input whose contents changed since the previous frame (see CathodeRetro::Render). Rows
+  //  past the bottom of the input are ignored, so All() covers every row of any input.
+  struct ChangedRows
+  {
+    static constexpr ChangedRows All() { return {0, UINT32_MAX}; }
+    static constexpr ChangedRows None() { return {0, 0}; }
+
+    uint32_t firstRow = 0;
+    uint32_t rowCount = 0;
+  };
+
+
   // This class handles the whole CathodeRetro pipeline.
   class CathodeRetro
   {
   public:
+    // If there are going to be multiple instances using the same graphics device, pass them all the same
+    //  SharedResources (created with that device) so that they share their shaders and mask textures. Otherwise, leave
+    //  it null and this instance will keep its own.
     CathodeRetro(
       IGraphicsDevice *graphicsDevice,
       SignalType sigType,
       uint32_t inputWidth,
       uint32_t inputHeight,
-      const SourceSettings &sourceSettings)
+      const SourceSettings &sourceSettings,
+      SharedResources *sharedResourcesIn = nullptr)
       : device(graphicsDevice)
+      , sharedResources(sharedResourcesIn)
+      , transients(graphicsDevice)
     {
+      if (sharedResources == nullptr)
+      {
+        ownedSharedResources = std::make_unique<SharedResources>(device);
+        sharedResources = ownedSharedResources.get();
+      }
+
+      assert(sharedResources->Device() == device);
       UpdateSourceSettings(sigType, inputWidth, inputHeight, sourceSettings);
     }
 
@@ -50,12 +86,27 @@ namespace CathodeRetro
       inWidth = inputWidth;
       inHeight = inputHeight;
 
+      // Everything that the recorded commands referred to is about to be replaced (and a pending frame, decoded from
+      //  the old input, can't be shown through the new stages).
+      commandList = nullptr;
+      decodeCommandList = nullptr;
+      pipelinedFrames[0] = nullptr;
+      pipelinedFrames[1] = nullptr;
+      pendingFrame = nullptr;
+      sliceFrameInProgress = false;
+      streamedInput = nullptr;
+      externalSignal = nullptr;
+      externalPhases = nullptr;
+
       if (sigType == SignalType::RGB)
       {
         signalGenerator = nullptr;
         signalDecoder = nullptr;
+        decodedFrameCache.SetFrameSize(device, 0, 0);
         rgbToCRT = std::make_unique<RGBToCRT>(
           device,
+          sharedResources,
+          &transients,
           inputWidth,
           inputWidth,
           inputHeight,
@@ -65,17 +116,30 @@ namespace CathodeRetro
       {
         signalGenerator = std::make_unique<SignalGenerator>(
           device,
+          sharedResources,
+          &transients,
           signalType,
           inputWidth,
           inputHeight,
           sourceSettings);
         signalGenerator->SetArtifactSettings(cachedArtifactSettings);
+        signalGenerator->SetSignalPrecision(signalPrecision);
+        signalGenerator->SetSignalGenerationPath(signalGenerationPath);
 
-        signalDecoder = std::make_unique<SignalDecoder>(device, signalGenerator->SignalProperties());
+        signalDecoder = std::make_unique<SignalDecoder>(
+          device,
+          sharedResources,
+          &transients,
+          signalGenerator->SignalProperties());
         signalDecoder->SetKnobSettings(cachedKnobSettings);
+        signalDecoder->SetSignalPrecision(signalPrecision);
+        signalDecoder->SetCompositeDecodePath(compositeDecodePath);
+        decodedFrameCache.SetFrameSize(device, signalDecoder->OutputTextureWidth(), inputHeight);
 
         rgbToCRT = std::make_unique<RGBToCRT>(
           device,
+          sharedResources,
+          &transients,
           inputWidth,
           signalDecoder->OutputTextureWidth(),
           inputHeight,
@@ -87,6 +151,9 @@ namespace CathodeRetro
         rgbToCRT->SetOutputSize(outWidth, outHeight);
       }
 
+      rgbToCRT->SetScreenTextureRegenerationFrameCount(screenTextureRegenerationFrameCount);
+      rgbToCRT->SetScreenTextureCacheBudget(screenTextureCacheBudget);
+      rgbToCRT->SetScreenTextureStore(screenTextureStore);
       rgbToCRT->SetSettings(cachedOverscanSettings, cachedScreenSettings);
     }
 
@@ -100,6 +167,11 @@ namespace CathodeRetro
     {
       using namespace Internal;
 
+      if (artifactSettings != cachedArtifactSettings || knobSettings != cachedKnobSettings)
+      {
+        decodedFrameCache.Invalidate();
+      }
+
       cachedArtifactSettings = artifactSettings;
       cachedKnobSettings = knobSettings;
       cachedOverscanSettings = overscanSettings;
@@ -122,6 +194,161 @@ namespace CathodeRetro
     }
 
 
+    // Call this to change the precision of the float textures that carry the signal between the generator and
+    //  decoder passes (this has no effect for RGB input). Float16 halves their memory and bandwidth use. This will
+    //  reallocate those textures if the precision changes.
+    void SetSignalPrecision(SignalPrecision precision)
+    {
+      signalPrecision = precision;
+      decodedFrameCache.Invalidate();
+
+      if (signalGenerator != nullptr)
+      {
+        signalGenerator->SetSignalPrecision(precision);
+        signalDecoder->SetSignalPrecision(precision);
+      }
+    }
+
+
+    // Call this to choose between decoding composite signals in three passes (the default) or in a single fused pass
+    //  (this has no effect for RGB or S-Video input). The graphics device needs to support the
+    //  ShaderID::Decoder_CompositeToRGB shader to use the single-pass path.
+    void SetCompositeDecodePath(CompositeDecodePath path)
+    {
+      compositeDecodePath = path;
+      decodedFrameCache.Invalidate();
+
+      if (signalDecoder != nullptr)
+      {
+        signalDecoder->SetCompositeDecodePath(path);
+      }
+    }
+
+
+    // Call this to choose between applying artifacts (ghosting and noise) in a separate pass after generating the
+    //  signal (the default) or while generating it (this has no effect for RGB input, or without those artifacts). The
+    //  graphics device needs to support the ShaderID::Generator_RGBToSignalWithArtifacts shader to use the
+    //  single-pass path.
+    void SetSignalGenerationPath(SignalGenerationPath path)
+    {
+      signalGenerationPath = path;
+      decodedFrameCache.Invalidate();
+
+      if (signalGenerator != nullptr)
+      {
+        signalGenerator->SetSignalGenerationPath(path);
+      }
+    }
+
+
+    // Call this to have the decoded RGB frames of an unchanging input cached (this has no effect for RGB input). When
+    //  there's no noise or tracking instability, the signal generated from a given input only depends on which phase
+    //  the frame starts at, which cycles through (at most) SourceSettings::denominator values. So while Render keeps
+    //  being told that the input hasn't changed, each of those phases only goes through the generator and decoder
+    //  once, and every frame after that only runs the CRT passes, using the cached frame for its phase. When Render is
+    //  told that only some rows changed, only those rows go through the generator and decoder (every one of their
+    //  passes works along a single scanline), so small updates like a status bar or a text box cost proportionally
+    //  less. This costs one extra copy of the decoded rows (which are small, at the input's resolution) for every
+    //  frame that does get decoded, plus the memory for the cached frames.
+    void SetDecodedFrameCacheEnabled(bool enabled)
+    {
+      if (enabled == decodedFrameCacheEnabled)
+      {
+        return;
+      }
+
+      decodedFrameCacheEnabled = enabled;
+      decodedFrameCache.Invalidate();
+
+      // The commands get split up differently with the cache, and the frames get decoded into different textures.
+      commandList = nullptr;
+      pendingFrame = nullptr;
+    }
+
+
+    // Call this to trade latency for throughput (this has no effect for RGB input). With a pipeline latency of 0 (the
+    //  default), Render shows the frame that it's given. With a latency of 1, Render only runs the generator and
+    //  decoder passes on the frame that it's given, and shows the frame that it was given the time before (decoded into
+    //  a second RGB texture, so the two don't collide). Those two halves don't depend on each other, so a device that
+    //  supports IGraphicsDevice::ExecuteConcurrently can run them at the same time: the software device uses this to
+    //  keep more of its threads busy. Changing this drops any pending frame (see RenderPendingFrame).
+    void SetPipelineLatency(uint32_t frameCount)
+    {
+      assert(frameCount <= 1);
+      frameCount = std::min(frameCount, 1U);
+      if (frameCount == pipelineLatency)
+      {
+        return;
+      }
+
+      pipelineLatency = frameCount;
+
+      // The commands get split up differently in the pipeline.
+      commandList = nullptr;
+      pendingFrame = nullptr;
+    }
+
+
+    // Call this to choose how many frames regenerating the screen texture (which happens whenever the output size,
+    //  screen settings, or overscan settings change) gets spread out over. It's expensive at high output resolutions,
+    //  so by default it's generated a band at a time over several frames, with the frames in the meantime still using
+    //  the previous screen texture. 1 means that it's regenerated all at once, on the next frame that gets rendered.
+    //  Either way, the very first screen texture is always generated all at once.
+    void SetScreenTextureRegenerationFrameCount(uint32_t frameCount)
+    {
+      screenTextureRegenerationFrameCount = frameCount;
+
+      if (rgbToCRT != nullptr)
+      {
+        rgbToCRT->SetScreenTextureRegenerationFrameCount(frameCount);
+      }
+    }
+
+
+    // Call this to keep up to the given number of bytes' worth of screen textures that are no longer in use around in
+    //  memory (the least recently used ones get freed first), so that switching back to a recent output size or screen
+    //  setup (like toggling between windowed and fullscreen) doesn't need to generate its screen texture again. The
+    //  default is 0, which frees each screen texture as soon as it's replaced.
+    void SetScreenTextureCacheBudget(size_t byteCount)
+    {
+      screenTextureCacheBudget = byteCount;
+
+      if (rgbToCRT != nullptr)
+      {
+        rgbToCRT->SetScreenTextureCacheBudget(byteCount);
+      }
+    }
+
+
+    // Call this to have screen textures loaded from (and newly generated ones saved to) the given store, which needs to
+    //  outlive this instance (see CathodeRetro/ScreenTextureStore.h). Pass nullptr to stop using a store.
+    void SetScreenTextureStore(IScreenTextureStore *store)
+    {
+      screenTextureStore = store;
+
+      if (rgbToCRT != nullptr)
+      {
+        rgbToCRT->SetScreenTextureStore(store);
+      }
+    }
+
+
+    // Call this to have the signal that the generator makes for each frame (along with its phases and levels) handed
+    //  to the given recorder, which needs to outlive this instance (see CathodeRetro/SignalRecorder.h). Pass nullptr
+    //  to stop recording. While recording, the decoded frame cache still gets used, but every frame is generated in
+    //  full. Signals from StreamSignalScanlines aren't recorded.
+    void SetSignalRecorder(ISignalRecorder *recorder)
+    {
+      // Recording copies the signal out as part of the commands, so starting or stopping it means recording them again.
+      if ((recorder != nullptr) != (signalRecorder != nullptr))
+      {
+        commandList = nullptr;
+      }
+
+      signalRecorder = recorder;
+    }
+
+
     // Call this to change the output size (i.e. the size of the texture we'll be rendering to). This will reallocate
     //  any screen-sized textures that might exist.
     void SetOutputSize(uint32_t outputWidth, uint32_t outputHeight)
@@ -143,49 +370,798 @@ namespace CathodeRetro
     }
 
 
-    // Call this to actually render
-    void Render(
+    // Call this to actually render. changedRows should be the band of rows of the input texture whose contents are
+    //  different from the last time Render was called (ChangedRows::None() if it hasn't changed at all), which lets
+    //  the decoded frame cache, if it's enabled, only decode those rows.
+    // With a pipeline latency of 1 (see SetPipelineLatency), what gets rendered to the output is the frame from the
+    //  previous call, and if there isn't one (on the first call, or the first after something dropped the pending
+    //  frame) this renders nothing to the output and returns false. Otherwise it returns true.
+    bool Render(
       const ITexture *currentFrameInputRGB,
       ScanlineType scanlineType,
-      IRenderTarget *output)
+      IRenderTarget *output,
+      ChangedRows changedRows = ChangedRows::All())
     {
       device->BeginRendering();
 
+      uint64_t phaseKey = 0;
       if (signalType != SignalType::RGB)
       {
-        signalGenerator->Generate(currentFrameInputRGB);
-        signalDecoder->Decode(
+        phaseKey = signalGenerator->NextFramePhaseKey();
+        signalGenerator->UpdateFrameConstants();
+        signalDecoder->UpdateFrameConstants(signalGenerator->SignalLevels());
+      }
+
+      sliceFrameInProgress = false;
+
+      bool pipelined = (pipelineLatency > 0 && signalType != SignalType::RGB);
+      bool showsPendingFrame = (pipelined && pendingFrame != nullptr);
+      rgbToCRT->UpdateFrameConstants(showsPendingFrame ? pendingScanlineType : scanlineType);
+      rgbToCRT->RenderStaticTextures();
+
+      if (CommandsOutOfDate(CommandLayout::WholeFrame))
+      {
+        RecordCommandList(CommandLayout::WholeFrame);
+      }
+
+      if (decodeCommandList == nullptr)
+      {
+        commandList->Execute(currentFrameInputRGB, output);
+        RecordSignalFrame(scanlineType);
+        device->EndRendering();
+        return true;
+      }
+
+      // Figure out which texture this frame gets decoded into, and which of its rows need decoding (a row count of 0
+      //  means all of them).
+      IRenderTarget *decodedFrame;
+      uint32_t decodeFirstRow = 0;
+      uint32_t decodeRowCount = 0;
+      bool needsDecode = true;
+      if (decodedFrameCacheEnabled)
+      {
+        // A cached frame's rows can only be reused if those rows of the input are the same as when it was decoded, and
+        //  nothing other than the phase changes from frame to frame.
+        if (signalGenerator->SignalDependsOnlyOnPhases())
+        {
+          decodedFrameCache.MarkRowsChanged(changedRows.firstRow, changedRows.rowCount);
+        }
+        else
+        {
+          decodedFrameCache.Invalidate();
+        }
+
+        decodedFrame = decodedFrameCache.Get(phaseKey, &decodeFirstRow, &decodeRowCount, pendingFrame);
+
+        // A recorded frame needs all of its signal, so all of its rows get generated (and decoded again).
+        if (recordedSignal != nullptr)
+        {
+          decodeFirstRow = 0;
+          decodeRowCount = inHeight;
+        }
+
+        needsDecode = (decodeRowCount != 0);
+      }
+      else
+      {
+        decodedFrame = NextPipelinedFrame();
+      }
+
+      if (!pipelined)
+      {
+        if (needsDecode)
+        {
+          decodeCommandList->ExecuteRows(currentFrameInputRGB, decodedFrame, decodeFirstRow, decodeRowCount);
+        }
+
+        commandList->Execute(decodedFrame, output);
+      }
+      else if (!showsPendingFrame)
+      {
+        // The pipeline is empty, so this frame only gets decoded (for the next call to show).
+        if (needsDecode)
+        {
+          decodeCommandList->ExecuteRows(currentFrameInputRGB, decodedFrame, decodeFirstRow, decodeRowCount);
+        }
+      }
+      else if (!needsDecode)
+      {
+        commandList->Execute(pendingFrame, output);
+      }
+      else if (decodedFrame == pendingFrame)
+      {
+        // This frame is getting decoded into the same cached frame as the pending one (which is only possible with the
+        //  decoded frame cache, when they both start at the same phase), so the pending frame has to be shown first.
+        commandList->Execute(pendingFrame, output);
+        decodeCommandList->ExecuteRows(currentFrameInputRGB, decodedFrame, decodeFirstRow, decodeRowCount);
+      }
+      else
+      {
+        device->ExecuteConcurrently(
+          { decodeCommandList.get(), currentFrameInputRGB, decodedFrame, decodeFirstRow, decodeRowCount },
+          { commandList.get(), pendingFrame, output });
+      }
+
+      if (pipelined)
+      {
+        pendingFrame = decodedFrame;
+        pendingScanlineType = scanlineType;
+      }
+
+      RecordSignalFrame(scanlineType);
+      device->EndRendering();
+      return !pipelined || showsPendingFrame;
+    }
+
+
+    // With a pipeline latency of 1, render the frame that was given to the last call to Render (which the next call
+    //  would otherwise show), so that the last frame of a sequence can be shown without waiting for another one. This
+    //  returns false (and renders nothing) if there's no such frame. Either way, the pipeline is empty afterwards, so
+    //  the next call to Render won't render anything to its output.
+    bool RenderPendingFrame(IRenderTarget *output)
+    {
+      if (pendingFrame == nullptr)
+      {
+        return false;
+      }
+
+      device->BeginRendering();
+      rgbToCRT->UpdateFrameConstants(pendingScanlineType);
+      rgbToCRT->RenderStaticTextures();
+
+      if (CommandsOutOfDate(CommandLayout::WholeFrame))
+      {
+        RecordCommandList(CommandLayout::WholeFrame);
+      }
+
+      commandList->Execute(pendingFrame, output);
+      pendingFrame = nullptr;
+      device->EndRendering();
+      return true;
+    }
+
+
+    // Call this instead of Render to render each frame in slices as the emulator produces its scanlines, so that the
+    //  top of the output can be shown (by racing the display's beam) while the bottom of the frame is still being
+    //  emulated.
+    //  Call it once the input texture's scanlines firstScanline through lastScanline are done, with each frame's
+    //  slices in order from the top: a slice with a firstScanline of 0 starts a new frame, and the frame is done once
+    //  a slice reaches the last scanline. Each call only runs the generator and decoder passes (which all work along a
+    //  single scanline) on its own scanlines, and renders the rows of the output that only read scanlines that are done
+    //  so far (which depends on the screen curvature), returning that band of output rows (which can be empty).
+    // The diffusion blur spreads across scanlines, so with diffusion, each slice also redoes its passes over the last
+    //  few scanlines of the slice before (the ones that the blur reached past). Settings changes (other than to the
+    //  source settings, which start a new frame) take effect at the start of the next frame. This doesn't use the
+    //  decoded frame cache or the pipeline latency, and drops any pending frame.
+    ChangedRows RenderSlice(
+      const ITexture *currentFrameInputRGB,
+      ScanlineType scanlineType,
+      IRenderTarget *output,
+      uint32_t firstScanline,
+      uint32_t lastScanline)
+    {
+      assert(firstScanline <= lastScanline);
+      lastScanline = std::min(lastScanline, inHeight - 1);
+
+      device->BeginRendering();
+
+      // A slice that doesn't continue the frame in progress starts a new one, which needs every scanline up to the end
+      //  of the slice.
+      if (!ContinuesSlicedFrame(firstScanline, SliceSource::Input))
+      {
+        BeginSlicedFrame(scanlineType, SliceSource::Input);
+      }
+
+      ChangedRows renderedRows = RenderSlicedFrameRows(currentFrameInputRGB, output, lastScanline + 1);
+
+      device->EndRendering();
+      return renderedRows;
+    }
+
+
+    // Call this as the emulator finishes each scanline (or run of scanlines) of a frame, with the texels of the input
+    //  scanlines firstScanline through lastScanline (as RGBA_Unorm8 texels, where each row starts rowPitch bytes after
+    //  the previous one) in CPU memory. Each frame's scanlines need to be given in order from the top: a call with a
+    //  firstScanline of 0 starts a new frame. The scanlines are uploaded into an input texture that this keeps (only
+    //  the given rows of it, if the device supports IGraphicsDevice::UpdateTextureRows), and the generator and decoder
+    //  passes (which all work along a single scanline) run on them right away, so that the cost of generating the
+    //  signal is spread out over the frame instead of all landing on the call that renders it. Once the frame is done,
+    //  call RenderStreamedFrame to render it.
+    // Like RenderSlice (a call to either of which starts a new frame if the one in progress came from the other), this
+    //  doesn't use the decoded frame cache or the pipeline latency, and drops any pending frame.
+    void StreamScanlines(
+      const void *scanlineTexels,
+      ptrdiff_t rowPitch,
+      ScanlineType scanlineType,
+      uint32_t firstScanline,
+      uint32_t lastScanline)
+    {
+      assert(firstScanline <= lastScanline);
+      lastScanline = std::min(lastScanline, inHeight - 1);
+
+      if (streamedInput == nullptr)
+      {
+        streamedInput = std::make_unique<Internal::StreamedTexture>(
+          device,
+          inWidth,
+          inHeight,
+          TextureFormat::RGBA_Unorm8);
+      }
+
+      streamedInput->UpdateRows(firstScanline, lastScanline - firstScanline + 1, scanlineTexels, rowPitch);
+
+      device->BeginRendering();
+      if (!ContinuesSlicedFrame(firstScanline, SliceSource::StreamedInput))
+      {
+        BeginSlicedFrame(scanlineType, SliceSource::StreamedInput);
+      }
+
+      DecodeSlicedFrameRows(streamedInput->Texture(), lastScanline + 1);
+      device->EndRendering();
+    }
+
+
+    // Set the levels of the signal that StreamSignalScanlines gets given (which take effect at the start of its next
+    //  frame). A nonzero temporalArtifactReduction means that the signal is doubled up, the way that the generator
+    //  makes it for temporal artifact reduction.
+    void SetExternalSignalLevels(const SignalLevels &levels)
+      { externalSignalLevels = levels; }
+
+
+    // The number of samples along each scanline of the signal that StreamSignalScanlines expects (there's one
+    //  scanline per row of the input size, and the source settings determine its width the same way that they do for
+    //  the generator's signal). This is 0 for RGB input.
+    uint32_t SignalScanlineWidth() const
+      { return (signalGenerator != nullptr) ? signalGenerator->SignalProperties().scanlineWidth : 0; }
+
+
+    // Call this instead of StreamScanlines to decode a signal that comes from somewhere other than the generator (for
+    //  instance, a composite signal captured from real hardware, or one that was recorded from the generator earlier),
+    //  giving it the signal scanlines firstScanline through lastScanline, in order from the top, as they're available
+    //  (a call with a firstScanline of 0 starts a new frame). Then call RenderStreamedFrame to render the frame.
+    //  - The samples are 32-bit floats, with SignalScanlineWidth() texels per scanline, where each row starts
+    //    rowPitch bytes after the previous one. Each texel has one sample for composite (luma and chroma for S-Video),
+    //    and twice that if the signal is doubled up (see SetExternalSignalLevels).
+    //  - The phases are the colorburst phase of each of the given scanlines (one float per scanline, or two if the
+    //    signal is doubled up), in fractions of a colorburst cycle: the phase of the color carrier at the scanline's
+    //    first sample, as the generator's phases texture has it (see ComputeScanlinePhases).
+    // The scanlines get uploaded into textures that this keeps, and decoded right away (the decoder's passes all work
+    //  along a single scanline), so the frame that it renders to is only ever the size of the input. The signal isn't
+    //  affected by the artifact settings, and like StreamScanlines, this doesn't use the decoded frame cache or the
+    //  pipeline latency. This can't be used with RGB input.
+    void StreamSignalScanlines(
+      const float *samples,
+      ptrdiff_t rowPitch,
+      const float *phases,
+      ScanlineType scanlineType,
+      uint32_t firstScanline,
+      uint32_t lastScanline)
+    {
+      assert(signalType != SignalType::RGB);
+      assert(firstScanline <= lastScanline);
+      lastScanline = std::min(lastScanline, inHeight - 1);
+
+      device->BeginRendering();
+      if (!ContinuesSlicedFrame(firstScanline, SliceSource::ExternalSignal))
+      {
+        BeginSlicedFrame(scanlineType, SliceSource::ExternalSignal);
+      }
+
+      uint32_t scanlineCount = lastScanline - firstScanline + 1;
+      externalSignal->UpdateRows(firstScanline, scanlineCount, samples, rowPitch);
+      externalPhases->UpdateRows(
+        firstScanline,
+        scanlineCount,
+        phases,
+        ptrdiff_t(TexelByteCount(externalPhases->Texture()->Format())));
+
+      // The decoder reads the external signal textures directly, so there's no frame input.
+      DecodeSlicedFrameRows(nullptr, lastScanline + 1);
+      device->EndRendering();
+    }
+
+
+    // Render the frame that StreamScanlines (or StreamSignalScanlines) has been given so far. Any of its scanlines that
+    //  weren't given keep what the input (or signal) texture had for them from the frames before. This returns false
+    //  (and renders nothing) if neither of them has started a frame since the last one was rendered.
+    bool RenderStreamedFrame(IRenderTarget *output)
+    {
+      if (!sliceFrameInProgress || slicedFrameSource == SliceSource::Input)
+      {
+        return false;
+      }
+
+      bool isExternalSignal = (slicedFrameSource == SliceSource::ExternalSignal);
+
+      device->BeginRendering();
+      RenderSlicedFrameRows(isExternalSignal ? nullptr : streamedInput->Texture(), output, inHeight);
+      device->EndRendering();
+      return true;
+    }
+
+
+    // Get the per-pass timings of the most recent frame that the graphics device has measured. If the device does not
+    //  support timings, the result's isValid member is false.
+    FrameStats GetFrameStats() const
+    {
+      FrameStats stats;
+      if (device->GetFrameStats(&stats))
+      {
+        stats.isValid = true;
+        return stats;
+      }
+
+      return FrameStats();
+    }
+
+
+    // Get the memory usage of the intermediate render targets that the current settings use (as of the last call to
+    //  Render), both with and without sharing memory between those whose lifetimes within the frame don't overlap.
+    const TransientMemoryStats &GetTransientMemoryStats() const
+      { return transients.Stats(); }
+
+  private:
+    // What the recorded commands are set up for: rendering a whole frame at a time (Render), or rendering a frame in
+    //  slices (RenderSlice and StreamScanlines), with a signal from either the generator or StreamSignalScanlines.
+    enum class CommandLayout
+    {
+      WholeFrame,
+      Slices,
+      ExternalSignalSlices,
+    };
+
+
+    // Where the rows of a frame that's rendered in slices come from: the texture given to RenderSlice, the scanlines
+    //  given to StreamScanlines, or the signal given to StreamSignalScanlines. A frame is only ever continued by the
+    //  function that started it.
+    enum class SliceSource
+    {
+      Input,
+      StreamedInput,
+      ExternalSignal,
+    };
+
+
+    static CommandLayout SliceCommandLayout(SliceSource source)
+      { return (source == SliceSource::ExternalSignal) ? CommandLayout::ExternalSignalSlices : CommandLayout::Slices; }
+
+
+    // Whether a call (from the given source) whose first scanline is firstScanline continues the frame that's in the
+    //  middle of being rendered in slices, rather than starting a new one.
+    bool ContinuesSlicedFrame(uint32_t firstScanline, SliceSource source) const
+    {
+      return firstScanline > 0
+        && sliceFrameInProgress
+        && slicedFrameSource == source
+        && commandList != nullptr
+        && commandLayout == SliceCommandLayout(source);
+    }
+
+
+    bool CommandsOutOfDate(CommandLayout layout) const
+    {
+      // (The generator doesn't record anything when the signal comes from outside.)
+      return commandList == nullptr
+        || commandLayout != layout
+        || rgbToCRT->CommandsOutOfDate()
+        || (signalGenerator != nullptr
+          && layout != CommandLayout::ExternalSignalSlices
+          && signalGenerator->CommandsOutOfDate())
+        || (signalDecoder != nullptr && signalDecoder->CommandsOutOfDate());
+    }
+
+
+    // Start a new frame for RenderSlice (or one of the Stream functions): set up this frame's constants (and the
+    //  commands, if they're out of date) and pick the texture that its rows get decoded into.
+    void BeginSlicedFrame(ScanlineType scanlineType, SliceSource source)
+    {
+      CommandLayout layout = SliceCommandLayout(source);
+      if (layout == CommandLayout::ExternalSignalSlices)
+      {
+        UpdateExternalSignalTextures();
+        signalDecoder->UpdateFrameConstants(externalSignalLevels);
+      }
+      else if (signalType != SignalType::RGB)
+      {
+        signalGenerator->UpdateFrameConstants();
+        signalDecoder->UpdateFrameConstants(signalGenerator->SignalLevels());
+      }
+
+      rgbToCRT->UpdateFrameConstants(scanlineType);
+      rgbToCRT->RenderStaticTextures();
+
+      if (CommandsOutOfDate(layout))
+      {
+        RecordCommandList(layout);
+      }
+
+      // The cache doesn't get told which rows change from one sliced frame to the next, so it can't be trusted after
+      //  them.
+      decodedFrameCache.Invalidate();
+      pendingFrame = nullptr;
+
+      slicedFrame = (signalType != SignalType::RGB) ? NextPipelinedFrame() : nullptr;
+      slicedFrameSource = source;
+      slicedScanlineType = scanlineType;
+      sliceRGBRowCount = 0;
+      sliceBlurRowCount = 0;
+      sliceOutputRowCount = 0;
+      sliceFrameInProgress = true;
+    }
+
+
+    // Decode the sliced frame's rows up to rgbRowCount that aren't decoded yet (including any that got skipped). The
+    //  generator samples its input with linear filtering, which can pick up a sliver of the next row of the input, so
+    //  (until the frame's last row is in) the last of the given rows waits for the next call, when the row after it is
+    //  in as well.
+    void DecodeSlicedFrameRows(const ITexture *currentFrameInputRGB, uint32_t rgbRowCount)
+    {
+      if (decodeCommandList != nullptr && rgbRowCount < inHeight)
+      {
+        rgbRowCount--;
+      }
+
+      if (decodeCommandList != nullptr && rgbRowCount > sliceRGBRowCount)
+      {
+        decodeCommandList->ExecuteRows(
+          currentFrameInputRGB,
+          slicedFrame,
+          sliceRGBRowCount,
+          rgbRowCount - sliceRGBRowCount);
+
+        if (rgbRowCount == inHeight)
+        {
+          RecordSignalFrame(slicedScanlineType);
+        }
+      }
+
+      sliceRGBRowCount = std::max(rgbRowCount, sliceRGBRowCount);
+    }
+
+
+    // Decode the sliced frame's rows up to rgbRowCount, then render the output rows that only depend on the RGB rows
+    //  that are done so far (and finish the frame, once they all are), returning the band of output rows that got
+    //  rendered.
+    ChangedRows RenderSlicedFrameRows(const ITexture *currentFrameInputRGB, IRenderTarget *output, uint32_t rgbRowCount)
+    {
+      DecodeSlicedFrameRows(currentFrameInputRGB, rgbRowCount);
+
+      // The rows of the diffusion blur (and the other passes before the output) that are more than the blur's reach
+      //  above the last slice's rows only read rows that were already done then, so they don't need to be run again.
+      const ITexture *rgbInput = (slicedFrame != nullptr) ? slicedFrame : currentFrameInputRGB;
+      uint32_t firstRGBRow = sliceBlurRowCount - std::min(sliceBlurRowCount, Internal::RGBToCRT::SliceBlurRowReach());
+      if (sliceRGBRowsCommandList != nullptr && sliceRGBRowCount > firstRGBRow && sliceRGBRowCount > sliceBlurRowCount)
+      {
+        sliceRGBRowsCommandList->ExecuteRows(rgbInput, output, firstRGBRow, sliceRGBRowCount - firstRGBRow);
+        sliceBlurRowCount = sliceRGBRowCount;
+      }
+
+      ChangedRows renderedRows;
+      renderedRows.firstRow = sliceOutputRowCount;
+      renderedRows.rowCount = rgbToCRT->SliceOutputRowCount(sliceRGBRowCount) - sliceOutputRowCount;
+      if (renderedRows.rowCount > 0)
+      {
+        commandList->ExecuteRows(rgbInput, output, renderedRows.firstRow, renderedRows.rowCount);
+        sliceOutputRowCount += renderedRows.rowCount;
+      }
+
+      if (sliceRGBRowCount == inHeight)
+      {
+        sliceFinishCommandList->Execute(rgbInput, output);
+        sliceFrameInProgress = false;
+      }
+
+      return renderedRows;
+    }
+
+
+    // (Re)create the textures that StreamSignalScanlines uploads into if they don't exist yet or the signal levels
+    //  need them to be in a different format (which means that the commands need to be recorded again). They're
+    //  always at full precision, since the samples come in as 32-bit floats.
+    void UpdateExternalSignalTextures()
+    {
+      using namespace Internal;
+
+      TextureFormat signalFormat =
+        SignalTextureFormat(SignalPrecision::Float32, SignalChannelCount(externalSignalLevels));
+      if (externalSignal != nullptr && externalSignal->Texture()->Format() == signalFormat)
+      {
+        return;
+      }
+
+      externalSignal = std::make_unique<StreamedTexture>(device, SignalScanlineWidth(), inHeight, signalFormat);
+      externalPhases = std::make_unique<StreamedTexture>(
+        device,
+        1,
+        inHeight,
+        SignalTextureFormat(SignalPrecision::Float32, PhaseChannelCount(externalSignalLevels)));
+      commandList = nullptr;
+    }
+
+
+    // Get the texture that the next frame gets decoded into when there's no decoded frame cache, alternating between
+    //  the two so that it's never the pending frame.
+    IRenderTarget *NextPipelinedFrame()
+    {
+      std::unique_ptr<IRenderTarget> &frame = pipelinedFrames[nextPipelinedFrameIndex];
+      nextPipelinedFrameIndex ^= 1;
+      if (frame == nullptr)
+      {
+        frame = device->CreateRenderTarget(
+          signalDecoder->OutputTextureWidth(),
+          inHeight,
+          1,
+          TextureFormat::RGBA_Unorm8);
+      }
+
+      return frame.get();
+    }
+
+
+    // With a signal recorder, record the commands that copy the generator's signal and phases out into render targets
+    //  of their own (at full precision), where they're still there to read back once the frame is done.
+    void RecordSignalCopies(Internal::CommandListRecorder *recorder)
+    {
+      if (signalRecorder == nullptr)
+      {
+        return;
+      }
+
+      auto createCopy = [&](const ITexture *source, uint32_t channelCount)
+      {
+        return device->CreateRenderTarget(
+          source->Width(),
+          source->Height(),
+          1,
+          Internal::SignalTextureFormat(SignalPrecision::Float32, channelCount));
+      };
+
+      const SignalLevels &levels = signalGenerator->SignalLevels();
+      recordedSignal = createCopy(signalGenerator->SignalTexture(), SignalChannelCount(levels));
+      recordedPhases = createCopy(signalGenerator->PhasesTexture(), PhaseChannelCount(levels));
+
+      if (copyShader == nullptr)
+      {
+        copyShader = sharedResources->Shader(ShaderID::Util_Copy);
+      }
+
+      recorder->BeginPass(PassID::Generator);
+      recorder->RenderQuad(
+        copyShader.get(),
+        recordedSignal.get(),
+        {{signalGenerator->SignalTexture(), SamplerType::NearestClamp}});
+      recorder->RenderQuad(
+        copyShader.get(),
+        recordedPhases.get(),
+        {{signalGenerator->PhasesTexture(), SamplerType::NearestClamp}});
+      recorder->EndPass();
+    }
+
+
+    // Read back the signal that the current frame's commands copied out (if they did) and hand it to the recorder.
+    void RecordSignalFrame(ScanlineType scanlineType)
+    {
+      if (signalRecorder == nullptr || recordedSignal == nullptr)
+      {
+        return;
+      }
+
+      const SignalLevels &levels = signalGenerator->SignalLevels();
+      RecordedSignalFrame frame;
+      frame.signalType = signalType;
+      frame.inputWidth = inWidth;
+      frame.inputHeight = inHeight;
+      frame.sourceSettings = cachedSourceSettings;
+      frame.scanlineType = scanlineType;
+      frame.levels = levels;
+      frame.scanlineWidth = recordedSignal->Width();
+      frame.scanlineCount = recordedSignal->Height();
+      frame.signalChannelCount = SignalChannelCount(levels);
+      frame.phaseChannelCount = PhaseChannelCount(levels);
+
+      recordedSignalTexels.resize(size_t(frame.scanlineWidth) * frame.scanlineCount * frame.signalChannelCount);
+      recordedPhaseTexels.resize(size_t(frame.scanlineCount) * frame.phaseChannelCount);
+      if (!device->ReadRenderTarget(recordedSignal.get(), recordedSignalTexels.data())
+        || !device->ReadRenderTarget(recordedPhases.get(), recordedPhaseTexels.data()))
+      {
+        return;
+      }
+
+      frame.signal = recordedSignalTexels.data();
+      frame.phases = recordedPhaseTexels.data();
+      signalRecorder->RecordFrame(frame);
+    }
+
+
+    // The number of floats per texel of a signal with the given levels (and this instance's signal type), and of its
+    //  phases: both double up for temporal artifact reduction.
+    uint32_t SignalChannelCount(const SignalLevels &levels) const
+      { return ((signalType == SignalType::SVideo) ? 2 : 1) * PhaseChannelCount(levels); }
+
+    static uint32_t PhaseChannelCount(const SignalLevels &levels)
+      { return (levels.temporalArtifactReduction > 0.0f) ? 2 : 1; }
+
+
+    // Record the whole per-frame pass sequence into a command list, which then gets executed every frame until the
+    //  settings change in a way that affects which passes run (or which textures they use).
+    // With the decoded frame cache, a pipeline latency of 1, or for slices, the generator and decoder commands go
+    //  into their own command list, which ends by copying the decoded frame out to its output (a cache entry or a
+    //  pipelined frame), and the CRT commands read the decoded frame from their input instead. They're still recorded
+    //  together, so that the intermediate render targets get allocated for the sequence as a whole (with the pipeline,
+    //  the two halves might run at the same time, so they don't share any).
+    // For slices, the CRT commands are split up further: the ones that work on the rows of the RGB input (the
+    //  diffusion blur), the ones that render the output, and the ones that finish off the frame each get their own
+    //  command list, since each of those runs over a different band of rows. A signal from StreamSignalScanlines skips
+    //  the generator, and the decoder reads it straight from the textures that it gets uploaded into.
+    void RecordCommandList(CommandLayout layout)
+    {
+      Internal::CommandListRecorder recorder;
+
+      // (These get created again by RecordSignalCopies if this frame's signal gets recorded.)
+      recordedSignal = nullptr;
+      recordedPhases = nullptr;
+
+      bool forSlices = (layout != CommandLayout::WholeFrame);
+      const ITexture *rgbInput = recorder.FrameInput();
+      size_t decodeCommandCount = 0;
+      if (layout == CommandLayout::ExternalSignalSlices)
+      {
+        signalDecoder->RecordCommands(
+          &recorder,
+          externalSignal->Texture(),
+          externalPhases->Texture(),
+          externalSignalLevels);
+      }
+      else if (signalType != SignalType::RGB)
+      {
+        signalGenerator->RecordCommands(&recorder, rgbInput);
+        RecordSignalCopies(&recorder);
+        signalDecoder->RecordCommands(
+          &recorder,
           signalGenerator->SignalTexture(),
           signalGenerator->PhasesTexture(),
           signalGenerator->SignalLevels());
+      }
+
+      if (signalType != SignalType::RGB)
+      {
+        rgbInput = signalDecoder->CurrentFrameRGBOutput();
 
-        currentFrameInputRGB = signalDecoder->CurrentFrameRGBOutput();
+        if (decodedFrameCacheEnabled || pipelineLatency > 0 || forSlices)
+        {
+          if (copyShader == nullptr)
+          {
+            copyShader = sharedResources->Shader(ShaderID::Util_Copy);
+          }
+
+          recorder.BeginPass(PassID::Decoder);
+          recorder.RenderQuad(copyShader.get(), recorder.FrameOutput(), {{rgbInput, SamplerType::NearestClamp}});
+          recorder.EndPass();
+
+          decodeCommandCount = recorder.CommandCount();
+          rgbInput = recorder.FrameInput();
+        }
       }
 
-      rgbToCRT->Render(
-        currentFrameInputRGB,
-        output,
-        scanlineType);
+      Internal::RGBToCRT::SliceSplits sliceSplits;
+      rgbToCRT->RecordCommands(&recorder, rgbInput, recorder.FrameOutput(), forSlices ? &sliceSplits : nullptr);
 
-      device->EndRendering();
+      // Now that we know everything that this frame does, the intermediate render targets can be given actual memory.
+      //  For slices, the CRT passes' intermediates (the diffusion blur's textures) need to keep the rows that earlier
+      //  slices rendered into them.
+      std::vector<RecordedCommand> commands = recorder.TakeCommands();
+      transients.Allocate(
+        &commands,
+        (pipelineLatency > 0 && !forSlices) ? decodeCommandCount : 0,
+        forSlices ? decodeCommandCount : commands.size());
+
+      auto createCommandList = [&](size_t begin, size_t end)
+      {
+        return device->CreateCommandList(
+          std::vector<RecordedCommand>(commands.begin() + ptrdiff_t(begin), commands.begin() + ptrdiff_t(end)));
+      };
+
+      decodeCommandList = nullptr;
+      if (decodeCommandCount > 0)
+      {
+        decodeCommandList = createCommandList(0, decodeCommandCount);
+      }
+
+      if (forSlices)
+      {
+        sliceRGBRowsCommandList = createCommandList(decodeCommandCount, sliceSplits.outputBegin);
+        commandList = createCommandList(sliceSplits.outputBegin, sliceSplits.finishBegin);
+        sliceFinishCommandList = createCommandList(sliceSplits.finishBegin, commands.size());
+      }
+      else
+      {
+        sliceRGBRowsCommandList = nullptr;
+        sliceFinishCommandList = nullptr;
+        commandList = createCommandList(decodeCommandCount, commands.size());
+      }
+
+      commandLayout = layout;
     }
 
-  private:
+
     IGraphicsDevice *device;
+    SharedResources *sharedResources;
     SignalType signalType;
     SourceSettings cachedSourceSettings;
     ArtifactSettings cachedArtifactSettings;
     TVKnobSettings cachedKnobSettings;
     OverscanSettings cachedOverscanSettings;
     ScreenSettings cachedScreenSettings;
+    SignalPrecision signalPrecision = SignalPrecision::Float32;
+    CompositeDecodePath compositeDecodePath = CompositeDecodePath::ThreePass;
+    SignalGenerationPath signalGenerationPath = SignalGenerationPath::TwoPass;
+    uint32_t screenTextureRegenerationFrameCount = Internal::RGBToCRT::k_defaultScreenTextureRegenerationFrameCount;
+    size_t screenTextureCacheBudget = 0;
+    IScreenTextureStore *screenTextureStore = nullptr;
+    ISignalRecorder *signalRecorder = nullptr;
+    bool decodedFrameCacheEnabled = false;
+    uint32_t pipelineLatency = 0;
 
     uint32_t inWidth = 0;
     uint32_t inHeight = 0;
     uint32_t outWidth = 0;
     uint32_t outHeight = 0;
 
+    // These need to outlive the pipeline stages, since they create their shaders and intermediate render targets
+    //  through them.
+    std::unique_ptr<SharedResources> ownedSharedResources;
+    Internal::TransientRenderTargets transients;
+
     std::unique_ptr<Internal::SignalGenerator> signalGenerator;
     std::unique_ptr<Internal::SignalDecoder> signalDecoder;
     std::unique_ptr<Internal::RGBToCRT> rgbToCRT;
+    std::unique_ptr<ICommandList> commandList;
+
+    // These are only used with the decoded frame cache or a pipeline latency of 1: commandList then only has the CRT
+    //  commands, and the generator and decoder ones are in decodeCommandList.
+    std::unique_ptr<ICommandList> decodeCommandList;
+    std::shared_ptr<IShader> copyShader;
+    Internal::DecodedFrameCache decodedFrameCache;
+
+    // Without the decoded frame cache, frames get decoded into these, alternating between them.
+    std::unique_ptr<IRenderTarget> pipelinedFrames[2];
+    uint32_t nextPipelinedFrameIndex = 0;
+
+    // With a pipeline latency of 1, this is the decoded frame (and its scanline type) that the next call to Render
+    //  shows, or nullptr if there isn't one.
+    IRenderTarget *pendingFrame = nullptr;
+    ScanlineType pendingScanlineType = ScanlineType::Progressive;
+
+    // These are only used for slices. When the commands are recorded for them, commandList only has the commands that
+    //  render the output, and the rest of the CRT commands are in these.
+    CommandLayout commandLayout = CommandLayout::WholeFrame;
+    std::unique_ptr<ICommandList> sliceRGBRowsCommandList;
+    std::unique_ptr<ICommandList> sliceFinishCommandList;
+
+    // The frame that's in the middle of being rendered in slices (if any): where its rows come from, the texture that
+    //  its rows are decoded into (nullptr for RGB input, which is used directly), how many of its RGB rows and output
+    //  rows are done, and how many of its RGB rows the passes in sliceRGBRowsCommandList have been run over.
+    bool sliceFrameInProgress = false;
+    SliceSource slicedFrameSource = SliceSource::Input;
+    IRenderTarget *slicedFrame = nullptr;
+    ScanlineType slicedScanlineType = ScanlineType::Progressive;
+    uint32_t sliceRGBRowCount = 0;
+    uint32_t sliceBlurRowCount = 0;
+    uint32_t sliceOutputRowCount = 0;
+
+    // The input texture that StreamScanlines uploads its scanlines into.
+    std::unique_ptr<Internal::StreamedTexture> streamedInput;
+
+    // The textures that StreamSignalScanlines uploads the signal and its phases into, and the signal's levels.
+    std::unique_ptr<Internal::StreamedTexture> externalSignal;
+    std::unique_ptr<Internal::StreamedTexture> externalPhases;
+    SignalLevels externalSignalLevels;
+
+    // With a signal recorder, the render targets that each frame's signal and phases get copied into, and the CPU
+    //  copies of them that get handed to it.
+    std::unique_ptr<IRenderTarget> recordedSignal;
+    std::unique_ptr<IRenderTarget> recordedPhases;
+    std::vector<float> recordedSignalTexels;
+    std::vector<float> recordedPhaseTexels;
   };
 };
\ No newline at end of file
@@ -3,7 +3,13 @@
 // Note that most of these things use D3D terminology, since that's my standard reference frame.
 #pragma once
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <utility>
+#include <vector>
 
 namespace CathodeRetro
 {
@@ -50,13 +56,16 @@ namespace CathodeRetro
     Generator_GeneratePhaseTexture,                 // cathode-retro-generator-gen-phase.hlsl
     Generator_RGBToSVideoOrComposite,               // cathode-retro-generator-rgb-to-svideo-or-compsite.hlsl
     Generator_ApplyArtifacts,                       // cathode-retro-generator-apply-artifacts.hlsl
+    Generator_RGBToSignalWithArtifacts,             // cathode-retro-generator-rgb-to-signal-with-artifacts.hlsl
 
     Decoder_CompositeToSVideo,                      // cathode-retro-decoder-composite-to-svideo.hlsl
     Decoder_SVideoToModulatedChroma,                // cathode-retro-decoder-svideo-to-modulated-chroma.hlsl
     Decoder_SVideoToRGB,                            // cathode-retro-decoder-svideo-to-rgb.hlsl
     Decoder_FilterRGB,                              // cathode-retro-decoder-filter-rgb.hlsl
+    Decoder_CompositeToRGB,                         // cathode-retro-decoder-composite-to-rgb.hlsl
 
     CRT_GenerateScreenTexture,                      // cathode-retro-crt-generate-screen-texture.hlsl
+    CRT_GenerateDistortionLUT,                      // cathode-retro-crt-generate-distortion-lut.hlsl
     CRT_GenerateSlotMask,                           // cathode-retro-crt-generate-slot-mask.hlsl
     CRT_GenerateShadowMask,                         // cathode-retro-crt-generate-shadow-mask.hlsl
     CRT_GenerateApertureGrille,                     // cathode-retro-crt-generate-aperture-grille.hlsl
@@ -64,18 +73,119 @@ namespace CathodeRetro
   };
 
 
+  // These are the logical stages of the Cathode Retro pipeline. Every RenderQuad call that Cathode Retro makes happens
+  //  between an IGraphicsDevice::BeginPass/EndPass pair for one of these, so that the device can tell which stage it
+  //  is doing work for (for timing, debug markers, etc).
+  enum class PassID
+  {
+    Generator,                                      // SignalGenerator: phases, the clean signal, and artifacts
+    Decoder,                                        // SignalDecoder: decoding the signal back into RGB
+    CRT_MaskTexture,                                // RGBToCRT: the mask texture and its mips (on mask type change)
+    CRT_ScreenTexture,                              // RGBToCRT: screen texture/distortion LUT (on settings/size change)
+    CRT_Diffusion,                                  // RGBToCRT: tonemapping and blurring for the diffusion effect
+    CRT_RGBToCRT,                                   // RGBToCRT: the final CRT render (and previous frame copy)
+
+    Count,
+  };
+
+
+  inline const char *PassName(PassID pass)
+  {
+    switch (pass)
+    {
+    case PassID::Generator: return "Generator";
+    case PassID::Decoder: return "Decoder";
+    case PassID::CRT_MaskTexture: return "CRT_MaskTexture";
+    case PassID::CRT_ScreenTexture: return "CRT_ScreenTexture";
+    case PassID::CRT_Diffusion: return "CRT_Diffusion";
+    case PassID::CRT_RGBToCRT: return "CRT_RGBToCRT";
+    case PassID::Count: break;
+    }
+
+    return "Unknown";
+  }
+
+
+  // Per-pass timings of a single frame, as measured by the graphics device. Passes that did not run during the frame
+  //  (like the mask and screen texture passes, which only run when settings change) have a time of 0.
+  struct FrameStats
+  {
+    // This is false if the device does not measure timings (or does not have any results yet).
+    bool isValid = false;
+    float passMilliseconds[size_t(PassID::Count)] = {};
+
+    float TotalMilliseconds() const
+    {
+      float total = 0.0f;
+      for (float ms : passMilliseconds)
+      {
+        total += ms;
+      }
+
+      return total;
+    }
+  };
+
+
   // Cathode Retro uses standard RGBA_Unorm8 textures (the component ordering doesn't matter so if an API/platform
   //  needs it to be BGRA or the like, that is totally fine), as well as 1- 2- and 4-component float textures (for the
-  //  generated signal data)
+  //  generated signal data). The 16-bit float formats are only used for the signal data when the pipeline is set to
+  //  SignalPrecision::Float16.
   enum class TextureFormat
   {
     RGBA_Unorm8,
     R_Float32,
     RG_Float32,
     RGBA_Float32,
+    R_Float16,
+    RG_Float16,
+    RGBA_Float16,
   };
 
 
+  // The number of bytes that a single texel of the given format takes up.
+  inline uint32_t TexelByteCount(TextureFormat format)
+  {
+    switch (format)
+    {
+    case TextureFormat::RGBA_Unorm8: return 4;
+    case TextureFormat::R_Float32: return 4;
+    case TextureFormat::RG_Float32: return 8;
+    case TextureFormat::RGBA_Float32: return 16;
+    case TextureFormat::R_Float16: return 2;
+    case TextureFormat::RG_Float16: return 4;
+    case TextureFormat::RGBA_Float16: return 8;
+    }
+
+    return 0;
+  }
+
+
+  // The number of mip levels that a texture of the given size has when it's created with a mip count of 0 (meaning
+  //  "all mip levels").
+  inline uint32_t FullMipCount(uint32_t width, uint32_t height)
+    { return 1 + uint32_t(std::floor(std::log2(float(std::max(width, height))))); }
+
+
+  // The number of bytes that a render target with the given properties takes up when its mip levels are tightly packed
+  //  one after another. This is the size that Cathode Retro reserves for a render target in an IRenderTargetMemory.
+  inline size_t RenderTargetByteCount(uint32_t width, uint32_t height, uint32_t mipCount, TextureFormat format)
+  {
+    if (mipCount == 0)
+    {
+      mipCount = FullMipCount(width, height);
+    }
+
+    size_t byteCount = 0;
+    for (uint32_t mip = 0; mip < mipCount; mip++)
+    {
+      byteCount += size_t(std::max(1U, width >> mip)) * std::max(1U, height >> mip) * TexelByteCount(format);
+    }
+
+    return byteCount;
+  }
+
+
   // This interface represents a wrapper around a texture, as you might have guessed. It exposes a few metrics for
   //  Cathode Retro to query.
   class ITexture
@@ -116,6 +226,8 @@ namespace CathodeRetro
   //  mip levels should be samplable (using linear or, more ideally, anisotropic mip level filtering)
   struct ShaderResourceView
   {
+    ShaderResourceView() = default;
+
     ShaderResourceView(const ITexture *tex, SamplerType samp)
       : texture(tex)
       , samplerType(samp)
@@ -127,14 +239,20 @@ namespace CathodeRetro
       , samplerType(samp)
       { }
 
-    const ITexture *texture;
+    const ITexture *texture = nullptr;
     int32_t mipLevel = -1;
-    SamplerType samplerType;
+    SamplerType samplerType = SamplerType::LinearClamp;
   };
 
 
   // This represents a view output of a shader. It has a texture and an optional target mipmap level. If no mipmap
   //  level is specified, it will render to the largest mip level.
+  // It can also be restricted to a rectangle of texels of that mip level, in which case only the rows [firstRow,
+  //  firstRow + rowCount) of the columns [firstColumn, firstColumn + columnCount) get written (a rowCount of 0 means
+  //  every row, and a columnCount of 0 means every column, so a band of whole rows only needs the first two). Nothing
+  //  else about the render changes: the shader sees the same texture coordinates that it would for the whole target,
+  //  so rendering a target one rectangle at a time gives the same result as rendering all of it at once. Row 0 is the
+  //  v = 0 edge of the texture, and column 0 is the u = 0 edge.
   struct RenderTargetView
   {
     RenderTargetView(IRenderTarget *tex, uint32_t mip = 0)
@@ -142,8 +260,142 @@ namespace CathodeRetro
       , mipLevel(int32_t(mip))
       { }
 
+    RenderTargetView(IRenderTarget *tex, uint32_t mip, uint32_t firstRowIn, uint32_t rowCountIn)
+      : texture(tex)
+      , mipLevel(int32_t(mip))
+      , firstRow(firstRowIn)
+      , rowCount(rowCountIn)
+      { }
+
+    RenderTargetView(
+      IRenderTarget *tex,
+      uint32_t mip,
+      uint32_t firstRowIn,
+      uint32_t rowCountIn,
+      uint32_t firstColumnIn,
+      uint32_t columnCountIn)
+      : texture(tex)
+      , mipLevel(int32_t(mip))
+      , firstRow(firstRowIn)
+      , rowCount(rowCountIn)
+      , firstColumn(firstColumnIn)
+      , columnCount(columnCountIn)
+      { }
+
     IRenderTarget *texture;
     uint32_t mipLevel = 0;
+    uint32_t firstRow = 0;
+    uint32_t rowCount = 0;
+    uint32_t firstColumn = 0;
+    uint32_t columnCount = 0;
+  };
+
+
+  // A block of memory that a device can place multiple render targets into (see
+  //  IGraphicsDevice::CreateRenderTargetMemory). Cathode Retro uses these for its intermediate render targets, placing
+  //  any whose contents are never needed at the same time in the same bytes.
+  class IRenderTargetMemory
+  {
+  public:
+    virtual ~IRenderTargetMemory() = default;
+
+    // Create a render target whose texel data lives at the given byte offset into this memory. The render target
+    //  takes up RenderTargetByteCount bytes from there (the offset is always a multiple of 256), and this memory
+    //  outlives it.
+    virtual std::unique_ptr<IRenderTarget> CreateRenderTarget(
+      size_t byteOffset,
+      uint32_t width,
+      uint32_t height,
+      uint32_t mipCount, // 0 means "all mip levels"
+      TextureFormat format) = 0;
+  };
+
+
+  // The memory used by the intermediate render targets of the most recently recorded set of passes. Every one of these
+  //  is only needed for part of a frame, so those whose lifetimes don't overlap can share memory.
+  struct TransientMemoryStats
+  {
+    // How many intermediate render targets the pipeline has, and how many bytes they would take up if each had its
+    //  own memory (which is how they used to be allocated).
+    uint32_t renderTargetCount = 0;
+    size_t unaliasedByteCount = 0;
+
+    // How many of those are used by the recorded passes, and the number of bytes that actually back them.
+    uint32_t usedRenderTargetCount = 0;
+    size_t aliasedByteCount = 0;
+
+    // This is true if the device supports IRenderTargetMemory, so intermediates of any size and format can share
+    //  memory. Otherwise only intermediates with identical dimensions and formats can share a render target.
+    bool usesRenderTargetMemory = false;
+  };
+
+
+  // A single command in a recorded command list: either a pass marker or a RenderQuad call (with its inputs stored
+  //  inline rather than in an initializer_list). A command list is recorded once and replayed every frame, so it can't
+  //  refer to the frame's input texture or output target directly - instead, any input whose bit is set in
+  //  frameInputMask (and the output, if outputIsFrameOutput is set) is bound to the textures passed to Execute.
+  struct RecordedCommand
+  {
+    enum class Type
+    {
+      BeginPass,
+      EndPass,
+      RenderQuad,
+    };
+
+    static constexpr uint32_t k_maxInputs = 5;
+
+    Type type = Type::RenderQuad;
+    PassID pass = PassID::Generator;
+
+    IShader *shader = nullptr;
+    RenderTargetView output = {nullptr};
+    ShaderResourceView inputs[k_maxInputs];
+    uint32_t inputCount = 0;
+    IConstantBuffer *constantBuffer = nullptr;
+
+    uint32_t frameInputMask = 0;
+    bool outputIsFrameOutput = false;
+  };
+
+
+  // A recorded sequence of passes and RenderQuad calls, created by IGraphicsDevice::CreateCommandList. Cathode Retro
+  //  records one whenever its settings change and then executes it every frame, so the only per-frame work outside of
+  //  it is updating the contents of the constant buffers that it uses.
+  class ICommandList
+  {
+  public:
+    virtual ~ICommandList() = default;
+
+    // Run every recorded command (this is called between BeginRendering and EndRendering), using the given textures
+    //  for any of the commands that read the frame's input or write to its output.
+    virtual void Execute(const ITexture *frameInput, IRenderTarget *frameOutput) = 0;
+
+    // Run every recorded command like Execute does, except that each RenderQuad only writes the rows [firstRow,
+    //  firstRow + rowCount) of its output, as if its RenderTargetView had that row band (a rowCount of 0 means every
+    //  row, just like Execute), and any column range that a command's output has still applies. Cathode Retro only
+    //  does this when the band's rows come out the same as they would from Execute: either the passes each only read
+    //  the rows of their inputs that they're writing, or (for CathodeRetro::RenderSlice) the rows that they read
+    //  outside of the band are already up to date. The default implementation just calls Execute, which is slower
+    //  but gives the same results for those rows.
+    virtual void ExecuteRows(
+      const ITexture *frameInput,
+      IRenderTarget *frameOutput,
+      uint32_t firstRow,
+      uint32_t rowCount)
+      { (void)firstRow; (void)rowCount; Execute(frameInput, frameOutput); }
+  };
+
+
+  // One of the command lists given to IGraphicsDevice::ExecuteConcurrently, along with the arguments to execute it with
+  //  (as for ICommandList::ExecuteRows, a rowCount of 0 means every row).
+  struct CommandListExecution
+  {
+    ICommandList *commandList = nullptr;
+    const ITexture *frameInput = nullptr;
+    IRenderTarget *frameOutput = nullptr;
+    uint32_t firstRow = 0;
+    uint32_t rowCount = 0;
   };
 
 
@@ -172,6 +424,9 @@ namespace CathodeRetro
     // Cathode Retro specifically wants no alpha blending or testing enabled. Additionally, it expects floating-point
     //  textures to be able to use the full range of values, so if the API allows for truncating floating-point values
     //  to the 0..1 range on either shader output or sampling input, that should be disabled.
+    // Cathode Retro may create resources (render targets, textures, constant buffers, and shaders) between
+    //  BeginRendering and EndRendering, whenever its intermediate render targets get reallocated, so a device needs to
+    //  allow that.
     virtual void BeginRendering() = 0;
 
     // Render a quad using the given objects.
@@ -184,6 +439,185 @@ namespace CathodeRetro
     // This is called when Cathode Retro is done rendering, and is a good spot for render state to be restored back to
     //  whatever the enclosing app expects (i.e. if it's a game, the game probably has its own standard state setup).
     virtual void EndRendering() = 0;
+
+    // These are optional, and are called (between BeginRendering and EndRendering) around each logical stage of the
+    //  pipeline. Passes do not nest. A device can use them to time each stage (using timer queries or CPU timestamps,
+    //  say) or to emit debug markers.
+    virtual void BeginPass(PassID pass)
+      { (void)pass; }
+
+    virtual void EndPass()
+      { }
+
+    // Also optional: fill in the per-pass timings of the most recent frame that the device has results for (which, for
+    //  GPU timings, is usually a few frames behind the current one). Return false if timings are not available.
+    virtual bool GetFrameStats(FrameStats *statsOut)
+      { (void)statsOut; return false; }
+
+    // Also optional: turn a recorded list of commands into an ICommandList. The default implementation just replays
+    //  the commands through BeginPass/EndPass/RenderQuad, but a device can override this to resolve as much of each
+    //  command up front as it can (framebuffers, views, samplers, kernel pointers, etc) so that executing the list
+    //  every frame does less work than making the equivalent RenderQuad calls would.
+    virtual std::unique_ptr<ICommandList> CreateCommandList(std::vector<RecordedCommand> commands);
+
+    // Also optional: execute two command lists (both created by CreateCommandList) whose commands don't depend on each
+    //  other - neither one writes to a render target that the other one uses - so they can run in any order, or
+    //  overlapped. Cathode Retro uses this (with a pipeline latency of 1, see CathodeRetro::SetPipelineLatency) to run
+    //  the generator and decoder passes of one frame alongside the CRT passes of the previous one. The default
+    //  implementation just executes first and then second.
+    virtual void ExecuteConcurrently(const CommandListExecution &first, const CommandListExecution &second)
+    {
+      for (const CommandListExecution *execution : { &first, &second })
+      {
+        execution->commandList->ExecuteRows(
+          execution->frameInput,
+          execution->frameOutput,
+          execution->firstRow,
+          execution->rowCount);
+      }
+    }
+
+    // Also optional: create a block of memory that multiple render targets can be placed into. Return nullptr (which is
+    //  what the default implementation does) if the device doesn't support this, in which case intermediate render
+    //  targets can still be shared, but only between uses with identical dimensions and formats.
+    virtual std::unique_ptr<IRenderTargetMemory> CreateRenderTargetMemory(size_t byteCount)
+      { (void)byteCount; return nullptr; }
+
+    // Also optional: create a (single-mip) streaming texture, whose contents are replaced from the CPU using
+    //  UpdateTexture (potentially every frame) rather than by rendering into it. Cathode Retro uses these for textures
+    //  that it computes on the CPU, and apps can use them for their emulator frames. Return nullptr (which is what the
+    //  default implementation does) if the device doesn't support this, in which case Cathode Retro renders those
+    //  textures instead.
+    virtual std::unique_ptr<ITexture> CreateStreamingTexture(uint32_t width, uint32_t height, TextureFormat format)
+      { (void)width; (void)height; (void)format; return nullptr; }
+
+    // Replace the contents of a texture that came from CreateStreamingTexture with the given texels (in the texture's
+    //  format, starting with the row at the v = 0 edge of the texture), where each row starts rowPitch bytes after the
+    //  start of the previous one. rowPitch can be larger than the width of the texture (to skip padding at the end
+    //  of each row) or negative (to read the rows bottom-up).
+    // This can be called any time outside of the execution of a frame's commands, and the next commands that read the
+    //  texture need to see the new contents. It should neither allocate nor wait on the GPU to finish with earlier
+    //  contents, so devices with asynchronous GPUs should keep a small ring of staging buffers to copy the texels into.
+    virtual void UpdateTexture(ITexture *texture, const void *texels, ptrdiff_t rowPitch)
+      { (void)texture; (void)texels; (void)rowPitch; }
+
+    // Also optional: like UpdateTexture, but only replace the rows [firstRow, firstRow + rowCount) of the texture
+    //  (with texels pointing at the first of those rows), leaving the rest of its contents alone. Cathode Retro uses
+    //  this to upload the scanlines given to CathodeRetro::StreamScanlines as they come in. Return false (which is
+    //  what the default implementation does) if the device can't update part of a texture, in which case Cathode
+    //  Retro keeps its own copy of the texels and updates the whole texture from that instead.
+    virtual bool UpdateTextureRows(
+      ITexture *texture,
+      uint32_t firstRow,
+      uint32_t rowCount,
+      const void *texels,
+      ptrdiff_t rowPitch)
+      { (void)texture; (void)firstRow; (void)rowCount; (void)texels; (void)rowPitch; return false; }
+
+    // Also optional: create a texture (with the given number of mip levels) whose contents are given up front and never
+    //  change, as the texels of each mip level (tightly packed, starting with the row at the v = 0 edge) one after
+    //  another, largest first. Cathode Retro uses this to upload prebuilt textures from an AssetPack. Return nullptr
+    //  (which is what the default implementation does) if the device doesn't support this, in which case Cathode Retro
+    //  renders those textures instead.
+    virtual std::unique_ptr<ITexture> CreateStaticTexture(
+      uint32_t width,
+      uint32_t height,
+      uint32_t mipCount,
+      TextureFormat format,
+      const void *texels)
+      { (void)width; (void)height; (void)mipCount; (void)format; (void)texels; return nullptr; }
+
+    // Also optional: copy the texels of the top mip level of the given render target into texelsOut (tightly packed,
+    //  starting with the row at the v = 0 edge), returning false (which is what the default implementation does) if
+    //  the device doesn't support reading render targets back. This is allowed to wait for the GPU to finish rendering
+    //  to the render target, so Cathode Retro only uses it to save generated screen textures to an
+    //  IScreenTextureStore (see CathodeRetro/ScreenTextureStore.h), which only happens if the app gives it one.
+    virtual bool ReadRenderTarget(const IRenderTarget *renderTarget, void *texelsOut)
+      { (void)renderTarget; (void)texelsOut; return false; }
   };
+
+
+  // The default ICommandList, which feeds each recorded command back through the graphics device's own methods.
+  class ReplayCommandList : public ICommandList
+  {
+  public:
+    ReplayCommandList(IGraphicsDevice *deviceIn, std::vector<RecordedCommand> commandsIn)
+      : device(deviceIn)
+      , commands(std::move(commandsIn))
+      { }
+
+    void Execute(const ITexture *frameInput, IRenderTarget *frameOutput) override
+      { ExecuteRows(frameInput, frameOutput, 0, 0); }
+
+
+    void ExecuteRows(
+      const ITexture *frameInput,
+      IRenderTarget *frameOutput,
+      uint32_t firstRow,
+      uint32_t rowCount) override
+    {
+      for (const RecordedCommand &command : commands)
+      {
+        switch (command.type)
+        {
+        case RecordedCommand::Type::BeginPass:
+          device->BeginPass(command.pass);
+          break;
+
+        case RecordedCommand::Type::EndPass:
+          device->EndPass();
+          break;
+
+        case RecordedCommand::Type::RenderQuad:
+          {
+            RenderTargetView output = command.output;
+            if (command.outputIsFrameOutput)
+            {
+              output.texture = frameOutput;
+            }
+
+            if (rowCount != 0)
+            {
+              output.firstRow = firstRow;
+              output.rowCount = rowCount;
+            }
+
+            ShaderResourceView in[RecordedCommand::k_maxInputs];
+            for (uint32_t i = 0; i < command.inputCount; i++)
+            {
+              in[i] = command.inputs[i];
+              if ((command.frameInputMask & (1u << i)) != 0)
+              {
+                in[i].texture = frameInput;
+              }
+            }
+
+            IShader *ps = command.shader;
+            IConstantBuffer *cb = command.constantBuffer;
+            switch (command.inputCount)
+            {
+            case 0: device->RenderQuad(ps, output, {}, cb); break;
+            case 1: device->RenderQuad(ps, output, {in[0]}, cb); break;
+            case 2: device->RenderQuad(ps, output, {in[0], in[1]}, cb); break;
+            case 3: device->RenderQuad(ps, output, {in[0], in[1], in[2]}, cb); break;
+            case 4: device->RenderQuad(ps, output, {in[0], in[1], in[2], in[3]}, cb); break;
+            default: device->RenderQuad(ps, output, {in[0], in[1], in[2], in[3], in[4]}, cb); break;
+            }
+          }
+          break;
+        }
+      }
+    }
+
+  private:
+    IGraphicsDevice *device;
+    std::vector<RecordedCommand> commands;
+  };
+
+
+  inline std::unique_ptr<ICommandList> IGraphicsDevice::CreateCommandList(std::vector<RecordedCommand> commands)
+  {
+    return std::make_unique<ReplayCommandList>(this, std::move(commands));
+  }
 }
 
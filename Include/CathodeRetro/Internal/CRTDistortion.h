@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "CathodeRetro/Settings.h"
+
+
+namespace CathodeRetro
+{
+  namespace Internal
+  {
+    // A CPU version of DistortCRTCoordinates (from cathode-retro-crt-distort-coordinates.hlsli), which does the barrel
+    //  distortion of a [-1..1] texture coordinate that emulates a curved CRT screen. See the shader for the derivation.
+    // RGBToCRT uses this to work out which rows of the RGB input each output row reads (for rendering in slices), and
+    //  the software sample's port of the shaders uses it as well, so if the shader changes this needs to change too.
+    inline Vec2 DistortCRTCoordinates(Vec2 texCoord, Vec2 distortion)
+    {
+      if (distortion.x == 0.0f && distortion.y == 0.0f)
+      {
+        return texCoord;
+      }
+
+      constexpr float k_distance = 2.0f;
+      constexpr float k_minDistortion = 0.0001f;
+
+      distortion.x = std::max(k_minDistortion, distortion.x);
+      distortion.y = std::max(k_minDistortion, distortion.y);
+
+      auto approxAtan2 = [](float x, float y)
+      {
+        x /= y;
+        float x2 = x * x;
+        return x * (1.0f + x2 * (x2 * 0.2f - 0.333333333f));
+      };
+
+      // Hit the unit sphere with the ray from (0, 0, -k_distance) and turn the hit point into a latitude/longitude.
+      Vec2 ray = { texCoord.x * distortion.x, texCoord.y * distortion.y };
+      float rayLenSq = ray.x * ray.x + ray.y * ray.y + k_distance * k_distance;
+      float b = (k_distance * k_distance) / rayLenSq;
+      float c = (k_distance * k_distance - 1.0f) / rayLenSq;
+      float t = b - std::sqrt(std::max(0.0f, b * b - c));
+      float rayZ = k_distance - k_distance * t;
+
+      // Do the same for the rays pointing all the way to the right and all the way down, to get the extents.
+      auto maxUV = [&](float d)
+      {
+        float maxRayLenSq = d * d + k_distance * k_distance;
+        float maxB = (k_distance * k_distance) / maxRayLenSq;
+        float maxC = (k_distance * k_distance - 1.0f) / maxRayLenSq;
+        float maxT = maxB - std::sqrt(std::max(0.0f, maxB * maxB - maxC));
+        return approxAtan2(d * maxT, k_distance - k_distance * maxT);
+      };
+
+      return {
+        approxAtan2(ray.x * t, rayZ) / maxUV(distortion.x),
+        approxAtan2(ray.y * t, rayZ) / maxUV(distortion.y) };
+    }
+  }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cassert>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+#include "CathodeRetro/GraphicsDevice.h"
+
+
+namespace CathodeRetro
+{
+  namespace Internal
+  {
+    // This collects the per-frame passes of the pipeline into a list of RecordedCommands (to hand to
+    //  IGraphicsDevice::CreateCommandList). Its methods mirror the IGraphicsDevice ones so that the recording code
+    //  reads just like the rendering code. The frame's input texture and output target aren't known while recording,
+    //  so the pipeline uses the FrameInput and FrameOutput placeholders in their place.
+    class CommandListRecorder
+    {
+    public:
+      const ITexture *FrameInput() const
+        { return &frameInputPlaceholder; }
+
+      IRenderTarget *FrameOutput()
+        { return &frameOutputPlaceholder; }
+
+
+      void BeginPass(PassID pass)
+      {
+        RecordedCommand command;
+        command.type = RecordedCommand::Type::BeginPass;
+        command.pass = pass;
+        commands.push_back(command);
+      }
+
+
+      void EndPass()
+      {
+        RecordedCommand command;
+        command.type = RecordedCommand::Type::EndPass;
+        commands.push_back(command);
+      }
+
+
+      void RenderQuad(
+        IShader *ps,
+        RenderTargetView output,
+        std::initializer_list<ShaderResourceView> inputs,
+        IConstantBuffer *constantBuffer = nullptr)
+      {
+        assert(inputs.size() <= RecordedCommand::k_maxInputs);
+
+        RecordedCommand command;
+        command.type = RecordedCommand::Type::RenderQuad;
+        command.shader = ps;
+        command.output = output;
+        command.constantBuffer = constantBuffer;
+
+        if (output.texture == &frameOutputPlaceholder)
+        {
+          command.output.texture = nullptr;
+          command.outputIsFrameOutput = true;
+        }
+
+        for (const ShaderResourceView &input : inputs)
+        {
+          ShaderResourceView &view = command.inputs[command.inputCount];
+          view = input;
+          if (input.texture == &frameInputPlaceholder)
+          {
+            view.texture = nullptr;
+            command.frameInputMask |= 1u << command.inputCount;
+          }
+
+          command.inputCount++;
+        }
+
+        commands.push_back(command);
+      }
+
+
+      // How many commands have been recorded so far.
+      size_t CommandCount() const
+        { return commands.size(); }
+
+
+      std::vector<RecordedCommand> TakeCommands()
+        { return std::move(commands); }
+
+    private:
+      // A stand-in for a texture that is only known at execution time. Nothing should ever actually query it.
+      class PlaceholderTexture : public IRenderTarget
+      {
+      public:
+        uint32_t Width() const override
+          { return 0; }
+
+        uint32_t Height() const override
+          { return 0; }
+
+        uint32_t MipCount() const override
+          { return 1; }
+
+        TextureFormat Format() const override
+          { return TextureFormat::RGBA_Unorm8; }
+      };
+
+      PlaceholderTexture frameInputPlaceholder;
+      PlaceholderTexture frameOutputPlaceholder;
+      std::vector<RecordedCommand> commands;
+    };
+  }
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "CathodeRetro/GraphicsDevice.h"
+
+
+namespace CathodeRetro
+{
+  namespace Internal
+  {
+    // This holds on to the decoded RGB frames of an input that isn't changing. With no noise or tracking instability,
+    //  the signal that gets generated (and so the RGB that gets decoded from it) for a given input only depends on the
+    //  phase that the frame starts at (and, with temporal artifact reduction, the phase that the previous frame
+    //  started at). Those cycle through at most SourceSettings::denominator values, so once each combination has been
+    //  decoded once, a static input doesn't need to go through the generator and decoder at all (and an input that
+    //  only changes in a few rows only needs those rows to go through them).
+    class DecodedFrameCache
+    {
+    public:
+      // Set the device and the size of the decoded frames, freeing any existing entries.
+      void SetFrameSize(IGraphicsDevice *deviceIn, uint32_t widthIn, uint32_t heightIn)
+      {
+        device = deviceIn;
+        width = widthIn;
+        height = heightIn;
+        entries.clear();
+      }
+
+
+      // Forget every cached frame (their render targets are kept around to decode new frames into).
+      void Invalidate()
+      {
+        for (Entry &entry : entries)
+        {
+          entry.isValid = false;
+        }
+      }
+
+
+      // Mark the given rows of every cached frame as out of date (because those rows of the input changed). Each
+      //  pass of the generator and decoder works along a single scanline, so only those rows need to be decoded again
+      //  the next time each frame gets used. Every frame keeps a single band of out-of-date rows, so this grows that
+      //  band to cover the given rows as well.
+      void MarkRowsChanged(uint32_t firstRow, uint32_t rowCount)
+      {
+        uint32_t endRow = uint32_t(std::min(uint64_t(firstRow) + rowCount, uint64_t(height)));
+        if (firstRow >= endRow)
+        {
+          return;
+        }
+
+        for (Entry &entry : entries)
+        {
+          if (entry.staleFirstRow == entry.staleEndRow)
+          {
+            entry.staleFirstRow = firstRow;
+            entry.staleEndRow = endRow;
+          }
+          else
+          {
+            entry.staleFirstRow = std::min(entry.staleFirstRow, firstRow);
+            entry.staleEndRow = std::max(entry.staleEndRow, endRow);
+          }
+        }
+      }
+
+
+      // Get the cached frame with the given phase key (taking over an invalid entry or creating a new one if there
+      //  isn't one yet), along with the band of its rows that are out of date and need to be decoded into it. Those
+      //  rows count as up to date from then on. A staleRowCountOut of 0 means that the frame is entirely up to date.
+      // An invalid entry whose texture is inUse (a frame that's still waiting to be shown) won't be taken over.
+      IRenderTarget *Get(
+        uint64_t key,
+        uint32_t *staleFirstRowOut,
+        uint32_t *staleRowCountOut,
+        const IRenderTarget *inUse = nullptr)
+      {
+        Entry *entry = nullptr;
+        for (Entry &candidate : entries)
+        {
+          if (candidate.isValid && candidate.key == key)
+          {
+            entry = &candidate;
+            break;
+          }
+        }
+
+        if (entry == nullptr)
+        {
+          for (Entry &candidate : entries)
+          {
+            if (!candidate.isValid && candidate.texture.get() != inUse)
+            {
+              entry = &candidate;
+              break;
+            }
+          }
+
+          if (entry == nullptr)
+          {
+            entries.push_back({});
+            entry = &entries.back();
+            entry->texture = device->CreateRenderTarget(width, height, 1, TextureFormat::RGBA_Unorm8);
+          }
+
+          entry->key = key;
+          entry->isValid = true;
+          entry->staleFirstRow = 0;
+          entry->staleEndRow = height;
+        }
+
+        *staleFirstRowOut = entry->staleFirstRow;
+        *staleRowCountOut = entry->staleEndRow - entry->staleFirstRow;
+        entry->staleFirstRow = 0;
+        entry->staleEndRow = 0;
+        return entry->texture.get();
+      }
+
+    private:
+      struct Entry
+      {
+        uint64_t key = 0;
+        std::unique_ptr<IRenderTarget> texture;
+        bool isValid = false;
+
+        // The band of rows [staleFirstRow, staleEndRow) is out of date.
+        uint32_t staleFirstRow = 0;
+        uint32_t staleEndRow = 0;
+      };
+
+      IGraphicsDevice *device = nullptr;
+      uint32_t width = 0;
+      uint32_t height = 0;
+      std::vector<Entry> entries;
+    };
+  }
+}
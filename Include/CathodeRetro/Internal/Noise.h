@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+
+namespace CathodeRetro
+{
+  namespace Internal
+  {
+    // These are C++ versions of cathode-retro-util-noise.hlsli and cathode-retro-util-tracking-instability.hlsli, for
+    //  CPU-side code that needs the same noise values that the shaders compute (the scanline phases, which include the
+    //  tracking instability, and the software sample's ports of the shaders).
+    inline float NoiseFrac(float v)
+      { return v - std::floor(v); }
+
+
+    inline float Noise2D(float x, float y, float iseed)
+    {
+      auto distance = [](float ax, float ay, float bx, float by)
+        { return std::sqrt((ax - bx) * (ax - bx) + (ay - by) * (ay - by)); };
+
+      float fseed = NoiseFrac(iseed / 10000.0f);
+      float angle = NoiseFrac(distance(x, y, 1000.0f * (fseed + 0.3f + 1.0f), 1000.0f * (0.1f + 1.0f)));
+      return NoiseFrac(
+        std::tan(angle) * distance(x, y, 1000.0f * (fseed + 0.1f - 2.0f), 1000.0f * (fseed + 0.2f - 2.0f)));
+    }
+
+
+    inline float Noise1D(float coord, float iseed)
+      { return Noise2D(coord, 0.0f, iseed); }
+
+
+    inline float CalculateTrackingInstabilityOffset(
+      uint32_t scanlineIndex,
+      uint32_t noiseSeed,
+      float scale,
+      uint32_t signalTextureWidth)
+    {
+      return (Noise1D(float(scanlineIndex), float(noiseSeed)) - 0.5f) * scale / float(signalTextureWidth);
+    }
+  }
+}
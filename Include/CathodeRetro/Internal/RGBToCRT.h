@@ -4,10 +4,18 @@
 #include <cassert>
 #include <cinttypes>
 #include <cmath>
+#include <cstring>
 #include <utility>
+#include <vector>
 
+#include "CathodeRetro/Internal/CommandListRecorder.h"
+#include "CathodeRetro/Internal/CRTDistortion.h"
+#include "CathodeRetro/Internal/ScreenTextureCache.h"
+#include "CathodeRetro/Internal/TransientRenderTargets.h"
 #include "CathodeRetro/GraphicsDevice.h"
+#include "CathodeRetro/ScreenTextureStore.h"
 #include "CathodeRetro/Settings.h"
+#include "CathodeRetro/SharedResources.h"
 
 
 namespace CathodeRetro
@@ -19,49 +27,55 @@ namespace CathodeRetro
     class RGBToCRT
     {
     public:
+      static constexpr uint32_t k_defaultScreenTextureRegenerationFrameCount = 8;
+
+      // Where the commands that RecordCommands records get split up for rendering a frame in slices (as command
+      //  indices in the recorder): the ones before outputBegin work on rows of the RGB input (the diffusion blur), the
+      //  ones from there up to finishBegin render the output, and the rest finish off the frame (once every row of the
+      //  RGB input is done).
+      struct SliceSplits
+      {
+        size_t outputBegin = 0;
+        size_t finishBegin = 0;
+      };
+
       RGBToCRT(
         IGraphicsDevice *deviceIn,
+        SharedResources *sharedResourcesIn,
+        TransientRenderTargets *transientsIn,
         uint32_t originalInputImageWidthIn,
         uint32_t processedRGBTextureWidthIn,
         uint32_t scanlineCountIn,
         float pixelAspectIn)
       : device(deviceIn)
+      , sharedResources(sharedResourcesIn)
+      , transients(transientsIn)
       , originalInputImageWidth(originalInputImageWidthIn)
       , processedRGBTextureWidth(processedRGBTextureWidthIn)
       , scanlineCount(scanlineCountIn)
       , pixelAspect(pixelAspectIn)
       {
-        rgbToScreenShader = device->CreateShader(ShaderID::CRT_RGBToCRT);
-        generateScreenTextureShader = device->CreateShader(ShaderID::CRT_GenerateScreenTexture);
-        copyShader = device->CreateShader(ShaderID::Util_Copy);
-        downsample2XShader = device->CreateShader(ShaderID::Util_Downsample2X);
-        gaussianBlurShader = device->CreateShader(ShaderID::Util_GaussianBlur13);
-        toneMapShader = device->CreateShader(ShaderID::Util_TonemapAndDownsample);
-        generateSlotMaskShader = device->CreateShader(ShaderID::CRT_GenerateSlotMask);
-        generateShadowMaskShader = device->CreateShader(ShaderID::CRT_GenerateShadowMask);
-        generateApertureGrilleShader = device->CreateShader(ShaderID::CRT_GenerateApertureGrille);
+        rgbToScreenShader = sharedResources->Shader(ShaderID::CRT_RGBToCRT);
+        generateScreenTextureShader = sharedResources->Shader(ShaderID::CRT_GenerateScreenTexture);
+        generateDistortionLUTShader = sharedResources->Shader(ShaderID::CRT_GenerateDistortionLUT);
+        copyShader = sharedResources->Shader(ShaderID::Util_Copy);
+        downsample2XShader = sharedResources->Shader(ShaderID::Util_Downsample2X);
+        gaussianBlurShader = sharedResources->Shader(ShaderID::Util_GaussianBlur13);
+        toneMapShader = sharedResources->Shader(ShaderID::Util_TonemapAndDownsample);
 
         screenTextureConstantBuffer = device->CreateConstantBuffer(sizeof(ScreenTextureConstants));
+        distortionLUTConstantBuffer = device->CreateConstantBuffer(sizeof(CommonConstants));
         rgbToScreenConstantBuffer = device->CreateConstantBuffer(sizeof(RGBToScreenConstants));
         toneMapConstantBuffer = device->CreateConstantBuffer(sizeof(ToneMapConstants));
         blurDownsampleConstantBuffer = device->CreateConstantBuffer(sizeof(Vec2));
         gaussianBlurConstantBufferH = device->CreateConstantBuffer(sizeof(GaussianBlurConstants));
         gaussianBlurConstantBufferV = device->CreateConstantBuffer(sizeof(GaussianBlurConstants));
-        generateMaskConstantBuffer = device->CreateConstantBuffer(sizeof(Vec2));
-        maskDownsampleConstantBufferH = device->CreateConstantBuffer(sizeof(Vec2));
-        maskDownsampleConstantBufferV = device->CreateConstantBuffer(sizeof(Vec2));
 
         prevRGBInput = device->CreateRenderTarget(
           processedRGBTextureWidth,
           scanlineCount,
           1,
           TextureFormat::RGBA_Unorm8);
-        maskTexture = device->CreateRenderTarget(k_maskSize, k_maskSize / 2, 0, TextureFormat::RGBA_Unorm8);
-        halfWidthMaskTexture = device->CreateRenderTarget(
-          k_maskSize / 2,
-          k_maskSize / 2,
-          0,
-          TextureFormat::RGBA_Unorm8);
 
         needsRenderMaskTexture = true;
         UpdateBlurTextures();
@@ -82,62 +96,243 @@ namespace CathodeRetro
 
           UpdateBlurTextures();
           needsRenderScreenTexture = true;
+          commandsOutOfDate = true;
         }
       }
 
 
-      void SetOutputSize(uint32_t outputWidth, uint32_t outputHeight)
+      void SetOutputSize(uint32_t outputWidthIn, uint32_t outputHeightIn)
       {
-        if (screenTexture == nullptr
-          || screenTexture->Width() != outputWidth
-          || screenTexture->Height() != outputHeight)
+        if (outputWidthIn != outputWidth || outputHeightIn != outputHeight)
         {
-          // Rebuild the texture at the correct resolution
-          screenTexture = device->CreateRenderTarget(outputWidth, outputHeight, 1, TextureFormat::RGBA_Unorm8);
+          // The screen texture gets rebuilt at the new resolution by RenderStaticTextures (and until it's done, the
+          //  old one keeps getting used).
+          outputWidth = outputWidthIn;
+          outputHeight = outputHeightIn;
           needsRenderScreenTexture = true;
         }
       }
 
 
-      void Render(
-        const ITexture *currentFrameRGBInput,
-        IRenderTarget *outputTexture,
-        ScanlineType scanType)
+      // Set how many frames regenerating the screen texture gets spread out over (see RenderStaticTextures). 1 means
+      //  that it's always regenerated all at once.
+      void SetScreenTextureRegenerationFrameCount(uint32_t frameCount)
+        { screenTextureRegenerationFrameCount = std::max(1U, frameCount); }
+
+
+      // Keep up to this many bytes of recently used screen textures around (see ScreenTextureCache), so that switching
+      //  back to them is free.
+      void SetScreenTextureCacheBudget(size_t byteCount)
+        { screenTextureCache.SetByteBudget(byteCount); }
+
+
+      // Load screen textures from (and save newly generated ones to) the given store, if it's not null.
+      void SetScreenTextureStore(IScreenTextureStore *store)
+        { screenTextureStore = store; }
+
+
+      // Update the distortion LUT and the screen texture (and the mask texture that it's generated from) if they need
+      //  it. These only change along with the settings (or output size), so rather than being part of the recorded
+      //  per-frame commands they're rendered directly, as needed. The mask texture comes from the shared resources, so
+      //  it only actually gets rendered if no other instance is already using one of the same type.
+      // The distortion LUT is a single cheap pass, so it's always brought up to date right away.
+      // If the needed screen texture is the current one, is in the cache, or is in the store, there's nothing to
+      //  generate. Otherwise, generating it is expensive at high resolutions, so once there is a current one, the new
+      //  one is generated a band of rows at a time over the next few frames (into a separate render target) while the
+      //  frames keep using the old one, and only swapped in once it's complete.
+      void RenderStaticTextures()
       {
-        assert(screenTexture != nullptr);
+        assert(outputWidth != 0 && outputHeight != 0);
+
+        if (needsRenderScreenTexture)
+        {
+          needsRenderScreenTexture = false;
+
+          ScreenTextureConstants constants = CalculateScreenTextureConstants();
+          UpdateDistortionLUT(constants.common);
+
+          ScreenTextureKey key = MakeScreenTextureKey(constants);
+          if (screenTexture != nullptr && key == screenTextureKey)
+          {
+            // Whatever changed doesn't affect the screen texture (or it changed back before the new one was done).
+            pendingScreenTexture = nullptr;
+          }
+          else if (pendingScreenTexture != nullptr && key == pendingScreenTextureKey)
+          {
+            // This is the one that's already being generated, so let it keep going.
+          }
+          else if (std::unique_ptr<ITexture> texture = FindScreenTexture(key))
+          {
+            pendingScreenTexture = nullptr;
+            SwapInScreenTexture(std::move(texture), key);
+          }
+          else
+          {
+            // Start generating the new screen texture from the top (this also throws away a partially-generated one,
+            //  if the settings changed again before it finished).
+            if (pendingScreenTexture == nullptr
+              || pendingScreenTexture->Width() != outputWidth
+              || pendingScreenTexture->Height() != outputHeight)
+            {
+              pendingScreenTexture = device->CreateRenderTarget(
+                outputWidth,
+                outputHeight,
+                1,
+                TextureFormat::RGBA_Unorm8);
+            }
+
+            if (needsRenderMaskTexture)
+            {
+              maskTexture = sharedResources->MaskTexture(screenSettings.maskType);
+              needsRenderMaskTexture = false;
+            }
+
+            screenTextureConstantBuffer->Update(constants);
+            pendingScreenTextureKey = key;
+            pendingScreenTextureRow = 0;
+          }
+        }
 
-        if (needsRenderMaskTexture)
+        if (pendingScreenTexture != nullptr)
         {
-          RenderMaskTexture();
-          needsRenderMaskTexture = false;
+          device->BeginPass(PassID::CRT_ScreenTexture);
+          if (screenTexture == nullptr || screenTextureRegenerationFrameCount == 1)
+          {
+            // There's no old screen texture to show in the meantime (or we were asked not to spread it out), so it all
+            //  has to be generated now.
+            RenderScreenTextureRows({pendingScreenTexture.get()});
+            pendingScreenTextureRow = outputHeight;
+          }
+          else
+          {
+            uint32_t rowsPerFrame =
+              (outputHeight + screenTextureRegenerationFrameCount - 1) / screenTextureRegenerationFrameCount;
+            uint32_t rowCount = std::min(rowsPerFrame, outputHeight - pendingScreenTextureRow);
+            RenderScreenTextureRows({pendingScreenTexture.get(), 0, pendingScreenTextureRow, rowCount});
+            pendingScreenTextureRow += rowCount;
+          }
+
+          device->EndPass();
+
+          if (pendingScreenTextureRow == outputHeight)
+          {
+            SaveScreenTexture(pendingScreenTextureKey, pendingScreenTexture.get());
+            SwapInScreenTexture(std::move(pendingScreenTexture), pendingScreenTextureKey);
+          }
         }
+      }
 
-        if (needsRenderScreenTexture)
+
+      // This is true if the commands that RecordCommands would record have changed since it was last called.
+      bool CommandsOutOfDate() const
+        { return commandsOutOfDate; }
+
+
+      // Record the per-frame passes that take the RGB input to the CRT output. If sliceSplitsOut is given, each part
+      //  of the commands gets its own pass markers, so that they can be split up into separate command lists there.
+      void RecordCommands(
+        CommandListRecorder *commands,
+        const ITexture *currentFrameRGBInput,
+        IRenderTarget *outputTexture,
+        SliceSplits *sliceSplitsOut = nullptr)
+      {
+        assert(screenTexture != nullptr);
+
+        if (screenSettings.diffusionStrength > 0.0f)
         {
-          RenderScreenTexture();
-          needsRenderScreenTexture = false;
+          commands->BeginPass(PassID::CRT_Diffusion);
+          RenderBlur(commands, currentFrameRGBInput);
+          commands->EndPass();
         }
 
+        commands->BeginPass(PassID::CRT_RGBToCRT);
         if (isFirstFrame)
         {
-          isFirstFrame = false;
-          device->RenderQuad(
+          // There is no previous frame yet, so start it out as a copy of this one. This only happens once, so the
+          //  commands will need to be recorded again (without the copy) for the next frame.
+          commands->RenderQuad(
             copyShader.get(),
             prevRGBInput.get(),
             { { currentFrameRGBInput, SamplerType::LinearClamp } });
         }
 
+        if (sliceSplitsOut != nullptr)
+        {
+          commands->EndPass();
+          sliceSplitsOut->outputBegin = commands->CommandCount();
+          commands->BeginPass(PassID::CRT_RGBToCRT);
+        }
+
+        commands->RenderQuad(
+          rgbToScreenShader.get(),
+          outputTexture,
+          {
+            {currentFrameRGBInput, SamplerType::LinearClamp},
+            {prevRGBInput.get(), SamplerType::LinearClamp},
+            {screenTexture.get(), SamplerType::NearestClamp},
+            {blurTexture.get(), SamplerType::LinearClamp},
+            {distortionLUT.get(), SamplerType::NearestClamp},
+          },
+          rgbToScreenConstantBuffer.get());
+
+        if (sliceSplitsOut != nullptr)
+        {
+          commands->EndPass();
+          sliceSplitsOut->finishBegin = commands->CommandCount();
+          commands->BeginPass(PassID::CRT_RGBToCRT);
+        }
+
+        commands->RenderQuad(
+          copyShader.get(),
+          prevRGBInput.get(),
+          { { currentFrameRGBInput, SamplerType::LinearClamp } });
+        commands->EndPass();
+
+        commandsOutOfDate = isFirstFrame;
+        isFirstFrame = false;
+      }
+
+
+      // For rendering a frame in slices: get the number of rows at the top of the output that can be rendered once the
+      //  first rgbRowCount rows of the RGB input are done. Each output row reads the RGB input at its distorted texture
+      //  coordinates (see DistortCRTCoordinates), plus a few rows around those for the filtering and (with diffusion)
+      //  the blur, and the rows of the output are rendered in order, so this is the number of rows at the top whose
+      //  rows of the input (and those of every row above them) are all done.
+      uint32_t SliceOutputRowCount(uint32_t rgbRowCount)
+      {
+        if (rgbRowCount >= scanlineCount)
+        {
+          return outputHeight;
+        }
+
+        UpdateSliceRowMap();
+        return uint32_t(
+          std::upper_bound(sliceLastRGBRows.begin(), sliceLastRGBRows.end(), int32_t(rgbRowCount) - 1)
+            - sliceLastRGBRows.begin());
+      }
+
+
+      // For rendering a frame in slices: how many rows of the diffusion blur (counting up from the last RGB row that
+      //  it was run up to) can still change once the RGB rows below them are done, since the blur reaches into those.
+      static uint32_t SliceBlurRowReach()
+        { return uint32_t(k_sliceDiffusionRowMargin); }
+
+
+      // Update the constants for the current frame's passes.
+      void UpdateFrameConstants(ScanlineType scanType)
+      {
+        assert(outputWidth != 0 && outputHeight != 0);
+
         // Between 4k and 2k (2160p and 1080p vertical resolution) we want to scale up the effect of the scanlines
         //  and mask (up to a maximum of 1.0, which means that some higher values don't have any effect at 1080p). The
         //  resulting scale values here were eyeballed to make the 2k version look reasonably consistent with the 4k
         //  one.
         float resolutionEffectScale = std::max(
           0.0f,
-          std::min(1.0f, 1.0f - (float(screenTexture->Height()) - 1080.0f) / 1080.0f));
+          std::min(1.0f, 1.0f - (float(outputHeight) - 1080.0f) / 1080.0f));
 
         rgbToScreenConstantBuffer->Update(
           RGBToScreenConstants{
-            CalculateCommonConstants(CalculateAspectData()),
             screenSettings.borderColor,
 
             // $TODO: may want to artificially increase phosphorPersistence if we're interlaced
@@ -153,31 +348,13 @@ namespace CathodeRetro
 
         if (screenSettings.diffusionStrength > 0.0f)
         {
-          RenderBlur(currentFrameRGBInput);
+          UpdateBlurConstants();
         }
 
-        device->RenderQuad(
-          rgbToScreenShader.get(),
-          outputTexture,
-          {
-            {currentFrameRGBInput, SamplerType::LinearClamp},
-            {prevRGBInput.get(), SamplerType::LinearClamp},
-            {screenTexture.get(), SamplerType::NearestClamp},
-            {blurTexture.get(), SamplerType::LinearClamp},
-          },
-          rgbToScreenConstantBuffer.get());
-
-        device->RenderQuad(
-          copyShader.get(),
-          prevRGBInput.get(),
-          { { currentFrameRGBInput, SamplerType::LinearClamp } });
-
         prevScanlineType = scanType;
       }
 
     protected:
-      static constexpr uint32_t k_maskSize = 512;
-
       struct AspectData
       {
         Vec2 overscanSize;
@@ -207,8 +384,6 @@ namespace CathodeRetro
 
       struct RGBToScreenConstants
       {
-        CommonConstants common;
-
         Color backgroundColor;
         float phosphorPersistence;
         float scanlineCount;          // How many scanlines there are
@@ -261,17 +436,17 @@ namespace CathodeRetro
           float(int32_t(overscanSettings.overscanTop - overscanSettings.overscanBottom)) / scanlineCount * 0.5f;
 
         // Figure out the aspect ratio of the output, given both our dimensions as well as the pixel aspect ratio in the screen settings.
-        if (float(screenTexture->Width()) > aspectData.aspect * float(screenTexture->Height()))
+        if (float(outputWidth) > aspectData.aspect * float(outputHeight))
         {
-          float desiredWidth = aspectData.aspect * float(screenTexture->Height());
-          data.viewScale.x = float(screenTexture->Width()) / desiredWidth;
+          float desiredWidth = aspectData.aspect * float(outputHeight);
+          data.viewScale.x = float(outputWidth) / desiredWidth;
           data.viewScale.y = 1.0f;
         }
         else
         {
-          float desiredHeight = float(screenTexture->Width()) / aspectData.aspect;
+          float desiredHeight = float(outputWidth) / aspectData.aspect;
           data.viewScale.x = 1.0f;
-          data.viewScale.y = float(screenTexture->Height()) / desiredHeight;
+          data.viewScale.y = float(outputHeight) / desiredHeight;
         }
 
         // Taking the square root of the distortion gives us a little more change at smaller values.
@@ -282,10 +457,8 @@ namespace CathodeRetro
       }
 
 
-      void RenderScreenTexture()
+      ScreenTextureConstants CalculateScreenTextureConstants()
       {
-        assert(screenTexture != nullptr);
-
         ScreenTextureConstants data;
 
         auto aspectData = CalculateAspectData();
@@ -319,17 +492,154 @@ namespace CathodeRetro
         //  version look reasonably consistent with the 4k one.
         float resolutionEffectScale = std::max(
           0.0f,
-          std::min(1.0f, 1.0f - (float(screenTexture->Height()) - 1080.0f) / 1080.0f));
+          std::min(1.0f, 1.0f - (float(outputHeight) - 1080.0f) / 1080.0f));
         data.maskScale.x *= (1.0f - 0.1f * resolutionEffectScale);
         data.maskScale.y *= (1.0f - 0.1f * resolutionEffectScale);
 
         data.screenAspect = aspectData.aspect;
+        return data;
+      }
+
+
+      ScreenTextureKey MakeScreenTextureKey(const ScreenTextureConstants &constants)
+      {
+        static_assert(sizeof(ScreenTextureConstants) == sizeof(ScreenTextureKey::parameters));
+
+        ScreenTextureKey key;
+        key.width = outputWidth;
+        key.height = outputHeight;
+        key.maskType = screenSettings.maskType;
+        memcpy(key.parameters, &constants, sizeof(key.parameters));
+        return key;
+      }
+
+
+      // Find the screen texture with the given key in the cache or, failing that, the store.
+      std::unique_ptr<ITexture> FindScreenTexture(const ScreenTextureKey &key)
+      {
+        if (std::unique_ptr<ITexture> texture = screenTextureCache.Take(key))
+        {
+          return texture;
+        }
+
+        if (screenTextureStore == nullptr)
+        {
+          return nullptr;
+        }
+
+        std::vector<uint8_t> texels(RenderTargetByteCount(key.width, key.height, 1, TextureFormat::RGBA_Unorm8));
+        if (!screenTextureStore->Load(key, texels.data()))
+        {
+          return nullptr;
+        }
+
+        return device->CreateStaticTexture(key.width, key.height, 1, TextureFormat::RGBA_Unorm8, texels.data());
+      }
+
+
+      void SaveScreenTexture(const ScreenTextureKey &key, const IRenderTarget *texture)
+      {
+        if (screenTextureStore == nullptr)
+        {
+          return;
+        }
+
+        std::vector<uint8_t> texels(RenderTargetByteCount(key.width, key.height, 1, TextureFormat::RGBA_Unorm8));
+        if (device->ReadRenderTarget(texture, texels.data()))
+        {
+          screenTextureStore->Save(key, texels.data());
+        }
+      }
+
+
+      // Make the given texture the current screen texture, moving the previous one into the cache.
+      void SwapInScreenTexture(std::unique_ptr<ITexture> texture, const ScreenTextureKey &key)
+      {
+        if (screenTexture != nullptr)
+        {
+          screenTextureCache.Add(screenTextureKey, std::move(screenTexture));
+        }
+
+        screenTexture = std::move(texture);
+        screenTextureKey = key;
+        commandsOutOfDate = true;
+      }
+
+
+      // Regenerate the distortion LUT if the output size or the given constants (which are all that it depends on) have
+      //  changed since it was last generated.
+      void UpdateDistortionLUT(const CommonConstants &constants)
+      {
+        bool sizeChanged = distortionLUT == nullptr
+          || distortionLUT->Width() != outputWidth
+          || distortionLUT->Height() != outputHeight;
+        if (!sizeChanged && memcmp(&constants, &distortionLUTConstants, sizeof(constants)) == 0)
+        {
+          return;
+        }
 
-        screenTextureConstantBuffer->Update(data);
+        if (sizeChanged)
+        {
+          // The per-frame commands refer to the LUT, so they need to be recorded again to use the new one.
+          distortionLUT = device->CreateRenderTarget(outputWidth, outputHeight, 1, TextureFormat::RG_Float32);
+          commandsOutOfDate = true;
+        }
 
+        distortionLUTConstants = constants;
+        distortionLUTConstantBuffer->Update(constants);
+        sliceLastRGBRows.clear();
+
+        device->BeginPass(PassID::CRT_ScreenTexture);
+        device->RenderQuad(
+          generateDistortionLUTShader.get(),
+          distortionLUT.get(),
+          {},
+          distortionLUTConstantBuffer.get());
+        device->EndPass();
+      }
+
+
+      // Work out sliceLastRGBRows (for SliceOutputRowCount), if it's out of date: for each row of the output, the last
+      //  row of the RGB input that it or any row above it reads. The distortion only bends the rows, so sampling a
+      //  handful of columns across each one finds its extent closely enough (with the margin on top).
+      void UpdateSliceRowMap()
+      {
+        int32_t margin = k_sliceRowMargin + ((screenSettings.diffusionStrength > 0.0f) ? k_sliceDiffusionRowMargin : 0);
+        if (sliceLastRGBRows.size() == outputHeight && margin == sliceRowMapMargin)
+        {
+          return;
+        }
+
+        const CommonConstants &c = distortionLUTConstants;
+        sliceLastRGBRows.resize(outputHeight);
+        sliceRowMapMargin = margin;
+
+        int32_t lastRow = 0;
+        for (uint32_t y = 0; y < outputHeight; y++)
+        {
+          float v = (float(y) + 0.5f) / float(outputHeight) * 2.0f - 1.0f;
+          float maxRow = 0.0f;
+          for (uint32_t i = 0; i <= k_sliceRowMapColumnCount; i++)
+          {
+            float u = float(i) / float(k_sliceRowMapColumnCount) * 2.0f - 1.0f;
+            Vec2 t = DistortCRTCoordinates({ u * c.viewScale.x, v * c.viewScale.y }, c.distortion);
+            float rgbV = (t.y * c.overscanScale.y + c.overscanOffset.y * 2.0f) * 0.5f + 0.5f;
+            maxRow = std::max(maxRow, rgbV * float(scanlineCount));
+          }
+
+          int32_t row = std::min(int32_t(std::min(maxRow, float(scanlineCount))) + margin, int32_t(scanlineCount) - 1);
+          lastRow = std::max(lastRow, row);
+          sliceLastRGBRows[y] = lastRow;
+        }
+      }
+
+
+      // Generate the given rows of the screen texture (using the constants that are in screenTextureConstantBuffer).
+      void RenderScreenTextureRows(RenderTargetView output)
+      {
         device->RenderQuad(
           generateScreenTextureShader.get(),
-          screenTexture.get(),
+          output,
           {{maskTexture.get(), SamplerType::LinearWrap}},
           screenTextureConstantBuffer.get());
       }
@@ -367,19 +677,19 @@ namespace CathodeRetro
           || toneMapTexture->Height() != tonemapTexHeight)
         {
           // Rebuild our blur textures.
-          toneMapTexture = device->CreateRenderTarget(
+          toneMapTexture = transients->Create(
             tonemapTexWidth,
             tonemapTexHeight,
             1,
             TextureFormat::RGBA_Unorm8);
 
-          blurTexture = device->CreateRenderTarget(
+          blurTexture = transients->Create(
             blurTextureWidth,
             tonemapTexHeight,
             1,
             TextureFormat::RGBA_Unorm8);
 
-          blurScratchTexture = device->CreateRenderTarget(
+          blurScratchTexture = transients->Create(
             blurTextureWidth,
             tonemapTexHeight,
             1,
@@ -388,54 +698,7 @@ namespace CathodeRetro
       }
 
 
-      // Generate the mask texture we use for the CRT emulation
-      void RenderMaskTexture()
-      {
-        IShader *shader = nullptr;
-        switch (screenSettings.maskType)
-        {
-        case MaskType::SlotMask:
-          shader = generateSlotMaskShader.get();
-          break;
-
-        case MaskType::ShadowMask:
-          shader = generateShadowMaskShader.get();
-          break;
-
-        case MaskType::ApertureGrille:
-          shader = generateApertureGrilleShader.get();
-          break;
-        }
-
-        // First step is the generate the texture at the largest mip level
-        generateMaskConstantBuffer->Update(Vec2{ float(k_maskSize), float(k_maskSize / 2) });
-        device->RenderQuad(
-          shader,
-          maskTexture.get(),
-          {},
-          generateMaskConstantBuffer.get());
-
-        // Now it's generated so we need to generate the mips by using our lanczos downsample
-        maskDownsampleConstantBufferH->Update(Vec2{ 1.0f, 0.0f });
-        maskDownsampleConstantBufferV->Update(Vec2{ 0.0f, 1.0f });
-        for (uint32_t destMip = 1; destMip < maskTexture->MipCount(); destMip++)
-        {
-          device->RenderQuad(
-            downsample2XShader.get(),
-            {halfWidthMaskTexture.get(), destMip - 1},
-            {{maskTexture.get(), destMip - 1, SamplerType::LinearWrap}},
-            maskDownsampleConstantBufferH.get());
-
-          device->RenderQuad(
-            downsample2XShader.get(),
-            {maskTexture.get(), destMip},
-            {{halfWidthMaskTexture.get(), destMip - 1, SamplerType::LinearWrap}},
-            maskDownsampleConstantBufferV.get());
-        }
-      }
-
-
-      void RenderBlur(const ITexture *inputTexture)
+      void UpdateBlurConstants()
       {
         // $TODO: This is slightly inaccurate, we should really be using the max of inputTexture and
         //  prevFrameTexture * phosphorPersistence, but for now, this is fine.
@@ -452,27 +715,32 @@ namespace CathodeRetro
         //  that we can just abuse this shader as if it were)
         blurDownsampleConstantBuffer->Update(Vec2{ 1.0f, 0.0f });
 
-        device->RenderQuad(
+        gaussianBlurConstantBufferH->Update(GaussianBlurConstants{1.0f, 0.0f});
+        gaussianBlurConstantBufferV->Update(GaussianBlurConstants{0.0f, 1.0f});
+      }
+
+
+      void RenderBlur(CommandListRecorder *commands, const ITexture *inputTexture)
+      {
+        commands->RenderQuad(
           toneMapShader.get(),
           toneMapTexture.get(),
           {{inputTexture, SamplerType::LinearClamp}},
           toneMapConstantBuffer.get());
 
-        device->RenderQuad(
+        commands->RenderQuad(
           downsample2XShader.get(),
           blurTexture.get(),
           {{toneMapTexture.get(), SamplerType::LinearClamp}},
           blurDownsampleConstantBuffer.get());
 
-        gaussianBlurConstantBufferH->Update(GaussianBlurConstants{1.0f, 0.0f});
-        device->RenderQuad(
+        commands->RenderQuad(
           gaussianBlurShader.get(),
           blurScratchTexture.get(),
           {{blurTexture.get(), SamplerType::LinearClamp}},
           gaussianBlurConstantBufferH.get());
 
-        gaussianBlurConstantBufferV->Update(GaussianBlurConstants{0.0f, 1.0f});
-        device->RenderQuad(
+        commands->RenderQuad(
           gaussianBlurShader.get(),
           blurTexture.get(),
           {{blurScratchTexture.get(), SamplerType::LinearClamp}},
@@ -481,6 +749,8 @@ namespace CathodeRetro
 
 
       IGraphicsDevice *device;
+      SharedResources *sharedResources;
+      TransientRenderTargets *transients;
 
       uint32_t originalInputImageWidth;
       uint32_t processedRGBTextureWidth;
@@ -489,30 +759,54 @@ namespace CathodeRetro
       bool isFirstFrame = true;
 
       std::unique_ptr<IConstantBuffer> screenTextureConstantBuffer;
+      std::unique_ptr<IConstantBuffer> distortionLUTConstantBuffer;
       std::unique_ptr<IConstantBuffer> rgbToScreenConstantBuffer;
       std::unique_ptr<IConstantBuffer> toneMapConstantBuffer;
       std::unique_ptr<IConstantBuffer> blurDownsampleConstantBuffer;
       std::unique_ptr<IConstantBuffer> gaussianBlurConstantBufferH;
       std::unique_ptr<IConstantBuffer> gaussianBlurConstantBufferV;
-      std::unique_ptr<IConstantBuffer> generateMaskConstantBuffer;
-      std::unique_ptr<IConstantBuffer> maskDownsampleConstantBufferH;
-      std::unique_ptr<IConstantBuffer> maskDownsampleConstantBufferV;
-
-      std::unique_ptr<IShader> rgbToScreenShader;
-      std::unique_ptr<IShader> copyShader;
-      std::unique_ptr<IShader> downsample2XShader;
-      std::unique_ptr<IShader> toneMapShader;
-      std::unique_ptr<IShader> gaussianBlurShader;
-      std::unique_ptr<IShader> generateScreenTextureShader;
-      std::unique_ptr<IShader> generateSlotMaskShader;
-      std::unique_ptr<IShader> generateShadowMaskShader;
-      std::unique_ptr<IShader> generateApertureGrilleShader;
+
+      std::shared_ptr<IShader> rgbToScreenShader;
+      std::shared_ptr<IShader> copyShader;
+      std::shared_ptr<IShader> downsample2XShader;
+      std::shared_ptr<IShader> toneMapShader;
+      std::shared_ptr<IShader> gaussianBlurShader;
+      std::shared_ptr<IShader> generateScreenTextureShader;
+      std::shared_ptr<IShader> generateDistortionLUTShader;
 
       std::unique_ptr<IRenderTarget> prevRGBInput;
 
-      std::unique_ptr<IRenderTarget> maskTexture;
-      std::unique_ptr<IRenderTarget> halfWidthMaskTexture;
-      std::unique_ptr<IRenderTarget> screenTexture;
+      // The distorted texture coordinate for each output pixel (and the constants that it was generated with).
+      std::unique_ptr<IRenderTarget> distortionLUT;
+      CommonConstants distortionLUTConstants = {};
+
+      // For SliceOutputRowCount: how many rows past its distorted texture coordinate an output row can read from the
+      //  RGB input (for the bilinear filtering and the even/odd scanline offset), and how many more the diffusion blur
+      //  reaches (its vertical taps, plus the filtering in the passes around it), and the number of columns to sample
+      //  across each row.
+      static constexpr int32_t k_sliceRowMargin = 2;
+      static constexpr int32_t k_sliceDiffusionRowMargin = 10;
+      static constexpr uint32_t k_sliceRowMapColumnCount = 16;
+
+      // The last RGB input row that each output row (or any above it) reads, and the margin it was worked out with.
+      std::vector<int32_t> sliceLastRGBRows;
+      int32_t sliceRowMapMargin = 0;
+
+      std::shared_ptr<ITexture> maskTexture;
+      std::unique_ptr<ITexture> screenTexture;
+      ScreenTextureKey screenTextureKey;
+
+      // The screen texture that's in the middle of being generated (if any), and how many of its rows are done.
+      std::unique_ptr<IRenderTarget> pendingScreenTexture;
+      ScreenTextureKey pendingScreenTextureKey;
+      uint32_t pendingScreenTextureRow = 0;
+
+      ScreenTextureCache screenTextureCache;
+      IScreenTextureStore *screenTextureStore = nullptr;
+      uint32_t screenTextureRegenerationFrameCount = k_defaultScreenTextureRegenerationFrameCount;
+
+      uint32_t outputWidth = 0;
+      uint32_t outputHeight = 0;
 
       std::unique_ptr<IRenderTarget> toneMapTexture;
       std::unique_ptr<IRenderTarget> blurScratchTexture;
@@ -522,6 +816,7 @@ namespace CathodeRetro
       OverscanSettings overscanSettings;
       bool needsRenderScreenTexture = false;
       bool needsRenderMaskTexture = false;
+      bool commandsOutOfDate = true;
 
       ScanlineType prevScanlineType = ScanlineType::Progressive;
       float downsampleDirX;
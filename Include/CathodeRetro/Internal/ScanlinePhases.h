@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "CathodeRetro/Settings.h"
+#include "CathodeRetro/Internal/Noise.h"
+
+
+namespace CathodeRetro
+{
+  namespace Internal
+  {
+    // Compute the colorburst phase of every scanline, the same values that cathode-retro-generator-gen-phase.hlsl
+    //  renders into the phases texture: the phase at the start of each scanline for the current frame (and, if
+    //  channelCount is 2, the previous frame), in fractional multiples of the colorburst wavelength, offset to the
+    //  center of the decoder's filter and by the scanline's tracking instability. The results are written into
+    //  texelsOut as channelCount floats per scanline.
+    // The shader has to accumulate the phase increments in floats, but here the phase at the start of each scanline is
+    //  kept as an exact fraction over sourceSettings.denominator until it's wrapped into [0, 1), so there's no error
+    //  that grows with the scanline index.
+    inline void ComputeScanlinePhases(
+      const SourceSettings &sourceSettings,
+      uint32_t frameStartPhaseNumerator,
+      uint32_t prevFrameStartPhaseNumerator,
+      uint32_t samplesPerColorburstCycle,
+      float instabilityScale,
+      uint32_t noiseSeed,
+      uint32_t signalTextureWidth,
+      uint32_t scanlineCount,
+      uint32_t channelCount,
+      float *texelsOut)
+    {
+      const uint64_t denominator = sourceSettings.denominator;
+      const uint32_t startNumerators[] = { frameStartPhaseNumerator, prevFrameStartPhaseNumerator };
+
+      for (uint32_t scanlineIndex = 0; scanlineIndex < scanlineCount; scanlineIndex++)
+      {
+        // Offset by half a sample so that it lines up with the *center* of the filter instead of the left edge of it,
+        //  and then by the scaled instability so that if there are color artifacts, they'll have the correct phase.
+        double offset = 0.5 / double(samplesPerColorburstCycle);
+        if (instabilityScale != 0.0f)
+        {
+          float instability = CalculateTrackingInstabilityOffset(
+            scanlineIndex,
+            noiseSeed,
+            instabilityScale,
+            signalTextureWidth);
+          offset += double(instability) * double(signalTextureWidth) / double(samplesPerColorburstCycle);
+        }
+
+        for (uint32_t channel = 0; channel < channelCount; channel++)
+        {
+          uint64_t numerator =
+            (startNumerators[channel] + uint64_t(sourceSettings.phaseIncrementPerLine) * scanlineIndex) % denominator;
+
+          double phase = double(numerator) / double(denominator) + offset;
+          float wrapped = float(phase - std::floor(phase));
+
+          // Rounding to float can land a phase just under 1 on exactly 1, which needs to wrap as well.
+          *texelsOut++ = (wrapped < 1.0f) ? wrapped : 0.0f;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <list>
+#include <memory>
+
+#include "CathodeRetro/GraphicsDevice.h"
+#include "CathodeRetro/ScreenTextureStore.h"
+
+
+namespace CathodeRetro
+{
+  namespace Internal
+  {
+    // A least-recently-used cache of screen textures that aren't currently in use, so that switching back to an output
+    //  size or screen setup that was used recently doesn't have to generate its screen texture all over again. Once the
+    //  textures in the cache add up to more than the byte budget, the least recently used ones get freed (so with the
+    //  default budget of 0, nothing is kept).
+    class ScreenTextureCache
+    {
+    public:
+      void SetByteBudget(size_t byteBudgetIn)
+      {
+        byteBudget = byteBudgetIn;
+        Trim();
+      }
+
+
+      // Take the texture with the given key out of the cache, returning nullptr if it's not in there.
+      std::unique_ptr<ITexture> Take(const ScreenTextureKey &key)
+      {
+        for (auto iter = entries.begin(); iter != entries.end(); ++iter)
+        {
+          if (iter->key == key)
+          {
+            std::unique_ptr<ITexture> texture = std::move(iter->texture);
+            byteCount -= iter->byteCount;
+            entries.erase(iter);
+            return texture;
+          }
+        }
+
+        return nullptr;
+      }
+
+
+      // Add a texture that's no longer being used to the cache, as its most recently used entry.
+      void Add(const ScreenTextureKey &key, std::unique_ptr<ITexture> texture)
+      {
+        size_t textureByteCount = RenderTargetByteCount(key.width, key.height, 1, TextureFormat::RGBA_Unorm8);
+        entries.push_front({key, std::move(texture), textureByteCount});
+        byteCount += textureByteCount;
+        Trim();
+      }
+
+    private:
+      struct Entry
+      {
+        ScreenTextureKey key;
+        std::unique_ptr<ITexture> texture;
+        size_t byteCount;
+      };
+
+
+      void Trim()
+      {
+        while (byteCount > byteBudget)
+        {
+          byteCount -= entries.back().byteCount;
+          entries.pop_back();
+        }
+      }
+
+
+      std::list<Entry> entries;
+      size_t byteCount = 0;
+      size_t byteBudget = 0;
+    };
+  }
+}
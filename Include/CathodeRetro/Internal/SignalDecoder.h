@@ -1,9 +1,12 @@
 #pragma once
 
+#include "CathodeRetro/Internal/CommandListRecorder.h"
 #include "CathodeRetro/Internal/Constants.h"
 #include "CathodeRetro/Internal/SignalLevels.h"
 #include "CathodeRetro/Internal/SignalProperties.h"
+#include "CathodeRetro/Internal/TransientRenderTargets.h"
 #include "CathodeRetro/Settings.h"
+#include "CathodeRetro/SharedResources.h"
 
 
 namespace CathodeRetro
@@ -13,38 +16,24 @@ namespace CathodeRetro
     class SignalDecoder
     {
     public:
-      SignalDecoder(IGraphicsDevice *deviceIn, const SignalProperties &signalPropsIn)
+      SignalDecoder(
+        IGraphicsDevice *deviceIn,
+        SharedResources *sharedResourcesIn,
+        TransientRenderTargets *transientsIn,
+        const SignalProperties &signalPropsIn)
       : device(deviceIn)
+      , sharedResources(sharedResourcesIn)
+      , transients(transientsIn)
       , signalProps(signalPropsIn)
       {
         if (signalProps.type == SignalType::Composite)
         {
           // We need a Composite -> SVideo step (luma/chroma separation), so run that
           compositeToSVideoConstantBuffer = device->CreateConstantBuffer(sizeof(CompositeToSVideoConstantData));
-          compositeToSVideoShader = device->CreateShader(ShaderID::Decoder_CompositeToSVideo);
-
-          decodedSVideoTextureSingle = device->CreateRenderTarget(
-            signalProps.scanlineWidth,
-            signalProps.scanlineCount,
-            1,
-            TextureFormat::RG_Float32);
-          decodedSVideoTextureDouble = device->CreateRenderTarget(
-            signalProps.scanlineWidth,
-            signalProps.scanlineCount,
-            1,
-            TextureFormat::RGBA_Float32);
+          compositeToSVideoShader = sharedResources->Shader(ShaderID::Decoder_CompositeToSVideo);
         }
 
-        modulatedChromaTextureSingle = device->CreateRenderTarget(
-          signalProps.scanlineWidth,
-          signalProps.scanlineCount,
-          1,
-          TextureFormat::RG_Float32);
-        modulatedChromaTextureDouble = device->CreateRenderTarget(
-          signalProps.scanlineWidth,
-          signalProps.scanlineCount,
-          1,
-          TextureFormat::RGBA_Float32);
+        CreateSignalTextures();
 
         // the output RGB image is narrower by totalSidePaddingTexelCount, since we're removing the padding as part of
         //  the decode process.
@@ -54,14 +43,14 @@ namespace CathodeRetro
         sVideoToRGBConstantBuffer = device->CreateConstantBuffer(sizeof(SVideoToRGBConstantData));
         sVideoToModulatedChromaConstantBuffer =
           device->CreateConstantBuffer(sizeof(SVideoToModulatedChromaConstantData));
-        sVideoToModulatedChromaShader = device->CreateShader(ShaderID::Decoder_SVideoToModulatedChroma);
-        sVideoToRGBShader = device->CreateShader(ShaderID::Decoder_SVideoToRGB);
-        rgbTexture = device->CreateRenderTarget(
+        sVideoToModulatedChromaShader = sharedResources->Shader(ShaderID::Decoder_SVideoToModulatedChroma);
+        sVideoToRGBShader = sharedResources->Shader(ShaderID::Decoder_SVideoToRGB);
+        rgbTexture = transients->Create(
           rgbWidth,
           signalProps.scanlineCount,
           1,
           TextureFormat::RGBA_Unorm8);
-        scratchRGBTexture = device->CreateRenderTarget(
+        scratchRGBTexture = transients->Create(
           rgbWidth,
           signalProps.scanlineCount,
           1,
@@ -69,36 +58,130 @@ namespace CathodeRetro
 
         // Finally, the RGB filtering portions
         filterRGBConstantBuffer = device->CreateConstantBuffer(sizeof(FilterRGBConstantData));
-        filterRGBShader = device->CreateShader(ShaderID::Decoder_FilterRGB);
+        filterRGBShader = sharedResources->Shader(ShaderID::Decoder_FilterRGB);
       }
 
       void SetKnobSettings(const TVKnobSettings &settings)
-        { knobSettings = settings; }
+      {
+        if ((settings.sharpness != 0.0f) != (knobSettings.sharpness != 0.0f))
+        {
+          commandsOutOfDate = true;
+        }
+
+        knobSettings = settings;
+      }
+
+      // Switch the intermediate S-Video and modulated chroma textures between 32- and 16-bit floats.
+      void SetSignalPrecision(SignalPrecision precisionIn)
+      {
+        if (precisionIn != precision)
+        {
+          precision = precisionIn;
+          CreateSignalTextures();
+          commandsOutOfDate = true;
+        }
+      }
+
+      // Choose whether a composite signal gets decoded in three passes or one (this has no effect on S-Video).
+      void SetCompositeDecodePath(CompositeDecodePath path)
+      {
+        if (signalProps.type != SignalType::Composite || path == decodePath)
+        {
+          return;
+        }
+
+        decodePath = path;
+        if (decodePath == CompositeDecodePath::SinglePass && compositeToRGBShader == nullptr)
+        {
+          // Only load the single-pass shader once it's wanted, so that devices that don't support it can still use
+          //  the three-pass path.
+          compositeToRGBConstantBuffer = device->CreateConstantBuffer(sizeof(CompositeToRGBConstantData));
+          compositeToRGBShader = sharedResources->Shader(ShaderID::Decoder_CompositeToRGB);
+        }
+
+        commandsOutOfDate = true;
+      }
 
       const ITexture *CurrentFrameRGBOutput() const
         { return rgbTexture.get(); }
 
-      void Decode(const ITexture *inputSignal, const ITexture *inputPhases, const SignalLevels &levels)
+      // This is true if the commands that RecordCommands would record have changed since it was last called.
+      bool CommandsOutOfDate() const
+        { return commandsOutOfDate; }
+
+      // Record the decoder's per-frame passes. The set of passes (and which textures they use) depends on the signal
+      //  type, the composite decode path, whether the signal is doubled up for temporal artifact reduction, and
+      //  whether there's any sharpening.
+      void RecordCommands(
+        CommandListRecorder *commands,
+        const ITexture *inputSignal,
+        const ITexture *inputPhases,
+        const SignalLevels &levels)
       {
-        const ITexture *sVideoTexture;
-        if (signalProps.type == SignalType::Composite)
+        commands->BeginPass(PassID::Decoder);
+
+        bool isDoubled = (levels.temporalArtifactReduction > 0.0f);
+        IRenderTarget *rgbOutput = (knobSettings.sharpness != 0.0f) ? scratchRGBTexture.get() : rgbTexture.get();
+        if (UsesSinglePass())
         {
-          ITexture *outTex = (levels.temporalArtifactReduction > 0.0f)
-            ? decodedSVideoTextureDouble.get()
-            : decodedSVideoTextureSingle.get();
-          sVideoTexture = outTex;
-          CompositeToSVideo(inputSignal, levels.temporalArtifactReduction > 0.0f);
+          CompositeToRGB(commands, inputSignal, inputPhases, rgbOutput);
         }
         else
         {
-          sVideoTexture = inputSignal;
+          const ITexture *sVideoTexture;
+          if (signalProps.type == SignalType::Composite)
+          {
+            sVideoTexture = isDoubled ? decodedSVideoTextureDouble.get() : decodedSVideoTextureSingle.get();
+            CompositeToSVideo(commands, inputSignal, isDoubled);
+          }
+          else
+          {
+            sVideoTexture = inputSignal;
+          }
+
+          SVideoToRGB(commands, sVideoTexture, inputPhases, isDoubled, rgbOutput);
         }
 
-        SVideoToRGB(sVideoTexture, inputPhases, levels);
+        if (knobSettings.sharpness != 0.0f)
+        {
+          // We decoded into the scratch texture, so filter that into the final output.
+          FilterRGB(commands);
+        }
+
+        commands->EndPass();
+        commandsOutOfDate = false;
+      }
+
+      // Update the constants for the current frame's passes.
+      void UpdateFrameConstants(const SignalLevels &levels)
+      {
+        if (UsesSinglePass())
+        {
+          compositeToRGBConstantBuffer->Update(
+            CompositeToRGBConstantData {
+              k_signalSamplesPerColorCycle,
+              knobSettings.tint,
+              knobSettings.saturation / levels.saturationScale * knobSettings.brightness,
+              knobSettings.brightness,
+              levels.blackLevel,
+              levels.whiteLevel,
+              levels.temporalArtifactReduction,
+              signalProps.scanlineWidth,
+              rgbTexture->Width(),
+            });
+        }
+        else
+        {
+          UpdateMultiPassConstants(levels);
+        }
 
         if (knobSettings.sharpness != 0.0f)
         {
-          FilterRGB();
+          filterRGBConstantBuffer->Update(
+            FilterRGBConstantData {
+              -knobSettings.sharpness,
+              signalProps.colorCyclesPerInputPixel * float(k_signalSamplesPerColorCycle)
+            });
         }
       }
 
@@ -108,39 +191,24 @@ namespace CathodeRetro
       }
 
     private:
-      void CompositeToSVideo(const ITexture *inputSignal, bool isDoubled)
-      {
-        compositeToSVideoConstantBuffer->Update(CompositeToSVideoConstantData{ k_signalSamplesPerColorCycle });
-        device->RenderQuad(
-          compositeToSVideoShader.get(),
-          (isDoubled ? decodedSVideoTextureDouble : decodedSVideoTextureSingle).get(),
-          {{inputSignal, SamplerType::LinearClamp}},
-          compositeToSVideoConstantBuffer.get());
-      }
+      bool UsesSinglePass() const
+        { return signalProps.type == SignalType::Composite && decodePath == CompositeDecodePath::SinglePass; }
 
 
-      void SVideoToRGB(const ITexture *sVideoTexture, const ITexture *inputPhases, const SignalLevels &levels)
+      void UpdateMultiPassConstants(const SignalLevels &levels)
       {
+        if (signalProps.type == SignalType::Composite)
+        {
+          compositeToSVideoConstantBuffer->Update(CompositeToSVideoConstantData{ k_signalSamplesPerColorCycle });
+        }
+
         sVideoToModulatedChromaConstantBuffer->Update(
           SVideoToModulatedChromaConstantData {
             k_signalSamplesPerColorCycle,
             knobSettings.tint,
-            sVideoTexture->Width(),
+            signalProps.scanlineWidth,
           });
 
-        IRenderTarget *modulatedChromaTex = (levels.temporalArtifactReduction > 0.0f)
-          ? modulatedChromaTextureDouble.get()
-          : modulatedChromaTextureSingle.get();
-
-        device->RenderQuad(
-          sVideoToModulatedChromaShader.get(),
-          modulatedChromaTex,
-          {
-            {sVideoTexture, SamplerType::LinearClamp},
-            {inputPhases, SamplerType::NearestClamp},
-          },
-          sVideoToModulatedChromaConstantBuffer.get());
-
         sVideoToRGBConstantBuffer->Update(
           SVideoToRGBConstantData {
             k_signalSamplesPerColorCycle,
@@ -152,13 +220,74 @@ namespace CathodeRetro
             levels.blackLevel,
             levels.whiteLevel,
             levels.temporalArtifactReduction,
-            sVideoTexture->Width(),
+            signalProps.scanlineWidth,
             rgbTexture->Width(),
           });
+      }
 
-        device->RenderQuad(
+
+      void CreateSignalTextures()
+      {
+        if (signalProps.type == SignalType::Composite)
+        {
+          decodedSVideoTextureSingle = transients->Create(
+            signalProps.scanlineWidth,
+            signalProps.scanlineCount,
+            1,
+            SignalTextureFormat(precision, 2));
+          decodedSVideoTextureDouble = transients->Create(
+            signalProps.scanlineWidth,
+            signalProps.scanlineCount,
+            1,
+            SignalTextureFormat(precision, 4));
+        }
+
+        modulatedChromaTextureSingle = transients->Create(
+          signalProps.scanlineWidth,
+          signalProps.scanlineCount,
+          1,
+          SignalTextureFormat(precision, 2));
+        modulatedChromaTextureDouble = transients->Create(
+          signalProps.scanlineWidth,
+          signalProps.scanlineCount,
+          1,
+          SignalTextureFormat(precision, 4));
+      }
+
+
+      void CompositeToSVideo(CommandListRecorder *commands, const ITexture *inputSignal, bool isDoubled)
+      {
+        commands->RenderQuad(
+          compositeToSVideoShader.get(),
+          (isDoubled ? decodedSVideoTextureDouble : decodedSVideoTextureSingle).get(),
+          {{inputSignal, SamplerType::LinearClamp}},
+          compositeToSVideoConstantBuffer.get());
+      }
+
+
+      void SVideoToRGB(
+        CommandListRecorder *commands,
+        const ITexture *sVideoTexture,
+        const ITexture *inputPhases,
+        bool isDoubled,
+        IRenderTarget *outputTexture)
+      {
+        IRenderTarget *modulatedChromaTex = isDoubled
+          ? modulatedChromaTextureDouble.get()
+          : modulatedChromaTextureSingle.get();
+
+        commands->RenderQuad(
+          sVideoToModulatedChromaShader.get(),
+          modulatedChromaTex,
+          {
+            {sVideoTexture, SamplerType::LinearClamp},
+            {inputPhases, SamplerType::NearestClamp},
+          },
+          sVideoToModulatedChromaConstantBuffer.get());
+
+        commands->RenderQuad(
           sVideoToRGBShader.get(),
-          rgbTexture.get(),
+          outputTexture,
           {
             {sVideoTexture, SamplerType::LinearClamp},
             {modulatedChromaTex, SamplerType::LinearClamp},
@@ -167,30 +296,43 @@ namespace CathodeRetro
       }
 
 
-      void FilterRGB()
+      void CompositeToRGB(
+        CommandListRecorder *commands,
+        const ITexture *inputSignal,
+        const ITexture *inputPhases,
+        IRenderTarget *outputTexture)
       {
-        filterRGBConstantBuffer->Update(
-          FilterRGBConstantData {
-            -knobSettings.sharpness,
-            signalProps.colorCyclesPerInputPixel * float(k_signalSamplesPerColorCycle)
-          });
+        commands->RenderQuad(
+          compositeToRGBShader.get(),
+          outputTexture,
+          {
+            {inputSignal, SamplerType::NearestClamp},
+            {inputPhases, SamplerType::NearestClamp},
+          },
+          compositeToRGBConstantBuffer.get());
+      }
+
 
-        device->RenderQuad(
+      void FilterRGB(CommandListRecorder *commands)
+      {
+        commands->RenderQuad(
           filterRGBShader.get(),
-          scratchRGBTexture.get(),
-          {{rgbTexture.get(), SamplerType::LinearClamp}},
+          rgbTexture.get(),
+          {{scratchRGBTexture.get(), SamplerType::LinearClamp}},
           filterRGBConstantBuffer.get());
-
-        // Our output is the new RGB Texture.
-        std::swap(rgbTexture, scratchRGBTexture);
       }
 
       IGraphicsDevice *device;
+      SharedResources *sharedResources;
+      TransientRenderTargets *transients;
 
       std::unique_ptr<IRenderTarget> rgbTexture;
       std::unique_ptr<IRenderTarget> scratchRGBTexture;
       SignalProperties signalProps;
       TVKnobSettings knobSettings;
+      SignalPrecision precision = SignalPrecision::Float32;
+      CompositeDecodePath decodePath = CompositeDecodePath::ThreePass;
+      bool commandsOutOfDate = true;
 
       // Step 1: Composite to SVideo elements
       struct CompositeToSVideoConstantData
@@ -198,7 +340,7 @@ namespace CathodeRetro
         uint32_t outputTexelsPerColorburstCycle;        // This value should match k_signalSamplesPerColorCycle
       };
 
-      std::unique_ptr<IShader> compositeToSVideoShader;
+      std::shared_ptr<IShader> compositeToSVideoShader;
       std::unique_ptr<IConstantBuffer> compositeToSVideoConstantBuffer;
       std::unique_ptr<IRenderTarget> decodedSVideoTextureSingle;
       std::unique_ptr<IRenderTarget> decodedSVideoTextureDouble;
@@ -226,10 +368,10 @@ namespace CathodeRetro
         uint32_t inputWidth;
       };
 
-      std::unique_ptr<IShader> sVideoToModulatedChromaShader;
+      std::shared_ptr<IShader> sVideoToModulatedChromaShader;
       std::unique_ptr<IRenderTarget> modulatedChromaTextureSingle;
       std::unique_ptr<IRenderTarget> modulatedChromaTextureDouble;
-      std::unique_ptr<IShader> sVideoToRGBShader;
+      std::shared_ptr<IShader> sVideoToRGBShader;
       std::unique_ptr<IConstantBuffer> sVideoToModulatedChromaConstantBuffer;
       std::unique_ptr<IConstantBuffer> sVideoToRGBConstantBuffer;
 
@@ -240,8 +382,25 @@ namespace CathodeRetro
         float blurSampleStepSize;
       };
 
-      std::unique_ptr<IShader> filterRGBShader;
+      std::shared_ptr<IShader> filterRGBShader;
       std::unique_ptr<IConstantBuffer> filterRGBConstantBuffer;
+
+      // Alternatively: single-pass Composite to RGB elements
+      struct CompositeToRGBConstantData
+      {
+        uint32_t samplesPerColorburstCycle;           // This value should match k_signalSamplesPerColorCycle
+        float tint;
+        float saturation;
+        float brightness;
+        float blackLevel;
+        float whiteLevel;
+        float temporalArtifactReduction;
+        uint32_t inputWidth;
+        uint32_t outputWidth;
+      };
+
+      std::shared_ptr<IShader> compositeToRGBShader;
+      std::unique_ptr<IConstantBuffer> compositeToRGBConstantBuffer;
     };
   }
 }
\ No newline at end of file
@@ -1,9 +1,13 @@
 #pragma once
 
+#include "CathodeRetro/Internal/CommandListRecorder.h"
 #include "CathodeRetro/Internal/Constants.h"
+#include "CathodeRetro/Internal/ScanlinePhases.h"
 #include "CathodeRetro/Internal/SignalLevels.h"
 #include "CathodeRetro/Internal/SignalProperties.h"
+#include "CathodeRetro/Internal/TransientRenderTargets.h"
 #include "CathodeRetro/Settings.h"
+#include "CathodeRetro/SharedResources.h"
 
 namespace CathodeRetro
 {
@@ -14,11 +18,16 @@ namespace CathodeRetro
     public:
       SignalGenerator(
         IGraphicsDevice *deviceIn,
+        SharedResources *sharedResourcesIn,
+        TransientRenderTargets *transientsIn,
         SignalType type,
         uint32_t inputWidth,
         uint32_t inputHeight,
         const SourceSettings &inputSettings)
       : device(deviceIn)
+      , sharedResources(sharedResourcesIn)
+      , transients(transientsIn)
+      , inputRGBWidth(inputWidth)
       {
         sourceSettings = inputSettings;
 
@@ -36,13 +45,13 @@ namespace CathodeRetro
         signalProps.colorCyclesPerInputPixel = float(inputSettings.colorCyclesPerInputPixel) / float(inputSettings.denominator);
         signalProps.inputPixelAspectRatio = inputSettings.inputPixelAspectRatio;
 
-        generateSignalConstantBuffer = device->CreateConstantBuffer(
-          std::max(sizeof(RGBToSVideoConstantData), sizeof(GeneratePhaseTextureConstantData)));
-        rgbToSVideoShader = device->CreateShader(ShaderID::Generator_RGBToSVideoOrComposite);
-        generatePhaseTextureShader = device->CreateShader(ShaderID::Generator_GeneratePhaseTexture);
+        // Each pass needs its own constant buffer, since all of a frame's constants are updated before its recorded
+        //  commands are executed.
+        rgbToSVideoConstantBuffer = device->CreateConstantBuffer(sizeof(RGBToSVideoConstantData));
+        rgbToSVideoShader = sharedResources->Shader(ShaderID::Generator_RGBToSVideoOrComposite);
 
         applyArtifactsConstantBuffer = device->CreateConstantBuffer(sizeof(ApplyArtifactsConstantData));
-        applyArtifactsShader = device->CreateShader(ShaderID::Generator_ApplyArtifacts);
+        applyArtifactsShader = sharedResources->Shader(ShaderID::Generator_ApplyArtifacts);
 
         frameStartPhaseNumerator = sourceSettings.initialFramePhase;
 
@@ -56,7 +65,14 @@ namespace CathodeRetro
         { return levels; }
 
       const ITexture *PhasesTexture() const
-        { return phasesTexture.get(); }
+      {
+        if (streamingPhasesTexture != nullptr)
+        {
+          return streamingPhasesTexture.get();
+        }
+
+        return phasesTexture.get();
+      }
 
       const ITexture *SignalTexture() const
         { return signalTexture.get(); }
@@ -65,41 +81,193 @@ namespace CathodeRetro
       {
         artifactSettings = settings;
 
-        // If we have any temporal artifact reduction we are going to double up our generated signal textures so that two phases of the same
-        //  frame can be blended together by the decoder.
-        bool wantsDouble = (artifactSettings.temporalArtifactReduction > 0.0f);
+        UpdateTextureFormats();
 
-        TextureFormat phasesFormat = wantsDouble ? TextureFormat::RG_Float32 : TextureFormat::R_Float32;
-        TextureFormat signalFormat = wantsDouble
-          ? ((signalProps.type == SignalType::SVideo) ? TextureFormat::RGBA_Float32 : TextureFormat::RG_Float32)
-          : ((signalProps.type == SignalType::SVideo) ? TextureFormat::RG_Float32 : TextureFormat::R_Float32);
+        bool wantsArtifacts = (artifactSettings.noiseStrength > 0.0f || artifactSettings.ghostVisibility > 0.0f);
+        if (wantsArtifacts != hasArtifacts)
+        {
+          hasArtifacts = wantsArtifacts;
+          commandsOutOfDate = true;
+        }
+
+        levels.temporalArtifactReduction = artifactSettings.temporalArtifactReduction;
+        levels.blackLevel = 0.0f;
+        levels.whiteLevel = 1.0f;
+        levels.saturationScale = 0.5f;
+      }
 
-        if (phasesTexture == nullptr || phasesTexture->Format() != phasesFormat)
+      // Switch the signal textures between 32- and 16-bit floats.
+      void SetSignalPrecision(SignalPrecision precisionIn)
+      {
+        precision = precisionIn;
+        UpdateTextureFormats();
+      }
+
+      // Choose whether the artifacts get applied in their own pass after generating the clean signal, or while
+      //  generating it.
+      void SetSignalGenerationPath(SignalGenerationPath path)
+      {
+        if (path == generationPath)
         {
-          phasesTexture = device->CreateRenderTarget(1, signalProps.scanlineCount, 1, phasesFormat);
+          return;
         }
 
-        if (signalTexture == nullptr || signalTexture->Format() != signalFormat)
+        generationPath = path;
+        if (generationPath == SignalGenerationPath::SinglePass && rgbToSignalWithArtifactsShader == nullptr)
+        {
+          // Only load the single-pass shader once it's wanted, so that devices that don't support it can still use
+          //  the two-pass path.
+          rgbToSignalWithArtifactsConstantBuffer =
+            device->CreateConstantBuffer(sizeof(RGBToSignalWithArtifactsConstantData));
+          rgbToSignalWithArtifactsShader = sharedResources->Shader(ShaderID::Generator_RGBToSignalWithArtifacts);
+        }
+
+        commandsOutOfDate = true;
+      }
+
+      // This is true if the signal only depends on the input and the phases that the frames start at (see
+      //  NextFramePhaseKey), which is the case when there's no noise or tracking instability.
+      bool SignalDependsOnlyOnPhases() const
+        { return artifactSettings.noiseStrength == 0.0f && artifactSettings.instabilityScale == 0.0f; }
+
+      // Get a value that identifies the phases that the next frame's signal will be generated with (that is, the one
+      //  that the next UpdateFrameConstants call sets up), which is the phase that it starts at and, with temporal
+      //  artifact reduction, the phase that the frame before it started at.
+      uint64_t NextFramePhaseKey() const
+      {
+        uint64_t key = uint64_t(frameStartPhaseNumerator) << 32;
+        if (artifactSettings.temporalArtifactReduction > 0.0f)
+        {
+          key |= prevFrameStartPhaseNumerator;
+        }
+
+        return key;
+      }
+
+      // This is true if the commands that RecordCommands would record have changed since it was last called (which
+      //  means that any command list that they were recorded into needs to be recorded again).
+      bool CommandsOutOfDate() const
+        { return commandsOutOfDate; }
+
+      // Record the generator's per-frame passes. The set of passes only depends on the current settings - everything
+      //  that changes from frame to frame goes through the constant buffers, which UpdateFrameConstants fills in.
+      void RecordCommands(CommandListRecorder *commands, const ITexture *inputRGBTexture)
+      {
+        commands->BeginPass(PassID::Generator);
+
+        if (streamingPhasesTexture == nullptr)
+        {
+          GeneratePhasesTexture(commands);
+        }
+
+        if (hasArtifacts && generationPath == SignalGenerationPath::SinglePass)
+        {
+          // Generate the signal with the artifacts already applied, skipping the clean signal texture entirely.
+          GenerateSignalWithArtifacts(commands, inputRGBTexture);
+        }
+        else if (hasArtifacts)
+        {
+          // Generate the clean signal into its own texture, then apply the artifacts to it to get the final signal.
+          GenerateCleanSignal(commands, inputRGBTexture, cleanSignalTexture.get());
+          ApplyArtifacts(commands);
+        }
+        else
         {
-          signalTexture = device->CreateRenderTarget(signalProps.scanlineWidth, signalProps.scanlineCount, 1, signalFormat);
-          scratchSignalTexture = device->CreateRenderTarget(signalProps.scanlineWidth, signalProps.scanlineCount, 1, signalFormat);
+          GenerateCleanSignal(commands, inputRGBTexture, signalTexture.get());
         }
+
+        commands->EndPass();
+        commandsOutOfDate = false;
       }
 
-      void Generate(const ITexture *inputRGBTexture, int32_t frameStartPhaseNumeratorIn = -1)
+      // Update the constants for the current frame's passes, then step the phase and noise forward to the next frame.
+      void UpdateFrameConstants(int32_t frameStartPhaseNumeratorIn = -1)
       {
         if (frameStartPhaseNumeratorIn >= 0)
         {
           frameStartPhaseNumerator = uint32_t(frameStartPhaseNumeratorIn);
         }
 
-        GeneratePhasesTexture();
-        GenerateCleanSignal(inputRGBTexture);
+        if (streamingPhasesTexture != nullptr)
+        {
+          // Compute the scanline phases here and upload them, rather than rendering them.
+          uint32_t channelCount = (streamingPhasesTexture->Format() == TextureFormat::RG_Float32) ? 2 : 1;
+          phaseTexels.resize(size_t(signalProps.scanlineCount) * channelCount);
+          ComputeScanlinePhases(
+            sourceSettings,
+            frameStartPhaseNumerator,
+            prevFrameStartPhaseNumerator,
+            k_signalSamplesPerColorCycle,
+            artifactSettings.instabilityScale,
+            noiseSeed,
+            signalTexture->Width(),
+            signalProps.scanlineCount,
+            channelCount,
+            phaseTexels.data());
+          device->UpdateTexture(
+            streamingPhasesTexture.get(),
+            phaseTexels.data(),
+            ptrdiff_t(channelCount * sizeof(float)));
+        }
+        else
+        {
+          // Update our scanline phases texture constants
+          generatePhaseTextureConstantBuffer->Update(
+            GeneratePhaseTextureConstantData{
+              float(frameStartPhaseNumerator) / float(sourceSettings.denominator),
+              float(prevFrameStartPhaseNumerator) / float(sourceSettings.denominator),
+              float(sourceSettings.phaseIncrementPerLine) / float(sourceSettings.denominator),
+              k_signalSamplesPerColorCycle,
+              artifactSettings.instabilityScale,
+              noiseSeed,
+              signalTexture->Width(),
+              signalTexture->Height(),
+            });
+        }
 
-        if (artifactSettings.noiseStrength > 0.0f || artifactSettings.ghostVisibility > 0.0f)
+        RGBToSVideoConstantData rgbToSVideoConstants {
+          k_signalSamplesPerColorCycle,
+          inputRGBWidth,
+          signalTexture->Width(),
+          signalTexture->Height(),
+          (signalProps.type == SignalType::Composite) ? 1.0f : 0.0f,
+          artifactSettings.instabilityScale,
+          noiseSeed,
+          signalProps.totalSidePaddingTexelCount,
+        };
+
+        if (hasArtifacts && generationPath == SignalGenerationPath::SinglePass)
         {
-          // Apply artifacts to the signal, then swap signal and scratch to get the artifact output
-          ApplyArtifacts();
+          rgbToSignalWithArtifactsConstantBuffer->Update(
+            RGBToSignalWithArtifactsConstantData {
+              rgbToSVideoConstants,
+
+              artifactSettings.ghostVisibility,
+              artifactSettings.ghostDistance,
+              artifactSettings.ghostSpreadScale,
+              artifactSettings.noiseStrength,
+            });
+        }
+        else
+        {
+          rgbToSVideoConstantBuffer->Update(rgbToSVideoConstants);
+        }
+
+        if (hasArtifacts && generationPath == SignalGenerationPath::TwoPass)
+        {
+          applyArtifactsConstantBuffer->Update(
+            ApplyArtifactsConstantData {
+              artifactSettings.ghostVisibility,
+              artifactSettings.ghostDistance,
+              artifactSettings.ghostSpreadScale,
+
+              artifactSettings.noiseStrength,
+              noiseSeed,
+
+              signalTexture->Width(),
+              signalTexture->Height(),
+              k_signalSamplesPerColorCycle,
+            });
         }
 
         isEvenFrame = !isEvenFrame;
@@ -154,109 +322,140 @@ namespace CathodeRetro
         uint32_t samplesPerColorburstCycle;
       };
 
+      struct RGBToSignalWithArtifactsConstantData
+      {
+        // The clean signal generation constants, followed by the artifact constants that aren't already in there.
+        RGBToSVideoConstantData signal;
+        float ghostVisibility;
+        float ghostDistance;
+        float ghostSpreadScale;
+        float noiseStrength;
+      };
 
-      void GeneratePhasesTexture()
+
+      // (Re)create the phase and signal textures if the current settings need them to be in a different format.
+      void UpdateTextureFormats()
       {
-        // Update our scanline phases texture
-        generateSignalConstantBuffer->Update(
-          GeneratePhaseTextureConstantData{
-            float(frameStartPhaseNumerator) / float(sourceSettings.denominator),
-            float(prevFrameStartPhaseNumerator) / float(sourceSettings.denominator),
-            float(sourceSettings.phaseIncrementPerLine) / float(sourceSettings.denominator),
-            k_signalSamplesPerColorCycle,
-            artifactSettings.instabilityScale,
-            noiseSeed,
-            signalTexture->Width(),
-            signalTexture->Height(),
-          });
+        // If we have any temporal artifact reduction we are going to double up our generated signal textures so that
+        //  two phases of the same frame can be blended together by the decoder.
+        bool wantsDouble = (artifactSettings.temporalArtifactReduction > 0.0f);
+
+        // The phases texture is tiny (one texel per scanline), and half floats are a little coarse for the phase
+        //  values, so it stays at full precision regardless of the signal precision.
+        TextureFormat phasesFormat = wantsDouble ? TextureFormat::RG_Float32 : TextureFormat::R_Float32;
+        uint32_t signalChannelCount = ((signalProps.type == SignalType::SVideo) ? 2 : 1) * (wantsDouble ? 2 : 1);
+        TextureFormat signalFormat = SignalTextureFormat(precision, signalChannelCount);
+
+        if (PhasesTexture() == nullptr || PhasesTexture()->Format() != phasesFormat)
+        {
+          // The phases get computed on the CPU and uploaded if the device supports that, otherwise they're rendered.
+          phasesTexture = nullptr;
+          streamingPhasesTexture = device->CreateStreamingTexture(1, signalProps.scanlineCount, phasesFormat);
+          if (streamingPhasesTexture == nullptr)
+          {
+            if (generatePhaseTextureShader == nullptr)
+            {
+              generatePhaseTextureConstantBuffer =
+                device->CreateConstantBuffer(sizeof(GeneratePhaseTextureConstantData));
+              generatePhaseTextureShader = sharedResources->Shader(ShaderID::Generator_GeneratePhaseTexture);
+            }
+
+            phasesTexture = transients->Create(1, signalProps.scanlineCount, 1, phasesFormat);
+          }
+
+          commandsOutOfDate = true;
+        }
+
+        if (signalTexture == nullptr || signalTexture->Format() != signalFormat)
+        {
+          signalTexture = transients->Create(signalProps.scanlineWidth, signalProps.scanlineCount, 1, signalFormat);
+          cleanSignalTexture =
+            transients->Create(signalProps.scanlineWidth, signalProps.scanlineCount, 1, signalFormat);
+          commandsOutOfDate = true;
+        }
+      }
 
-        device->RenderQuad(
+
+      void GeneratePhasesTexture(CommandListRecorder *commands)
+      {
+        commands->RenderQuad(
           generatePhaseTextureShader.get(),
           phasesTexture.get(),
           {},
-          generateSignalConstantBuffer.get());
+          generatePhaseTextureConstantBuffer.get());
       }
 
 
-      void GenerateCleanSignal(const ITexture *rgbTexture)
+      void GenerateCleanSignal(CommandListRecorder *commands, const ITexture *rgbTexture, IRenderTarget *outputTexture)
       {
-        // Now run the actual shader
-        generateSignalConstantBuffer->Update(
-          RGBToSVideoConstantData{
-            k_signalSamplesPerColorCycle,
-            rgbTexture->Width(),
-            signalTexture->Width(),
-            signalTexture->Height(),
-            (signalProps.type == SignalType::Composite) ? 1.0f : 0.0f,
-            artifactSettings.instabilityScale,
-            noiseSeed,
-            signalProps.totalSidePaddingTexelCount,
-          });
-
-        device->RenderQuad(
+        commands->RenderQuad(
           rgbToSVideoShader.get(),
-          signalTexture.get(),
-          {{rgbTexture, SamplerType::LinearClamp}, {phasesTexture.get(), SamplerType::NearestClamp}},
-          generateSignalConstantBuffer.get());
-
-        levels.temporalArtifactReduction = artifactSettings.temporalArtifactReduction;
-        levels.blackLevel = 0.0f;
-        levels.whiteLevel = 1.0f;
-        levels.saturationScale = 0.5f;
+          outputTexture,
+          {{rgbTexture, SamplerType::LinearClamp}, {PhasesTexture(), SamplerType::NearestClamp}},
+          rgbToSVideoConstantBuffer.get());
       }
 
 
-      void ApplyArtifacts()
+      void ApplyArtifacts(CommandListRecorder *commands)
       {
-        applyArtifactsConstantBuffer->Update(
-          ApplyArtifactsConstantData {
-            artifactSettings.ghostVisibility,
-            artifactSettings.ghostDistance,
-            artifactSettings.ghostSpreadScale,
-
-            artifactSettings.noiseStrength,
-            noiseSeed,
-
-            scratchSignalTexture->Width(),
-            scratchSignalTexture->Height(),
-            k_signalSamplesPerColorCycle,
-          });
-
-        device->RenderQuad(
+        commands->RenderQuad(
           applyArtifactsShader.get(),
-          scratchSignalTexture.get(),
-          {{signalTexture.get(), SamplerType::LinearClamp}},
+          signalTexture.get(),
+          {{cleanSignalTexture.get(), SamplerType::LinearClamp}},
           applyArtifactsConstantBuffer.get());
+      }
+
 
-        // Our output is the new signal texture so swap scratch into place.
-        std::swap(signalTexture, scratchSignalTexture);
+      void GenerateSignalWithArtifacts(CommandListRecorder *commands, const ITexture *rgbTexture)
+      {
+        commands->RenderQuad(
+          rgbToSignalWithArtifactsShader.get(),
+          signalTexture.get(),
+          {{rgbTexture, SamplerType::LinearClamp}, {PhasesTexture(), SamplerType::NearestClamp}},
+          rgbToSignalWithArtifactsConstantBuffer.get());
       }
 
 
       IGraphicsDevice *device;
+      SharedResources *sharedResources;
+      TransientRenderTargets *transients;
+      uint32_t inputRGBWidth;
 
       uint32_t noiseSeed = 0;
 
-      std::unique_ptr<IShader> rgbToSVideoShader;
-      std::unique_ptr<IShader> generatePhaseTextureShader;
-      std::unique_ptr<IShader> applyArtifactsShader;
-      std::unique_ptr<IConstantBuffer> generateSignalConstantBuffer;
+      std::shared_ptr<IShader> rgbToSVideoShader;
+      std::shared_ptr<IShader> generatePhaseTextureShader;
+      std::shared_ptr<IShader> applyArtifactsShader;
+      std::unique_ptr<IConstantBuffer> generatePhaseTextureConstantBuffer;
+      std::unique_ptr<IConstantBuffer> rgbToSVideoConstantBuffer;
       std::unique_ptr<IConstantBuffer> applyArtifactsConstantBuffer;
 
+      // These are only created if the single-pass path gets used.
+      std::shared_ptr<IShader> rgbToSignalWithArtifactsShader;
+      std::unique_ptr<IConstantBuffer> rgbToSignalWithArtifactsConstantBuffer;
+
+      // Only one of these exists at a time: the phases are either uploaded (if the device supports it) or rendered.
+      std::unique_ptr<ITexture> streamingPhasesTexture;
       std::unique_ptr<IRenderTarget> phasesTexture;
+      std::vector<float> phaseTexels;
 
       std::unique_ptr<IRenderTarget> signalTexture;
-      std::unique_ptr<IRenderTarget> scratchSignalTexture;
+      std::unique_ptr<IRenderTarget> cleanSignalTexture;
 
       SourceSettings sourceSettings;
       Internal::SignalProperties signalProps;
       Internal::SignalLevels levels;
 
       ArtifactSettings artifactSettings;
+      SignalPrecision precision = SignalPrecision::Float32;
+      SignalGenerationPath generationPath = SignalGenerationPath::TwoPass;
 
       uint32_t frameStartPhaseNumerator = 0;
       uint32_t prevFrameStartPhaseNumerator = 0;
       bool isEvenFrame = false;
+
+      bool hasArtifacts = false;
+      bool commandsOutOfDate = true;
     };
   }
 }
\ No newline at end of file
@@ -1,15 +1,13 @@
 #pragma once
 
+#include "CathodeRetro/Settings.h"
+
 namespace CathodeRetro
 {
   namespace Internal
   {
-    struct SignalLevels
-    {
-      float temporalArtifactReduction;
-      float whiteLevel;
-      float blackLevel;
-      float saturationScale;
-    };
+    // The signal levels are part of the public settings (see Settings.h), since a signal can come from outside of the
+    //  generator.
+    using SignalLevels = CathodeRetro::SignalLevels;
   }
-}
\ No newline at end of file
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cassert>
+
+#include "CathodeRetro/GraphicsDevice.h"
 #include "CathodeRetro/Settings.h"
 
 
@@ -19,5 +22,22 @@ namespace CathodeRetro
       float inputPixelAspectRatio; // $TODO: Does this really belong here?
       uint32_t totalSidePaddingTexelCount = 0;
     };
+
+
+    // The float texture format with the given number of channels (1, 2, or 4) at the given signal precision.
+    inline TextureFormat SignalTextureFormat(SignalPrecision precision, uint32_t channelCount)
+    {
+      assert(channelCount == 1 || channelCount == 2 || channelCount == 4);
+      if (precision == SignalPrecision::Float16)
+      {
+        return (channelCount == 1) ? TextureFormat::R_Float16
+          : (channelCount == 2) ? TextureFormat::RG_Float16
+          : TextureFormat::RGBA_Float16;
+      }
+
+      return (channelCount == 1) ? TextureFormat::R_Float32
+        : (channelCount == 2) ? TextureFormat::RG_Float32
+        : TextureFormat::RGBA_Float32;
+    }
   }
 }
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "CathodeRetro/GraphicsDevice.h"
+
+
+namespace CathodeRetro
+{
+  namespace Internal
+  {
+    // A streaming texture whose contents come from the CPU a band of rows at a time (see StreamScanlines and
+    //  StreamSignalScanlines in CathodeRetro.h). If the device can't update only some of the rows of a texture (see
+    //  IGraphicsDevice::UpdateTextureRows), this keeps its own copy of the texels and replaces the whole texture from
+    //  that instead (which uploads the whole texture for every band, so it's only a fallback).
+    class StreamedTexture
+    {
+    public:
+      StreamedTexture(IGraphicsDevice *deviceIn, uint32_t width, uint32_t height, TextureFormat format)
+        : device(deviceIn)
+        , texture(device->CreateStreamingTexture(width, height, format))
+        { assert(texture != nullptr); }
+
+
+      ITexture *Texture() const
+        { return texture.get(); }
+
+
+      // Replace the rows [firstRow, firstRow + rowCount) of the texture with the given texels (in the texture's
+      //  format), where each row starts rowPitch bytes after the start of the previous one.
+      void UpdateRows(uint32_t firstRow, uint32_t rowCount, const void *texels, ptrdiff_t rowPitch)
+      {
+        if (cpuTexels.empty() && device->UpdateTextureRows(texture.get(), firstRow, rowCount, texels, rowPitch))
+        {
+          return;
+        }
+
+        size_t rowByteCount = size_t(texture->Width()) * TexelByteCount(texture->Format());
+        cpuTexels.resize(rowByteCount * texture->Height());
+        auto src = static_cast<const uint8_t *>(texels);
+        for (uint32_t y = firstRow; y < firstRow + rowCount; y++, src += rowPitch)
+        {
+          memcpy(&cpuTexels[rowByteCount * y], src, rowByteCount);
+        }
+
+        device->UpdateTexture(texture.get(), cpuTexels.data(), ptrdiff_t(rowByteCount));
+      }
+
+    private:
+      IGraphicsDevice *device;
+      std::unique_ptr<ITexture> texture;
+
+      // The copy of the texels, if the device can't update only some of the rows.
+      std::vector<uint8_t> cpuTexels;
+    };
+  }
+}
@@ -0,0 +1,416 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+#include "CathodeRetro/GraphicsDevice.h"
+
+
+namespace CathodeRetro
+{
+  namespace Internal
+  {
+    // This hands out the intermediate render targets that the pipeline stages use within a frame (the signal textures,
+    //  the decoder's intermediate textures, the blur textures, etc). The contents of these are never needed outside
+    //  of the frame's recorded commands, so the render targets that it creates are just stand-ins with no memory of
+    //  their own. Once a command list has been recorded, Allocate works out when each one is first and last used,
+    //  places the ones whose lifetimes don't overlap in the same memory, and then swaps the real render targets into
+    //  the recorded commands.
+    // The stand-ins can't be rendered to (or read from) outside of a recorded command list.
+    class TransientRenderTargets
+    {
+    public:
+      explicit TransientRenderTargets(IGraphicsDevice *deviceIn)
+        : device(deviceIn)
+        { }
+
+      TransientRenderTargets(const TransientRenderTargets &) = delete;
+      void operator=(const TransientRenderTargets &) = delete;
+
+      ~TransientRenderTargets()
+      {
+        // Every stand-in should be gone by now (they need to be destroyed before this is).
+        assert(standIns.empty());
+      }
+
+
+      // Create a stand-in render target with the given properties.
+      std::unique_ptr<IRenderTarget> Create(uint32_t width, uint32_t height, uint32_t mipCount, TextureFormat format)
+      {
+        if (mipCount == 0)
+        {
+          mipCount = FullMipCount(width, height);
+        }
+
+        return std::make_unique<StandIn>(this, width, height, mipCount, format);
+      }
+
+
+      // Place every stand-in that the commands use into real render targets, and point the commands at those. This
+      //  also updates the stats.
+      // If concurrentSplit is nonzero, the commands before that index and the ones from it on are going to be split
+      //  into two command lists that can run at the same time (see IGraphicsDevice::ExecuteConcurrently), so a stand-in
+      //  that's used on one side of the split never shares memory with one that's used on the other side.
+      // The stand-ins that are used by the commands from persistentBegin on keep their contents from one run of the
+      //  commands to the next (for rendering a frame in slices, where each slice only redoes some of their rows), so
+      //  they never share memory with anything.
+      void Allocate(
+        std::vector<RecordedCommand> *commands,
+        size_t concurrentSplit = 0,
+        size_t persistentBegin = ~size_t(0))
+      {
+        for (StandIn *standIn : standIns)
+        {
+          standIn->firstUse = k_unused;
+          standIn->lastUse = 0;
+          standIn->sides = 0;
+          standIn->actual = nullptr;
+        }
+
+        // Figure out the lifetime of each stand-in, in terms of the indices of the first and last commands that use
+        //  it.
+        for (uint32_t i = 0; i < uint32_t(commands->size()); i++)
+        {
+          const RecordedCommand &command = (*commands)[i];
+          if (command.type != RecordedCommand::Type::RenderQuad)
+          {
+            continue;
+          }
+
+          uint32_t side = (concurrentSplit != 0 && i >= concurrentSplit) ? k_afterSplit : k_beforeSplit;
+          MarkUse(command.output.texture, i, side);
+          for (uint32_t input = 0; input < command.inputCount; input++)
+          {
+            MarkUse(command.inputs[input].texture, i, side);
+          }
+        }
+
+        // Stretching the lifetimes of the persistent stand-ins over every command keeps anything else from being
+        //  placed in their memory.
+        for (size_t i = persistentBegin; i < commands->size(); i++)
+        {
+          const RecordedCommand &command = (*commands)[i];
+          if (command.type != RecordedCommand::Type::RenderQuad)
+          {
+            continue;
+          }
+
+          uint32_t lastCommand = uint32_t(commands->size() - 1);
+          MarkUse(command.output.texture, 0, 0);
+          MarkUse(command.output.texture, lastCommand, 0);
+          for (uint32_t input = 0; input < command.inputCount; input++)
+          {
+            MarkUse(command.inputs[input].texture, 0, 0);
+            MarkUse(command.inputs[input].texture, lastCommand, 0);
+          }
+        }
+
+        std::vector<StandIn *> used;
+        for (StandIn *standIn : standIns)
+        {
+          if (standIn->firstUse != k_unused)
+          {
+            used.push_back(standIn);
+          }
+        }
+
+        stats = TransientMemoryStats();
+        stats.renderTargetCount = uint32_t(standIns.size());
+        stats.usedRenderTargetCount = uint32_t(used.size());
+        for (StandIn *standIn : standIns)
+        {
+          stats.unaliasedByteCount += standIn->byteCount;
+        }
+
+        if (!deviceHasMemory || !AllocateInMemory(used))
+        {
+          AllocateShared(used);
+        }
+
+        // Now that everything has a real render target, swap them into the commands.
+        for (RecordedCommand &command : *commands)
+        {
+          if (command.type != RecordedCommand::Type::RenderQuad)
+          {
+            continue;
+          }
+
+          if (StandIn *standIn = Find(command.output.texture))
+          {
+            command.output.texture = standIn->actual;
+          }
+
+          for (uint32_t input = 0; input < command.inputCount; input++)
+          {
+            if (StandIn *standIn = Find(command.inputs[input].texture))
+            {
+              command.inputs[input].texture = standIn->actual;
+            }
+          }
+        }
+      }
+
+
+      const TransientMemoryStats &Stats() const
+        { return stats; }
+
+    private:
+      static constexpr uint32_t k_unused = ~0u;
+
+      // The bits of StandIn::sides.
+      static constexpr uint32_t k_beforeSplit = 1;
+      static constexpr uint32_t k_afterSplit = 2;
+      static constexpr size_t k_placementAlignment = 256;
+
+      class StandIn : public IRenderTarget
+      {
+      public:
+        StandIn(TransientRenderTargets *ownerIn, uint32_t w, uint32_t h, uint32_t mips, TextureFormat fmt)
+          : owner(ownerIn)
+          , width(w)
+          , height(h)
+          , mipCount(mips)
+          , format(fmt)
+          , byteCount(RenderTargetByteCount(w, h, mips, fmt))
+        {
+          owner->standIns.push_back(this);
+        }
+
+        ~StandIn()
+        {
+          auto &list = owner->standIns;
+          list.erase(std::find(list.begin(), list.end(), this));
+        }
+
+        uint32_t Width() const override
+          { return width; }
+
+        uint32_t Height() const override
+          { return height; }
+
+        uint32_t MipCount() const override
+          { return mipCount; }
+
+        TextureFormat Format() const override
+          { return format; }
+
+        bool Matches(const StandIn &other) const
+        {
+          return width == other.width
+            && height == other.height
+            && mipCount == other.mipCount
+            && format == other.format;
+        }
+
+        // Two stand-ins on opposite sides of a concurrent split count as overlapping no matter where they're used,
+        //  since the two sides can be running at the same time.
+        bool LifetimeOverlaps(const StandIn &other) const
+        {
+          return (firstUse <= other.lastUse && other.firstUse <= lastUse)
+            || (sides | other.sides) == (k_beforeSplit | k_afterSplit);
+        }
+
+        TransientRenderTargets *owner;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipCount;
+        TextureFormat format;
+        size_t byteCount;
+
+        uint32_t firstUse = k_unused;
+        uint32_t lastUse = 0;
+        uint32_t sides = 0;
+        IRenderTarget *actual = nullptr;
+      };
+
+
+      StandIn *Find(const ITexture *texture) const
+      {
+        for (StandIn *standIn : standIns)
+        {
+          if (standIn == texture)
+          {
+            return standIn;
+          }
+        }
+
+        return nullptr;
+      }
+
+
+      void MarkUse(const ITexture *texture, uint32_t commandIndex, uint32_t side)
+      {
+        if (StandIn *standIn = Find(texture))
+        {
+          standIn->firstUse = std::min(standIn->firstUse, commandIndex);
+          standIn->lastUse = std::max(standIn->lastUse, commandIndex);
+          standIn->sides |= side;
+        }
+      }
+
+
+      // Place the stand-ins at byte offsets into a single IRenderTargetMemory, such that any two whose lifetimes
+      //  overlap don't overlap in memory either. Returns false if the device doesn't support render target memory.
+      bool AllocateInMemory(const std::vector<StandIn *> &used)
+      {
+        // Place the largest ones first, each at the lowest offset that doesn't collide with anything already placed
+        //  that is alive at the same time (the usual greedy approach, which does well for a handful of resources).
+        std::vector<StandIn *> order = used;
+        std::stable_sort(
+          order.begin(),
+          order.end(),
+          [](const StandIn *a, const StandIn *b) { return a->byteCount > b->byteCount; });
+
+        struct Placement
+        {
+          StandIn *standIn;
+          size_t offset;
+        };
+
+        std::vector<Placement> placements;
+        size_t totalByteCount = 0;
+        for (StandIn *standIn : order)
+        {
+          size_t offset = 0;
+          for (bool moved = true; moved;)
+          {
+            moved = false;
+            for (const Placement &placed : placements)
+            {
+              if (placed.standIn->LifetimeOverlaps(*standIn)
+                && offset < placed.offset + placed.standIn->byteCount
+                && placed.offset < offset + standIn->byteCount)
+              {
+                offset = AlignUp(placed.offset + placed.standIn->byteCount);
+                moved = true;
+              }
+            }
+          }
+
+          placements.push_back({standIn, offset});
+          totalByteCount = std::max(totalByteCount, offset + standIn->byteCount);
+        }
+
+        // Keep the existing memory if it's big enough, since this runs whenever the commands get recorded again.
+        actualTargets.clear();
+        if (memory == nullptr || memoryByteCount < totalByteCount)
+        {
+          memory = nullptr;
+          memory = device->CreateRenderTargetMemory(std::max(totalByteCount, k_placementAlignment));
+          if (memory == nullptr)
+          {
+            deviceHasMemory = false;
+            return false;
+          }
+
+          memoryByteCount = std::max(totalByteCount, k_placementAlignment);
+        }
+
+        for (const Placement &placed : placements)
+        {
+          StandIn *s = placed.standIn;
+          actualTargets.push_back(
+            memory->CreateRenderTarget(placed.offset, s->width, s->height, s->mipCount, s->format));
+          s->actual = actualTargets.back().get();
+        }
+
+        stats.usesRenderTargetMemory = true;
+        stats.aliasedByteCount = memoryByteCount;
+        return true;
+      }
+
+
+      // Without render target memory, the best we can do is to have stand-ins with identical properties (whose
+      //  lifetimes don't overlap, and which are on the same side of any concurrent split) share the same render target.
+      void AllocateShared(const std::vector<StandIn *> &used)
+      {
+        struct Shared
+        {
+          std::unique_ptr<IRenderTarget> target;
+          const StandIn *desc;
+          uint32_t lastUse;
+          uint32_t sides;
+        };
+
+        // Any render targets from the last allocation can be reused (as long as they match), since their contents
+        //  don't need to be kept.
+        std::vector<std::unique_ptr<IRenderTarget>> previous = std::move(actualTargets);
+        actualTargets.clear();
+
+        std::vector<StandIn *> order = used;
+        std::stable_sort(
+          order.begin(),
+          order.end(),
+          [](const StandIn *a, const StandIn *b) { return a->firstUse < b->firstUse; });
+
+        std::vector<Shared> shared;
+        for (StandIn *standIn : order)
+        {
+          Shared *match = nullptr;
+          for (Shared &candidate : shared)
+          {
+            if (candidate.desc->Matches(*standIn)
+              && candidate.lastUse < standIn->firstUse
+              && (candidate.sides | standIn->sides) != (k_beforeSplit | k_afterSplit))
+            {
+              match = &candidate;
+              break;
+            }
+          }
+
+          if (match == nullptr)
+          {
+            std::unique_ptr<IRenderTarget> target;
+            for (auto &prev : previous)
+            {
+              if (prev != nullptr
+                && prev->Width() == standIn->width
+                && prev->Height() == standIn->height
+                && prev->MipCount() == standIn->mipCount
+                && prev->Format() == standIn->format)
+              {
+                target = std::move(prev);
+                break;
+              }
+            }
+
+            if (target == nullptr)
+            {
+              target = device->CreateRenderTarget(standIn->width, standIn->height, standIn->mipCount, standIn->format);
+            }
+
+            shared.push_back({std::move(target), standIn, 0, 0});
+            match = &shared.back();
+            stats.aliasedByteCount += standIn->byteCount;
+          }
+
+          match->lastUse = standIn->lastUse;
+          match->sides |= standIn->sides;
+          standIn->actual = match->target.get();
+        }
+
+        for (Shared &s : shared)
+        {
+          actualTargets.push_back(std::move(s.target));
+        }
+      }
+
+
+      static size_t AlignUp(size_t byteCount)
+        { return (byteCount + k_placementAlignment - 1) & ~(k_placementAlignment - 1); }
+
+
+      IGraphicsDevice *device;
+      std::vector<StandIn *> standIns;
+
+      bool deviceHasMemory = true;
+      std::unique_ptr<IRenderTargetMemory> memory;
+      size_t memoryByteCount = 0;
+      std::vector<std::unique_ptr<IRenderTarget>> actualTargets;
+
+      TransientMemoryStats stats;
+    };
+  }
+}
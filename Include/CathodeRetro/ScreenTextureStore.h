@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "CathodeRetro/Settings.h"
+
+
+namespace CathodeRetro
+{
+  // This identifies a generated screen texture: it holds everything that the screen texture's contents depend on,
+  //  which is the output size, the mask type, and the constants that the generation shader gets (these are worked out
+  //  from the output size, the input's dimensions and pixel aspect ratio, the overscan settings, and the screen
+  //  settings' distortion, edge and corner rounding, and mask scale). Two screen textures with equal keys are
+  //  identical.
+  struct ScreenTextureKey
+  {
+    // This gets bumped whenever the screen texture would come out differently for the same key (for instance, because
+    //  the generation shader changed), so that an IScreenTextureStore can tell when what it saved is stale.
+    static constexpr uint32_t k_version = 1;
+
+    static constexpr uint32_t k_parameterCount = 14;
+
+    bool operator==(const ScreenTextureKey &other) const { return memcmp(this, &other, sizeof(*this)) == 0; }
+    bool operator!=(const ScreenTextureKey &other) const { return memcmp(this, &other, sizeof(*this)) != 0; }
+
+    // A 64-bit FNV-1a hash of the key, for stores that need a short name for each key (like a file name).
+    uint64_t Hash() const
+    {
+      uint64_t hash = 0xCBF29CE484222325ULL;
+      auto bytes = reinterpret_cast<const uint8_t *>(this);
+      for (size_t i = 0; i < sizeof(*this); i++)
+      {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+      }
+
+      return hash;
+    }
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    MaskType maskType = MaskType::SlotMask;
+    float parameters[k_parameterCount] = {};
+  };
+
+
+  // An app can give Cathode Retro one of these to keep generated screen textures around between runs (see
+  //  CathodeRetro::SetScreenTextureStore): whenever Cathode Retro needs a screen texture that it doesn't already have,
+  //  it tries loading it from the store before generating it, and it saves each one that it does generate. Screen
+  //  textures are always width x height RGBA_Unorm8 texels, tightly packed, starting with the row at the v = 0 edge.
+  // Saving requires the graphics device to support IGraphicsDevice::ReadRenderTarget, and loading requires it to
+  //  support IGraphicsDevice::CreateStaticTexture.
+  class IScreenTextureStore
+  {
+  public:
+    virtual ~IScreenTextureStore() = default;
+
+    // Fill texelsOut with the stored screen texture for the given key, returning false if there isn't one.
+    virtual bool Load(const ScreenTextureKey &key, void *texelsOut) = 0;
+
+    // Store the given screen texture for the given key (replacing any that's already stored for it).
+    virtual void Save(const ScreenTextureKey &key, const void *texels) = 0;
+  };
+}
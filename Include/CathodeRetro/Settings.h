@@ -14,6 +14,38 @@ namespace CathodeRetro
   };
 
 
+  // The precision of the float textures that carry the signal through the generator and decoder (the generated
+  //  signal and its intermediate luma/chroma textures). Float16 halves the memory (and bandwidth) that they use, and
+  //  is plenty for the values involved, but the output will differ very slightly from the Float32 output.
+  enum class SignalPrecision
+  {
+    Float32,
+    Float16,
+  };
+
+
+  // Which set of passes decodes a composite signal back into RGB. ThreePass separates the luma from the chroma,
+  //  demodulates the chroma, and low-pass filters it in three separate passes (with a float texture in between each),
+  //  while SinglePass does all of that in one pass, which does more math per texel but skips the memory traffic of
+  //  those intermediate textures. They give the same results (give or take floating-point rounding).
+  enum class CompositeDecodePath
+  {
+    ThreePass,
+    SinglePass,
+  };
+
+
+  // Which set of passes generates the signal when there are artifacts (ghosting or noise) to apply. TwoPass generates
+  //  the clean signal into a float texture and then applies the artifacts to it in a second pass, while SinglePass
+  //  applies them as it generates the signal, recomputing the clean signal for each ghost tap instead of reading it
+  //  back from a texture. They give the same results (give or take floating-point rounding).
+  enum class SignalGenerationPath
+  {
+    TwoPass,
+    SinglePass,
+  };
+
+
   enum class ScanlineType
   {
     Odd,                // This is an "odd" interlaced frame, the (1-based) odd scanlines will be full brightness.
@@ -109,6 +141,24 @@ namespace CathodeRetro
   };
 
 
+  // This describes the levels of a signal, which the decoder needs in order to turn it back into RGB. The generator's
+  //  signals always have the default levels (other than the temporal artifact reduction, which comes from the
+  //  ArtifactSettings), but a signal from somewhere else (see CathodeRetro::StreamSignalScanlines) can have its own.
+  struct SignalLevels
+  {
+    bool operator==(const SignalLevels &other) const { return memcmp(this, &other, sizeof(*this)) == 0; }
+    bool operator!=(const SignalLevels &other) const { return memcmp(this, &other, sizeof(*this)) != 0; }
+
+    // How much to blend the two phases of a doubled-up signal together. If this is nonzero, every texel of the signal
+    //  holds two versions of it (generated at different phases), and the phases texture holds two phases per scanline.
+    float temporalArtifactReduction = 0.0f;
+
+    float whiteLevel = 1.0f;                // The signal level of white
+    float blackLevel = 0.0f;                // The signal level of black
+    float saturationScale = 0.5f;           // How much the chroma in the signal is scaled relative to full saturation
+  };
+
+
   // These settings describe the screen properties of the virtual CRT TV that is displaying the image: things like how
   //  curved is the screen and the appearance of the mask and scanlines.
   struct ScreenSettings
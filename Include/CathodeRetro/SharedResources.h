@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cassert>
+#include <map>
+#include <memory>
+
+#include "CathodeRetro/AssetPack.h"
+#include "CathodeRetro/GraphicsDevice.h"
+#include "CathodeRetro/Settings.h"
+
+
+namespace CathodeRetro
+{
+  // This holds the resources that don't depend on any one CathodeRetro instance's settings (the shaders, and the CRT
+  //  mask textures), so that any number of instances using the same graphics device can share a single copy of each
+  //  instead of every instance creating its own. Pass the same SharedResources to each CathodeRetro's constructor.
+  // Everything is created the first time something asks for it and is reference-counted: the cache itself only keeps
+  //  weak references, so a shader or mask texture goes away once the last instance using it is done with it (and is
+  //  created again if something asks for it later). The SharedResources needs to outlive the instances that use it
+  //  (and the graphics device needs to outlive all of them).
+  // Like the graphics device, this is not thread-safe.
+  class SharedResources
+  {
+  public:
+    explicit SharedResources(IGraphicsDevice *deviceIn)
+      : device(deviceIn)
+      { }
+
+    SharedResources(const SharedResources &) = delete;
+    void operator=(const SharedResources &) = delete;
+
+
+    IGraphicsDevice *Device() const
+      { return device; }
+
+
+    // Use the prebuilt textures in the given asset pack (which needs to outlive this) instead of rendering them, where
+    //  the device supports it (see IGraphicsDevice::CreateStaticTexture). Pass nullptr to go back to rendering them.
+    //  This only affects textures that get created after the call.
+    void SetAssetPack(const AssetPack *pack)
+      { assetPack = pack; }
+
+
+    // Get the shader with the given ID, creating it if no one is using it yet.
+    std::shared_ptr<IShader> Shader(ShaderID id)
+    {
+      std::weak_ptr<IShader> &entry = shaders[id];
+      if (std::shared_ptr<IShader> shader = entry.lock())
+      {
+        return shader;
+      }
+
+      std::shared_ptr<IShader> shader = device->CreateShader(id);
+      entry = shader;
+      return shader;
+    }
+
+
+    // Get the (fully mipped) mask texture for the given mask type, creating it if no one is using it yet: it gets
+    //  uploaded from the asset pack if there is one, and rendered otherwise. Since this might render, it must be called
+    //  between the device's BeginRendering and EndRendering.
+    std::shared_ptr<ITexture> MaskTexture(MaskType type)
+    {
+      std::weak_ptr<ITexture> &entry = maskTextures[type];
+      if (std::shared_ptr<ITexture> texture = entry.lock())
+      {
+        return texture;
+      }
+
+      std::shared_ptr<ITexture> texture = LoadMaskTexture(type);
+      if (texture == nullptr)
+      {
+        std::shared_ptr<IRenderTarget> renderTarget =
+          device->CreateRenderTarget(k_maskSize, k_maskSize / 2, 0, TextureFormat::RGBA_Unorm8);
+
+        RenderMaskTexture(type, renderTarget.get());
+        texture = std::move(renderTarget);
+      }
+
+      entry = texture;
+      return texture;
+    }
+
+
+    // Render the given mask texture (which needs to be a k_maskSize x k_maskSize / 2 RGBA_Unorm8 render target with all
+    //  of its mip levels) the same way MaskTexture would, ignoring the asset pack. This is what the asset pack builder
+    //  uses to bake them.
+    void RenderMaskTexture(MaskType type, IRenderTarget *maskTexture)
+    {
+      assert(maskTexture->Width() == k_maskSize && maskTexture->Height() == k_maskSize / 2);
+      device->BeginPass(PassID::CRT_MaskTexture);
+      RenderMaskMips(type, maskTexture);
+      device->EndPass();
+    }
+
+
+    static constexpr uint32_t k_maskSize = 512;
+
+  private:
+    // Upload the given mask texture from the asset pack, if the pack has it (at the expected size and format) and the
+    //  device can create static textures.
+    std::unique_ptr<ITexture> LoadMaskTexture(MaskType type)
+    {
+      AssetPack::Texture texture;
+      if (assetPack == nullptr
+        || !assetPack->FindTexture(MaskAssetID(type), &texture)
+        || texture.format != TextureFormat::RGBA_Unorm8
+        || texture.width != k_maskSize
+        || texture.height != k_maskSize / 2
+        || texture.mipCount != FullMipCount(k_maskSize, k_maskSize / 2))
+      {
+        return nullptr;
+      }
+
+      return device->CreateStaticTexture(
+        texture.width,
+        texture.height,
+        texture.mipCount,
+        texture.format,
+        texture.texels);
+    }
+
+
+    // Generate the mask texture we use for the CRT emulation
+    void RenderMaskMips(MaskType type, IRenderTarget *maskTexture)
+    {
+      ShaderID generateShaderID = ShaderID::CRT_GenerateSlotMask;
+      switch (type)
+      {
+      case MaskType::SlotMask:
+        generateShaderID = ShaderID::CRT_GenerateSlotMask;
+        break;
+
+      case MaskType::ShadowMask:
+        generateShaderID = ShaderID::CRT_GenerateShadowMask;
+        break;
+
+      case MaskType::ApertureGrille:
+        generateShaderID = ShaderID::CRT_GenerateApertureGrille;
+        break;
+      }
+
+      // The mask generation shaders are only needed while a mask is being rendered, so they're let go of once it's
+      //  done. The half-width texture that the downsampling goes through is kept, though: there's only ever one of it
+      //  no matter how many instances there are.
+      std::shared_ptr<IShader> generateShader = Shader(generateShaderID);
+      std::shared_ptr<IShader> downsample2XShader = Shader(ShaderID::Util_Downsample2X);
+      if (halfWidthMaskTexture == nullptr)
+      {
+        halfWidthMaskTexture = device->CreateRenderTarget(
+          k_maskSize / 2,
+          k_maskSize / 2,
+          0,
+          TextureFormat::RGBA_Unorm8);
+        generateMaskConstantBuffer = device->CreateConstantBuffer(sizeof(Vec2));
+        maskDownsampleConstantBufferH = device->CreateConstantBuffer(sizeof(Vec2));
+        maskDownsampleConstantBufferV = device->CreateConstantBuffer(sizeof(Vec2));
+      }
+
+      // First step is the generate the texture at the largest mip level
+      generateMaskConstantBuffer->Update(Vec2{ float(k_maskSize), float(k_maskSize / 2) });
+      device->RenderQuad(
+        generateShader.get(),
+        maskTexture,
+        {},
+        generateMaskConstantBuffer.get());
+
+      // Now it's generated so we need to generate the mips by using our lanczos downsample
+      maskDownsampleConstantBufferH->Update(Vec2{ 1.0f, 0.0f });
+      maskDownsampleConstantBufferV->Update(Vec2{ 0.0f, 1.0f });
+      for (uint32_t destMip = 1; destMip < maskTexture->MipCount(); destMip++)
+      {
+        device->RenderQuad(
+          downsample2XShader.get(),
+          {halfWidthMaskTexture.get(), destMip - 1},
+          {{maskTexture, destMip - 1, SamplerType::LinearWrap}},
+          maskDownsampleConstantBufferH.get());
+
+        device->RenderQuad(
+          downsample2XShader.get(),
+          {maskTexture, destMip},
+          {{halfWidthMaskTexture.get(), destMip - 1, SamplerType::LinearWrap}},
+          maskDownsampleConstantBufferV.get());
+      }
+    }
+
+
+    IGraphicsDevice *device;
+    const AssetPack *assetPack = nullptr;
+
+    std::map<ShaderID, std::weak_ptr<IShader>> shaders;
+    std::map<MaskType, std::weak_ptr<ITexture>> maskTextures;
+
+    std::unique_ptr<IRenderTarget> halfWidthMaskTexture;
+    std::unique_ptr<IConstantBuffer> generateMaskConstantBuffer;
+    std::unique_ptr<IConstantBuffer> maskDownsampleConstantBufferH;
+    std::unique_ptr<IConstantBuffer> maskDownsampleConstantBufferV;
+  };
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+#include "CathodeRetro/Settings.h"
+
+
+namespace CathodeRetro
+{
+  // One frame of the signal that the generator made: everything that the decoder (and the CRT passes) got from it, so
+  //  that the frame can be decoded again later through CathodeRetro::StreamSignalScanlines and
+  //  CathodeRetro::SetExternalSignalLevels, without the input or the generator.
+  struct RecordedSignalFrame
+  {
+    // What the CathodeRetro instance that made the signal was created with. An instance that decodes the signal again
+    //  needs to be created with the same type, input size, and source settings, so that its SignalScanlineWidth()
+    //  matches scanlineWidth.
+    SignalType signalType = SignalType::Composite;
+    uint32_t inputWidth = 0;
+    uint32_t inputHeight = 0;
+    SourceSettings sourceSettings;
+
+    ScanlineType scanlineType = ScanlineType::Progressive;
+    SignalLevels levels;
+
+    // The signal is scanlineCount rows of scanlineWidth texels, each of which is signalChannelCount 32-bit floats
+    //  (tightly packed, starting with the top scanline). There are phaseChannelCount phases per scanline (2 if the
+    //  signal is doubled up for temporal artifact reduction, 1 otherwise), in fractions of a colorburst cycle.
+    uint32_t scanlineWidth = 0;
+    uint32_t scanlineCount = 0;
+    uint32_t signalChannelCount = 0;
+    uint32_t phaseChannelCount = 0;
+    const float *signal = nullptr;
+    const float *phases = nullptr;
+  };
+
+
+  // An app can give Cathode Retro one of these to be handed the signal that the generator makes for every frame (see
+  //  CathodeRetro::SetSignalRecorder), for instance to save it to a file to run decoder and CRT experiments (or
+  //  benchmarks) on later, without re-running the emulator or the generator.
+  // Recording requires the graphics device to support IGraphicsDevice::ReadRenderTarget (which is allowed to wait for
+  //  the GPU) for the 32-bit float texture formats, and ShaderID::Util_Copy.
+  class ISignalRecorder
+  {
+  public:
+    virtual ~ISignalRecorder() = default;
+
+    // Record the given frame. Its signal and phases pointers are only valid for the duration of the call.
+    virtual void RecordFrame(const RecordedSignalFrame &frame) = 0;
+  };
+}
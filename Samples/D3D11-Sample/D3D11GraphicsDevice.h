@@ -221,9 +221,9 @@ public:
     uint32_t width,
     uint32_t height,
     CathodeRetro::TextureFormat format,
-    void *initialDataTexels)
+    const void *initialDataTexels)
   {
-    return CreateTexture(width, height, 1, format, false, initialDataTexels);
+    return CreateTexture(width, height, 1, format, TextureUsage::Static, initialDataTexels);
   }
 
 
@@ -232,7 +232,6 @@ public:
 
   std::unique_ptr<CathodeRetro::IShader> CreateShader(CathodeRetro::ShaderID id) override
   {
-    assert(!isRendering);
     int resourceID = 0;
     switch (id)
     {
@@ -243,11 +242,16 @@ public:
       case CathodeRetro::ShaderID::Generator_GeneratePhaseTexture: resourceID = IDR_GENERATE_PHASE_TEXTURE; break;
       case CathodeRetro::ShaderID::Generator_RGBToSVideoOrComposite: resourceID = IDR_RGB_TO_SVIDEO_OR_COMPOSITE; break;
       case CathodeRetro::ShaderID::Generator_ApplyArtifacts: resourceID = IDR_APPLY_ARTIFACTS; break;
+      case CathodeRetro::ShaderID::Generator_RGBToSignalWithArtifacts:
+        resourceID = IDR_RGB_TO_SIGNAL_WITH_ARTIFACTS;
+        break;
       case CathodeRetro::ShaderID::Decoder_CompositeToSVideo: resourceID = IDR_COMPOSITE_TO_SVIDEO; break;
       case CathodeRetro::ShaderID::Decoder_SVideoToModulatedChroma: resourceID = IDR_SVIDEO_TO_MODULATED_CHROMA; break;
       case CathodeRetro::ShaderID::Decoder_SVideoToRGB: resourceID = IDR_SVIDEO_TO_RGB; break;
       case CathodeRetro::ShaderID::Decoder_FilterRGB: resourceID = IDR_FILTER_RGB; break;
+      case CathodeRetro::ShaderID::Decoder_CompositeToRGB: resourceID = IDR_COMPOSITE_TO_RGB; break;
       case CathodeRetro::ShaderID::CRT_GenerateScreenTexture: resourceID = IDR_GENERATE_SCREEN_TEXTURE; break;
+      case CathodeRetro::ShaderID::CRT_GenerateDistortionLUT: resourceID = IDR_GENERATE_DISTORTION_LUT; break;
       case CathodeRetro::ShaderID::CRT_GenerateSlotMask: resourceID = IDR_GENERATE_SLOT_MASK; break;
       case CathodeRetro::ShaderID::CRT_GenerateShadowMask: resourceID = IDR_GENERATE_SHADOW_MASK; break;
       case CathodeRetro::ShaderID::CRT_GenerateApertureGrille: resourceID = IDR_GENERATE_APERTURE_GRILLE; break;
@@ -270,7 +274,6 @@ public:
 
   std::unique_ptr<CathodeRetro::IConstantBuffer> CreateConstantBuffer(size_t size) override
   {
-    assert(!isRendering);
     // Constant buffers must be multiples of 16 bytes in size so round up if we're off.
     if (size & 0x0F)
     {
@@ -302,7 +305,7 @@ public:
           height,
           mipCount,
           format,
-          true,
+          TextureUsage::RenderTarget,
           nullptr).release())
       };
   }
@@ -387,6 +390,20 @@ public:
       vp.MaxDepth = 1.0f;
 
       context->RSSetViewports(1, &vp);
+
+      // Texture row 0 is the top of the viewport, so the output's rectangle maps straight onto a scissor rect (and the
+      //  viewport stays the whole target, which keeps the texture coordinates the same).
+      if (output.rowCount != 0 || output.columnCount != 0)
+      {
+        D3D11_RECT scissor;
+        scissor.left = LONG((output.columnCount != 0) ? output.firstColumn : 0);
+        scissor.top = LONG((output.rowCount != 0) ? output.firstRow : 0);
+        scissor.right = LONG((output.columnCount != 0) ? output.firstColumn + output.columnCount : viewportWidth);
+        scissor.bottom = LONG((output.rowCount != 0) ? output.firstRow + output.rowCount : viewportHeight);
+
+        context->RSSetState(scissorRasterizerState);
+        context->RSSetScissorRects(1, &scissor);
+      }
     }
 
     context->PSSetShader(static_cast<D3DPixelShader *>(ps)->shader, nullptr, 0);
@@ -413,6 +430,11 @@ public:
       context->PSSetShaderResources(0, UINT(inputs.size()), nullSrvs);
     }
 
+    if (output.rowCount != 0 || output.columnCount != 0)
+    {
+      context->RSSetState(rasterizerState);
+    }
+
     rtv = nullptr;
     context->OMSetRenderTargets(1, &rtv, nullptr);
   }
@@ -429,21 +451,130 @@ public:
   }
 
 
+  std::unique_ptr<CathodeRetro::ITexture> CreateStreamingTexture(
+    uint32_t width,
+    uint32_t height,
+    CathodeRetro::TextureFormat format) override
+  {
+    return CreateTexture(width, height, 1, format, TextureUsage::Streaming, nullptr);
+  }
+
+
+  void UpdateTexture(CathodeRetro::ITexture *texture, const void *texels, ptrdiff_t rowPitch) override
+  {
+    UpdateTextureRows(texture, 0, texture->Height(), texels, rowPitch);
+  }
+
+
+  // Streaming textures are default-usage textures that get updated with UpdateSubresource (rather than dynamic ones
+  //  that get mapped with WRITE_DISCARD, which can only be replaced as a whole), so that just a band of rows can be
+  //  replaced. If the GPU is still using the texture, the driver copies the texels aside and does the update later,
+  //  so this doesn't wait either way.
+  bool UpdateTextureRows(
+    CathodeRetro::ITexture *texture,
+    uint32_t firstRow,
+    uint32_t rowCount,
+    const void *texels,
+    ptrdiff_t rowPitch) override
+  {
+    auto d3dTexture = static_cast<D3DTexture *>(texture);
+    assert(firstRow + rowCount <= d3dTexture->height);
+    if (rowCount == 0)
+    {
+      return true;
+    }
+
+    D3D11_BOX box = {};
+    box.right = d3dTexture->width;
+    box.back = 1;
+    if (rowPitch >= 0)
+    {
+      box.top = firstRow;
+      box.bottom = firstRow + rowCount;
+      context->UpdateSubresource(d3dTexture->texture, 0, &box, texels, UINT(rowPitch), 0);
+    }
+    else
+    {
+      // UpdateSubresource can't read rows bottom-up, so those go a row at a time.
+      auto src = static_cast<const uint8_t *>(texels);
+      for (uint32_t y = firstRow; y < firstRow + rowCount; y++, src += rowPitch)
+      {
+        box.top = y;
+        box.bottom = y + 1;
+        context->UpdateSubresource(d3dTexture->texture, 0, &box, src, 0, 0);
+      }
+    }
+
+    return true;
+  }
+
+
+  std::unique_ptr<CathodeRetro::ITexture> CreateStaticTexture(
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipCount,
+    CathodeRetro::TextureFormat format,
+    const void *texels) override
+  {
+    return CreateTexture(width, height, mipCount, format, TextureUsage::Static, texels);
+  }
+
+
+  // This copies the top mip level into a staging texture and maps that, which waits for the GPU to get through
+  //  everything up to the copy.
+  bool ReadRenderTarget(const CathodeRetro::IRenderTarget *renderTarget, void *texelsOut) override
+  {
+    auto d3dTexture = static_cast<const D3DTexture *>(renderTarget);
+
+    D3D11_TEXTURE2D_DESC desc;
+    d3dTexture->texture->GetDesc(&desc);
+    desc.MipLevels = 1;
+    desc.Usage = D3D11_USAGE_STAGING;
+    desc.BindFlags = 0;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    desc.MiscFlags = 0;
+
+    ComPtr<ID3D11Texture2D> staging;
+    CHECK_HRESULT(device->CreateTexture2D(&desc, nullptr, staging.AddressForReplace()), "create staging texture");
+    context->CopySubresourceRegion(staging, 0, 0, 0, 0, d3dTexture->texture, 0, nullptr);
+
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    CHECK_HRESULT(context->Map(staging, 0, D3D11_MAP_READ, 0, &mapped), "map staging texture");
+
+    size_t rowByteCount = size_t(d3dTexture->width) * CathodeRetro::TexelByteCount(d3dTexture->format);
+    auto src = static_cast<const uint8_t *>(mapped.pData);
+    auto dest = static_cast<uint8_t *>(texelsOut);
+    for (uint32_t y = 0; y < d3dTexture->height; y++, src += mapped.RowPitch, dest += rowByteCount)
+    {
+      memcpy(dest, src, rowByteCount);
+    }
+
+    context->Unmap(staging, 0);
+    return true;
+  }
+
+
 private:
   struct Vertex
   {
     float x, y;
   };
 
+  enum class TextureUsage
+  {
+    Static,
+    RenderTarget,
+    Streaming,
+  };
+
   std::unique_ptr<CathodeRetro::ITexture> CreateTexture(
     uint32_t width,
     uint32_t height,
     uint32_t mipCount,
     CathodeRetro::TextureFormat format,
-    bool isRenderTarget,
-    void *initialDataTexels)
+    TextureUsage usage,
+    const void *initialDataTexels)
   {
-    assert(!isRendering);
     std::unique_ptr<D3DTexture> tex = std::make_unique<D3DTexture>();
 
     DXGI_FORMAT dxgiFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
@@ -469,6 +600,21 @@ private:
       dxgiFormat = DXGI_FORMAT_R32G32B32A32_FLOAT;
       texelByteCount = 4 * sizeof(float);
       break;
+
+    case CathodeRetro::TextureFormat::R_Float16:
+      dxgiFormat = DXGI_FORMAT_R16_FLOAT;
+      texelByteCount = 1 * sizeof(uint16_t);
+      break;
+
+    case CathodeRetro::TextureFormat::RG_Float16:
+      dxgiFormat = DXGI_FORMAT_R16G16_FLOAT;
+      texelByteCount = 2 * sizeof(uint16_t);
+      break;
+
+    case CathodeRetro::TextureFormat::RGBA_Float16:
+      dxgiFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
+      texelByteCount = 4 * sizeof(uint16_t);
+      break;
     }
 
     {
@@ -479,22 +625,30 @@ private:
       desc.Format = dxgiFormat;
       desc.SampleDesc.Count = 1;
       desc.Usage = D3D11_USAGE_DEFAULT;
-      desc.CPUAccessFlags = (isRenderTarget) ? D3D11_CPU_ACCESS_WRITE : 0;
+      desc.CPUAccessFlags = (usage == TextureUsage::RenderTarget) ? D3D11_CPU_ACCESS_WRITE : 0;
       desc.MipLevels = mipCount;
       desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-      if (isRenderTarget)
+      if (usage == TextureUsage::RenderTarget)
       {
         desc.BindFlags |= D3D11_BIND_RENDER_TARGET;
       }
 
-      D3D11_SUBRESOURCE_DATA initialDataStorage = {};
+      // Initial data has one entry per mip level, each one starting right after the end of the previous one.
+      std::vector<D3D11_SUBRESOURCE_DATA> initialDataStorage;
       D3D11_SUBRESOURCE_DATA *initialData = nullptr;
       if (initialDataTexels != nullptr)
       {
-        initialData = &initialDataStorage;
+        assert(mipCount != 0);
+        auto texels = static_cast<const uint8_t *>(initialDataTexels);
+        for (uint32_t mip = 0; mip < mipCount; mip++)
+        {
+          uint32_t mipWidth = std::max(1U, width >> mip);
+          uint32_t mipHeight = std::max(1U, height >> mip);
+          initialDataStorage.push_back({ texels, mipWidth * texelByteCount, 0 });
+          texels += size_t(mipWidth) * mipHeight * texelByteCount;
+        }
 
-        initialData->pSysMem = initialDataTexels;
-        initialData->SysMemPitch = width * texelByteCount;
+        initialData = initialDataStorage.data();
       }
 
       tex->width = width;
@@ -526,7 +680,7 @@ private:
         tex->mipSRVs.push_back(std::move(srv));
       }
 
-      if (isRenderTarget)
+      if (usage == TextureUsage::RenderTarget)
       {
         D3D11_RENDER_TARGET_VIEW_DESC desc = {};
         desc.Format = dxgiFormat;
@@ -699,6 +853,12 @@ private:
       CHECK_HRESULT(
         device->CreateRasterizerState(&desc, rasterizerState.AddressForReplace()),
         "create rasterizer state");
+
+      // This one is for rendering to a band of rows of the target (see CathodeRetro::RenderTargetView).
+      desc.ScissorEnable = true;
+      CHECK_HRESULT(
+        device->CreateRasterizerState(&desc, scissorRasterizerState.AddressForReplace()),
+        "create scissor rasterizer state");
     }
 
     {
@@ -722,6 +882,7 @@ private:
 
   ComPtr<ID3D11SamplerState> samplerStates[4];
   ComPtr<ID3D11RasterizerState> rasterizerState;
+  ComPtr<ID3D11RasterizerState> scissorRasterizerState;
   ComPtr<ID3D11BlendState> blendState;
 
   ComPtr<ID3D11VertexShader> vertexShader;
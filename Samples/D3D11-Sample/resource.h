@@ -21,12 +21,15 @@
 #define IDR_TONEMAP_AND_DOWNSAMPLE      115
 #define IDR_SVIDEO_TO_MODULATED_CHROMA  116
 #define IDR_COPY                        117
+#define IDR_COMPOSITE_TO_RGB            118
+#define IDR_RGB_TO_SIGNAL_WITH_ARTIFACTS 119
+#define IDR_GENERATE_DISTORTION_LUT     120
 
 // Next default values for new objects
 //
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        118
+#define _APS_NEXT_RESOURCE_VALUE        121
 #define _APS_NEXT_COMMAND_VALUE         40005
 #define _APS_NEXT_CONTROL_VALUE         1054
 #define _APS_NEXT_SYMED_VALUE           101
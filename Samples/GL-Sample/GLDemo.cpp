@@ -93,19 +93,14 @@ public:
     uint32_t *rgbaData) override
   {
     // Demo app loads in images where 0, 0 is the upper-left corner, but GL's images put 0,0 in the lower right, so we
-    //  need to vertically flip the image before creating the texture.
-    std::vector<uint32_t> rgbaDataFlipped;
-    rgbaDataFlipped.resize(width * height);
-    for (size_t y = 0; y < height; y++)
-    {
-      size_t srcY = (height - 1 - y);
-      memcpy(&rgbaDataFlipped[y * width], &rgbaData[srcY * width], width * sizeof(uint32_t));
-    }
-
-    return graphicsDevice->CreateTexture(
-      width,
-      height,
-      CathodeRetro::TextureFormat::RGBA_Unorm8, rgbaDataFlipped.data());
+    //  need to vertically flip the image. Uploading it through a streaming texture (the same way an emulator would
+    //  push each new frame) handles that without a temporary copy: start at the last row and step backwards.
+    auto texture = graphicsDevice->CreateStreamingTexture(width, height, CathodeRetro::TextureFormat::RGBA_Unorm8);
+    graphicsDevice->UpdateTexture(
+      texture.get(),
+      &rgbaData[size_t(height - 1) * width],
+      -ptrdiff_t(width * sizeof(uint32_t)));
+    return texture;
   }
 
 
@@ -136,10 +136,27 @@ public:
       glformat = GL_RG;
       type = GL_FLOAT;
       break;
+    case CathodeRetro::TextureFormat::RGBA_Float16:
+      internalFormat = GL_RGBA16F;
+      glformat = GL_RGBA;
+      type = GL_HALF_FLOAT;
+      break;
+    case CathodeRetro::TextureFormat::R_Float16:
+      internalFormat = GL_R16F;
+      glformat = GL_RED;
+      type = GL_HALF_FLOAT;
+      break;
+    case CathodeRetro::TextureFormat::RG_Float16:
+      internalFormat = GL_RG16F;
+      glformat = GL_RG;
+      type = GL_HALF_FLOAT;
+      break;
     }
 
     // Initialize the image to the correct size (with the correct initial contents)
     glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, glformat, type, optionalInitialDataTexels);
+    uploadFormat = glformat;
+    uploadType = type;
 
     if (mipCount != 1)
     {
@@ -181,6 +198,19 @@ public:
 
   ~GLTexture()
   {
+    if (unpackBuffers[0] != 0)
+    {
+      for (GLsync fence : unpackFences)
+      {
+        if (fence != nullptr)
+        {
+          glDeleteSync(fence);
+        }
+      }
+
+      glDeleteBuffers(k_unpackBufferCount, unpackBuffers);
+    }
+
     if (!fboHandles.empty())
     {
       glDeleteFramebuffers(GLsizei(fboHandles.size()), fboHandles.data());
@@ -223,6 +253,132 @@ public:
     return texHandle;
   }
 
+
+  // Replace the texels of every mip level with the given data (each level tightly packed, one after another).
+  void SetAllMips(const void *texels)
+  {
+    auto mipTexels = static_cast<const uint8_t *>(texels);
+    glBindTexture(GL_TEXTURE_2D, texHandle);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t mip = 0; mip < mipCount; mip++)
+    {
+      uint32_t mipWidth = std::max(1U, width >> mip);
+      uint32_t mipHeight = std::max(1U, height >> mip);
+      glTexSubImage2D(GL_TEXTURE_2D, mip, 0, 0, mipWidth, mipHeight, uploadFormat, uploadType, mipTexels);
+      mipTexels += size_t(mipWidth) * mipHeight * CathodeRetro::TexelByteCount(format);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    CheckGLError();
+  }
+
+
+  // Copy the texels of the top mip level out into texelsOut (tightly packed). This waits for the GPU to finish any
+  //  rendering to the texture.
+  void Read(void *texelsOut) const
+  {
+    glBindTexture(GL_TEXTURE_2D, texHandle);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, uploadFormat, uploadType, texelsOut);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    CheckGLError();
+  }
+
+
+  // Replace the rows [firstRow, firstRow + rowCount) of the top mip level with the given data, whose rows start
+  //  rowPitch bytes apart. The texels are copied into the next of a small ring of pixel unpack buffers and the texture
+  //  is updated from that buffer, so the copy out of the caller's memory happens right away but the upload itself
+  //  doesn't stall. Updates can come in much faster than the GPU gets through them (StreamScanlines can hand over one
+  //  scanline at a time), so if the GPU hasn't finished with a buffer by the time it comes back around in the ring,
+  //  the buffer gets orphaned (the driver hands it fresh storage) rather than waited on.
+  void Update(const void *texels, ptrdiff_t rowPitch, uint32_t firstRow, uint32_t rowCount)
+  {
+    assert(firstRow + rowCount <= height);
+    if (rowCount == 0)
+    {
+      return;
+    }
+
+    size_t rowByteCount = size_t(width) * CathodeRetro::TexelByteCount(format);
+    size_t byteCount = rowByteCount * height;
+    if (unpackBuffers[0] == 0)
+    {
+      glGenBuffers(k_unpackBufferCount, unpackBuffers);
+      for (GLuint buffer : unpackBuffers)
+      {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(byteCount), nullptr, GL_STREAM_DRAW);
+      }
+    }
+
+    uint32_t index = nextUnpackBufferIndex;
+    nextUnpackBufferIndex = (nextUnpackBufferIndex + 1) % k_unpackBufferCount;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffers[index]);
+    if (unpackFences[index] != nullptr)
+    {
+      // Only poll the fence (a timeout of 0 never waits).
+      GLenum status = glClientWaitSync(unpackFences[index], 0, 0);
+      if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+      {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(byteCount), nullptr, GL_STREAM_DRAW);
+      }
+
+      glDeleteSync(unpackFences[index]);
+      unpackFences[index] = nullptr;
+    }
+
+    // Either way, nothing is using this buffer's storage anymore, so it can be mapped without synchronization. (Each
+    //  buffer is big enough for the whole texture, but only the rows being updated get written.)
+    auto dest = static_cast<uint8_t *>(
+      glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER,
+        0,
+        GLsizeiptr(rowByteCount * rowCount),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+
+    glBindTexture(GL_TEXTURE_2D, texHandle);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (dest != nullptr)
+    {
+      auto src = static_cast<const uint8_t *>(texels);
+      for (uint32_t y = 0; y < rowCount; y++, dest += rowByteCount, src += rowPitch)
+      {
+        memcpy(dest, src, rowByteCount);
+      }
+
+      glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+      // With an unpack buffer bound, the "pointer" to the texels is an offset into that buffer.
+      glTexSubImage2D(
+        GL_TEXTURE_2D,
+        0,
+        0,
+        GLint(firstRow),
+        GLsizei(width),
+        GLsizei(rowCount),
+        uploadFormat,
+        uploadType,
+        nullptr);
+      unpackFences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    else
+    {
+      // The buffer couldn't be mapped (the driver ran out of memory for it, say), so upload straight from the caller's
+      //  memory instead, a row at a time (since rowPitch need not be a whole number of texels).
+      glGetError();
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      auto src = static_cast<const uint8_t *>(texels);
+      for (uint32_t y = 0; y < rowCount; y++, src += rowPitch)
+      {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, GLint(firstRow + y), GLsizei(width), 1, uploadFormat, uploadType, src);
+      }
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    CheckGLError();
+  }
+
 private:
   GLTexture(uint32_t w, uint32_t h)
     : width(w)
@@ -240,6 +396,14 @@ private:
   GLuint texHandle = 0;
   CathodeRetro::TextureFormat format = CathodeRetro::TextureFormat::RGBA_Unorm8;
   std::vector<GLuint> fboHandles;
+  GLenum uploadFormat = GL_RGBA;
+  GLenum uploadType = GL_UNSIGNED_BYTE;
+
+  // These are only created if the texture gets updated from the CPU (see Update).
+  static constexpr uint32_t k_unpackBufferCount = 3;
+  GLuint unpackBuffers[k_unpackBufferCount] = {};
+  GLsync unpackFences[k_unpackBufferCount] = {};
+  uint32_t nextUnpackBufferIndex = 0;
 };
 
 
@@ -280,6 +444,19 @@ public:
 
   ~GLGraphicsDevice()
   {
+    for (auto &frame : timerFrames)
+    {
+      for (auto &query : frame.queries)
+      {
+        freeTimerQueries.push_back(query.second);
+      }
+    }
+
+    if (!freeTimerQueries.empty())
+    {
+      glDeleteQueries(GLsizei(freeTimerQueries.size()), freeTimerQueries.data());
+    }
+
     glDeleteShader(vertexShaderHandle);
     glDeleteVertexArrays(1, &vertexArrayObject);
     glDeleteBuffers(1, &vertexBufferObject);
@@ -340,6 +517,10 @@ public:
         .textureNames = { "g_sourceTexture", "g_scanlinePhases"}
       },
       { .path = "Content/cathode-retro-generator-apply-artifacts.hlsl", .textureNames = { "g_sourceTexture" } },
+      {
+        .path = "Content/cathode-retro-generator-rgb-to-signal-with-artifacts.hlsl",
+        .textureNames = { "g_sourceTexture", "g_scanlinePhases"}
+      },
 
       { .path = "Content/cathode-retro-decoder-composite-to-svideo.hlsl", .textureNames = { "g_sourceTexture" } },
       {
@@ -351,8 +532,13 @@ public:
         .textureNames = { "g_sourceTexture", "g_modulatedChromaTexture"}
       },
       { .path = "Content/cathode-retro-decoder-filter-rgb.hlsl", .textureNames = { "g_sourceTexture" } },
+      {
+        .path = "Content/cathode-retro-decoder-composite-to-rgb.hlsl",
+        .textureNames = { "g_sourceTexture", "g_scanlinePhases"}
+      },
 
       { .path = "Content/cathode-retro-crt-generate-screen-texture.hlsl", .textureNames = { "g_maskTexture" } },
+      { .path = "Content/cathode-retro-crt-generate-distortion-lut.hlsl", .textureNames = {} },
       { .path = "Content/cathode-retro-crt-generate-slot-mask.hlsl", .textureNames = {} },
       { .path = "Content/cathode-retro-crt-generate-shadow-mask.hlsl", .textureNames = {} },
       { .path = "Content/cathode-retro-crt-generate-aperture-grille.hlsl", .textureNames = {} },
@@ -364,6 +550,7 @@ public:
           "g_previousFrameTexture",
           "g_screenMaskTexture",
           "g_diffusionTexture",
+          "g_distortionLUT",
         }
       },
     };
@@ -392,6 +579,47 @@ public:
     // All of our quads use the same vertex array.
     glBindVertexArray(vertexArrayObject);
     CheckGLError();
+
+    // If the timer queries from the last time we used this frame's slot still haven't been read back, we have to wait
+    //  for them now (this only stalls if the GPU is a full k_timerFrameCount frames behind).
+    auto &frame = timerFrames[timerFrameIndex];
+    if (!frame.queries.empty())
+    {
+      ResolveTimerFrame(&frame);
+    }
+  }
+
+
+  void BeginPass(CathodeRetro::PassID pass) override
+  {
+    GLuint query;
+    if (freeTimerQueries.empty())
+    {
+      glGenQueries(1, &query);
+    }
+    else
+    {
+      query = freeTimerQueries.back();
+      freeTimerQueries.pop_back();
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    timerFrames[timerFrameIndex].queries.push_back({pass, query});
+    CheckGLError();
+  }
+
+
+  void EndPass() override
+  {
+    glEndQuery(GL_TIME_ELAPSED);
+    CheckGLError();
+  }
+
+
+  bool GetFrameStats(CathodeRetro::FrameStats *statsOut) override
+  {
+    *statsOut = lastFrameStats;
+    return lastFrameStats.isValid;
   }
 
 
@@ -401,109 +629,408 @@ public:
     std::initializer_list<CathodeRetro::ShaderResourceView> inputs,
     CathodeRetro::IConstantBuffer *constantBuffer) override
   {
-    // Start rendering to the correct mip level of the given texture and set up the viewport properly.
-    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLTexture *>(output.texture)->FBOHandle(output.mipLevel));
-    glViewport(
-      0,
-      0,
-      std::max(output.texture->Width() >> output.mipLevel, 1U),
-      std::max(output.texture->Height() >> output.mipLevel, 1U));
-
-    // Bind our shaders
-    auto programHandle = static_cast<GLShader *>(ps)->ShaderProgramHandle();
-    glUseProgram(programHandle);
-
-    // Set up our constants if we have any
+    QuadBinding binding;
+    BindOutput(&binding, output);
+    binding.programHandle = static_cast<GLShader *>(ps)->ShaderProgramHandle();
     if (constantBuffer != nullptr)
     {
-      glUniformBlockBinding(programHandle, 0, 0);
-      glBindBufferBase(GL_UNIFORM_BUFFER, 0, static_cast<GLConstantBuffer *>(constantBuffer)->Handle());
+      binding.uniformBufferHandle = static_cast<GLConstantBuffer *>(constantBuffer)->Handle();
     }
 
-    // Set up each texture
-    for (size_t i = 0; i < inputs.size(); i++)
+    assert(inputs.size() <= std::size(binding.inputs));
+    for (auto &input : inputs)
     {
-      auto &input = inputs.begin()[i];
+      binding.inputs[binding.inputCount++] = BindInput(input);
+    }
 
-      auto texHandle = static_cast<const GLTexture *>(input.texture)->TexHandle();
-      glActiveTexture(GLenum(GL_TEXTURE0 + i));
-      glBindTexture(GL_TEXTURE_2D, texHandle);
-      switch (input.samplerType)
-      {
-      case CathodeRetro::SamplerType::LinearWrap:
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(
-          GL_TEXTURE_2D,
-          GL_TEXTURE_MIN_FILTER,
-          (input.texture->MipCount() == 1) ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        break;
+    DrawQuad(binding);
+  }
 
-      case CathodeRetro::SamplerType::LinearClamp:
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-        glTexParameteri(
-          GL_TEXTURE_2D,
-          GL_TEXTURE_MIN_FILTER,
-          (input.texture->MipCount() == 1) ? GL_LINEAR : GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        break;
 
-      case CathodeRetro::SamplerType::NearestWrap:
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(
-          GL_TEXTURE_2D,
-          GL_TEXTURE_MIN_FILTER,
-          (input.texture->MipCount() == 1) ? GL_NEAREST: GL_NEAREST_MIPMAP_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        break;
+  std::unique_ptr<CathodeRetro::ICommandList> CreateCommandList(
+    std::vector<CathodeRetro::RecordedCommand> commands) override
+  {
+    return std::make_unique<CommandList>(this, commands);
+  }
+
 
-      case CathodeRetro::SamplerType::NearestClamp:
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-        glTexParameteri(
-          GL_TEXTURE_2D,
-          GL_TEXTURE_MIN_FILTER,
-          (input.texture->MipCount() == 1) ? GL_NEAREST : GL_NEAREST_MIPMAP_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  std::unique_ptr<CathodeRetro::ITexture> CreateStreamingTexture(
+    uint32_t width,
+    uint32_t height,
+    CathodeRetro::TextureFormat format) override
+  {
+    return std::make_unique<GLTexture>(width, height, 1, format, false, nullptr);
+  }
+
+
+  void UpdateTexture(CathodeRetro::ITexture *texture, const void *texels, ptrdiff_t rowPitch) override
+  {
+    static_cast<GLTexture *>(texture)->Update(texels, rowPitch, 0, texture->Height());
+  }
+
+
+  bool UpdateTextureRows(
+    CathodeRetro::ITexture *texture,
+    uint32_t firstRow,
+    uint32_t rowCount,
+    const void *texels,
+    ptrdiff_t rowPitch) override
+  {
+    static_cast<GLTexture *>(texture)->Update(texels, rowPitch, firstRow, rowCount);
+    return true;
+  }
+
+
+  std::unique_ptr<CathodeRetro::ITexture> CreateStaticTexture(
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipCount,
+    CathodeRetro::TextureFormat format,
+    const void *texels) override
+  {
+    auto texture = std::make_unique<GLTexture>(width, height, mipCount, format, false, nullptr);
+    texture->SetAllMips(texels);
+    return texture;
+  }
+
+
+  bool ReadRenderTarget(const CathodeRetro::IRenderTarget *renderTarget, void *texelsOut) override
+  {
+    static_cast<const GLTexture *>(renderTarget)->Read(texelsOut);
+    return true;
+  }
+
+
+  void EndRendering() override
+  {
+    // Set our framebuffer back to the render target.
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    CheckGLError();
+
+    // Move on to the next frame's set of queries, then read back any earlier frames whose results are ready (without
+    //  waiting on anything), oldest first so that the stats end up holding the newest completed frame.
+    timerFrameIndex = (timerFrameIndex + 1) % k_timerFrameCount;
+    for (uint32_t i = 0; i < k_timerFrameCount; i++)
+    {
+      auto &frame = timerFrames[(timerFrameIndex + i) % k_timerFrameCount];
+      if (frame.queries.empty())
+      {
+        continue;
+      }
+
+      // Queries complete in order, so if the last one is done they all are.
+      GLuint available = 0;
+      glGetQueryObjectuiv(frame.queries.back().second, GL_QUERY_RESULT_AVAILABLE, &available);
+      if (!available)
+      {
         break;
       }
 
-      if (input.mipLevel >= 0)
+      ResolveTimerFrame(&frame);
+    }
+  }
+
+
+private:
+  // Everything needed to draw a single quad, with the Cathode Retro objects already resolved down to GL handles and
+  //  texture parameter values.
+  struct QuadBinding
+  {
+    struct Input
+    {
+      GLuint texHandle;
+      GLint wrap;
+      GLint minFilter;
+      GLint magFilter;
+      GLint baseLevel;
+      GLint maxLevel;
+    };
+
+    GLuint fboHandle = 0;
+    GLsizei viewportWidth = 0;
+    GLsizei viewportHeight = 0;
+    bool hasScissor = false;        // If this is false the whole target gets rendered
+    GLint scissorX = 0;
+    GLint scissorY = 0;
+    GLsizei scissorWidth = 0;
+    GLsizei scissorHeight = 0;
+    GLuint programHandle = 0;
+    GLuint uniformBufferHandle = 0; // 0 means "no constant buffer"
+    Input inputs[CathodeRetro::RecordedCommand::k_maxInputs];
+    uint32_t inputCount = 0;
+  };
+
+
+  // A command list for the GL device is a list of QuadBindings (and pass markers) that have been resolved up front, so
+  //  that executing it only has to issue the GL calls. Only the commands that use the frame's input texture or output
+  //  target need any resolving at execution time.
+  class CommandList : public CathodeRetro::ICommandList
+  {
+  public:
+    CommandList(GLGraphicsDevice *deviceIn, const std::vector<CathodeRetro::RecordedCommand> &recorded)
+      : device(deviceIn)
+    {
+      commands.reserve(recorded.size());
+      for (auto &rec : recorded)
       {
-        // We specified a mip level so clamp our base and max to the given level
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, input.mipLevel);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, input.mipLevel);
+        Command command;
+        command.type = rec.type;
+        command.pass = rec.pass;
+        command.frameInputMask = rec.frameInputMask;
+        command.outputIsFrameOutput = rec.outputIsFrameOutput;
+        command.output = rec.output;
+
+        if (rec.type == CathodeRetro::RecordedCommand::Type::RenderQuad)
+        {
+          QuadBinding &binding = command.binding;
+          if (!rec.outputIsFrameOutput)
+          {
+            BindOutput(&binding, rec.output);
+          }
+
+          binding.programHandle = static_cast<GLShader *>(rec.shader)->ShaderProgramHandle();
+          if (rec.constantBuffer != nullptr)
+          {
+            binding.uniformBufferHandle = static_cast<GLConstantBuffer *>(rec.constantBuffer)->Handle();
+          }
+
+          for (uint32_t i = 0; i < rec.inputCount; i++)
+          {
+            command.inputViews[i] = rec.inputs[i];
+            if ((rec.frameInputMask & (1u << i)) == 0)
+            {
+              binding.inputs[i] = BindInput(rec.inputs[i]);
+            }
+          }
+
+          binding.inputCount = rec.inputCount;
+        }
+
+        commands.push_back(command);
       }
-      else
+    }
+
+
+    void Execute(const CathodeRetro::ITexture *frameInput, CathodeRetro::IRenderTarget *frameOutput) override
+      { ExecuteRows(frameInput, frameOutput, 0, 0); }
+
+
+    void ExecuteRows(
+      const CathodeRetro::ITexture *frameInput,
+      CathodeRetro::IRenderTarget *frameOutput,
+      uint32_t firstRow,
+      uint32_t rowCount) override
+    {
+      for (Command &command : commands)
       {
-        // Use every mip level available.
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, input.texture->MipCount() - 1);
+        switch (command.type)
+        {
+        case CathodeRetro::RecordedCommand::Type::BeginPass:
+          device->BeginPass(command.pass);
+          break;
+
+        case CathodeRetro::RecordedCommand::Type::EndPass:
+          device->EndPass();
+          break;
+
+        case CathodeRetro::RecordedCommand::Type::RenderQuad:
+          if (command.outputIsFrameOutput)
+          {
+            CathodeRetro::RenderTargetView output = command.output;
+            output.texture = frameOutput;
+            BindOutput(&command.binding, output);
+          }
+
+          for (uint32_t i = 0; i < command.binding.inputCount; i++)
+          {
+            if ((command.frameInputMask & (1u << i)) != 0)
+            {
+              CathodeRetro::ShaderResourceView view = command.inputViews[i];
+              view.texture = frameInput;
+              command.binding.inputs[i] = BindInput(view);
+            }
+          }
+
+          if (rowCount != 0)
+          {
+            QuadBinding bandBinding = command.binding;
+            bandBinding.hasScissor = true;
+            bandBinding.scissorY = GLint(firstRow);
+            bandBinding.scissorHeight = GLsizei(rowCount);
+            device->DrawQuad(bandBinding);
+          }
+          else
+          {
+            device->DrawQuad(command.binding);
+          }
+          break;
+        }
       }
     }
 
+  private:
+    struct Command
+    {
+      CathodeRetro::RecordedCommand::Type type;
+      CathodeRetro::PassID pass;
+      QuadBinding binding;
+      CathodeRetro::ShaderResourceView inputViews[CathodeRetro::RecordedCommand::k_maxInputs];
+      uint32_t frameInputMask;
+      bool outputIsFrameOutput;
+      CathodeRetro::RenderTargetView output = {nullptr};
+    };
+
+    GLGraphicsDevice *device;
+    std::vector<Command> commands;
+  };
+
+
+  static void BindOutput(QuadBinding *binding, CathodeRetro::RenderTargetView output)
+  {
+    binding->fboHandle = static_cast<GLTexture *>(output.texture)->FBOHandle(output.mipLevel);
+    binding->viewportWidth = GLsizei(std::max(output.texture->Width() >> output.mipLevel, 1U));
+    binding->viewportHeight = GLsizei(std::max(output.texture->Height() >> output.mipLevel, 1U));
+
+    // Framebuffer row 0 is texture row 0 (the quad's v = 0 edge), so the output's rectangle maps straight onto a
+    //  scissor rect. The viewport stays the whole target, which keeps the texture coordinates the same.
+    binding->hasScissor = (output.rowCount != 0 || output.columnCount != 0);
+    binding->scissorX = 0;
+    binding->scissorY = 0;
+    binding->scissorWidth = binding->viewportWidth;
+    binding->scissorHeight = binding->viewportHeight;
+    if (output.rowCount != 0)
+    {
+      binding->scissorY = GLint(output.firstRow);
+      binding->scissorHeight = GLsizei(output.rowCount);
+    }
+
+    if (output.columnCount != 0)
+    {
+      binding->scissorX = GLint(output.firstColumn);
+      binding->scissorWidth = GLsizei(output.columnCount);
+    }
+  }
+
+
+  static QuadBinding::Input BindInput(const CathodeRetro::ShaderResourceView &input)
+  {
+    using CathodeRetro::SamplerType;
+    bool isLinear = (input.samplerType == SamplerType::LinearClamp || input.samplerType == SamplerType::LinearWrap);
+    bool isWrap = (input.samplerType == SamplerType::LinearWrap || input.samplerType == SamplerType::NearestWrap);
+    bool hasMips = (input.texture->MipCount() != 1);
+
+    QuadBinding::Input bound;
+    bound.texHandle = static_cast<const GLTexture *>(input.texture)->TexHandle();
+    bound.wrap = isWrap ? GL_REPEAT : GL_CLAMP;
+    bound.magFilter = isLinear ? GL_LINEAR : GL_NEAREST;
+    if (isLinear)
+    {
+      bound.minFilter = hasMips ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+    }
+    else
+    {
+      bound.minFilter = hasMips ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST;
+    }
+
+    if (input.mipLevel >= 0)
+    {
+      // We specified a mip level so clamp our base and max to the given level
+      bound.baseLevel = input.mipLevel;
+      bound.maxLevel = input.mipLevel;
+    }
+    else
+    {
+      // Use every mip level available.
+      bound.baseLevel = 0;
+      bound.maxLevel = GLint(input.texture->MipCount() - 1);
+    }
+
+    return bound;
+  }
+
+
+  void DrawQuad(const QuadBinding &binding)
+  {
+    // Start rendering to the correct mip level of the given texture and set up the viewport properly.
+    glBindFramebuffer(GL_FRAMEBUFFER, binding.fboHandle);
+    glViewport(0, 0, binding.viewportWidth, binding.viewportHeight);
+    if (binding.hasScissor)
+    {
+      glEnable(GL_SCISSOR_TEST);
+      glScissor(binding.scissorX, binding.scissorY, binding.scissorWidth, binding.scissorHeight);
+    }
+
+    // Bind our shaders
+    glUseProgram(binding.programHandle);
+
+    // Set up our constants if we have any
+    if (binding.uniformBufferHandle != 0)
+    {
+      glUniformBlockBinding(binding.programHandle, 0, 0);
+      glBindBufferBase(GL_UNIFORM_BUFFER, 0, binding.uniformBufferHandle);
+    }
+
+    // Set up each texture
+    for (uint32_t i = 0; i < binding.inputCount; i++)
+    {
+      auto &input = binding.inputs[i];
+      glActiveTexture(GLenum(GL_TEXTURE0 + i));
+      glBindTexture(GL_TEXTURE_2D, input.texHandle);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, input.wrap);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, input.wrap);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, input.minFilter);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, input.magFilter);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, input.baseLevel);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, input.maxLevel);
+    }
+
     // Set the active texture back to 0 now that we're done with all that.
     glActiveTexture(GL_TEXTURE0);
 
     // Finally, draw the quad.
     glDrawArrays(GL_TRIANGLES, 0, 6);
+    if (binding.hasScissor)
+    {
+      glDisable(GL_SCISSOR_TEST);
+    }
+
     CheckGLError();
   }
 
 
-  void EndRendering() override
+  // The GL_TIME_ELAPSED queries issued for a single frame, one per pass.
+  struct TimerFrame
   {
-    // Set our framebuffer back to the render target.
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    std::vector<std::pair<CathodeRetro::PassID, GLuint>> queries;
+  };
+
+
+  void ResolveTimerFrame(TimerFrame *frame)
+  {
+    CathodeRetro::FrameStats stats;
+    for (auto &query : frame->queries)
+    {
+      GLuint64 nanoseconds = 0;
+      glGetQueryObjectui64v(query.second, GL_QUERY_RESULT, &nanoseconds);
+      stats.passMilliseconds[size_t(query.first)] += float(double(nanoseconds) / 1000000.0);
+      freeTimerQueries.push_back(query.second);
+    }
+
     CheckGLError();
+    frame->queries.clear();
+    stats.isValid = true;
+    lastFrameStats = stats;
   }
 
 
-private:
   GLuint vertexBufferObject = 0;
   GLuint vertexArrayObject = 0;
   GLuint vertexShaderHandle = 0;
+
+  // Timer query results show up a few frames late, so keep a ring of frames' worth of them in flight.
+  static constexpr uint32_t k_timerFrameCount = 4;
+  TimerFrame timerFrames[k_timerFrameCount];
+  uint32_t timerFrameIndex = 0;
+  std::vector<GLuint> freeTimerQueries;
+  CathodeRetro::FrameStats lastFrameStats;
 };
\ No newline at end of file
@@ -34,6 +34,9 @@
 #define WGL_CONTEXT_PROFILE_MASK_ARB      0x9126
 
 
+#define GL_MAP_WRITE_BIT                  0x0002
+#define GL_MAP_INVALIDATE_BUFFER_BIT      0x0008
+#define GL_MAP_UNSYNCHRONIZED_BIT         0x0020
 #define GL_INVALID_FRAMEBUFFER_OPERATION  0x0506
 #define GL_TEXTURE_BASE_LEVEL             0x813C
 #define GL_TEXTURE_MAX_LEVEL              0x813D
@@ -73,9 +76,14 @@
 #define GL_TEXTURE30                      0x84DE
 #define GL_TEXTURE31                      0x84DF
 #define GL_RGBA32F                        0x8814
+#define GL_QUERY_RESULT                   0x8866
+#define GL_QUERY_RESULT_AVAILABLE         0x8867
 #define GL_ARRAY_BUFFER                   0x8892
+#define GL_TIME_ELAPSED                   0x88BF
+#define GL_STREAM_DRAW                    0x88E0
 #define GL_STATIC_DRAW                    0x88E4
 #define GL_DYNAMIC_DRAW                   0x88E8
+#define GL_PIXEL_UNPACK_BUFFER            0x88EC
 #define GL_UNIFORM_BUFFER                 0x8A11
 #define GL_FRAGMENT_SHADER                0x8B30
 #define GL_VERTEX_SHADER                  0x8B31
@@ -90,15 +98,26 @@
 #define GL_FRAMEBUFFER_COMPLETE           0x8CD5
 #define GL_COLOR_ATTACHMENT0              0x8CE0
 #define GL_FRAMEBUFFER                    0x8D40
+#define GL_SYNC_GPU_COMMANDS_COMPLETE     0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT        0x00000001
+#define GL_TIMEOUT_IGNORED                0xFFFFFFFFFFFFFFFFull
 
 using GLsizeiptr = std::make_signed_t<size_t>;
+using GLintptr = std::make_signed_t<size_t>;
 using GLchar = char;
+using GLuint64 = uint64_t;
+using GLsync = struct __GLsync *;
 
 
 void (*glGenBuffers) (GLsizei n, GLuint *arraysOut) = nullptr;
 void (*glBindBuffer) (GLenum target, GLuint buffer) = nullptr;
 void (*glBufferData) (GLenum target, GLsizeiptr size, const void *data, GLenum usage) = nullptr;
 void (*glDeleteBuffers) (GLsizei n, const GLuint * buffers);
+void *(*glMapBufferRange) (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) = nullptr;
+GLboolean (*glUnmapBuffer) (GLenum target) = nullptr;
+GLsync (*glFenceSync) (GLenum condition, GLbitfield flags) = nullptr;
+GLenum (*glClientWaitSync) (GLsync sync, GLbitfield flags, GLuint64 timeout) = nullptr;
+void (*glDeleteSync) (GLsync sync) = nullptr;
 GLuint (*glCreateShader) (GLenum shaderType) = nullptr;
 HGLRC (WINAPI *wglCreateContextAttribsARB) (HDC hDC, HGLRC hShareContext, const int *attribList) = nullptr;
 void (*glShaderSource) (GLuint shader, GLsizei count, const GLchar **string, const GLint *length) = nullptr;
@@ -158,6 +177,12 @@ void (*glGetActiveUniform) (
   GLchar *name);
 void (*glClampColor) (GLenum target, GLenum clamp);
 void (*glDeleteProgram) (GLuint program);
+void (*glGenQueries) (GLsizei n, GLuint *ids);
+void (*glDeleteQueries) (GLsizei n, const GLuint *ids);
+void (*glBeginQuery) (GLenum target, GLuint id);
+void (*glEndQuery) (GLenum target);
+void (*glGetQueryObjectuiv) (GLuint id, GLenum pname, GLuint *params);
+void (*glGetQueryObjectui64v) (GLuint id, GLenum pname, GLuint64 *params);
 
 
 // Using an out parameter here so I don't have to specify the function output type as a template parameter.
@@ -185,6 +210,11 @@ inline void InitializeGLHelpers()
     LOAD_GL_FUNCTION(glBindBuffer);
     LOAD_GL_FUNCTION(glBufferData);
     LOAD_GL_FUNCTION(glDeleteBuffers);
+    LOAD_GL_FUNCTION(glMapBufferRange);
+    LOAD_GL_FUNCTION(glUnmapBuffer);
+    LOAD_GL_FUNCTION(glFenceSync);
+    LOAD_GL_FUNCTION(glClientWaitSync);
+    LOAD_GL_FUNCTION(glDeleteSync);
     LOAD_GL_FUNCTION(wglCreateContextAttribsARB);
     LOAD_GL_FUNCTION(glCreateShader);
     LOAD_GL_FUNCTION(glShaderSource);
@@ -225,6 +255,12 @@ inline void InitializeGLHelpers()
     LOAD_GL_FUNCTION(glGetActiveUniform);
     LOAD_GL_FUNCTION(glClampColor);
     LOAD_GL_FUNCTION(glDeleteProgram);
+    LOAD_GL_FUNCTION(glGenQueries);
+    LOAD_GL_FUNCTION(glDeleteQueries);
+    LOAD_GL_FUNCTION(glBeginQuery);
+    LOAD_GL_FUNCTION(glEndQuery);
+    LOAD_GL_FUNCTION(glGetQueryObjectuiv);
+    LOAD_GL_FUNCTION(glGetQueryObjectui64v);
     return true;
   }();
 }
@@ -0,0 +1,127 @@
+// An offline tool that builds a Cathode Retro asset pack (see CathodeRetro/AssetPack.h): it renders each of the mask
+//  textures (with their whole mip chains) once, on the CPU via SoftwareGraphicsDevice, and writes them all out into a
+//  single binary file. Loading that pack (see the batch tool's --asset-pack option) turns creating a mask texture from
+//  a couple of dozen render passes into a single upload.
+//
+// The pack is tied to AssetPack::k_version, so it needs to be rebuilt whenever that changes.
+
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CathodeRetro/AssetPack.h"
+#include "CathodeRetro/SharedResources.h"
+
+#include "SoftwareGraphicsDevice.h"
+
+
+static void PrintUsage()
+{
+  printf(
+    "Usage: cathode-retro-asset-pack [options] <output file>\n"
+    "\n"
+    "Options:\n"
+    "  --threads <n>      Render threads (default: 0, one per hardware thread)\n"
+    "  -h, --help         Show this message\n");
+}
+
+
+int main(int argc, char **argv)
+{
+  using namespace CathodeRetro;
+
+  try
+  {
+    SoftwareSIMD::CheckCPUSupport();
+
+    uint32_t threadCount = 0;
+    std::string outputPath;
+
+    for (int i = 1; i < argc; i++)
+    {
+      std::string arg = argv[i];
+      if (arg == "-h" || arg == "--help")
+      {
+        PrintUsage();
+        return 0;
+      }
+
+      if (arg[0] != '-')
+      {
+        outputPath = arg;
+        continue;
+      }
+
+      if (i + 1 >= argc)
+      {
+        throw std::runtime_error("Missing value for " + arg);
+      }
+
+      std::string value = argv[++i];
+      if (arg == "--threads")
+      {
+        threadCount = uint32_t(strtoul(value.c_str(), nullptr, 10));
+      }
+      else
+      {
+        throw std::runtime_error("Unknown option " + arg);
+      }
+    }
+
+    if (outputPath.empty())
+    {
+      PrintUsage();
+      return 1;
+    }
+
+    SoftwareGraphicsDevice device(threadCount);
+    SharedResources sharedResources(&device);
+
+    // Render every mask into its own texture (these need to stay around until the pack is built, since the pack
+    //  entries point at their texels).
+    std::vector<std::unique_ptr<CathodeRetro::IRenderTarget>> masks;
+    std::vector<AssetPack::BuildEntry> entries;
+    device.BeginRendering();
+    for (auto maskType : { MaskType::SlotMask, MaskType::ShadowMask, MaskType::ApertureGrille })
+    {
+      masks.push_back(
+        device.CreateRenderTarget(
+          SharedResources::k_maskSize,
+          SharedResources::k_maskSize / 2,
+          0,
+          TextureFormat::RGBA_Unorm8));
+      sharedResources.RenderMaskTexture(maskType, masks.back().get());
+
+      auto texture = static_cast<const SoftwareTexture *>(masks.back().get());
+      entries.push_back({
+        MaskAssetID(maskType),
+        { texture->Format(), texture->Width(), texture->Height(), texture->MipCount(), texture->MipData(0) } });
+    }
+
+    device.EndRendering();
+
+    std::vector<uint8_t> pack = AssetPack::Build(entries);
+
+    FILE *file = fopen(outputPath.c_str(), "wb");
+    if (file == nullptr)
+    {
+      throw std::runtime_error("Failed to open " + outputPath);
+    }
+
+    bool wrote = (fwrite(pack.data(), 1, pack.size(), file) == pack.size());
+    if (fclose(file) != 0 || !wrote)
+    {
+      throw std::runtime_error("Failed to write " + outputPath);
+    }
+
+    printf("Wrote %zu assets (%zu bytes) to %s\n", entries.size(), pack.size(), outputPath.c_str());
+    return 0;
+  }
+  catch (const std::exception &ex)
+  {
+    fprintf(stderr, "Error: %s\n", ex.what());
+    return 1;
+  }
+}
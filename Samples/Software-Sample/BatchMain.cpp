@@ -0,0 +1,830 @@
+// A headless command-line tool that runs the whole Cathode Retro pipeline (on the CPU, via SoftwareGraphicsDevice) over
+//  a batch of PNG files, writing one output PNG per input. Inputs are processed in order as a sequence of frames, so
+//  the per-frame effects (phase alternation, noise, temporal artifact reduction) carry from one image to the next.
+//
+// Decoding, rendering, and encoding each run on their own threads so that the PNG work overlaps the rendering.
+
+#include <glob.h>
+#include <strings.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CathodeRetro/AssetPack.h"
+#include "CathodeRetro/CathodeRetro.h"
+#include "CathodeRetro/SettingPresets.h"
+
+#include "CommandLine.h"
+#include "MappedFile.h"
+#include "PngFile.h"
+#include "ScreenTextureDirectory.h"
+#include "SignalRecordingFile.h"
+#include "SoftwareGraphicsDevice.h"
+
+
+namespace fs = std::filesystem;
+
+
+struct Options
+{
+  std::vector<std::string> inputs;
+  std::string outputDirectory;
+
+  CathodeRetro::SignalType signalType = CathodeRetro::SignalType::Composite;
+  CathodeRetro::SignalPrecision signalPrecision = CathodeRetro::SignalPrecision::Float32;
+  CathodeRetro::CompositeDecodePath compositeDecodePath = CathodeRetro::CompositeDecodePath::ThreePass;
+  CathodeRetro::SignalGenerationPath signalGenerationPath = CathodeRetro::SignalGenerationPath::TwoPass;
+  CathodeRetro::SourceSettings sourceSettings = CathodeRetro::k_sourcePresets[1].settings;
+  CathodeRetro::ArtifactSettings artifactSettings = CathodeRetro::k_artifactPresets[1].settings;
+  CathodeRetro::ScreenSettings screenSettings = CathodeRetro::k_screenPresets[4].settings;
+
+  // 0 means "pick an output size based on the input size".
+  uint32_t outputWidth = 0;
+  uint32_t outputHeight = 0;
+
+  uint32_t renderThreadCount = 0;
+  uint32_t ioThreadCount = 2;
+
+  // If set, the mask textures are loaded from this asset pack (see AssetPackMain.cpp) instead of being rendered.
+  std::string assetPackPath;
+
+  // If set, generated screen textures are saved to (and loaded from) this directory.
+  std::string screenCacheDirectory;
+
+  // If set, consecutive input images reuse the rows of their decoded frames that didn't change (see
+  //  CathodeRetro::SetDecodedFrameCacheEnabled).
+  bool cacheStaticFrames = false;
+
+  // With a latency of 1, each frame's generator and decoder passes run alongside the previous frame's CRT passes (see
+  //  CathodeRetro::SetPipelineLatency).
+  uint32_t pipelineLatency = 0;
+
+  // If nonzero, each frame is rendered in this many bands of scanlines, the way an emulator racing the beam would (see
+  //  CathodeRetro::RenderSlice).
+  uint32_t sliceCount = 0;
+
+  // If nonzero, each frame's scanlines are handed over from CPU memory in this many runs, the way an emulator would as
+  //  it produces them, and the frame is rendered once they're all in (see CathodeRetro::StreamScanlines).
+  uint32_t streamRunCount = 0;
+
+  // If set, every frame's generated signal is recorded to this file (see SignalRecordingFile.h), which
+  //  cathode-retro-decode-signal can decode again with --recording.
+  std::string signalRecordingPath;
+};
+
+
+// A single image as it moves through the decode -> render -> encode stages.
+struct Frame
+{
+  std::string inputPath;
+  std::string outputPath;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  std::vector<uint32_t> colors;
+  std::string error;
+};
+
+
+// A bounded queue whose items come out in index order regardless of the order they were pushed in, so that several
+//  threads can work on different frames at once while the next stage still sees them in sequence. A push blocks while
+//  its index is too far ahead of the next index to be popped, which keeps the number of frames in flight bounded.
+template <typename T>
+class OrderedQueue
+{
+public:
+  explicit OrderedQueue(size_t capacityIn)
+    : capacity(capacityIn)
+    { }
+
+
+  void Push(size_t index, T item)
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    spaceCondition.wait(lock, [&] { return index < nextPopIndex + capacity; });
+    items.emplace(index, std::move(item));
+    itemCondition.notify_all();
+  }
+
+
+  // Pop the next item in index order, waiting for it to be pushed if necessary. Every pushed index must get popped
+  //  exactly once.
+  T Pop()
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    size_t index = nextPopIndex++;
+    spaceCondition.notify_all();
+
+    itemCondition.wait(lock, [&] { return items.count(index) != 0; });
+    auto iter = items.find(index);
+    T item = std::move(iter->second);
+    items.erase(iter);
+    return item;
+  }
+
+private:
+  size_t capacity;
+  size_t nextPopIndex = 0;
+  std::map<size_t, T> items;
+  std::mutex mutex;
+  std::condition_variable itemCondition;
+  std::condition_variable spaceCondition;
+};
+
+
+static void PrintUsage()
+{
+  printf(
+    "Usage: cathode-retro-batch [options] -o <output directory> <input>...\n"
+    "\n"
+    "Each input can be a PNG file, a directory (every .png file in it is used), or a quoted glob pattern. Inputs are\n"
+    "  processed in sorted order as a sequence of frames.\n"
+    "\n"
+    "Options:\n"
+    "  -o, --output <dir>       Directory to write the output PNG files to (created if needed)\n"
+    "  --signal <type>          composite (default), svideo, or rgb\n"
+    "  --precision <bits>       Float precision of the signal textures: 32 (default) or 16\n"
+    "  --decode <passes>        Composite decode passes: three (default) or single\n"
+    "  --generate <passes>      Signal generation passes when there are artifacts: two (default) or single\n"
+    "  --source <preset>        Source preset name or index (default: \"%s\")\n"
+    "  --artifacts <preset>     Artifact preset name or index (default: \"%s\")\n"
+    "  --screen <preset>        Screen preset name or index (default: \"%s\")\n"
+    "  --size <w>x<h>           Output size (default: 4x the input height, with a 4:3 aspect ratio)\n"
+    "  --threads <n>            Render threads (default: 0, one per hardware thread)\n"
+    "  --io-threads <n>         Threads for each of decoding and encoding (default: 2)\n"
+    "  --asset-pack <file>      Load prebuilt mask textures from an asset pack instead of rendering them\n"
+    "  --screen-cache <dir>     Save generated screen textures to this directory, and reuse them from there\n"
+    "  --cache-static           Only decode the rows that changed from one input image to the next\n"
+    "  --pipeline-latency <n>   0 (default), or 1 to decode each image while rendering the previous one\n"
+    "  --slices <n>             Render each image in n bands of scanlines, as if racing the beam\n"
+    "  --stream <n>             Stream each image's scanlines in n runs from memory, then render it\n"
+    "  --record-signal <file>   Record every image's generated signal (with its phases and levels) to a file\n"
+    "  --list-presets           List the available presets and exit\n"
+    "  -h, --help               Show this message\n",
+    CathodeRetro::k_sourcePresets[1].name,
+    CathodeRetro::k_artifactPresets[1].name,
+    CathodeRetro::k_screenPresets[4].name);
+}
+
+
+// Returns false if the program should exit without processing anything.
+static bool ParseCommandLine(int argc, char **argv, Options *options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    auto value = [&]() -> std::string
+    {
+      if (i + 1 >= argc)
+      {
+        throw std::runtime_error("Missing value for " + arg);
+      }
+
+      return argv[++i];
+    };
+
+    if (arg == "-h" || arg == "--help")
+    {
+      PrintUsage();
+      return false;
+    }
+    else if (arg == "--list-presets")
+    {
+      PrintPresets("Source presets", CathodeRetro::k_sourcePresets);
+      PrintPresets("Artifact presets", CathodeRetro::k_artifactPresets);
+      PrintPresets("Screen presets", CathodeRetro::k_screenPresets);
+      return false;
+    }
+    else if (arg == "--cache-static")
+    {
+      options->cacheStaticFrames = true;
+    }
+    else if (arg == "-o" || arg == "--output")
+    {
+      options->outputDirectory = value();
+    }
+    else if (arg == "--signal")
+    {
+      std::string type = value();
+      if (type == "composite")
+      {
+        options->signalType = CathodeRetro::SignalType::Composite;
+      }
+      else if (type == "svideo")
+      {
+        options->signalType = CathodeRetro::SignalType::SVideo;
+      }
+      else if (type == "rgb")
+      {
+        options->signalType = CathodeRetro::SignalType::RGB;
+      }
+      else
+      {
+        throw std::runtime_error("Unknown signal type \"" + type + "\"");
+      }
+    }
+    else if (arg == "--precision")
+    {
+      std::string bits = value();
+      if (bits == "32")
+      {
+        options->signalPrecision = CathodeRetro::SignalPrecision::Float32;
+      }
+      else if (bits == "16")
+      {
+        options->signalPrecision = CathodeRetro::SignalPrecision::Float16;
+      }
+      else
+      {
+        throw std::runtime_error("Unknown signal precision \"" + bits + "\"");
+      }
+    }
+    else if (arg == "--decode")
+    {
+      std::string passes = value();
+      if (passes == "three")
+      {
+        options->compositeDecodePath = CathodeRetro::CompositeDecodePath::ThreePass;
+      }
+      else if (passes == "single")
+      {
+        options->compositeDecodePath = CathodeRetro::CompositeDecodePath::SinglePass;
+      }
+      else
+      {
+        throw std::runtime_error("Unknown composite decode path \"" + passes + "\"");
+      }
+    }
+    else if (arg == "--generate")
+    {
+      std::string passes = value();
+      if (passes == "two")
+      {
+        options->signalGenerationPath = CathodeRetro::SignalGenerationPath::TwoPass;
+      }
+      else if (passes == "single")
+      {
+        options->signalGenerationPath = CathodeRetro::SignalGenerationPath::SinglePass;
+      }
+      else
+      {
+        throw std::runtime_error("Unknown signal generation path \"" + passes + "\"");
+      }
+    }
+    else if (arg == "--asset-pack")
+    {
+      options->assetPackPath = value();
+    }
+    else if (arg == "--screen-cache")
+    {
+      options->screenCacheDirectory = value();
+    }
+    else if (arg == "--source")
+    {
+      options->sourceSettings = FindPreset("source", value(), CathodeRetro::k_sourcePresets);
+    }
+    else if (arg == "--artifacts")
+    {
+      options->artifactSettings = FindPreset("artifact", value(), CathodeRetro::k_artifactPresets);
+    }
+    else if (arg == "--screen")
+    {
+      options->screenSettings = FindPreset("screen", value(), CathodeRetro::k_screenPresets);
+    }
+    else if (arg == "--size")
+    {
+      std::string size = value();
+      size_t x = size.find('x');
+      if (x == std::string::npos)
+      {
+        throw std::runtime_error("Invalid size \"" + size + "\" (expected <width>x<height>)");
+      }
+
+      options->outputWidth = ParseUInt(arg, size.substr(0, x));
+      options->outputHeight = ParseUInt(arg, size.substr(x + 1));
+      if (options->outputWidth == 0 || options->outputHeight == 0)
+      {
+        throw std::runtime_error("Invalid size \"" + size + "\"");
+      }
+    }
+    else if (arg == "--threads")
+    {
+      options->renderThreadCount = ParseUInt(arg, value());
+    }
+    else if (arg == "--io-threads")
+    {
+      options->ioThreadCount = std::max(1U, ParseUInt(arg, value()));
+    }
+    else if (arg == "--pipeline-latency")
+    {
+      options->pipelineLatency = ParseUInt(arg, value());
+      if (options->pipelineLatency > 1)
+      {
+        throw std::runtime_error("The pipeline latency must be 0 or 1");
+      }
+    }
+    else if (arg == "--slices")
+    {
+      options->sliceCount = ParseUInt(arg, value());
+    }
+    else if (arg == "--stream")
+    {
+      options->streamRunCount = ParseUInt(arg, value());
+    }
+    else if (arg == "--record-signal")
+    {
+      options->signalRecordingPath = value();
+    }
+    else if (arg.size() > 1 && arg[0] == '-')
+    {
+      throw std::runtime_error("Unknown option " + arg);
+    }
+    else
+    {
+      options->inputs.push_back(arg);
+    }
+  }
+
+  if (options->inputs.empty() || options->outputDirectory.empty())
+  {
+    PrintUsage();
+    return false;
+  }
+
+  if (options->sliceCount != 0 && (options->pipelineLatency != 0 || options->cacheStaticFrames))
+  {
+    throw std::runtime_error("--slices can't be combined with --pipeline-latency or --cache-static");
+  }
+
+  if (options->streamRunCount != 0
+    && (options->sliceCount != 0 || options->pipelineLatency != 0 || options->cacheStaticFrames))
+  {
+    throw std::runtime_error("--stream can't be combined with --slices, --pipeline-latency or --cache-static");
+  }
+
+  if (!options->signalRecordingPath.empty() && options->signalType == CathodeRetro::SignalType::RGB)
+  {
+    throw std::runtime_error("--record-signal needs a composite or S-Video signal");
+  }
+
+  return true;
+}
+
+
+// Find the band of rows that differ between a frame's colors and the previous frame's (which is every row if their
+//  sizes differ).
+static CathodeRetro::ChangedRows FindChangedRows(const Frame &frame, const std::vector<uint32_t> &previousColors)
+{
+  if (frame.colors.size() != previousColors.size())
+  {
+    return CathodeRetro::ChangedRows::All();
+  }
+
+  auto rowChanged = [&](uint32_t row)
+  {
+    size_t offset = size_t(row) * frame.width;
+    return !std::equal(
+      frame.colors.begin() + ptrdiff_t(offset),
+      frame.colors.begin() + ptrdiff_t(offset + frame.width),
+      previousColors.begin() + ptrdiff_t(offset));
+  };
+
+  uint32_t firstRow = 0;
+  while (firstRow < frame.height && !rowChanged(firstRow))
+  {
+    firstRow++;
+  }
+
+  if (firstRow == frame.height)
+  {
+    return CathodeRetro::ChangedRows::None();
+  }
+
+  uint32_t endRow = frame.height;
+  while (!rowChanged(endRow - 1))
+  {
+    endRow--;
+  }
+
+  return {firstRow, endRow - firstRow};
+}
+
+
+// Expand the inputs (directories, glob patterns, and plain files) out into the sorted list of files to process.
+static std::vector<std::string> GatherInputFiles(const std::vector<std::string> &inputs)
+{
+  std::vector<std::string> files;
+  for (auto &input : inputs)
+  {
+    std::vector<std::string> inputFiles;
+    if (fs::is_directory(input))
+    {
+      for (auto &entry : fs::directory_iterator(input))
+      {
+        std::string extension = entry.path().extension().string();
+        if (entry.is_regular_file() && strcasecmp(extension.c_str(), ".png") == 0)
+        {
+          inputFiles.push_back(entry.path().string());
+        }
+      }
+    }
+    else if (input.find_first_of("*?[") != std::string::npos)
+    {
+      glob_t globResult = {};
+      if (glob(input.c_str(), 0, nullptr, &globResult) == 0)
+      {
+        for (size_t i = 0; i < globResult.gl_pathc; i++)
+        {
+          inputFiles.push_back(globResult.gl_pathv[i]);
+        }
+      }
+
+      globfree(&globResult);
+    }
+    else
+    {
+      inputFiles.push_back(input);
+    }
+
+    if (inputFiles.empty())
+    {
+      throw std::runtime_error("No PNG files found for \"" + input + "\"");
+    }
+
+    std::sort(inputFiles.begin(), inputFiles.end());
+    files.insert(files.end(), inputFiles.begin(), inputFiles.end());
+  }
+
+  return files;
+}
+
+
+int main(int argc, char **argv)
+{
+  try
+  {
+    SoftwareSIMD::CheckCPUSupport();
+
+    Options options;
+    if (!ParseCommandLine(argc, argv, &options))
+    {
+      return 0;
+    }
+
+    std::vector<std::string> inputFiles = GatherInputFiles(options.inputs);
+    fs::create_directories(options.outputDirectory);
+
+    // The pack is memory-mapped, so it's only read from as the textures in it actually get used.
+    std::unique_ptr<MappedFile> assetPackFile;
+    CathodeRetro::AssetPack assetPack;
+    if (!options.assetPackPath.empty())
+    {
+      assetPackFile = std::make_unique<MappedFile>(options.assetPackPath.c_str());
+      if (!assetPack.Load(assetPackFile->Data(), assetPackFile->ByteCount()))
+      {
+        throw std::runtime_error(options.assetPackPath + " is not a valid asset pack (or is from another version)");
+      }
+    }
+
+    // (This needs to outlive the CathodeRetro instance that records to it.)
+    std::unique_ptr<SignalRecordingWriter> signalRecording;
+    if (!options.signalRecordingPath.empty())
+    {
+      signalRecording = std::make_unique<SignalRecordingWriter>(options.signalRecordingPath.c_str());
+    }
+
+    std::unique_ptr<ScreenTextureDirectory> screenCache;
+    if (!options.screenCacheDirectory.empty())
+    {
+      fs::create_directories(options.screenCacheDirectory);
+      screenCache = std::make_unique<ScreenTextureDirectory>(options.screenCacheDirectory);
+    }
+
+    size_t frameCount = inputFiles.size();
+    size_t queueCapacity = options.ioThreadCount * 2;
+    OrderedQueue<Frame> decodedFrames(queueCapacity);
+    OrderedQueue<Frame> renderedFrames(queueCapacity);
+
+    // Decode threads: each grabs the next input index and pushes the decoded frame to the render stage.
+    std::atomic<size_t> nextDecodeIndex { 0 };
+    std::vector<std::thread> decodeThreads;
+    for (uint32_t i = 0; i < options.ioThreadCount; i++)
+    {
+      decodeThreads.emplace_back(
+        [&]
+        {
+          for (size_t index = nextDecodeIndex++; index < frameCount; index = nextDecodeIndex++)
+          {
+            Frame frame;
+            frame.inputPath = inputFiles[index];
+            frame.outputPath = (fs::path(options.outputDirectory) / fs::path(frame.inputPath).filename())
+              .replace_extension(".png")
+              .string();
+
+            try
+            {
+              frame.colors = ReadPngFile(frame.inputPath.c_str(), &frame.width, &frame.height);
+            }
+            catch (const std::exception &ex)
+            {
+              frame.error = ex.what();
+            }
+
+            decodedFrames.Push(index, std::move(frame));
+          }
+        });
+    }
+
+    // Encode threads: write out the rendered frames.
+    std::atomic<size_t> nextEncodeIndex { 0 };
+    std::atomic<size_t> failedCount { 0 };
+    std::vector<std::thread> encodeThreads;
+    for (uint32_t i = 0; i < options.ioThreadCount; i++)
+    {
+      encodeThreads.emplace_back(
+        [&]
+        {
+          while (nextEncodeIndex++ < frameCount)
+          {
+            Frame frame = renderedFrames.Pop();
+            if (frame.error.empty())
+            {
+              try
+              {
+                SavePngFile(frame.outputPath.c_str(), frame.width, frame.height, frame.colors.data());
+              }
+              catch (const std::exception &ex)
+              {
+                frame.error = ex.what();
+              }
+            }
+
+            if (frame.error.empty())
+            {
+              printf("%s -> %s\n", frame.inputPath.c_str(), frame.outputPath.c_str());
+            }
+            else
+            {
+              fprintf(stderr, "Error: %s\n", frame.error.c_str());
+              failedCount++;
+            }
+          }
+        });
+    }
+
+    // Render on this thread, strictly in input order (the signal generator's per-frame state depends on it).
+    auto startTime = std::chrono::steady_clock::now();
+    CathodeRetro::FrameStats totalStats;
+    CathodeRetro::TransientMemoryStats memoryStats;
+    size_t renderedCount = 0;
+    {
+      SoftwareGraphicsDevice device(options.renderThreadCount);
+      CathodeRetro::SharedResources sharedResources(&device);
+      if (assetPackFile != nullptr)
+      {
+        sharedResources.SetAssetPack(&assetPack);
+      }
+
+      std::unique_ptr<CathodeRetro::CathodeRetro> cathodeRetro;
+      std::unique_ptr<CathodeRetro::IRenderTarget> output;
+      std::vector<uint32_t> previousInputColors;
+
+      // With a pipeline latency of 1, this is the frame that the next render shows.
+      Frame pendingFrame;
+      size_t pendingIndex = 0;
+      bool hasPendingFrame = false;
+
+      auto addStats = [&]
+      {
+        auto stats = cathodeRetro->GetFrameStats();
+        for (size_t pass = 0; pass < size_t(CathodeRetro::PassID::Count); pass++)
+        {
+          totalStats.passMilliseconds[pass] += stats.passMilliseconds[pass];
+        }
+      };
+
+      // Replace a frame's input colors with the output that was just rendered for it, and send it off to be encoded.
+      auto finishFrame = [&](size_t frameIndex, Frame frame)
+      {
+        frame.width = output->Width();
+        frame.height = output->Height();
+        frame.colors.resize(size_t(frame.width) * frame.height);
+        memcpy(
+          frame.colors.data(),
+          static_cast<SoftwareTexture *>(output.get())->MipData(0),
+          frame.colors.size() * sizeof(uint32_t));
+        renderedFrames.Push(frameIndex, std::move(frame));
+      };
+
+      // Render the pending frame on its own (before anything changes that would drop it, or at the end).
+      auto flushPendingFrame = [&]
+      {
+        if (hasPendingFrame)
+        {
+          cathodeRetro->RenderPendingFrame(output.get());
+          addStats();
+          finishFrame(pendingIndex, std::move(pendingFrame));
+          hasPendingFrame = false;
+        }
+      };
+
+      for (size_t index = 0; index < frameCount; index++)
+      {
+        Frame frame = decodedFrames.Pop();
+        if (frame.error.empty())
+        {
+          // A change in the input size means new pipeline stages (and a new output size), so the pending frame needs to
+          //  be rendered through the current ones first.
+          if (hasPendingFrame && (frame.width != pendingFrame.width || frame.height != pendingFrame.height))
+          {
+            flushPendingFrame();
+          }
+
+          if (cathodeRetro == nullptr)
+          {
+            cathodeRetro = std::make_unique<CathodeRetro::CathodeRetro>(
+              &device,
+              options.signalType,
+              frame.width,
+              frame.height,
+              options.sourceSettings,
+              &sharedResources);
+            cathodeRetro->UpdateSettings(options.artifactSettings, {}, {}, options.screenSettings);
+            cathodeRetro->SetSignalPrecision(options.signalPrecision);
+            cathodeRetro->SetCompositeDecodePath(options.compositeDecodePath);
+            cathodeRetro->SetSignalGenerationPath(options.signalGenerationPath);
+
+            // Every output image needs to be exact, so a new screen texture (if the output size changes between
+            //  inputs) can't be spread out over several frames.
+            cathodeRetro->SetScreenTextureRegenerationFrameCount(1);
+            cathodeRetro->SetScreenTextureStore(screenCache.get());
+            cathodeRetro->SetDecodedFrameCacheEnabled(options.cacheStaticFrames);
+            cathodeRetro->SetPipelineLatency(options.pipelineLatency);
+            cathodeRetro->SetSignalRecorder(signalRecording.get());
+          }
+          else
+          {
+            cathodeRetro->UpdateSourceSettings(options.signalType, frame.width, frame.height, options.sourceSettings);
+          }
+
+          uint32_t outputHeight = (options.outputHeight != 0) ? options.outputHeight : frame.height * 4;
+          uint32_t outputWidth = (options.outputWidth != 0) ? options.outputWidth : (outputHeight * 4 + 1) / 3;
+          cathodeRetro->SetOutputSize(outputWidth, outputHeight);
+          if (output == nullptr || output->Width() != outputWidth || output->Height() != outputHeight)
+          {
+            output = device.CreateRenderTarget(outputWidth, outputHeight, 1, CathodeRetro::TextureFormat::RGBA_Unorm8);
+          }
+
+          // (Streamed scanlines go straight from the decoded colors into the streamed input texture.)
+          std::unique_ptr<CathodeRetro::ITexture> input;
+          if (options.streamRunCount == 0)
+          {
+            input = device.CreateTexture(
+              frame.width,
+              frame.height,
+              CathodeRetro::TextureFormat::RGBA_Unorm8,
+              frame.colors.data());
+          }
+
+          // (A change in the input size resets the cache by itself, in UpdateSourceSettings.)
+          auto changedRows = CathodeRetro::ChangedRows::All();
+          if (options.cacheStaticFrames)
+          {
+            changedRows = FindChangedRows(frame, previousInputColors);
+            previousInputColors = frame.colors;
+          }
+
+          bool rendered = true;
+          if (options.sliceCount != 0)
+          {
+            uint32_t sliceCount = std::min(options.sliceCount, frame.height);
+            for (uint32_t slice = 0; slice < sliceCount; slice++)
+            {
+              cathodeRetro->RenderSlice(
+                input.get(),
+                CathodeRetro::ScanlineType::Progressive,
+                output.get(),
+                frame.height * slice / sliceCount,
+                frame.height * (slice + 1) / sliceCount - 1);
+              addStats();
+            }
+          }
+          else if (options.streamRunCount != 0)
+          {
+            uint32_t runCount = std::min(options.streamRunCount, frame.height);
+            for (uint32_t run = 0; run < runCount; run++)
+            {
+              uint32_t firstScanline = frame.height * run / runCount;
+              cathodeRetro->StreamScanlines(
+                &frame.colors[size_t(frame.width) * firstScanline],
+                ptrdiff_t(frame.width * sizeof(uint32_t)),
+                CathodeRetro::ScanlineType::Progressive,
+                firstScanline,
+                frame.height * (run + 1) / runCount - 1);
+              addStats();
+            }
+
+            cathodeRetro->RenderStreamedFrame(output.get());
+            addStats();
+          }
+          else
+          {
+            rendered =
+              cathodeRetro->Render(input.get(), CathodeRetro::ScanlineType::Progressive, output.get(), changedRows);
+            addStats();
+          }
+
+          memoryStats = cathodeRetro->GetTransientMemoryStats();
+          renderedCount++;
+
+          if (options.pipelineLatency == 0 || options.signalType == CathodeRetro::SignalType::RGB)
+          {
+            finishFrame(index, std::move(frame));
+          }
+          else
+          {
+            // What got rendered was the previous frame, and this one is pending until the next render.
+            if (rendered)
+            {
+              finishFrame(pendingIndex, std::move(pendingFrame));
+            }
+
+            pendingFrame = std::move(frame);
+            pendingIndex = index;
+            hasPendingFrame = true;
+          }
+        }
+        else
+        {
+          renderedFrames.Push(index, std::move(frame));
+        }
+      }
+
+      flushPendingFrame();
+    }
+
+    for (auto &thread : decodeThreads)
+    {
+      thread.join();
+    }
+
+    if (signalRecording != nullptr)
+    {
+      signalRecording->Close();
+      printf(
+        "Recorded the signal of %" PRIu64 " frame(s) to %s\n",
+        signalRecording->FrameCount(),
+        options.signalRecordingPath.c_str());
+    }
+
+    for (auto &thread : encodeThreads)
+    {
+      thread.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    printf(
+      "Processed %zu frame(s) in %.2f seconds (%.2f frames/second)\n",
+      frameCount - failedCount,
+      seconds,
+      double(frameCount) / seconds);
+
+    if (renderedCount > 0)
+    {
+      printf("Average render time per frame:\n");
+      for (size_t pass = 0; pass < size_t(CathodeRetro::PassID::Count); pass++)
+      {
+        printf(
+          "  %-20s %9.3f ms\n",
+          CathodeRetro::PassName(CathodeRetro::PassID(pass)),
+          totalStats.passMilliseconds[pass] / float(renderedCount));
+      }
+
+      printf(
+        "Intermediate render targets: %u in use (of %u), %.2f MiB shared (%.2f MiB if allocated separately)\n",
+        memoryStats.usedRenderTargetCount,
+        memoryStats.renderTargetCount,
+        double(memoryStats.aliasedByteCount) / (1024.0 * 1024.0),
+        double(memoryStats.unaliasedByteCount) / (1024.0 * 1024.0));
+    }
+
+    return (failedCount == 0) ? 0 : 1;
+  }
+  catch (const std::exception &ex)
+  {
+    fprintf(stderr, "Error: %s\n", ex.what());
+    return 1;
+  }
+}
@@ -0,0 +1,530 @@
+// A microbenchmark for the individual Cathode Retro passes, as run by the SoftwareGraphicsDevice.
+//
+// For each combination of input size (taken from the source presets) and output size, this renders one frame through
+//  a device that records every RenderQuad call (with a snapshot of its constants), and then re-runs each recorded pass
+//  on its own a number of times, grouped by ShaderID. The results are written out as JSON so that they can be compared
+//  between runs to catch regressions in individual kernels.
+
+#include <strings.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CathodeRetro/CathodeRetro.h"
+#include "CathodeRetro/SettingPresets.h"
+
+#include "SoftwareGraphicsDevice.h"
+
+
+static const char *ShaderName(CathodeRetro::ShaderID id)
+{
+  using CathodeRetro::ShaderID;
+  switch (id)
+  {
+  case ShaderID::Util_Copy: return "Util_Copy";
+  case ShaderID::Util_Downsample2X: return "Util_Downsample2X";
+  case ShaderID::Util_TonemapAndDownsample: return "Util_TonemapAndDownsample";
+  case ShaderID::Util_GaussianBlur13: return "Util_GaussianBlur13";
+  case ShaderID::Generator_GeneratePhaseTexture: return "Generator_GeneratePhaseTexture";
+  case ShaderID::Generator_RGBToSVideoOrComposite: return "Generator_RGBToSVideoOrComposite";
+  case ShaderID::Generator_ApplyArtifacts: return "Generator_ApplyArtifacts";
+  case ShaderID::Generator_RGBToSignalWithArtifacts: return "Generator_RGBToSignalWithArtifacts";
+  case ShaderID::Decoder_CompositeToSVideo: return "Decoder_CompositeToSVideo";
+  case ShaderID::Decoder_SVideoToModulatedChroma: return "Decoder_SVideoToModulatedChroma";
+  case ShaderID::Decoder_SVideoToRGB: return "Decoder_SVideoToRGB";
+  case ShaderID::Decoder_FilterRGB: return "Decoder_FilterRGB";
+  case ShaderID::Decoder_CompositeToRGB: return "Decoder_CompositeToRGB";
+  case ShaderID::CRT_GenerateScreenTexture: return "CRT_GenerateScreenTexture";
+  case ShaderID::CRT_GenerateDistortionLUT: return "CRT_GenerateDistortionLUT";
+  case ShaderID::CRT_GenerateSlotMask: return "CRT_GenerateSlotMask";
+  case ShaderID::CRT_GenerateShadowMask: return "CRT_GenerateShadowMask";
+  case ShaderID::CRT_GenerateApertureGrille: return "CRT_GenerateApertureGrille";
+  case ShaderID::CRT_RGBToCRT: return "CRT_RGBToCRT";
+  }
+
+  return "Unknown";
+}
+
+
+// A single RenderQuad call, with everything needed to run it again later.
+struct RecordedPass
+{
+  CathodeRetro::IShader *shader;
+  CathodeRetro::RenderTargetView output;
+  std::vector<CathodeRetro::ShaderResourceView> inputs;
+  std::unique_ptr<SoftwareConstantBuffer> constants;
+};
+
+
+// A graphics device that passes everything through to a SoftwareGraphicsDevice, but also records the RenderQuad
+//  calls it sees (optionally only those for a subset of shaders).
+class RecordingDevice : public CathodeRetro::IGraphicsDevice
+{
+public:
+  explicit RecordingDevice(SoftwareGraphicsDevice *deviceIn)
+    : device(deviceIn)
+    { }
+
+
+  std::vector<RecordedPass> passes;
+
+  // If non-empty, only passes using these shaders get recorded.
+  std::vector<CathodeRetro::ShaderID> recordFilter;
+
+
+  std::unique_ptr<CathodeRetro::IRenderTarget> CreateRenderTarget(
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipCount,
+    CathodeRetro::TextureFormat format) override
+    { return device->CreateRenderTarget(width, height, mipCount, format); }
+
+  std::unique_ptr<CathodeRetro::IConstantBuffer> CreateConstantBuffer(size_t size) override
+    { return device->CreateConstantBuffer(size); }
+
+  std::unique_ptr<CathodeRetro::IShader> CreateShader(CathodeRetro::ShaderID id) override
+    { return device->CreateShader(id); }
+
+  void BeginRendering() override
+    { device->BeginRendering(); }
+
+  void EndRendering() override
+    { device->EndRendering(); }
+
+  void BeginPass(CathodeRetro::PassID pass) override
+    { device->BeginPass(pass); }
+
+  void EndPass() override
+    { device->EndPass(); }
+
+
+  void RenderQuad(
+    CathodeRetro::IShader *ps,
+    CathodeRetro::RenderTargetView output,
+    std::initializer_list<CathodeRetro::ShaderResourceView> inputs,
+    CathodeRetro::IConstantBuffer *constantBuffer) override
+  {
+    device->RenderQuad(ps, output, inputs, constantBuffer);
+
+    auto id = static_cast<SoftwareShader *>(ps)->ID();
+    if (!recordFilter.empty() && std::find(recordFilter.begin(), recordFilter.end(), id) == recordFilter.end())
+    {
+      return;
+    }
+
+    RecordedPass pass { ps, output, inputs, nullptr };
+    if (constantBuffer != nullptr)
+    {
+      // The constant buffers get reused between passes, so keep a copy of what this pass saw.
+      auto source = static_cast<SoftwareConstantBuffer *>(constantBuffer);
+      pass.constants = std::make_unique<SoftwareConstantBuffer>(source->Size());
+      pass.constants->Update(source->Data(), source->Size());
+    }
+
+    passes.push_back(std::move(pass));
+  }
+
+private:
+  SoftwareGraphicsDevice *device;
+};
+
+
+static void RunPass(SoftwareGraphicsDevice *device, const RecordedPass &pass)
+{
+  auto &in = pass.inputs;
+  switch (in.size())
+  {
+  case 0: device->RenderQuad(pass.shader, pass.output, {}, pass.constants.get()); break;
+  case 1: device->RenderQuad(pass.shader, pass.output, {in[0]}, pass.constants.get()); break;
+  case 2: device->RenderQuad(pass.shader, pass.output, {in[0], in[1]}, pass.constants.get()); break;
+  case 3: device->RenderQuad(pass.shader, pass.output, {in[0], in[1], in[2]}, pass.constants.get()); break;
+  case 4: device->RenderQuad(pass.shader, pass.output, {in[0], in[1], in[2], in[3]}, pass.constants.get()); break;
+  default:
+    device->RenderQuad(pass.shader, pass.output, {in[0], in[1], in[2], in[3], in[4]}, pass.constants.get());
+    break;
+  }
+}
+
+
+// The byte size of the given mip level of a texture.
+static uint64_t MipByteCount(const CathodeRetro::ITexture *texture, uint32_t mip)
+{
+  auto software = static_cast<const SoftwareTexture *>(texture);
+  return uint64_t(software->MipWidth(mip))
+    * software->MipHeight(mip)
+    * SoftwareTexture::TexelByteCount(texture->Format());
+}
+
+
+// The texture data that a pass can see: for each input, either the single mip it's restricted to or its whole mip
+//  chain. This is an upper bound on what the pass actually reads.
+static uint64_t BytesRead(const RecordedPass &pass)
+{
+  uint64_t bytes = 0;
+  for (auto &input : pass.inputs)
+  {
+    if (input.mipLevel >= 0)
+    {
+      bytes += MipByteCount(input.texture, uint32_t(input.mipLevel));
+    }
+    else
+    {
+      for (uint32_t mip = 0; mip < input.texture->MipCount(); mip++)
+      {
+        bytes += MipByteCount(input.texture, mip);
+      }
+    }
+  }
+
+  return bytes;
+}
+
+
+struct Size
+{
+  uint32_t width;
+  uint32_t height;
+};
+
+
+struct InputConfig
+{
+  const char *sourcePresetName;
+  Size size;
+};
+
+
+static constexpr InputConfig k_inputConfigs[] =
+{
+  { "NES/SNES", { 256, 240 } },
+  { "PC Composite 320x200", { 320, 200 } },
+  { "PC Composite 640x480", { 640, 480 } },
+  { "Apple II Monochrome 560 x 192", { 560, 192 } },
+};
+
+
+static constexpr Size k_outputSizes[] =
+{
+  { 1920, 1080 },
+  { 2560, 1440 },
+  { 3840, 2160 },
+  { 7680, 4320 },
+};
+
+
+static const CathodeRetro::SourceSettings &FindSourcePreset(const char *name)
+{
+  for (auto &preset : CathodeRetro::k_sourcePresets)
+  {
+    if (strcasecmp(preset.name, name) == 0)
+    {
+      return preset.settings;
+    }
+  }
+
+  throw std::runtime_error(std::string("Missing source preset ") + name);
+}
+
+
+static Size ParseSize(const std::string &str)
+{
+  Size size = {};
+  if (sscanf(str.c_str(), "%ux%u", &size.width, &size.height) != 2 || size.width == 0 || size.height == 0)
+  {
+    throw std::runtime_error("Invalid size \"" + str + "\" (expected <width>x<height>)");
+  }
+
+  return size;
+}
+
+
+static void PrintUsage()
+{
+  printf(
+    "Usage: cathode-retro-benchmark [options]\n"
+    "\n"
+    "Options:\n"
+    "  --iterations <n>   Timed runs of each pass (default: 5)\n"
+    "  --threads <n>      Render threads (default: 0, one per hardware thread)\n"
+    "  --input <w>x<h>    Only benchmark this input size (may be repeated)\n"
+    "  --output <w>x<h>   Only benchmark this output size (may be repeated)\n"
+    "  --json <file>      Write the results to a file instead of stdout\n"
+    "  -h, --help         Show this message\n");
+}
+
+
+int main(int argc, char **argv)
+{
+  using namespace CathodeRetro;
+
+  try
+  {
+    SoftwareSIMD::CheckCPUSupport();
+
+    uint32_t iterations = 5;
+    uint32_t threadCount = 0;
+    std::vector<InputConfig> inputConfigs;
+    std::vector<Size> outputSizes;
+    std::string jsonPath;
+
+    for (int i = 1; i < argc; i++)
+    {
+      std::string arg = argv[i];
+      if (arg == "-h" || arg == "--help")
+      {
+        PrintUsage();
+        return 0;
+      }
+
+      if (i + 1 >= argc)
+      {
+        throw std::runtime_error("Missing value for " + arg);
+      }
+
+      std::string value = argv[++i];
+      if (arg == "--iterations")
+      {
+        iterations = std::max(1U, uint32_t(strtoul(value.c_str(), nullptr, 10)));
+      }
+      else if (arg == "--threads")
+      {
+        threadCount = uint32_t(strtoul(value.c_str(), nullptr, 10));
+      }
+      else if (arg == "--input")
+      {
+        Size size = ParseSize(value);
+        auto iter = std::find_if(
+          std::begin(k_inputConfigs),
+          std::end(k_inputConfigs),
+          [&](const InputConfig &c) { return c.size.width == size.width && c.size.height == size.height; });
+        if (iter == std::end(k_inputConfigs))
+        {
+          throw std::runtime_error("No source preset for input size " + value);
+        }
+
+        inputConfigs.push_back(*iter);
+      }
+      else if (arg == "--output")
+      {
+        outputSizes.push_back(ParseSize(value));
+      }
+      else if (arg == "--json")
+      {
+        jsonPath = value;
+      }
+      else
+      {
+        throw std::runtime_error("Unknown option " + arg);
+      }
+    }
+
+    if (inputConfigs.empty())
+    {
+      inputConfigs.assign(std::begin(k_inputConfigs), std::end(k_inputConfigs));
+    }
+
+    if (outputSizes.empty())
+    {
+      outputSizes.assign(std::begin(k_outputSizes), std::end(k_outputSizes));
+    }
+
+    FILE *json = stdout;
+    if (!jsonPath.empty())
+    {
+      json = fopen(jsonPath.c_str(), "w");
+      if (json == nullptr)
+      {
+        throw std::runtime_error("Failed to open " + jsonPath);
+      }
+    }
+
+    SoftwareGraphicsDevice device(threadCount);
+
+    fprintf(json, "{\n");
+    fprintf(json, "  \"threadCount\": %u,\n", device.ThreadCount());
+    fprintf(json, "  \"simdWidth\": %u,\n", uint32_t(SOFTWARE_SIMD_WIDTH));
+    fprintf(json, "  \"iterations\": %u,\n", iterations);
+    fprintf(json, "  \"results\": [");
+
+    bool firstResult = true;
+    for (auto &inputConfig : inputConfigs)
+    {
+      for (auto &outputSize : outputSizes)
+      {
+        fprintf(
+          stderr,
+          "%ux%u -> %ux%u\n",
+          inputConfig.size.width,
+          inputConfig.size.height,
+          outputSize.width,
+          outputSize.height);
+
+        // Some noise as input, so that no pass gets to take advantage of a flat image.
+        std::mt19937 rng(1);
+        std::vector<uint32_t> colors(size_t(inputConfig.size.width) * inputConfig.size.height);
+        for (auto &c : colors)
+        {
+          c = rng() | 0xFF000000;
+        }
+
+        auto input = device.CreateTexture(
+          inputConfig.size.width,
+          inputConfig.size.height,
+          TextureFormat::RGBA_Unorm8,
+          colors.data());
+        auto output = device.CreateRenderTarget(outputSize.width, outputSize.height, 1, TextureFormat::RGBA_Unorm8);
+
+        // Record a full frame (with temporal artifact reduction on, so that the generator and decoder produce their
+        //  doubled outputs)...
+        RecordingDevice recorder(&device);
+        auto screenSettings = k_screenPresets[4].settings;
+
+        // The shared resources only keep the mask textures (and the shaders that generate them) alive while something
+        //  is using them, so hold on to those until the recorded passes are done with them.
+        CathodeRetro::SharedResources sharedResources(&recorder);
+        std::vector<std::shared_ptr<CathodeRetro::IShader>> maskShaders;
+        std::vector<std::shared_ptr<CathodeRetro::ITexture>> maskTextures;
+        for (ShaderID id :
+          { ShaderID::CRT_GenerateSlotMask, ShaderID::CRT_GenerateShadowMask, ShaderID::CRT_GenerateApertureGrille })
+        {
+          maskShaders.push_back(sharedResources.Shader(id));
+        }
+
+        CathodeRetro::CathodeRetro cathodeRetro(
+          &recorder,
+          SignalType::Composite,
+          inputConfig.size.width,
+          inputConfig.size.height,
+          FindSourcePreset(inputConfig.sourcePresetName),
+          &sharedResources);
+        cathodeRetro.SetOutputSize(outputSize.width, outputSize.height);
+        cathodeRetro.UpdateSettings(k_artifactPresets[2].settings, {}, {}, screenSettings);
+        cathodeRetro.Render(input.get(), ScanlineType::Odd, output.get());
+
+        // ...plus the mask generation passes for the mask types that the frame didn't use (the one it did use is
+        //  already in the shared resources, so asking for it again doesn't render anything).
+        recorder.recordFilter = {
+          ShaderID::CRT_GenerateSlotMask,
+          ShaderID::CRT_GenerateShadowMask,
+          ShaderID::CRT_GenerateApertureGrille };
+        recorder.BeginRendering();
+        for (auto maskType : { MaskType::SlotMask, MaskType::ShadowMask, MaskType::ApertureGrille })
+        {
+          maskTextures.push_back(sharedResources.MaskTexture(maskType));
+        }
+
+        recorder.EndRendering();
+
+        // ...plus the single-pass signal generator and composite decoder. These need their own instance, since
+        //  switching the first one over would release the intermediate render targets that its recorded passes use.
+        CathodeRetro::CathodeRetro singlePassCathodeRetro(
+          &recorder,
+          SignalType::Composite,
+          inputConfig.size.width,
+          inputConfig.size.height,
+          FindSourcePreset(inputConfig.sourcePresetName),
+          &sharedResources);
+        singlePassCathodeRetro.SetOutputSize(outputSize.width, outputSize.height);
+        singlePassCathodeRetro.UpdateSettings(k_artifactPresets[2].settings, {}, {}, screenSettings);
+        singlePassCathodeRetro.SetCompositeDecodePath(CompositeDecodePath::SinglePass);
+        singlePassCathodeRetro.SetSignalGenerationPath(SignalGenerationPath::SinglePass);
+        recorder.recordFilter = { ShaderID::Generator_RGBToSignalWithArtifacts, ShaderID::Decoder_CompositeToRGB };
+        singlePassCathodeRetro.Render(input.get(), ScanlineType::Odd, output.get());
+
+        // Group the passes by shader, then time each group.
+        std::map<ShaderID, std::vector<const RecordedPass *>> passesByShader;
+        for (auto &pass : recorder.passes)
+        {
+          passesByShader[static_cast<SoftwareShader *>(pass.shader)->ID()].push_back(&pass);
+        }
+
+        for (auto &[id, passes] : passesByShader)
+        {
+          uint64_t texelCount = 0;
+          uint64_t bytesRead = 0;
+          uint64_t bytesWritten = 0;
+          for (auto pass : passes)
+          {
+            auto target = static_cast<SoftwareTexture *>(pass->output.texture);
+            uint32_t mip = pass->output.mipLevel;
+            texelCount += uint64_t(target->MipWidth(mip)) * target->MipHeight(mip);
+            bytesRead += BytesRead(*pass);
+            bytesWritten += MipByteCount(target, mip);
+          }
+
+          std::vector<double> nsPerTexel;
+          device.BeginRendering();
+          for (uint32_t i = 0; i < iterations; i++)
+          {
+            auto start = std::chrono::steady_clock::now();
+            for (auto pass : passes)
+            {
+              RunPass(&device, *pass);
+            }
+
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            nsPerTexel.push_back(ns / double(texelCount));
+          }
+          device.EndRendering();
+
+          double mean = 0.0;
+          for (double v : nsPerTexel)
+          {
+            mean += v;
+          }
+
+          mean /= double(iterations);
+
+          double variance = 0.0;
+          for (double v : nsPerTexel)
+          {
+            variance += (v - mean) * (v - mean);
+          }
+
+          variance /= double(iterations);
+
+          fprintf(json, "%s\n    {\n", firstResult ? "" : ",");
+          fprintf(json, "      \"shader\": \"%s\",\n", ShaderName(id));
+          fprintf(json, "      \"sourcePreset\": \"%s\",\n", inputConfig.sourcePresetName);
+          fprintf(json, "      \"inputWidth\": %u,\n", inputConfig.size.width);
+          fprintf(json, "      \"inputHeight\": %u,\n", inputConfig.size.height);
+          fprintf(json, "      \"outputWidth\": %u,\n", outputSize.width);
+          fprintf(json, "      \"outputHeight\": %u,\n", outputSize.height);
+          fprintf(json, "      \"passCount\": %zu,\n", passes.size());
+          fprintf(json, "      \"texelCount\": %llu,\n", static_cast<unsigned long long>(texelCount));
+          fprintf(json, "      \"nsPerTexel\": %.4f,\n", mean);
+          fprintf(
+            json,
+            "      \"nsPerTexelMin\": %.4f,\n",
+            *std::min_element(nsPerTexel.begin(), nsPerTexel.end()));
+          fprintf(json, "      \"nsPerTexelVariance\": %.6f,\n", variance);
+          fprintf(json, "      \"bytesRead\": %llu,\n", static_cast<unsigned long long>(bytesRead));
+          fprintf(json, "      \"bytesWritten\": %llu\n", static_cast<unsigned long long>(bytesWritten));
+          fprintf(json, "    }");
+          firstResult = false;
+        }
+      }
+    }
+
+    fprintf(json, "\n  ]\n}\n");
+    if (json != stdout)
+    {
+      fclose(json);
+    }
+
+    return 0;
+  }
+  catch (const std::exception &ex)
+  {
+    fprintf(stderr, "Error: %s\n", ex.what());
+    return 1;
+  }
+}
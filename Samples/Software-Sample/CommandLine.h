@@ -0,0 +1,93 @@
+#pragma once
+
+#include <strings.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "CathodeRetro/SettingPresets.h"
+
+
+// Helpers for the command-line tools' option parsing. The parsing functions throw std::runtime_error (naming the
+//  option) if the value is invalid.
+
+template <typename T, size_t N>
+void PrintPresets(const char *title, const CathodeRetro::Preset<T> (&presets)[N])
+{
+  printf("%s:\n", title);
+  for (size_t i = 0; i < N; i++)
+  {
+    printf("  %zu: %s\n", i, presets[i].name);
+  }
+}
+
+
+// Find a preset either by its index or by its (case-insensitive) name.
+template <typename T, size_t N>
+T FindPreset(const char *kind, const std::string &nameOrIndex, const CathodeRetro::Preset<T> (&presets)[N])
+{
+  char *end;
+  unsigned long index = strtoul(nameOrIndex.c_str(), &end, 10);
+  if (!nameOrIndex.empty() && *end == '\0')
+  {
+    if (index < N)
+    {
+      return presets[index].settings;
+    }
+  }
+  else
+  {
+    for (auto &preset : presets)
+    {
+      if (strcasecmp(preset.name, nameOrIndex.c_str()) == 0)
+      {
+        return preset.settings;
+      }
+    }
+  }
+
+  throw std::runtime_error("Unknown " + std::string(kind) + " preset \"" + nameOrIndex + "\" (see --list-presets)");
+}
+
+
+inline uint32_t ParseUInt(const std::string &arg, const std::string &value)
+{
+  char *end;
+  unsigned long result = strtoul(value.c_str(), &end, 10);
+  if (value.empty() || *end != '\0')
+  {
+    throw std::runtime_error("Invalid value \"" + value + "\" for " + arg);
+  }
+
+  return uint32_t(result);
+}
+
+
+inline float ParseFloat(const std::string &arg, const std::string &value)
+{
+  char *end;
+  float result = strtof(value.c_str(), &end);
+  if (value.empty() || *end != '\0')
+  {
+    throw std::runtime_error("Invalid value \"" + value + "\" for " + arg);
+  }
+
+  return result;
+}
+
+
+// Split a "<a>,<b>" value into its two halves.
+inline std::pair<std::string, std::string> SplitPair(const std::string &arg, const std::string &value)
+{
+  size_t comma = value.find(',');
+  if (comma == std::string::npos)
+  {
+    throw std::runtime_error("Invalid value \"" + value + "\" for " + arg + " (expected <a>,<b>)");
+  }
+
+  return {value.substr(0, comma), value.substr(comma + 1)};
+}
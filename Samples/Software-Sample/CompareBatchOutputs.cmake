@@ -0,0 +1,37 @@
+# Runs two batch tool builds (or one build with two sets of options) over the same inputs and checks that their outputs
+#  match to within a tolerance, using cathode-retro-png-compare. Run with cmake -P, with these defined:
+#
+#   BATCH_A, BATCH_B      The batch tool executables to compare (these can be the same).
+#   ARGS, ARGS_A, ARGS_B  Options for both runs, and for just the first or second one (lists separated by "|").
+#   INPUTS                The input PNG files (separated by "|").
+#   COMPARE               The cathode-retro-png-compare executable.
+#   TOLERANCE             Largest allowed difference in any channel, out of 255.
+#   OUTPUT_DIRECTORY      Where to write the two sets of outputs (any previous contents are removed).
+
+foreach(var BATCH_A BATCH_B INPUTS COMPARE TOLERANCE OUTPUT_DIRECTORY)
+  if(NOT DEFINED ${var})
+    message(FATAL_ERROR "${var} is not defined")
+  endif()
+endforeach()
+
+foreach(var ARGS ARGS_A ARGS_B INPUTS)
+  string(REPLACE "|" ";" ${var} "${${var}}")
+endforeach()
+
+file(REMOVE_RECURSE "${OUTPUT_DIRECTORY}")
+
+foreach(run A B)
+  execute_process(
+    COMMAND "${BATCH_${run}}" ${ARGS} ${ARGS_${run}} -o "${OUTPUT_DIRECTORY}/${run}" ${INPUTS}
+    RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "${BATCH_${run}} failed (${result})")
+  endif()
+endforeach()
+
+execute_process(
+  COMMAND "${COMPARE}" --tolerance ${TOLERANCE} "${OUTPUT_DIRECTORY}/A" "${OUTPUT_DIRECTORY}/B"
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "The outputs differ by more than ${TOLERANCE}/255")
+endif()
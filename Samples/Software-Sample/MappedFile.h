@@ -0,0 +1,73 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+
+// A read-only memory mapping of a whole file, which stays mapped for as long as this object exists. Throws
+//  std::runtime_error if the file can't be opened or mapped.
+class MappedFile
+{
+public:
+  explicit MappedFile(const char *path)
+  {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+      throw std::runtime_error(std::string("Failed to open ") + path);
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0)
+    {
+      close(fd);
+      throw std::runtime_error(std::string("Failed to get the size of ") + path);
+    }
+
+    byteCount = size_t(fileStat.st_size);
+    if (byteCount > 0)
+    {
+      void *mapping = mmap(nullptr, byteCount, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (mapping == MAP_FAILED)
+      {
+        close(fd);
+        throw std::runtime_error(std::string("Failed to map ") + path);
+      }
+
+      data = mapping;
+    }
+
+    // The mapping keeps its own reference to the file.
+    close(fd);
+  }
+
+
+  MappedFile(const MappedFile &) = delete;
+  void operator=(const MappedFile &) = delete;
+
+
+  ~MappedFile()
+  {
+    if (data != nullptr)
+    {
+      munmap(const_cast<void *>(data), byteCount);
+    }
+  }
+
+
+  const void *Data() const
+    { return data; }
+
+  size_t ByteCount() const
+    { return byteCount; }
+
+private:
+  const void *data = nullptr;
+  size_t byteCount = 0;
+};
@@ -0,0 +1,149 @@
+// A small command-line tool that compares two directories of PNG files (say, the outputs of two cathode-retro-batch
+//  runs that should agree), texel by texel, and fails if any channel of any texel differs by more than a tolerance.
+//  The tests use it to check that the different software device builds render the same frames.
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "PngFile.h"
+
+
+namespace fs = std::filesystem;
+
+
+static void PrintUsage()
+{
+  printf(
+    "Usage: cathode-retro-png-compare [options] <expected directory> <actual directory>\n"
+    "\n"
+    "Every .png file in the expected directory must have a file of the same name and size in the actual directory.\n"
+    "\n"
+    "Options:\n"
+    "  --tolerance <n>    Largest allowed difference in any channel, out of 255 (default: 0)\n"
+    "  -h, --help         Show this message\n");
+}
+
+
+int main(int argc, char **argv)
+{
+  try
+  {
+    uint32_t tolerance = 0;
+    std::vector<std::string> directories;
+
+    for (int i = 1; i < argc; i++)
+    {
+      std::string arg = argv[i];
+      if (arg == "-h" || arg == "--help")
+      {
+        PrintUsage();
+        return 0;
+      }
+
+      if (arg[0] != '-')
+      {
+        directories.push_back(arg);
+        continue;
+      }
+
+      if (i + 1 >= argc)
+      {
+        throw std::runtime_error("Missing value for " + arg);
+      }
+
+      std::string value = argv[++i];
+      if (arg == "--tolerance")
+      {
+        tolerance = uint32_t(strtoul(value.c_str(), nullptr, 10));
+      }
+      else
+      {
+        throw std::runtime_error("Unknown option " + arg);
+      }
+    }
+
+    if (directories.size() != 2)
+    {
+      PrintUsage();
+      return 1;
+    }
+
+    std::vector<fs::path> expectedPaths;
+    for (auto &entry : fs::directory_iterator(directories[0]))
+    {
+      if (entry.is_regular_file() && entry.path().extension() == ".png")
+      {
+        expectedPaths.push_back(entry.path());
+      }
+    }
+
+    if (expectedPaths.empty())
+    {
+      throw std::runtime_error("No .png files in " + directories[0]);
+    }
+
+    std::sort(expectedPaths.begin(), expectedPaths.end());
+
+    bool allMatched = true;
+    for (auto &expectedPath : expectedPaths)
+    {
+      fs::path actualPath = fs::path(directories[1]) / expectedPath.filename();
+
+      uint32_t expectedWidth;
+      uint32_t expectedHeight;
+      uint32_t actualWidth;
+      uint32_t actualHeight;
+      std::vector<uint32_t> expected = ReadPngFile(expectedPath.string().c_str(), &expectedWidth, &expectedHeight);
+      std::vector<uint32_t> actual = ReadPngFile(actualPath.string().c_str(), &actualWidth, &actualHeight);
+      if (actualWidth != expectedWidth || actualHeight != expectedHeight)
+      {
+        printf(
+          "%s: size is %ux%u, expected %ux%u\n",
+          actualPath.string().c_str(),
+          actualWidth,
+          actualHeight,
+          expectedWidth,
+          expectedHeight);
+        allMatched = false;
+        continue;
+      }
+
+      // Track the largest difference in any channel, and how many texels differ by more than the tolerance.
+      uint32_t maxDifference = 0;
+      size_t failedTexelCount = 0;
+      for (size_t i = 0; i < expected.size(); i++)
+      {
+        uint32_t texelDifference = 0;
+        for (uint32_t shift = 0; shift < 32; shift += 8)
+        {
+          int32_t e = int32_t((expected[i] >> shift) & 0xFF);
+          int32_t a = int32_t((actual[i] >> shift) & 0xFF);
+          texelDifference = std::max(texelDifference, uint32_t(std::abs(e - a)));
+        }
+
+        maxDifference = std::max(maxDifference, texelDifference);
+        failedTexelCount += (texelDifference > tolerance) ? 1 : 0;
+      }
+
+      printf(
+        "%s: max difference %u, %zu texels over the tolerance\n",
+        expectedPath.filename().string().c_str(),
+        maxDifference,
+        failedTexelCount);
+      allMatched = allMatched && (failedTexelCount == 0);
+    }
+
+    return allMatched ? 0 : 1;
+  }
+  catch (const std::exception &ex)
+  {
+    fprintf(stderr, "Error: %s\n", ex.what());
+    return 1;
+  }
+}
@@ -0,0 +1,56 @@
+#include <png.h>
+
+#include <stdexcept>
+#include <string>
+
+#include "PngFile.h"
+
+
+std::vector<uint32_t> ReadPngFile(const char *inputPath, uint32_t *width, uint32_t *height)
+{
+  png_image image = {};
+  image.version = PNG_IMAGE_VERSION;
+
+  if (!png_image_begin_read_from_file(&image, inputPath))
+  {
+    throw std::runtime_error(std::string("Failed to open ") + inputPath + ": " + image.message);
+  }
+
+  // Have libpng convert whatever is in the file (palettized, grayscale, 16-bit, etc) to 8-bit RGBA, which (on a
+  //  little-endian machine) is exactly the layout of an RGBA_Unorm8 texture.
+  image.format = PNG_FORMAT_RGBA;
+  std::vector<uint32_t> colors(size_t(image.width) * image.height);
+  if (!png_image_finish_read(&image, nullptr, colors.data(), 0, nullptr))
+  {
+    png_image_free(&image);
+    throw std::runtime_error(std::string("Failed to read ") + inputPath + ": " + image.message);
+  }
+
+  *width = image.width;
+  *height = image.height;
+  return colors;
+}
+
+
+void SavePngFile(const char *outputPath, uint32_t width, uint32_t height, const uint32_t *colors)
+{
+  // Cathode Retro's output alpha is not meaningful as transparency, so drop it.
+  std::vector<uint8_t> rgb(size_t(width) * height * 3);
+  for (size_t i = 0; i < size_t(width) * height; i++)
+  {
+    rgb[i * 3 + 0] = uint8_t(colors[i]);
+    rgb[i * 3 + 1] = uint8_t(colors[i] >> 8);
+    rgb[i * 3 + 2] = uint8_t(colors[i] >> 16);
+  }
+
+  png_image image = {};
+  image.version = PNG_IMAGE_VERSION;
+  image.width = width;
+  image.height = height;
+  image.format = PNG_FORMAT_RGB;
+
+  if (!png_image_write_to_file(&image, outputPath, 0, rgb.data(), 0, nullptr))
+  {
+    throw std::runtime_error(std::string("Failed to write ") + outputPath + ": " + image.message);
+  }
+}
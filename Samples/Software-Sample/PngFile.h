@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cinttypes>
+#include <vector>
+
+// Read a PNG file (of any PNG pixel format) as 8-bit RGBA. Throws std::runtime_error on failure.
+std::vector<uint32_t> ReadPngFile(const char *inputPath, uint32_t *width, uint32_t *height);
+
+// Write 8-bit RGBA colors out as an (opaque, RGB) PNG file. Throws std::runtime_error on failure.
+void SavePngFile(const char *outputPath, uint32_t width, uint32_t height, const uint32_t *colors);
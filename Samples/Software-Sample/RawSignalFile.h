@@ -0,0 +1,331 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CathodeRetro/CathodeRetro.h"
+
+#include "MappedFile.h"
+
+
+// The layout of a raw composite signal capture: a file with no header, holding frame after frame of samples taken at
+//  4x the colorburst frequency (the rate that Cathode Retro's decoder works at), each frame made of whole lines.
+struct RawSignalFormat
+{
+  enum class SampleType
+  {
+    U8,
+    U16,
+    S16,
+    F32,
+  };
+
+  // Multi-byte samples are in the machine's byte order.
+  SampleType sampleType = SampleType::U16;
+  uint32_t samplesPerLine = 0;
+  uint32_t linesPerFrame = 0;
+
+  // The part of each frame that gets decoded. A count of 0 means the rest of the line (or frame). The sample count
+  //  gets rounded down to a whole number of color cycles.
+  uint32_t firstActiveSample = 0;
+  uint32_t activeSampleCount = 0;
+  uint32_t firstActiveLine = 0;
+  uint32_t activeLineCount = 0;
+
+  // The samples of each line that hold its colorburst, which its phase gets measured from (unless the phases come
+  //  from a file of their own instead).
+  uint32_t firstBurstSample = 0;
+  uint32_t burstSampleCount = 0;
+
+  // The raw sample values of black and white.
+  float blackLevel = 0.0f;
+  float whiteLevel = 1.0f;
+};
+
+
+// A memory-mapped raw composite signal capture (see RawSignalFormat), which streams each frame's scanlines straight
+//  out of the mapping into CathodeRetro::StreamSignalScanlines, so only the pages of the frames that get decoded are
+//  ever read in. 32-bit float samples are handed over as they are, and anything else gets converted a run of
+//  scanlines at a time.
+// The phase of each scanline either gets measured from its colorburst, or comes from a second file of raw 32-bit
+//  floats (one per active line of each frame, in the same fractions of a colorburst cycle that StreamSignalScanlines
+//  takes), for captures that were already time-base corrected to a fixed phase or whose burst is missing.
+// Throws std::runtime_error if either file can't be mapped or doesn't fit the format.
+class RawSignalFile
+{
+public:
+  // The samples on either side of the active part of each line that get decoded along with it (when the line has
+  //  them), so that the decoder's filters have something to work with at the edges (see
+  //  SourceSettings::sidePaddingColorCycleCount).
+  static constexpr uint32_t k_sidePaddingColorCycleCount = 2;
+
+  // The phase of an NTSC colorburst is 180 degrees from the B-Y axis, which puts the carrier phase that the decoder
+  //  expects (where I is on the sine and -Q is on the cosine) 57 degrees behind the burst's own phase.
+  static constexpr float k_burstToCarrierPhase = -57.0f / 360.0f;
+
+  static constexpr float k_pi = 3.141592653f;
+
+
+  RawSignalFile(const char *path, const RawSignalFormat &formatIn, const char *phasesPath = nullptr)
+    : file(path)
+    , format(formatIn)
+  {
+    if (format.samplesPerLine == 0 || format.linesPerFrame == 0)
+    {
+      throw std::runtime_error("The samples per line and lines per frame of a raw signal need to be given");
+    }
+
+    if (format.activeSampleCount == 0 && format.firstActiveSample < format.samplesPerLine)
+    {
+      format.activeSampleCount = format.samplesPerLine - format.firstActiveSample;
+    }
+
+    if (format.activeLineCount == 0 && format.firstActiveLine < format.linesPerFrame)
+    {
+      format.activeLineCount = format.linesPerFrame - format.firstActiveLine;
+    }
+
+    format.activeSampleCount -= format.activeSampleCount % CathodeRetro::Internal::k_signalSamplesPerColorCycle;
+    if (format.activeSampleCount == 0
+      || format.activeLineCount == 0
+      || format.firstActiveSample + format.activeSampleCount > format.samplesPerLine
+      || format.firstActiveLine + format.activeLineCount > format.linesPerFrame
+      || format.firstBurstSample + format.burstSampleCount > format.samplesPerLine
+      || format.whiteLevel == format.blackLevel)
+    {
+      throw std::runtime_error(std::string("The raw signal format doesn't fit the lines of ") + path);
+    }
+
+    // Pad the active samples with the ones around them, if there's room for all of the padding on both sides.
+    uint32_t paddingSampleCount = k_sidePaddingColorCycleCount * CathodeRetro::Internal::k_signalSamplesPerColorCycle;
+    if (format.firstActiveSample >= paddingSampleCount
+      && format.firstActiveSample + format.activeSampleCount + paddingSampleCount <= format.samplesPerLine)
+    {
+      sidePaddingColorCycleCount = k_sidePaddingColorCycleCount;
+    }
+
+    frameByteCount = SampleByteCount() * format.samplesPerLine * format.linesPerFrame;
+    frameCount = uint32_t(file.ByteCount() / frameByteCount);
+
+    if (phasesPath != nullptr)
+    {
+      phasesFile = std::make_unique<MappedFile>(phasesPath);
+      if (phasesFile->ByteCount() < sizeof(float) * format.activeLineCount * frameCount)
+      {
+        throw std::runtime_error(std::string("There aren't enough phases in ") + phasesPath);
+      }
+    }
+    else if (format.burstSampleCount < CathodeRetro::Internal::k_signalSamplesPerColorCycle)
+    {
+      throw std::runtime_error("A raw signal needs either a colorburst of at least one cycle, or a phases file");
+    }
+  }
+
+
+  uint32_t FrameCount() const
+    { return frameCount; }
+
+  // The size of the input that the CathodeRetro instance that decodes this needs to be created with: one input pixel
+  //  per color cycle of the active samples, and one row per active line.
+  uint32_t InputWidth() const
+    { return format.activeSampleCount / CathodeRetro::Internal::k_signalSamplesPerColorCycle; }
+
+  uint32_t InputHeight() const
+    { return format.activeLineCount; }
+
+
+  // The source settings to create the CathodeRetro instance with, for which its signal is exactly as wide as the
+  //  (padded) active samples of a line, given the aspect ratio of an input pixel (that is, of a color cycle).
+  CathodeRetro::SourceSettings SourceSettings(float inputPixelAspectRatio) const
+  {
+    CathodeRetro::SourceSettings settings;
+    settings.inputPixelAspectRatio = inputPixelAspectRatio;
+    settings.sidePaddingColorCycleCount = sidePaddingColorCycleCount;
+    settings.denominator = 1;
+    settings.colorCyclesPerInputPixel = 1;
+    return settings;
+  }
+
+
+  // The samples get handed over at their raw values, so the levels say where black and white are (and the chroma
+  //  gets scaled by the same amount as the luma).
+  CathodeRetro::SignalLevels SignalLevels() const
+  {
+    CathodeRetro::SignalLevels levels;
+    levels.blackLevel = format.blackLevel;
+    levels.whiteLevel = format.whiteLevel;
+    levels.saturationScale *= format.whiteLevel - format.blackLevel;
+    return levels;
+  }
+
+
+  // Stream the active lines [firstLine, endLine) of the given frame into the given CathodeRetro instance (which needs
+  //  to have been set up with InputWidth, InputHeight, SourceSettings, and SignalLevels). Each frame's lines need to
+  //  be streamed in order from the top, and once they all are, the frame is ready for RenderStreamedFrame.
+  void StreamLines(
+    CathodeRetro::CathodeRetro *cathodeRetro,
+    uint32_t frameIndex,
+    CathodeRetro::ScanlineType scanlineType,
+    uint32_t firstLine,
+    uint32_t endLine)
+  {
+    phases.resize(endLine - firstLine);
+    for (uint32_t line = firstLine; line < endLine; line++)
+    {
+      phases[line - firstLine] = LinePhase(frameIndex, line);
+    }
+
+    const float *samples;
+    ptrdiff_t rowPitch;
+    if (format.sampleType == RawSignalFormat::SampleType::F32)
+    {
+      samples = reinterpret_cast<const float *>(LineSamples(frameIndex, firstLine) + SignalFirstSample() * 4);
+      rowPitch = ptrdiff_t(format.samplesPerLine * sizeof(float));
+    }
+    else
+    {
+      uint32_t signalWidth = cathodeRetro->SignalScanlineWidth();
+      convertedSamples.resize(size_t(signalWidth) * (endLine - firstLine));
+      for (uint32_t line = firstLine; line < endLine; line++)
+      {
+        ReadSamples(
+          frameIndex,
+          line,
+          SignalFirstSample(),
+          signalWidth,
+          &convertedSamples[size_t(line - firstLine) * signalWidth]);
+      }
+
+      samples = convertedSamples.data();
+      rowPitch = ptrdiff_t(signalWidth * sizeof(float));
+    }
+
+    cathodeRetro->StreamSignalScanlines(samples, rowPitch, phases.data(), scanlineType, firstLine, endLine - 1);
+  }
+
+private:
+  size_t SampleByteCount() const
+  {
+    switch (format.sampleType)
+    {
+    case RawSignalFormat::SampleType::U8:
+      return 1;
+    case RawSignalFormat::SampleType::U16:
+    case RawSignalFormat::SampleType::S16:
+      return 2;
+    default:
+      return 4;
+    }
+  }
+
+
+  // The index (within the line) of the first sample of the signal that gets decoded: the active samples, plus the
+  //  padding on the left side.
+  uint32_t SignalFirstSample() const
+  {
+    return format.firstActiveSample
+      - sidePaddingColorCycleCount * CathodeRetro::Internal::k_signalSamplesPerColorCycle;
+  }
+
+
+  // Get the start of the given active line's samples in the mapping.
+  const uint8_t *LineSamples(uint32_t frameIndex, uint32_t activeLine) const
+  {
+    size_t lineByteCount = SampleByteCount() * format.samplesPerLine;
+    return static_cast<const uint8_t *>(file.Data())
+      + frameByteCount * frameIndex
+      + lineByteCount * (format.firstActiveLine + activeLine);
+  }
+
+
+  // Convert count samples of the given active line (starting at the given sample) to floats.
+  void ReadSamples(uint32_t frameIndex, uint32_t activeLine, uint32_t firstSample, uint32_t count, float *out) const
+  {
+    const uint8_t *src = LineSamples(frameIndex, activeLine) + SampleByteCount() * firstSample;
+    for (uint32_t i = 0; i < count; i++)
+    {
+      switch (format.sampleType)
+      {
+      case RawSignalFormat::SampleType::U8:
+        out[i] = float(src[i]);
+        break;
+
+      case RawSignalFormat::SampleType::U16:
+        {
+          uint16_t value;
+          memcpy(&value, src + i * 2, sizeof(value));
+          out[i] = float(value);
+        }
+        break;
+
+      case RawSignalFormat::SampleType::S16:
+        {
+          int16_t value;
+          memcpy(&value, src + i * 2, sizeof(value));
+          out[i] = float(value);
+        }
+        break;
+
+      case RawSignalFormat::SampleType::F32:
+        memcpy(&out[i], src + i * 4, sizeof(float));
+        break;
+      }
+    }
+  }
+
+
+  // Get the carrier phase at the first decoded sample of the given active line, either from the phases file, or by
+  //  measuring its colorburst: with 4 samples per cycle, correlating the burst against a sine and cosine at the
+  //  carrier frequency only takes adding and subtracting samples (which also cancels out the level that it sits at).
+  float LinePhase(uint32_t frameIndex, uint32_t activeLine)
+  {
+    if (phasesFile != nullptr)
+    {
+      float phase;
+      memcpy(
+        &phase,
+        static_cast<const uint8_t *>(phasesFile->Data())
+          + sizeof(float) * (size_t(format.activeLineCount) * frameIndex + activeLine),
+        sizeof(phase));
+      return phase;
+    }
+
+    uint32_t burstCycleCount = format.burstSampleCount / CathodeRetro::Internal::k_signalSamplesPerColorCycle;
+    burstSamples.resize(burstCycleCount * CathodeRetro::Internal::k_signalSamplesPerColorCycle);
+    ReadSamples(frameIndex, activeLine, format.firstBurstSample, uint32_t(burstSamples.size()), burstSamples.data());
+
+    // For a burst of sin(2 * pi * (phase + n / 4)), the sum against the sine is cos(2 * pi * phase) and the sum
+    //  against the cosine is sin(2 * pi * phase) (both scaled by the same amount).
+    float sineSum = 0.0f;
+    float cosineSum = 0.0f;
+    for (uint32_t i = 0; i < burstSamples.size(); i += 4)
+    {
+      sineSum += burstSamples[i + 1] - burstSamples[i + 3];
+      cosineSum += burstSamples[i + 0] - burstSamples[i + 2];
+    }
+
+    float burstPhase = std::atan2(cosineSum, sineSum) / (2.0f * k_pi);
+    float phase = burstPhase
+      + k_burstToCarrierPhase
+      + (float(SignalFirstSample()) - float(format.firstBurstSample))
+        / float(CathodeRetro::Internal::k_signalSamplesPerColorCycle);
+    return phase - std::floor(phase);
+  }
+
+
+  MappedFile file;
+  RawSignalFormat format;
+  std::unique_ptr<MappedFile> phasesFile;
+  uint32_t sidePaddingColorCycleCount = 0;
+  size_t frameByteCount = 0;
+  uint32_t frameCount = 0;
+
+  std::vector<float> phases;
+  std::vector<float> convertedSamples;
+  std::vector<float> burstSamples;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "CathodeRetro/GraphicsDevice.h"
+#include "CathodeRetro/ScreenTextureStore.h"
+
+
+// A CathodeRetro::IScreenTextureStore that keeps each screen texture in its own file in a directory (which needs to
+//  exist), named after the hash of its key. Each file starts with the full key and ScreenTextureKey::k_version, so a
+//  hash collision or a file from another version just counts as not being in the store. Saving writes to a temporary
+//  file and then renames it into place, so another process reading the same directory never sees a partial file.
+class ScreenTextureDirectory : public CathodeRetro::IScreenTextureStore
+{
+public:
+  explicit ScreenTextureDirectory(std::string directoryIn)
+    : directory(std::move(directoryIn))
+    { }
+
+
+  bool Load(const CathodeRetro::ScreenTextureKey &key, void *texelsOut) override
+  {
+    FILE *file = fopen(PathForKey(key).c_str(), "rb");
+    if (file == nullptr)
+    {
+      return false;
+    }
+
+    Header header;
+    Header expected = MakeHeader(key);
+    bool loaded = fread(&header, sizeof(header), 1, file) == 1
+      && memcmp(&header, &expected, sizeof(header)) == 0
+      && fread(texelsOut, 1, TexelByteCount(key), file) == TexelByteCount(key);
+    fclose(file);
+    return loaded;
+  }
+
+
+  void Save(const CathodeRetro::ScreenTextureKey &key, const void *texels) override
+  {
+    std::string path = PathForKey(key);
+    std::string tempPath = path + ".tmp." + std::to_string(getpid());
+    FILE *file = fopen(tempPath.c_str(), "wb");
+    if (file == nullptr)
+    {
+      return;
+    }
+
+    // The store is just a cache, so failing to save a texture isn't an error (it'll be generated again next time).
+    Header header = MakeHeader(key);
+    bool wrote = fwrite(&header, sizeof(header), 1, file) == 1
+      && fwrite(texels, 1, TexelByteCount(key), file) == TexelByteCount(key);
+    if (fclose(file) != 0 || !wrote || rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+      remove(tempPath.c_str());
+    }
+  }
+
+private:
+  struct Header
+  {
+    char magic[4];
+    uint32_t version;
+    CathodeRetro::ScreenTextureKey key;
+  };
+
+
+  static Header MakeHeader(const CathodeRetro::ScreenTextureKey &key)
+  {
+    Header header;
+    memcpy(header.magic, "CRST", sizeof(header.magic));
+    header.version = CathodeRetro::ScreenTextureKey::k_version;
+    header.key = key;
+    return header;
+  }
+
+
+  static size_t TexelByteCount(const CathodeRetro::ScreenTextureKey &key)
+    { return CathodeRetro::RenderTargetByteCount(key.width, key.height, 1, CathodeRetro::TextureFormat::RGBA_Unorm8); }
+
+
+  std::string PathForKey(const CathodeRetro::ScreenTextureKey &key) const
+  {
+    char name[32];
+    snprintf(name, sizeof(name), "%016" PRIx64 ".crscreen", key.Hash());
+    return directory + "/" + name;
+  }
+
+
+  std::string directory;
+};
@@ -0,0 +1,528 @@
+// A headless command-line tool that decodes a raw composite signal capture (see RawSignalFile.h), or a signal
+//  recording made by cathode-retro-batch's --record-signal option (see SignalRecordingFile.h), through Cathode Retro's
+//  decoder and CRT passes, without the signal generator, writing one output PNG per frame. Either file is
+//  memory-mapped and its scanlines go to the decoder straight from the mapping (see
+//  CathodeRetro::StreamSignalScanlines), so long captures don't get read into memory up front.
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "CathodeRetro/CathodeRetro.h"
+#include "CathodeRetro/SettingPresets.h"
+
+#include "CommandLine.h"
+#include "PngFile.h"
+#include "RawSignalFile.h"
+#include "SignalRecordingFile.h"
+#include "SoftwareGraphicsDevice.h"
+
+
+namespace fs = std::filesystem;
+
+
+struct Options
+{
+  std::string inputPath;
+  std::string phasesPath;
+  std::string outputDirectory;
+
+  // Whether the input is a signal recording rather than a raw capture (in which case it describes itself, and the
+  //  format options don't apply).
+  bool isRecording = false;
+
+  RawSignalFormat format;
+
+  // 0 means "4:3 for the whole active area".
+  float inputPixelAspectRatio = 0.0f;
+
+  CathodeRetro::SignalPrecision signalPrecision = CathodeRetro::SignalPrecision::Float32;
+  CathodeRetro::CompositeDecodePath compositeDecodePath = CathodeRetro::CompositeDecodePath::ThreePass;
+  CathodeRetro::ArtifactSettings artifactSettings = CathodeRetro::k_artifactPresets[1].settings;
+  CathodeRetro::ScreenSettings screenSettings = CathodeRetro::k_screenPresets[4].settings;
+  CathodeRetro::ScanlineType scanlineType = CathodeRetro::ScanlineType::Progressive;
+
+  // 0 means "pick an output size based on the number of active lines".
+  uint32_t outputWidth = 0;
+  uint32_t outputHeight = 0;
+
+  uint32_t renderThreadCount = 0;
+
+  // The frames of the capture to decode (a count of 0 means the rest of them).
+  uint32_t firstFrame = 0;
+  uint32_t frameCount = 0;
+
+  // The number of runs that each frame's scanlines are handed over in.
+  uint32_t streamRunCount = 1;
+};
+
+
+static void PrintUsage()
+{
+  printf(
+    "Usage: cathode-retro-decode-signal [options] --line <samples> --lines <lines> -o <output directory> <capture>\n"
+    "       cathode-retro-decode-signal [options] --recording -o <output directory> <recording>\n"
+    "\n"
+    "The capture is a raw file of composite signal samples at 4x the colorburst frequency, with no header: frame\n"
+    "  after frame, each made of whole lines. A recording is a file from cathode-retro-batch --record-signal. One\n"
+    "  PNG file is written per decoded frame.\n"
+    "\n"
+    "Options:\n"
+    "  -o, --output <dir>         Directory to write the output PNG files to (created if needed)\n"
+    "  --recording                The input is a signal recording (the capture format options don't apply)\n"
+    "  --format <type>            Sample type: u8, u16 (default), s16, or f32\n"
+    "  --line <n>                 Samples per line\n"
+    "  --lines <n>                Lines per frame\n"
+    "  --active <first>,<count>   The active samples of each line (default: the whole line)\n"
+    "  --active-lines <f>,<c>     The active lines of each frame (default: the whole frame)\n"
+    "  --burst <first>,<count>    The colorburst samples of each line\n"
+    "  --phases <file>            Raw 32-bit float phase per active line (in colorburst cycles), instead of --burst\n"
+    "  --levels <black>,<white>   The raw sample values of black and white (default: 0,1)\n"
+    "  --pixel-aspect <ratio>     Aspect ratio of one color cycle (default: 4:3 for the whole active area)\n"
+    "  --interlaced               Alternate a capture between even and odd fields, one per frame\n"
+    "  --frames <first>,<count>   The frames to decode (default: all of them)\n"
+    "  --stream <n>               Hand over each frame's scanlines in n runs (default: 1)\n"
+    "  --precision <bits>         Float precision of the decoder's textures: 32 (default) or 16\n"
+    "  --decode <passes>          Composite decode passes: three (default) or single\n"
+    "  --artifacts <preset>       Artifact preset name or index (default: \"%s\")\n"
+    "  --screen <preset>          Screen preset name or index (default: \"%s\")\n"
+    "  --size <w>x<h>             Output size (default: 4x the active line count, with a 4:3 aspect ratio)\n"
+    "  --threads <n>              Render threads (default: 0, one per hardware thread)\n"
+    "  --list-presets             List the available presets and exit\n"
+    "  -h, --help                 Show this message\n",
+    CathodeRetro::k_artifactPresets[1].name,
+    CathodeRetro::k_screenPresets[4].name);
+}
+
+
+// Returns false if the program should exit without processing anything.
+static bool ParseCommandLine(int argc, char **argv, Options *options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    auto value = [&]() -> std::string
+    {
+      if (i + 1 >= argc)
+      {
+        throw std::runtime_error("Missing value for " + arg);
+      }
+
+      return argv[++i];
+    };
+
+    if (arg == "-h" || arg == "--help")
+    {
+      PrintUsage();
+      return false;
+    }
+    else if (arg == "--list-presets")
+    {
+      PrintPresets("Artifact presets", CathodeRetro::k_artifactPresets);
+      PrintPresets("Screen presets", CathodeRetro::k_screenPresets);
+      return false;
+    }
+    else if (arg == "-o" || arg == "--output")
+    {
+      options->outputDirectory = value();
+    }
+    else if (arg == "--recording")
+    {
+      options->isRecording = true;
+    }
+    else if (arg == "--format")
+    {
+      std::string type = value();
+      if (type == "u8")
+      {
+        options->format.sampleType = RawSignalFormat::SampleType::U8;
+      }
+      else if (type == "u16")
+      {
+        options->format.sampleType = RawSignalFormat::SampleType::U16;
+      }
+      else if (type == "s16")
+      {
+        options->format.sampleType = RawSignalFormat::SampleType::S16;
+      }
+      else if (type == "f32")
+      {
+        options->format.sampleType = RawSignalFormat::SampleType::F32;
+      }
+      else
+      {
+        throw std::runtime_error("Unknown sample type \"" + type + "\"");
+      }
+    }
+    else if (arg == "--line")
+    {
+      options->format.samplesPerLine = ParseUInt(arg, value());
+    }
+    else if (arg == "--lines")
+    {
+      options->format.linesPerFrame = ParseUInt(arg, value());
+    }
+    else if (arg == "--active")
+    {
+      auto range = SplitPair(arg, value());
+      options->format.firstActiveSample = ParseUInt(arg, range.first);
+      options->format.activeSampleCount = ParseUInt(arg, range.second);
+    }
+    else if (arg == "--active-lines")
+    {
+      auto range = SplitPair(arg, value());
+      options->format.firstActiveLine = ParseUInt(arg, range.first);
+      options->format.activeLineCount = ParseUInt(arg, range.second);
+    }
+    else if (arg == "--burst")
+    {
+      auto range = SplitPair(arg, value());
+      options->format.firstBurstSample = ParseUInt(arg, range.first);
+      options->format.burstSampleCount = ParseUInt(arg, range.second);
+    }
+    else if (arg == "--phases")
+    {
+      options->phasesPath = value();
+    }
+    else if (arg == "--levels")
+    {
+      auto levels = SplitPair(arg, value());
+      options->format.blackLevel = ParseFloat(arg, levels.first);
+      options->format.whiteLevel = ParseFloat(arg, levels.second);
+    }
+    else if (arg == "--pixel-aspect")
+    {
+      options->inputPixelAspectRatio = ParseFloat(arg, value());
+      if (options->inputPixelAspectRatio <= 0.0f)
+      {
+        throw std::runtime_error("The pixel aspect ratio must be positive");
+      }
+    }
+    else if (arg == "--interlaced")
+    {
+      options->scanlineType = CathodeRetro::ScanlineType::Even;
+    }
+    else if (arg == "--frames")
+    {
+      auto range = SplitPair(arg, value());
+      options->firstFrame = ParseUInt(arg, range.first);
+      options->frameCount = ParseUInt(arg, range.second);
+    }
+    else if (arg == "--stream")
+    {
+      options->streamRunCount = std::max(1U, ParseUInt(arg, value()));
+    }
+    else if (arg == "--precision")
+    {
+      std::string bits = value();
+      if (bits == "32")
+      {
+        options->signalPrecision = CathodeRetro::SignalPrecision::Float32;
+      }
+      else if (bits == "16")
+      {
+        options->signalPrecision = CathodeRetro::SignalPrecision::Float16;
+      }
+      else
+      {
+        throw std::runtime_error("Unknown signal precision \"" + bits + "\"");
+      }
+    }
+    else if (arg == "--decode")
+    {
+      std::string passes = value();
+      if (passes == "three")
+      {
+        options->compositeDecodePath = CathodeRetro::CompositeDecodePath::ThreePass;
+      }
+      else if (passes == "single")
+      {
+        options->compositeDecodePath = CathodeRetro::CompositeDecodePath::SinglePass;
+      }
+      else
+      {
+        throw std::runtime_error("Unknown composite decode path \"" + passes + "\"");
+      }
+    }
+    else if (arg == "--artifacts")
+    {
+      options->artifactSettings = FindPreset("artifact", value(), CathodeRetro::k_artifactPresets);
+    }
+    else if (arg == "--screen")
+    {
+      options->screenSettings = FindPreset("screen", value(), CathodeRetro::k_screenPresets);
+    }
+    else if (arg == "--size")
+    {
+      std::string size = value();
+      size_t x = size.find('x');
+      if (x == std::string::npos)
+      {
+        throw std::runtime_error("Invalid size \"" + size + "\" (expected <width>x<height>)");
+      }
+
+      options->outputWidth = ParseUInt(arg, size.substr(0, x));
+      options->outputHeight = ParseUInt(arg, size.substr(x + 1));
+      if (options->outputWidth == 0 || options->outputHeight == 0)
+      {
+        throw std::runtime_error("Invalid size \"" + size + "\"");
+      }
+    }
+    else if (arg == "--threads")
+    {
+      options->renderThreadCount = ParseUInt(arg, value());
+    }
+    else if (arg.size() > 1 && arg[0] == '-')
+    {
+      throw std::runtime_error("Unknown option " + arg);
+    }
+    else if (options->inputPath.empty())
+    {
+      options->inputPath = arg;
+    }
+    else
+    {
+      throw std::runtime_error("Only one capture can be decoded at a time");
+    }
+  }
+
+  if (options->inputPath.empty() || options->outputDirectory.empty())
+  {
+    PrintUsage();
+    return false;
+  }
+
+  return true;
+}
+
+
+// Stream the scanlines [firstScanline, endScanline) of a recorded frame into the given CathodeRetro instance (which
+//  needs to have been set up with the frame's signal type, input size, source settings, and levels).
+static void StreamRecordedScanlines(
+  CathodeRetro::CathodeRetro *cathodeRetro,
+  const CathodeRetro::RecordedSignalFrame &frame,
+  uint32_t firstScanline,
+  uint32_t endScanline)
+{
+  size_t signalRowFloatCount = size_t(frame.scanlineWidth) * frame.signalChannelCount;
+  cathodeRetro->StreamSignalScanlines(
+    frame.signal + signalRowFloatCount * firstScanline,
+    ptrdiff_t(signalRowFloatCount * sizeof(float)),
+    frame.phases + size_t(frame.phaseChannelCount) * firstScanline,
+    frame.scanlineType,
+    firstScanline,
+    endScanline - 1);
+}
+
+
+int main(int argc, char **argv)
+{
+  try
+  {
+    SoftwareSIMD::CheckCPUSupport();
+
+    Options options;
+    if (!ParseCommandLine(argc, argv, &options))
+    {
+      return 0;
+    }
+
+    std::unique_ptr<RawSignalFile> capture;
+    std::unique_ptr<SignalRecordingReader> recording;
+    uint64_t sourceFrameCount;
+    if (options.isRecording)
+    {
+      recording = std::make_unique<SignalRecordingReader>(options.inputPath.c_str());
+      sourceFrameCount = recording->FrameCount();
+    }
+    else
+    {
+      capture = std::make_unique<RawSignalFile>(
+        options.inputPath.c_str(),
+        options.format,
+        options.phasesPath.empty() ? nullptr : options.phasesPath.c_str());
+      sourceFrameCount = capture->FrameCount();
+    }
+
+    if (options.firstFrame >= sourceFrameCount)
+    {
+      throw std::runtime_error(
+        options.inputPath + " only has " + std::to_string(sourceFrameCount) + " whole frame(s)");
+    }
+
+    uint64_t endFrame = sourceFrameCount;
+    if (options.frameCount != 0)
+    {
+      endFrame = std::min(endFrame, uint64_t(options.firstFrame) + options.frameCount);
+    }
+
+    fs::create_directories(options.outputDirectory);
+
+    // (A recording can change its input size partway through, but the output size comes from its first frame.)
+    uint32_t inputHeight = (recording != nullptr)
+      ? recording->Frame(options.firstFrame).inputHeight
+      : capture->InputHeight();
+    uint32_t outputHeight = (options.outputHeight != 0) ? options.outputHeight : inputHeight * 4;
+    uint32_t outputWidth = (options.outputWidth != 0) ? options.outputWidth : (outputHeight * 4 + 1) / 3;
+
+    auto startTime = std::chrono::steady_clock::now();
+    CathodeRetro::FrameStats totalStats;
+    uint32_t renderedCount = 0;
+    {
+      SoftwareGraphicsDevice device(options.renderThreadCount);
+      std::unique_ptr<CathodeRetro::CathodeRetro> cathodeRetro;
+      CathodeRetro::RecordedSignalFrame currentSource;
+
+      // Set up the instance for a signal of the given type, input size, and source settings (if it isn't already).
+      auto setUpSource = [&](const CathodeRetro::RecordedSignalFrame &source)
+      {
+        if (cathodeRetro == nullptr)
+        {
+          cathodeRetro = std::make_unique<CathodeRetro::CathodeRetro>(
+            &device,
+            source.signalType,
+            source.inputWidth,
+            source.inputHeight,
+            source.sourceSettings);
+          cathodeRetro->UpdateSettings(options.artifactSettings, {}, {}, options.screenSettings);
+          cathodeRetro->SetSignalPrecision(options.signalPrecision);
+          cathodeRetro->SetCompositeDecodePath(options.compositeDecodePath);
+          cathodeRetro->SetScreenTextureRegenerationFrameCount(1);
+          cathodeRetro->SetOutputSize(outputWidth, outputHeight);
+        }
+        else if (source.signalType != currentSource.signalType
+          || source.inputWidth != currentSource.inputWidth
+          || source.inputHeight != currentSource.inputHeight
+          || source.sourceSettings != currentSource.sourceSettings)
+        {
+          cathodeRetro->UpdateSourceSettings(
+            source.signalType,
+            source.inputWidth,
+            source.inputHeight,
+            source.sourceSettings);
+        }
+
+        currentSource = source;
+      };
+
+      if (capture != nullptr)
+      {
+        float inputPixelAspectRatio = options.inputPixelAspectRatio;
+        if (inputPixelAspectRatio == 0.0f)
+        {
+          inputPixelAspectRatio = 4.0f / 3.0f * float(capture->InputHeight()) / float(capture->InputWidth());
+        }
+
+        CathodeRetro::RecordedSignalFrame source;
+        source.signalType = CathodeRetro::SignalType::Composite;
+        source.inputWidth = capture->InputWidth();
+        source.inputHeight = capture->InputHeight();
+        source.sourceSettings = capture->SourceSettings(inputPixelAspectRatio);
+        setUpSource(source);
+        cathodeRetro->SetExternalSignalLevels(capture->SignalLevels());
+      }
+
+      auto output = device.CreateRenderTarget(outputWidth, outputHeight, 1, CathodeRetro::TextureFormat::RGBA_Unorm8);
+
+      auto addStats = [&]
+      {
+        auto stats = cathodeRetro->GetFrameStats();
+        for (size_t pass = 0; pass < size_t(CathodeRetro::PassID::Count); pass++)
+        {
+          totalStats.passMilliseconds[pass] += stats.passMilliseconds[pass];
+        }
+      };
+
+      std::string baseName = fs::path(options.inputPath).stem().string();
+      CathodeRetro::ScanlineType scanlineType = options.scanlineType;
+      for (uint64_t frame = options.firstFrame; frame < endFrame; frame++)
+      {
+        CathodeRetro::RecordedSignalFrame recordedFrame;
+        uint32_t lineCount;
+        if (recording != nullptr)
+        {
+          recordedFrame = recording->Frame(frame);
+          setUpSource(recordedFrame);
+          cathodeRetro->SetExternalSignalLevels(recordedFrame.levels);
+          lineCount = recordedFrame.scanlineCount;
+        }
+        else
+        {
+          lineCount = capture->InputHeight();
+        }
+
+        uint32_t runCount = std::min(options.streamRunCount, lineCount);
+        for (uint32_t run = 0; run < runCount; run++)
+        {
+          uint32_t firstLine = lineCount * run / runCount;
+          uint32_t endLine = lineCount * (run + 1) / runCount;
+          if (recording != nullptr)
+          {
+            StreamRecordedScanlines(cathodeRetro.get(), recordedFrame, firstLine, endLine);
+          }
+          else
+          {
+            capture->StreamLines(cathodeRetro.get(), uint32_t(frame), scanlineType, firstLine, endLine);
+          }
+
+          addStats();
+        }
+
+        cathodeRetro->RenderStreamedFrame(output.get());
+        addStats();
+        renderedCount++;
+
+        char frameSuffix[32];
+        snprintf(frameSuffix, sizeof(frameSuffix), "_%05" PRIu64 ".png", frame);
+        std::string outputPath = (fs::path(options.outputDirectory) / (baseName + frameSuffix)).string();
+        SavePngFile(
+          outputPath.c_str(),
+          outputWidth,
+          outputHeight,
+          reinterpret_cast<const uint32_t *>(static_cast<SoftwareTexture *>(output.get())->MipData(0)));
+        printf("%s [%" PRIu64 "] -> %s\n", options.inputPath.c_str(), frame, outputPath.c_str());
+
+        if (scanlineType != CathodeRetro::ScanlineType::Progressive)
+        {
+          scanlineType = (scanlineType == CathodeRetro::ScanlineType::Even)
+            ? CathodeRetro::ScanlineType::Odd
+            : CathodeRetro::ScanlineType::Even;
+        }
+      }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    printf(
+      "Decoded %u frame(s) in %.2f seconds (%.2f frames/second)\n",
+      renderedCount,
+      seconds,
+      double(renderedCount) / seconds);
+
+    if (renderedCount > 0)
+    {
+      printf("Average render time per frame:\n");
+      for (size_t pass = 0; pass < size_t(CathodeRetro::PassID::Count); pass++)
+      {
+        printf(
+          "  %-20s %9.3f ms\n",
+          CathodeRetro::PassName(CathodeRetro::PassID(pass)),
+          totalStats.passMilliseconds[pass] / float(renderedCount));
+      }
+    }
+
+    return 0;
+  }
+  catch (const std::exception &ex)
+  {
+    fprintf(stderr, "Error: %s\n", ex.what());
+    return 1;
+  }
+}
@@ -0,0 +1,367 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "CathodeRetro/SignalRecorder.h"
+
+#include "MappedFile.h"
+
+
+// A signal recording file holds the frames that a CathodeRetro::ISignalRecorder was handed, in order. It's written
+//  append-only: a file header, then one record per frame (a FrameHeader followed by the frame's signal and phases as
+//  raw 32-bit floats, padded out to a multiple of k_recordAlignment bytes), and then, once the recording is closed,
+//  an index of the frame records' offsets and a footer that points at it. Everything is in the machine's byte order.
+// Reading a recording memory-maps it and finds the footer at the end of the file, so getting at any frame is just a
+//  lookup in the index (and its samples are used straight from the mapping). A recording that never got its index
+//  (because the program that was writing it didn't close it) still reads, by walking the frame records once.
+namespace SignalRecording
+{
+  static constexpr uint32_t k_version = 1;
+
+  // Frame records start on this alignment, so that the samples in the mapping are aligned for any SIMD loads.
+  static constexpr uint64_t k_recordAlignment = 64;
+
+  struct FileHeader
+  {
+    char magic[4];
+    uint32_t version;
+  };
+
+  struct FrameHeader
+  {
+    char magic[4];
+    uint32_t frameIndex;
+    CathodeRetro::SignalType signalType;
+    CathodeRetro::ScanlineType scanlineType;
+    uint32_t inputWidth;
+    uint32_t inputHeight;
+    CathodeRetro::SourceSettings sourceSettings;
+    CathodeRetro::SignalLevels levels;
+    uint32_t scanlineWidth;
+    uint32_t scanlineCount;
+    uint32_t signalChannelCount;
+    uint32_t phaseChannelCount;
+  };
+
+  struct Footer
+  {
+    uint64_t indexOffset;
+    uint64_t frameCount;
+    char magic[4];
+    uint32_t version;
+  };
+
+
+  inline uint64_t SignalByteCount(const FrameHeader &header)
+  {
+    return uint64_t(header.scanlineWidth) * header.scanlineCount * header.signalChannelCount * sizeof(float);
+  }
+
+
+  inline uint64_t PhasesByteCount(const FrameHeader &header)
+    { return uint64_t(header.scanlineCount) * header.phaseChannelCount * sizeof(float); }
+
+
+  // The size of a whole frame record (including its padding).
+  inline uint64_t RecordByteCount(const FrameHeader &header)
+  {
+    uint64_t byteCount = sizeof(FrameHeader) + SignalByteCount(header) + PhasesByteCount(header);
+    return (byteCount + k_recordAlignment - 1) / k_recordAlignment * k_recordAlignment;
+  }
+}
+
+
+// A CathodeRetro::ISignalRecorder that appends every frame that it's handed to a signal recording file (see above),
+//  which it creates (replacing any file that's already there). The index gets written when this is destroyed (or
+//  Close is called). Throws std::runtime_error if the file can't be created or written to.
+class SignalRecordingWriter : public CathodeRetro::ISignalRecorder
+{
+public:
+  explicit SignalRecordingWriter(const char *pathIn)
+    : path(pathIn)
+  {
+    file = fopen(pathIn, "wb");
+    if (file == nullptr)
+    {
+      throw std::runtime_error("Failed to create " + path);
+    }
+
+    SignalRecording::FileHeader header;
+    memcpy(header.magic, "CRSG", sizeof(header.magic));
+    header.version = SignalRecording::k_version;
+    Write(&header, sizeof(header));
+  }
+
+
+  SignalRecordingWriter(const SignalRecordingWriter &) = delete;
+  void operator=(const SignalRecordingWriter &) = delete;
+
+
+  ~SignalRecordingWriter() override
+  {
+    if (file != nullptr)
+    {
+      // (Failing to write the index doesn't lose any frames, so there's nothing more to do about it here.)
+      try
+      {
+        Close();
+      }
+      catch (const std::exception &)
+      {
+      }
+    }
+  }
+
+
+  void RecordFrame(const CathodeRetro::RecordedSignalFrame &frame) override
+  {
+    // Pad out to the start of the record (the file header and every record before it are padded at their ends).
+    static const uint8_t k_zeros[SignalRecording::k_recordAlignment] = {};
+    uint64_t recordOffset =
+      (byteCount + SignalRecording::k_recordAlignment - 1) / SignalRecording::k_recordAlignment
+        * SignalRecording::k_recordAlignment;
+    Write(k_zeros, size_t(recordOffset - byteCount));
+
+    // (Cleared first so that any padding in the header is written out as zeros.)
+    SignalRecording::FrameHeader header;
+    memset(static_cast<void *>(&header), 0, sizeof(header));
+    memcpy(header.magic, "CRFR", sizeof(header.magic));
+    header.frameIndex = uint32_t(recordOffsets.size());
+    header.signalType = frame.signalType;
+    header.scanlineType = frame.scanlineType;
+    header.inputWidth = frame.inputWidth;
+    header.inputHeight = frame.inputHeight;
+    header.sourceSettings = frame.sourceSettings;
+    header.levels = frame.levels;
+    header.scanlineWidth = frame.scanlineWidth;
+    header.scanlineCount = frame.scanlineCount;
+    header.signalChannelCount = frame.signalChannelCount;
+    header.phaseChannelCount = frame.phaseChannelCount;
+
+    Write(&header, sizeof(header));
+    Write(frame.signal, size_t(SignalRecording::SignalByteCount(header)));
+    Write(frame.phases, size_t(SignalRecording::PhasesByteCount(header)));
+    Write(k_zeros, size_t(recordOffset + SignalRecording::RecordByteCount(header) - byteCount));
+    recordOffsets.push_back(recordOffset);
+  }
+
+
+  uint64_t FrameCount() const
+    { return recordOffsets.size(); }
+
+
+  // Write the index and footer and close the file (after which no more frames can be recorded).
+  void Close()
+  {
+    SignalRecording::Footer footer;
+    footer.indexOffset = byteCount;
+    footer.frameCount = recordOffsets.size();
+    memcpy(footer.magic, "CRIX", sizeof(footer.magic));
+    footer.version = SignalRecording::k_version;
+
+    Write(recordOffsets.data(), recordOffsets.size() * sizeof(uint64_t));
+    Write(&footer, sizeof(footer));
+
+    FILE *closingFile = file;
+    file = nullptr;
+    if (fclose(closingFile) != 0)
+    {
+      throw std::runtime_error("Failed to write " + path);
+    }
+  }
+
+private:
+  void Write(const void *data, size_t size)
+  {
+    if (file == nullptr)
+    {
+      throw std::runtime_error(path + " is already closed");
+    }
+
+    if (size > 0 && fwrite(data, 1, size, file) != size)
+    {
+      throw std::runtime_error("Failed to write " + path);
+    }
+
+    byteCount += size;
+  }
+
+
+  std::string path;
+  FILE *file = nullptr;
+  uint64_t byteCount = 0;
+  std::vector<uint64_t> recordOffsets;
+};
+
+
+// A memory-mapped signal recording file (see above), whose frames can be decoded again by handing them to
+//  CathodeRetro::SetExternalSignalLevels and CathodeRetro::StreamSignalScanlines. Throws std::runtime_error if the
+//  file can't be mapped or isn't a signal recording (or is from another version).
+class SignalRecordingReader
+{
+public:
+  explicit SignalRecordingReader(const char *path)
+    : file(path)
+  {
+    const SignalRecording::FileHeader *header = At<SignalRecording::FileHeader>(0);
+    if (header == nullptr
+      || memcmp(header->magic, "CRSG", sizeof(header->magic)) != 0
+      || header->version != SignalRecording::k_version)
+    {
+      throw std::runtime_error(std::string(path) + " is not a signal recording (or is from another version)");
+    }
+
+    if (!LoadIndex())
+    {
+      BuildIndex();
+    }
+  }
+
+
+  uint64_t FrameCount() const
+    { return frameCount; }
+
+
+  // Get the given frame, whose signal and phases point into the mapping (so they stay valid for as long as this
+  //  reader exists).
+  CathodeRetro::RecordedSignalFrame Frame(uint64_t frameIndex) const
+  {
+    if (frameIndex >= frameCount)
+    {
+      throw std::runtime_error("There is no frame " + std::to_string(frameIndex) + " in the recording");
+    }
+
+    uint64_t recordOffset = (index != nullptr) ? index[frameIndex] : builtIndex[size_t(frameIndex)];
+    const SignalRecording::FrameHeader *header = RecordAt(recordOffset);
+    if (header == nullptr)
+    {
+      throw std::runtime_error("Frame " + std::to_string(frameIndex) + " of the recording is corrupt");
+    }
+
+    CathodeRetro::RecordedSignalFrame frame;
+    frame.signalType = header->signalType;
+    frame.inputWidth = header->inputWidth;
+    frame.inputHeight = header->inputHeight;
+    frame.sourceSettings = header->sourceSettings;
+    frame.scanlineType = header->scanlineType;
+    frame.levels = header->levels;
+    frame.scanlineWidth = header->scanlineWidth;
+    frame.scanlineCount = header->scanlineCount;
+    frame.signalChannelCount = header->signalChannelCount;
+    frame.phaseChannelCount = header->phaseChannelCount;
+
+    const uint8_t *samples = Bytes() + recordOffset + sizeof(SignalRecording::FrameHeader);
+    frame.signal = reinterpret_cast<const float *>(samples);
+    frame.phases = reinterpret_cast<const float *>(samples + SignalRecording::SignalByteCount(*header));
+    return frame;
+  }
+
+private:
+  const uint8_t *Bytes() const
+    { return static_cast<const uint8_t *>(file.Data()); }
+
+
+  // Get a pointer to a T at the given offset, or nullptr if it doesn't fit in the file.
+  template <typename T>
+  const T *At(uint64_t offset) const
+  {
+    if (offset > file.ByteCount() || file.ByteCount() - offset < sizeof(T))
+    {
+      return nullptr;
+    }
+
+    return reinterpret_cast<const T *>(Bytes() + offset);
+  }
+
+
+  // Get the header of the frame record at the given offset, or nullptr if there isn't a whole one there. The sizes in
+  //  the header get checked before they're multiplied together, so that a corrupt one can't overflow its record's
+  //  byte count into something that fits in the file.
+  const SignalRecording::FrameHeader *RecordAt(uint64_t offset) const
+  {
+    auto header = At<SignalRecording::FrameHeader>(offset);
+    if (header == nullptr
+      || offset % SignalRecording::k_recordAlignment != 0
+      || memcmp(header->magic, "CRFR", sizeof(header->magic)) != 0
+      || header->scanlineWidth > k_maxScanlineWidth
+      || header->scanlineCount > k_maxScanlineCount
+      || header->signalChannelCount < 1 || header->signalChannelCount > 4
+      || header->phaseChannelCount < 1 || header->phaseChannelCount > 2
+      || file.ByteCount() - offset < SignalRecording::RecordByteCount(*header))
+    {
+      return nullptr;
+    }
+
+    return header;
+  }
+
+
+  // Use the index that the footer points at, if the file has one (and every entry in it points at a whole frame
+  //  record).
+  bool LoadIndex()
+  {
+    if (file.ByteCount() < sizeof(SignalRecording::Footer))
+    {
+      return false;
+    }
+
+    auto footer = At<SignalRecording::Footer>(file.ByteCount() - sizeof(SignalRecording::Footer));
+    uint64_t indexEnd = file.ByteCount() - sizeof(SignalRecording::Footer);
+    if (memcmp(footer->magic, "CRIX", sizeof(footer->magic)) != 0
+      || footer->version != SignalRecording::k_version
+      || footer->indexOffset > indexEnd
+      || footer->indexOffset % sizeof(uint64_t) != 0
+      || footer->frameCount > (indexEnd - footer->indexOffset) / sizeof(uint64_t)
+      || indexEnd - footer->indexOffset != footer->frameCount * sizeof(uint64_t))
+    {
+      return false;
+    }
+
+    auto entries = reinterpret_cast<const uint64_t *>(Bytes() + footer->indexOffset);
+    for (uint64_t i = 0; i < footer->frameCount; i++)
+    {
+      if (RecordAt(entries[i]) == nullptr)
+      {
+        return false;
+      }
+    }
+
+    index = entries;
+    frameCount = footer->frameCount;
+    return true;
+  }
+
+
+  // Find every whole frame record in a file that doesn't have an index.
+  void BuildIndex()
+  {
+    uint64_t offset = k_firstRecordOffset;
+    for (const SignalRecording::FrameHeader *header = RecordAt(offset); header != nullptr; header = RecordAt(offset))
+    {
+      builtIndex.push_back(offset);
+      offset += SignalRecording::RecordByteCount(*header);
+    }
+
+    frameCount = builtIndex.size();
+  }
+
+
+  // Bounds on the sizes in a frame header, well past anything that the signal generator makes (S-Video with temporal
+  //  artifact reduction is 4 channels).
+  static constexpr uint32_t k_maxScanlineWidth = 1 << 16;
+  static constexpr uint32_t k_maxScanlineCount = 1 << 16;
+
+  static constexpr uint64_t k_firstRecordOffset =
+    (sizeof(SignalRecording::FileHeader) + SignalRecording::k_recordAlignment - 1)
+      / SignalRecording::k_recordAlignment * SignalRecording::k_recordAlignment;
+
+  MappedFile file;
+  uint64_t frameCount = 0;
+  const uint64_t *index = nullptr;
+  std::vector<uint64_t> builtIndex;
+};
@@ -0,0 +1,579 @@
+#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "CathodeRetro/GraphicsDevice.h"
+
+#include "SoftwareShaders.h"
+#include "SoftwareTexture.h"
+#include "SoftwareThreadPool.h"
+
+
+// This is a Cathode Retro "shader", which for the software device is just the C++ kernel that the shader was ported to.
+class SoftwareShader : public CathodeRetro::IShader
+{
+public:
+  SoftwareShader(CathodeRetro::ShaderID idIn, SoftwareKernel kernelIn)
+    : id(idIn)
+    , kernel(kernelIn)
+    { }
+
+  CathodeRetro::ShaderID ID() const
+    { return id; }
+
+  SoftwareKernel Kernel() const
+    { return kernel; }
+
+private:
+  CathodeRetro::ShaderID id;
+  SoftwareKernel kernel;
+};
+
+
+// A graphics device that runs the whole Cathode Retro pipeline on the CPU, with no graphics API at all. Each RenderQuad
+//  call is split up into bands of rows which are rendered in parallel across a thread pool.
+class SoftwareGraphicsDevice : public CathodeRetro::IGraphicsDevice
+{
+public:
+  // A thread count of 0 means "use every hardware thread".
+  explicit SoftwareGraphicsDevice(uint32_t threadCount = 0)
+    : threadPool(threadCount)
+    { }
+
+
+  SoftwareGraphicsDevice(SoftwareGraphicsDevice &) = delete;
+  void operator=(const SoftwareGraphicsDevice &) = delete;
+
+
+  // Create a (single-mip) texture, optionally initialized with tightly-packed texel data in the given format.
+  std::unique_ptr<SoftwareTexture> CreateTexture(
+    uint32_t width,
+    uint32_t height,
+    CathodeRetro::TextureFormat format,
+    const void *initialDataTexels)
+  {
+    return std::make_unique<SoftwareTexture>(width, height, 1, format, initialDataTexels);
+  }
+
+
+  uint32_t ThreadCount() const
+    { return threadPool.ThreadCount(); }
+
+
+  // CathodeRetro::IGraphicsDevice implementations ////////////////////////////////////////////////////////////////////
+
+
+  std::unique_ptr<CathodeRetro::IRenderTarget> CreateRenderTarget(
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipCount, // 0 means "all mip levels"
+    CathodeRetro::TextureFormat format) override
+  {
+    return std::make_unique<SoftwareTexture>(width, height, mipCount, format, nullptr);
+  }
+
+
+  std::unique_ptr<CathodeRetro::IConstantBuffer> CreateConstantBuffer(size_t size) override
+  {
+    return std::make_unique<SoftwareConstantBuffer>(size);
+  }
+
+
+  std::unique_ptr<CathodeRetro::IShader> CreateShader(CathodeRetro::ShaderID id) override
+  {
+    return std::make_unique<SoftwareShader>(id, SoftwareShaders::KernelForShader(id));
+  }
+
+
+  void BeginRendering() override
+  {
+    // There's no render state to set up, all of the state that matters is passed in to each RenderQuad call.
+    assert(!isRendering);
+    isRendering = true;
+    currentFrameStats = CathodeRetro::FrameStats();
+  }
+
+
+  void RenderQuad(
+    CathodeRetro::IShader *ps,
+    CathodeRetro::RenderTargetView output,
+    std::initializer_list<CathodeRetro::ShaderResourceView> inputs,
+    CathodeRetro::IConstantBuffer *constantBuffer) override
+  {
+    assert(isRendering);
+
+    SoftwareRenderState state;
+    state.target = static_cast<SoftwareTexture *>(output.texture);
+    state.targetMip = output.mipLevel;
+    state.width = state.target->MipWidth(output.mipLevel);
+    state.height = state.target->MipHeight(output.mipLevel);
+    state.firstRow = output.firstRow;
+    state.rowCount = output.rowCount;
+    state.firstColumn = output.firstColumn;
+    state.columnCount = output.columnCount;
+
+    assert(inputs.size() <= std::size(state.inputs));
+    for (auto &input : inputs)
+    {
+      auto &view = state.inputs[state.inputCount++];
+      view.texture = static_cast<const SoftwareTexture *>(input.texture);
+      view.mipLevel = input.mipLevel;
+      view.samplerType = input.samplerType;
+    }
+
+    if (constantBuffer != nullptr)
+    {
+      state.constants = static_cast<SoftwareConstantBuffer *>(constantBuffer)->Data();
+    }
+
+    Dispatch(static_cast<SoftwareShader *>(ps)->Kernel(), state);
+  }
+
+
+  void EndRendering() override
+  {
+    assert(isRendering);
+    isRendering = false;
+    lastFrameStats = currentFrameStats;
+    lastFrameStats.isValid = true;
+  }
+
+
+  // Rendering is synchronous, so CPU timestamps around each pass measure exactly the work done for it.
+  void BeginPass(CathodeRetro::PassID pass) override
+  {
+    assert(isRendering);
+    currentPass = pass;
+    passStartTime = std::chrono::steady_clock::now();
+  }
+
+
+  void EndPass() override
+  {
+    assert(isRendering);
+    currentFrameStats.passMilliseconds[size_t(currentPass)] +=
+      std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - passStartTime).count();
+  }
+
+
+  bool GetFrameStats(CathodeRetro::FrameStats *statsOut) override
+  {
+    *statsOut = lastFrameStats;
+    return lastFrameStats.isValid;
+  }
+
+
+  std::unique_ptr<CathodeRetro::IRenderTargetMemory> CreateRenderTargetMemory(size_t byteCount) override
+  {
+    return std::make_unique<SoftwareRenderTargetMemory>(byteCount);
+  }
+
+
+  std::unique_ptr<CathodeRetro::ITexture> CreateStreamingTexture(
+    uint32_t width,
+    uint32_t height,
+    CathodeRetro::TextureFormat format) override
+  {
+    return CreateTexture(width, height, format, nullptr);
+  }
+
+
+  // Nothing reads textures outside of RenderQuad calls (which finish before they return), so there's nothing to
+  //  ring-buffer: the texels can be copied straight in, a row at a time.
+  void UpdateTexture(CathodeRetro::ITexture *texture, const void *texels, ptrdiff_t rowPitch) override
+    { SoftwareGraphicsDevice::UpdateTextureRows(texture, 0, texture->Height(), texels, rowPitch); }
+
+
+  bool UpdateTextureRows(
+    CathodeRetro::ITexture *texture,
+    uint32_t firstRow,
+    uint32_t rowCount,
+    const void *texels,
+    ptrdiff_t rowPitch) override
+  {
+    auto softwareTexture = static_cast<SoftwareTexture *>(texture);
+    assert(firstRow + rowCount <= softwareTexture->Height());
+    size_t rowByteCount = size_t(softwareTexture->Width()) * TexelByteCount(softwareTexture->Format());
+    uint8_t *dest = softwareTexture->MipData(0) + rowByteCount * firstRow;
+    auto src = static_cast<const uint8_t *>(texels);
+    if (rowPitch == ptrdiff_t(rowByteCount))
+    {
+      memcpy(dest, src, rowByteCount * rowCount);
+      return true;
+    }
+
+    for (uint32_t y = 0; y < rowCount; y++, dest += rowByteCount, src += rowPitch)
+    {
+      memcpy(dest, src, rowByteCount);
+    }
+
+    return true;
+  }
+
+
+  // The given texels are laid out exactly the way a SoftwareTexture stores its mip levels, so they can be copied in
+  //  all at once.
+  std::unique_ptr<CathodeRetro::ITexture> CreateStaticTexture(
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipCount,
+    CathodeRetro::TextureFormat format,
+    const void *texels) override
+  {
+    auto texture = std::make_unique<SoftwareTexture>(width, height, mipCount, format, nullptr);
+    memcpy(texture->MipData(0), texels, CathodeRetro::RenderTargetByteCount(width, height, mipCount, format));
+    return texture;
+  }
+
+
+  // Rendering is synchronous, so the texels are already there to copy.
+  bool ReadRenderTarget(const CathodeRetro::IRenderTarget *renderTarget, void *texelsOut) override
+  {
+    auto texture = static_cast<const SoftwareTexture *>(renderTarget);
+    memcpy(
+      texelsOut,
+      texture->MipData(0),
+      size_t(texture->Width()) * texture->Height() * TexelByteCount(texture->Format()));
+    return true;
+  }
+
+
+  std::unique_ptr<CathodeRetro::ICommandList> CreateCommandList(
+    std::vector<CathodeRetro::RecordedCommand> commands) override
+  {
+    return std::make_unique<CommandList>(this, commands);
+  }
+
+
+  // The two lists run in lockstep: each step takes the next kernel from each of them and dispatches the bands of both
+  //  as a single ParallelFor, so that threads that finish their share of one kernel's bands move on to the other's
+  //  instead of waiting at the end of each kernel (which matters most for the small kernels, whose few bands can't
+  //  keep every thread busy on their own). The time that each step takes counts toward the pass of each kernel that
+  //  ran in it, so the per-pass timings overlap (and add up to more than the frame took).
+  void ExecuteConcurrently(
+    const CathodeRetro::CommandListExecution &first,
+    const CathodeRetro::CommandListExecution &second) override
+  {
+    assert(isRendering);
+
+    const CathodeRetro::CommandListExecution *executions[] = { &first, &second };
+    CommandList::Cursor cursors[2];
+    for (uint32_t i = 0; i < 2; i++)
+    {
+      auto commandList = static_cast<CommandList *>(executions[i]->commandList);
+      commandList->BindFrameTextures(executions[i]->frameInput, executions[i]->frameOutput);
+      cursors[i].commandList = commandList;
+    }
+
+    for (;;)
+    {
+      DispatchJob jobs[2];
+      CathodeRetro::PassID passes[2];
+      uint32_t jobCount = 0;
+      bool anyCommands = false;
+      for (uint32_t i = 0; i < 2; i++)
+      {
+        SoftwareKernel kernel;
+        SoftwareRenderState state;
+        if (cursors[i].Next(executions[i]->firstRow, executions[i]->rowCount, &kernel, &state))
+        {
+          anyCommands = true;
+          if (MakeDispatchJob(kernel, state, &jobs[jobCount]))
+          {
+            passes[jobCount++] = cursors[i].pass;
+          }
+        }
+      }
+
+      if (!anyCommands)
+      {
+        break;
+      }
+
+      auto startTime = std::chrono::steady_clock::now();
+      RunDispatchJobs(jobs, jobCount);
+      float milliseconds =
+        std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+      for (uint32_t i = 0; i < jobCount; i++)
+      {
+        if (i == 0 || passes[i] != passes[0])
+        {
+          currentFrameStats.passMilliseconds[size_t(passes[i])] += milliseconds;
+        }
+      }
+    }
+  }
+
+private:
+  // A command list for the software device is a table of kernels to dispatch, each with its render state already
+  //  filled in. The only things left to do when executing it are to patch in the frame's input and output textures
+  //  (for the commands that use them) and to run each kernel.
+  class CommandList : public CathodeRetro::ICommandList
+  {
+  public:
+    CommandList(SoftwareGraphicsDevice *deviceIn, const std::vector<CathodeRetro::RecordedCommand> &recorded)
+      : device(deviceIn)
+    {
+      commands.reserve(recorded.size());
+      for (auto &rec : recorded)
+      {
+        Command command;
+        command.type = rec.type;
+        command.pass = rec.pass;
+        command.frameInputMask = rec.frameInputMask;
+        command.outputIsFrameOutput = rec.outputIsFrameOutput;
+
+        if (rec.type == CathodeRetro::RecordedCommand::Type::RenderQuad)
+        {
+          command.kernel = static_cast<SoftwareShader *>(rec.shader)->Kernel();
+
+          SoftwareRenderState &state = command.state;
+          state.targetMip = rec.output.mipLevel;
+          state.firstRow = rec.output.firstRow;
+          state.rowCount = rec.output.rowCount;
+          state.firstColumn = rec.output.firstColumn;
+          state.columnCount = rec.output.columnCount;
+          if (!rec.outputIsFrameOutput)
+          {
+            state.target = static_cast<SoftwareTexture *>(rec.output.texture);
+            state.width = state.target->MipWidth(state.targetMip);
+            state.height = state.target->MipHeight(state.targetMip);
+          }
+
+          for (uint32_t i = 0; i < rec.inputCount; i++)
+          {
+            auto &view = state.inputs[i];
+            view.texture = static_cast<const SoftwareTexture *>(rec.inputs[i].texture);
+            view.mipLevel = rec.inputs[i].mipLevel;
+            view.samplerType = rec.inputs[i].samplerType;
+          }
+
+          state.inputCount = rec.inputCount;
+
+          if (rec.constantBuffer != nullptr)
+          {
+            state.constants = static_cast<SoftwareConstantBuffer *>(rec.constantBuffer)->Data();
+          }
+        }
+
+        commands.push_back(command);
+      }
+    }
+
+
+    void Execute(const CathodeRetro::ITexture *frameInput, CathodeRetro::IRenderTarget *frameOutput) override
+      { ExecuteRows(frameInput, frameOutput, 0, 0); }
+
+
+    void ExecuteRows(
+      const CathodeRetro::ITexture *frameInput,
+      CathodeRetro::IRenderTarget *frameOutput,
+      uint32_t firstRow,
+      uint32_t rowCount) override
+    {
+      BindFrameTextures(frameInput, frameOutput);
+
+      for (Command &command : commands)
+      {
+        switch (command.type)
+        {
+        case CathodeRetro::RecordedCommand::Type::BeginPass:
+          device->BeginPass(command.pass);
+          break;
+
+        case CathodeRetro::RecordedCommand::Type::EndPass:
+          device->EndPass();
+          break;
+
+        case CathodeRetro::RecordedCommand::Type::RenderQuad:
+          assert(device->isRendering);
+          if (rowCount != 0)
+          {
+            SoftwareRenderState bandState = command.state;
+            bandState.firstRow = firstRow;
+            bandState.rowCount = rowCount;
+            device->Dispatch(command.kernel, bandState);
+          }
+          else
+          {
+            device->Dispatch(command.kernel, command.state);
+          }
+          break;
+        }
+      }
+    }
+
+
+    // Patch the frame's input and output textures into the commands that use them.
+    void BindFrameTextures(const CathodeRetro::ITexture *frameInput, CathodeRetro::IRenderTarget *frameOutput)
+    {
+      auto input = static_cast<const SoftwareTexture *>(frameInput);
+      auto output = static_cast<SoftwareTexture *>(frameOutput);
+
+      for (Command &command : commands)
+      {
+        if (command.type != CathodeRetro::RecordedCommand::Type::RenderQuad)
+        {
+          continue;
+        }
+
+        if (command.outputIsFrameOutput)
+        {
+          command.state.target = output;
+          command.state.width = output->MipWidth(command.state.targetMip);
+          command.state.height = output->MipHeight(command.state.targetMip);
+        }
+
+        for (uint32_t i = 0; i < command.state.inputCount; i++)
+        {
+          if ((command.frameInputMask & (1u << i)) != 0)
+          {
+            command.state.inputs[i].texture = input;
+          }
+        }
+      }
+    }
+
+
+    // Steps through the kernels of a command list (whose frame textures have already been bound), keeping track of
+    //  which pass each one is in, for SoftwareGraphicsDevice::ExecuteConcurrently.
+    struct Cursor
+    {
+      // Get the next kernel and its render state (limited to the given row band, if rowCount isn't 0), returning
+      //  false once there are none left.
+      bool Next(uint32_t firstRow, uint32_t rowCount, SoftwareKernel *kernelOut, SoftwareRenderState *stateOut)
+      {
+        for (; index < commandList->commands.size(); index++)
+        {
+          const Command &command = commandList->commands[index];
+          if (command.type == CathodeRetro::RecordedCommand::Type::BeginPass)
+          {
+            pass = command.pass;
+          }
+          else if (command.type == CathodeRetro::RecordedCommand::Type::RenderQuad)
+          {
+            *kernelOut = command.kernel;
+            *stateOut = command.state;
+            if (rowCount != 0)
+            {
+              stateOut->firstRow = firstRow;
+              stateOut->rowCount = rowCount;
+            }
+
+            index++;
+            return true;
+          }
+        }
+
+        return false;
+      }
+
+      CommandList *commandList = nullptr;
+      size_t index = 0;
+      CathodeRetro::PassID pass = CathodeRetro::PassID::Generator;
+    };
+
+  private:
+    struct Command
+    {
+      CathodeRetro::RecordedCommand::Type type;
+      CathodeRetro::PassID pass;
+      SoftwareKernel kernel = nullptr;
+      SoftwareRenderState state;
+      uint32_t frameInputMask;
+      bool outputIsFrameOutput;
+    };
+
+    SoftwareGraphicsDevice *device;
+    std::vector<Command> commands;
+  };
+
+
+  // Run the kernel over the rows of the target's rectangle (which is the whole target if it doesn't have one). The rows
+  //  are split up into bands, using a few more bands than there are threads so that uneven per-row costs (like the
+  //  edges of a curved screen) still balance out, and each band only covers the rectangle's columns.
+  void Dispatch(SoftwareKernel kernel, const SoftwareRenderState &state)
+  {
+    DispatchJob job;
+    if (MakeDispatchJob(kernel, state, &job))
+    {
+      RunDispatchJobs(&job, 1);
+    }
+  }
+
+
+  // A kernel to run over a band of rows, split up into smaller bands for the threads.
+  struct DispatchJob
+  {
+    SoftwareKernel kernel;
+    SoftwareRenderState state;
+    uint32_t firstRow;
+    uint32_t rowCount;
+    uint32_t bandCount;
+  };
+
+
+  // Set up the job for a kernel, returning false if there's nothing for it to do (its rectangle is empty).
+  bool MakeDispatchJob(SoftwareKernel kernel, const SoftwareRenderState &state, DispatchJob *jobOut)
+  {
+    uint32_t firstRow = 0;
+    uint32_t rowCount = state.height;
+    if (state.rowCount != 0)
+    {
+      firstRow = std::min(state.firstRow, state.height);
+      rowCount = std::min(state.height - firstRow, state.rowCount);
+    }
+
+    if (rowCount == 0 || state.ColumnBegin() == state.ColumnEnd())
+    {
+      return false;
+    }
+
+    jobOut->kernel = kernel;
+    jobOut->state = state;
+    jobOut->firstRow = firstRow;
+    jobOut->rowCount = rowCount;
+    jobOut->bandCount = std::min(rowCount, threadPool.ThreadCount() * 4);
+    return true;
+  }
+
+
+  // Run the bands of all of the given jobs with a single ParallelFor, and wait for them all to finish.
+  void RunDispatchJobs(const DispatchJob *jobs, uint32_t jobCount)
+  {
+    uint32_t totalBandCount = 0;
+    for (uint32_t i = 0; i < jobCount; i++)
+    {
+      totalBandCount += jobs[i].bandCount;
+    }
+
+    threadPool.ParallelFor(
+      totalBandCount,
+      [&](uint32_t band)
+      {
+        const DispatchJob *job = jobs;
+        while (band >= job->bandCount)
+        {
+          band -= job->bandCount;
+          job++;
+        }
+
+        uint32_t rowBegin = job->firstRow + uint32_t(uint64_t(job->rowCount) * band / job->bandCount);
+        uint32_t rowEnd = job->firstRow + uint32_t(uint64_t(job->rowCount) * (band + 1) / job->bandCount);
+        job->kernel(job->state, rowBegin, rowEnd);
+      });
+  }
+
+
+  SoftwareThreadPool threadPool;
+  bool isRendering = false;
+
+  CathodeRetro::PassID currentPass = CathodeRetro::PassID::Generator;
+  std::chrono::steady_clock::time_point passStartTime;
+  CathodeRetro::FrameStats currentFrameStats;
+  CathodeRetro::FrameStats lastFrameStats;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+
+
+// These are the (very) small set of vector types and HLSL-style helper functions that the software shader kernels need
+//  in order to read more or less like the shaders that they were ported from.
+struct Float2
+{
+  float x;
+  float y;
+};
+
+
+struct Float4
+{
+  float x;
+  float y;
+  float z;
+  float w;
+};
+
+
+inline Float2 operator+(Float2 a, Float2 b) { return { a.x + b.x, a.y + b.y }; }
+inline Float2 operator-(Float2 a, Float2 b) { return { a.x - b.x, a.y - b.y }; }
+inline Float2 operator*(Float2 a, Float2 b) { return { a.x * b.x, a.y * b.y }; }
+inline Float2 operator/(Float2 a, Float2 b) { return { a.x / b.x, a.y / b.y }; }
+inline Float2 operator*(Float2 a, float s) { return { a.x * s, a.y * s }; }
+inline Float2 operator*(float s, Float2 a) { return { a.x * s, a.y * s }; }
+inline Float2 operator/(Float2 a, float s) { return { a.x / s, a.y / s }; }
+inline Float2 operator+(Float2 a, float s) { return { a.x + s, a.y + s }; }
+inline Float2 operator-(Float2 a, float s) { return { a.x - s, a.y - s }; }
+
+inline Float4 operator+(Float4 a, Float4 b) { return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w }; }
+inline Float4 operator-(Float4 a, Float4 b) { return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w }; }
+inline Float4 operator*(Float4 a, Float4 b) { return { a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w }; }
+inline Float4 operator*(Float4 a, float s) { return { a.x * s, a.y * s, a.z * s, a.w * s }; }
+inline Float4 operator*(float s, Float4 a) { return { a.x * s, a.y * s, a.z * s, a.w * s }; }
+inline Float4 operator/(Float4 a, float s) { return { a.x / s, a.y / s, a.z / s, a.w / s }; }
+inline Float4 &operator+=(Float4 &a, Float4 b) { a = a + b; return a; }
+
+
+inline float Dot(Float2 a, Float2 b)
+  { return a.x * b.x + a.y * b.y; }
+
+inline float Length(Float2 a)
+  { return std::sqrt(Dot(a, a)); }
+
+inline float Distance(Float2 a, Float2 b)
+  { return Length(a - b); }
+
+inline Float2 Abs(Float2 a)
+  { return { std::abs(a.x), std::abs(a.y) }; }
+
+inline Float2 Max(Float2 a, Float2 b)
+  { return { std::max(a.x, b.x), std::max(a.y, b.y) }; }
+
+
+// HLSL's frac is x - floor(x) (so it is always positive), which is not what std::modf does for negative values.
+inline float Frac(float v)
+  { return v - std::floor(v); }
+
+inline Float2 Frac(Float2 v)
+  { return { Frac(v.x), Frac(v.y) }; }
+
+
+// Convert to an integer texel coordinate, clamping anything that is wildly out of range (or NaN) so that the
+//  conversion stays well-defined.
+inline int32_t FloorToInt(float v)
+{
+  constexpr float k_limit = 1073741824.0f;
+  return int32_t(std::floor((v > -k_limit) ? ((v < k_limit) ? v : k_limit) : -k_limit));
+}
+
+
+// Written so that a NaN input saturates to 0 like it does on a GPU.
+inline float Saturate(float v)
+  { return (v > 0.0f) ? ((v < 1.0f) ? v : 1.0f) : 0.0f; }
+
+
+inline float Lerp(float a, float b, float t)
+  { return a + (b - a) * t; }
+
+inline Float4 Lerp(Float4 a, Float4 b, float t)
+  { return a + (b - a) * t; }
+
+
+inline float Sign(float v)
+  { return (v > 0.0f) ? 1.0f : ((v < 0.0f) ? -1.0f : 0.0f); }
+
+
+inline float SmoothStep(float edge0, float edge1, float x)
+{
+  float t = Saturate((x - edge0) / (edge1 - edge0));
+  return t * t * (3.0f - 2.0f * t);
+}
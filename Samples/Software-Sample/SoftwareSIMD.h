@@ -0,0 +1,260 @@
+#pragma once
+
+// A thin wrapper around the x86 vector intrinsics, so that the SIMD kernels can be written once and compiled as 8-wide
+//  AVX2 (when the compiler is targeting it, i.e. -mavx2 or /arch:AVX2) or as 4-wide SSE2 otherwise. On any other
+//  architecture SOFTWARE_SIMD_WIDTH is 0 and the device just uses the scalar kernels. The build can also define
+//  SOFTWARE_SIMD_WIDTH to 0 itself to use the scalar kernels anywhere (which the tests use as a reference).
+
+#include <cinttypes>
+#include <stdexcept>
+
+#if defined(__AVX2__) && defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+#if defined(SOFTWARE_SIMD_WIDTH)
+  #if SOFTWARE_SIMD_WIDTH != 0
+    #error SOFTWARE_SIMD_WIDTH can only be defined to 0 (the vector width otherwise comes from the target)
+  #endif
+#elif defined(__AVX2__)
+  #include <immintrin.h>
+  #define SOFTWARE_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define SOFTWARE_SIMD_WIDTH 4
+#else
+  #define SOFTWARE_SIMD_WIDTH 0
+#endif
+
+
+namespace SoftwareSIMD
+{
+  // AVX2 builds (which also target FMA and F16C) crash with an illegal instruction on CPUs that don't have those, so
+  //  the tools call this before doing anything else, to exit with an error instead. Throws std::runtime_error if this
+  //  CPU can't run the code the build targets.
+  inline void CheckCPUSupport()
+  {
+#if defined(__AVX2__)
+  #if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    // FMA, F16C, and an OS that saves the AVX registers (OSXSAVE, with XCR0 covering the XMM and YMM state).
+    __cpuid(info, 1);
+    bool supported = maxLeaf >= 7
+      && (info[2] & (1 << 12)) != 0
+      && (info[2] & (1 << 29)) != 0
+      && (info[2] & (1 << 27)) != 0
+      && (_xgetbv(0) & 0x6) == 0x6;
+    if (supported)
+    {
+      __cpuidex(info, 7, 0);
+      supported = (info[1] & (1 << 5)) != 0;
+    }
+  #else
+    __builtin_cpu_init();
+    bool supported =
+      __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+  #endif
+
+    if (!supported)
+    {
+      throw std::runtime_error(
+        "This build uses AVX2, FMA, and F16C instructions, which this CPU does not support (reconfigure with "
+        "-DCATHODE_RETRO_SOFTWARE_AVX2=OFF for an SSE2 build)");
+    }
+#endif
+  }
+}
+
+
+#if SOFTWARE_SIMD_WIDTH > 0
+
+namespace SoftwareSIMD
+{
+  static constexpr uint32_t k_width = SOFTWARE_SIMD_WIDTH;
+
+#if SOFTWARE_SIMD_WIDTH == 8
+  using FloatReg = __m256;
+  using IntReg = __m256i;
+#else
+  using FloatReg = __m128;
+  using IntReg = __m128i;
+#endif
+
+
+  struct Int
+  {
+    IntReg v;
+  };
+
+
+  struct Float
+  {
+    FloatReg v;
+  };
+
+
+#if SOFTWARE_SIMD_WIDTH == 8
+  inline Float Splat(float s) { return { _mm256_set1_ps(s) }; }
+  inline Float Load(const float *p) { return { _mm256_loadu_ps(p) }; }
+  inline void Store(float *p, Float a) { _mm256_storeu_ps(p, a.v); }
+  inline Float LaneIndices() { return { _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7) }; }
+
+  inline Float operator+(Float a, Float b) { return { _mm256_add_ps(a.v, b.v) }; }
+  inline Float operator-(Float a, Float b) { return { _mm256_sub_ps(a.v, b.v) }; }
+  inline Float operator*(Float a, Float b) { return { _mm256_mul_ps(a.v, b.v) }; }
+  inline Float operator/(Float a, Float b) { return { _mm256_div_ps(a.v, b.v) }; }
+  inline Float Sqrt(Float a) { return { _mm256_sqrt_ps(a.v) }; }
+  inline Float operator&(Float a, Float b) { return { _mm256_and_ps(a.v, b.v) }; }
+  inline Float operator^(Float a, Float b) { return { _mm256_xor_ps(a.v, b.v) }; }
+  inline Float operator>(Float a, Float b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+
+  // Like the SSE instructions these map to, if either input is NaN the result is b.
+  inline Float Min(Float a, Float b) { return { _mm256_min_ps(a.v, b.v) }; }
+  inline Float Max(Float a, Float b) { return { _mm256_max_ps(a.v, b.v) }; }
+
+  inline Float Floor(Float a) { return { _mm256_floor_ps(a.v) }; }
+  inline Float Select(Float mask, Float a, Float b) { return { _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+
+  inline Int Splat(int32_t s) { return { _mm256_set1_epi32(s) }; }
+  inline Int operator+(Int a, Int b) { return { _mm256_add_epi32(a.v, b.v) }; }
+  inline Int operator&(Int a, Int b) { return { _mm256_and_si256(a.v, b.v) }; }
+  inline Int operator==(Int a, Int b) { return { _mm256_cmpeq_epi32(a.v, b.v) }; }
+  template <int N> Int ShiftLeft(Int a) { return { _mm256_slli_epi32(a.v, N) }; }
+  template <int N> Int ShiftRight(Int a) { return { _mm256_srli_epi32(a.v, N) }; }
+
+  // Conversions (ToInt truncates, so it should only be given values that are already integers).
+  inline Int ToInt(Float a) { return { _mm256_cvttps_epi32(a.v) }; }
+  inline Float ToFloat(Int a) { return { _mm256_cvtepi32_ps(a.v) }; }
+  inline Int AsInt(Float a) { return { _mm256_castps_si256(a.v) }; }
+  inline Float AsFloat(Int a) { return { _mm256_castsi256_ps(a.v) }; }
+
+  inline Float Gather(const float *base, Int indices) { return { _mm256_i32gather_ps(base, indices.v, 4) }; }
+#else
+  inline Float Splat(float s) { return { _mm_set1_ps(s) }; }
+  inline Float Load(const float *p) { return { _mm_loadu_ps(p) }; }
+  inline void Store(float *p, Float a) { _mm_storeu_ps(p, a.v); }
+  inline Float LaneIndices() { return { _mm_setr_ps(0, 1, 2, 3) }; }
+
+  inline Float operator+(Float a, Float b) { return { _mm_add_ps(a.v, b.v) }; }
+  inline Float operator-(Float a, Float b) { return { _mm_sub_ps(a.v, b.v) }; }
+  inline Float operator*(Float a, Float b) { return { _mm_mul_ps(a.v, b.v) }; }
+  inline Float operator/(Float a, Float b) { return { _mm_div_ps(a.v, b.v) }; }
+  inline Float Sqrt(Float a) { return { _mm_sqrt_ps(a.v) }; }
+  inline Float operator&(Float a, Float b) { return { _mm_and_ps(a.v, b.v) }; }
+  inline Float operator^(Float a, Float b) { return { _mm_xor_ps(a.v, b.v) }; }
+  inline Float operator>(Float a, Float b) { return { _mm_cmpgt_ps(a.v, b.v) }; }
+
+  // Like the SSE instructions these map to, if either input is NaN the result is b.
+  inline Float Min(Float a, Float b) { return { _mm_min_ps(a.v, b.v) }; }
+  inline Float Max(Float a, Float b) { return { _mm_max_ps(a.v, b.v) }; }
+
+  inline Float Select(Float mask, Float a, Float b)
+    { return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+
+  // SSE2 has no floor instruction, so truncate and then step down for negative non-integers. Only valid for values
+  //  that fit in an int32.
+  inline Float Floor(Float a)
+  {
+    Float t = { _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v)) };
+    return t - (Select(t > a, Splat(1.0f), Splat(0.0f)));
+  }
+
+  inline Int Splat(int32_t s) { return { _mm_set1_epi32(s) }; }
+  inline Int operator+(Int a, Int b) { return { _mm_add_epi32(a.v, b.v) }; }
+  inline Int operator&(Int a, Int b) { return { _mm_and_si128(a.v, b.v) }; }
+  inline Int operator==(Int a, Int b) { return { _mm_cmpeq_epi32(a.v, b.v) }; }
+  template <int N> Int ShiftLeft(Int a) { return { _mm_slli_epi32(a.v, N) }; }
+  template <int N> Int ShiftRight(Int a) { return { _mm_srli_epi32(a.v, N) }; }
+
+  // Conversions (ToInt truncates, so it should only be given values that are already integers).
+  inline Int ToInt(Float a) { return { _mm_cvttps_epi32(a.v) }; }
+  inline Float ToFloat(Int a) { return { _mm_cvtepi32_ps(a.v) }; }
+  inline Int AsInt(Float a) { return { _mm_castps_si128(a.v) }; }
+  inline Float AsFloat(Int a) { return { _mm_castsi128_ps(a.v) }; }
+
+  inline Float Gather(const float *base, Int indices)
+  {
+    alignas(16) int32_t i[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(i), indices.v);
+    return { _mm_setr_ps(base[i[0]], base[i[1]], base[i[2]], base[i[3]]) };
+  }
+#endif
+
+
+  inline Float Saturate(Float a)
+    { return Min(Max(a, Splat(0.0f)), Splat(1.0f)); }
+
+
+  // log2(x) for positive, finite x. The exponent comes straight from the float bits, and log2 of the mantissa m (in
+  //  [1, 2)) uses the atanh series in t = (m - 1) / (m + 1), which is accurate to about 2e-5 over that range.
+  inline Float Log2(Float x)
+  {
+    Int bits = AsInt(x);
+    Float exponent = ToFloat(ShiftRight<23>(bits)) - Splat(127.0f);
+    Float m = AsFloat((bits & Splat(0x007FFFFF)) + Splat(0x3F800000));
+
+    Float t = (m - Splat(1.0f)) / (m + Splat(1.0f));
+    Float t2 = t * t;
+    Float series = t * (Splat(1.0f) + t2 * (Splat(1.0f / 3.0f) + t2 * (Splat(1.0f / 5.0f) + t2 * Splat(1.0f / 7.0f))));
+    return exponent + series * Splat(2.0f / 0.693147181f);
+  }
+
+
+  // 2^x, for x in (roughly) [-126, 127]. The integer part goes straight into the exponent bits and the fractional part
+  //  uses a degree-7 Taylor series of e^(f ln 2), which has a relative error under 2e-6.
+  inline Float Exp2(Float x)
+  {
+    x = Min(Max(x, Splat(-126.0f)), Splat(127.0f));
+    Float i = Floor(x);
+    Float f = (x - i) * Splat(0.693147181f);
+
+    Float p = Splat(1.0f / 5040.0f);
+    p = p * f + Splat(1.0f / 720.0f);
+    p = p * f + Splat(1.0f / 120.0f);
+    p = p * f + Splat(1.0f / 24.0f);
+    p = p * f + Splat(1.0f / 6.0f);
+    p = p * f + Splat(1.0f / 2.0f);
+    p = p * f + Splat(1.0f);
+    p = p * f + Splat(1.0f);
+
+    return p * AsFloat(ShiftLeft<23>(ToInt(i) + Splat(127)));
+  }
+
+
+  // pow(x, e) for x >= 0 (which is all that the gamma curves need), with pow(0, e) = 0.
+  inline Float Pow(Float x, float e)
+  {
+    Float result = Exp2(Log2(x) * Splat(e));
+    return result & (x > Splat(0.0f));
+  }
+
+
+  // Computes sin(2 * pi * turns) and cos(2 * pi * turns). The angle is reduced to the nearest quarter turn, leaving a
+  //  remainder in [-pi/4, pi/4] that the Taylor series handle to within about 3e-7, and then the quarter-turn index
+  //  picks which of those goes where (and with what sign).
+  inline void SinCosTurns(Float turns, Float *sinOut, Float *cosOut)
+  {
+    Float quarter = Floor(turns * Splat(4.0f) + Splat(0.5f));
+    Float a = (turns - quarter * Splat(0.25f)) * Splat(2.0f * 3.14159265f);
+    Float a2 = a * a;
+
+    Float s = a * (Splat(1.0f) - a2 * (Splat(1.0f / 6.0f) - a2 * (Splat(1.0f / 120.0f) - a2 * Splat(1.0f / 5040.0f))));
+    Float c = Splat(1.0f) - a2 * (Splat(1.0f / 2.0f)
+      - a2 * (Splat(1.0f / 24.0f) - a2 * (Splat(1.0f / 720.0f) - a2 * Splat(1.0f / 40320.0f))));
+
+    // Quarter turns 1 and 3 swap sin and cos, quarter turns 2 and 3 negate sin, and quarter turns 1 and 2 negate cos.
+    //  (The quarter index is only ever used modulo 4, so the & 3 wrapping of negative values is what we want.)
+    Int q = ToInt(quarter) & Splat(3);
+    Float swap = AsFloat((q & Splat(1)) == Splat(1));
+    Float sinSign = AsFloat(ShiftLeft<30>(q & Splat(2)));
+    Float cosSign = AsFloat(ShiftLeft<30>((q + Splat(1)) & Splat(2)));
+
+    *sinOut = Select(swap, c, s) ^ sinSign;
+    *cosOut = Select(swap, s, c) ^ cosSign;
+  }
+}
+
+#endif
@@ -0,0 +1,1511 @@
+#pragma once
+
+// This file contains C++ ports of every shader in the Shaders/ directory, for use by the SoftwareGraphicsDevice. Each
+//  kernel is a straight port of the corresponding shader's Main function (run once per output texel, with the same
+//  texture coordinate that the full-target quad would have given the pixel shader), and each one mirrors the layout of
+//  its shader's cbuffer so that the constant buffer data Cathode Retro uploads can be read as-is.
+//
+// If you change a shader, the matching kernel here needs to change too.
+
+#include <cmath>
+#include <iterator>
+#include <vector>
+
+#include "CathodeRetro/GraphicsDevice.h"
+#include "CathodeRetro/Internal/CRTDistortion.h"
+#include "CathodeRetro/Internal/Noise.h"
+
+#include "SoftwareMath.h"
+#include "SoftwareSIMD.h"
+#include "SoftwareTexture.h"
+
+
+// Everything a kernel needs to render (a band of rows of) a RenderQuad call.
+struct SoftwareRenderState
+{
+  SoftwareTexture *target = nullptr;
+  uint32_t targetMip = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+
+  // The rectangle of texels that gets rendered (see CathodeRetro::RenderTargetView, a count of 0 means every row or
+  //  column). The kernels don't need to look at the rows: they're only ever asked for rows inside of the rectangle.
+  //  They do need to only write the columns [ColumnBegin(), ColumnEnd()), but they still compute their texture
+  //  coordinates from the whole target's width and height.
+  uint32_t firstRow = 0;
+  uint32_t rowCount = 0;
+  uint32_t firstColumn = 0;
+  uint32_t columnCount = 0;
+
+  SoftwareTextureView inputs[CathodeRetro::RecordedCommand::k_maxInputs];
+  uint32_t inputCount = 0;
+
+  const void *constants = nullptr;
+
+  template <typename T>
+  const T &Constants() const
+    { return *static_cast<const T *>(constants); }
+
+  uint32_t ColumnBegin() const
+    { return (columnCount == 0) ? 0 : std::min(firstColumn, width); }
+
+  uint32_t ColumnEnd() const
+    { return (columnCount == 0) ? width : std::min(firstColumn, width) + std::min(columnCount, width - ColumnBegin()); }
+};
+
+
+// A kernel renders the rows [rowBegin, rowEnd) of the target. Different bands of the same target can be rendered
+//  concurrently.
+using SoftwareKernel = void (*)(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd);
+
+
+namespace SoftwareShaders
+{
+  static constexpr float k_pi = 3.141592653f;
+
+
+  // Run the given function for every texel in the band (within the target's column range), passing it the texel's
+  //  (center) texture coordinate and storing the result into the target.
+  template <typename Func>
+  void ForEachTexel(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd, Func &&func)
+  {
+    float invWidth = 1.0f / float(state.width);
+    float invHeight = 1.0f / float(state.height);
+    for (uint32_t y = rowBegin; y < rowEnd; y++)
+    {
+      float v = (float(y) + 0.5f) * invHeight;
+      for (uint32_t x = state.ColumnBegin(); x < state.ColumnEnd(); x++)
+      {
+        state.target->Store(state.targetMip, x, y, func(Float2{ (float(x) + 0.5f) * invWidth, v }));
+      }
+    }
+  }
+
+
+  // cathode-retro-util-noise.hlsli and cathode-retro-util-tracking-instability.hlsli (these are shared with the
+  //  library, which needs the same values for the scanline phases).
+  using CathodeRetro::Internal::CalculateTrackingInstabilityOffset;
+
+  inline float Noise2D(Float2 coord, float iseed)
+    { return CathodeRetro::Internal::Noise2D(coord.x, coord.y, iseed); }
+
+
+  // cathode-retro-util-lanczos.hlsli
+  inline Float4 Lanczos2xDownsample(const SoftwareTextureView &source, Float2 centerTexCoord, Float2 filterDir)
+  {
+    static constexpr float k_coeffs[] = { -0.051f, 0.551f, 0.551f, -0.051f };
+    static constexpr float k_offsets[] = { -2.67647052f, -0.712341249f, 0.712341189f, 2.67647052f };
+
+    Float2 step = filterDir / source.Size();
+    Float4 v = {};
+    for (int i = 0; i < 4; i++)
+    {
+      v += source.Sample(centerTexCoord + step * k_offsets[i]) * k_coeffs[i];
+    }
+
+    return v;
+  }
+
+
+  // cathode-retro-util-box-filter.hlsli
+  inline Float4 BoxFilter(
+    const SoftwareTextureView &source,
+    Float2 invTextureSize,
+    uint32_t filterWidth,
+    Float2 texCoord,
+    Float4 *centerSample)
+  {
+    Float4 center = source.Sample(texCoord);
+    if (centerSample != nullptr)
+    {
+      *centerSample = center;
+    }
+
+    Float4 avg = center;
+
+    // See the shader for the details of how the linear filtering is used to get two texels per sample here.
+    uint32_t iterEnd = (filterWidth - 1) / 2;
+    for (uint32_t i = 2; i < iterEnd; i += 2)
+    {
+      avg += 2.0f * source.Sample(texCoord + Float2{ float(i) - 0.5f, 0.0f } * invTextureSize);
+      avg += 2.0f * source.Sample(texCoord - Float2{ float(i) - 0.5f, 0.0f } * invTextureSize);
+    }
+
+    uint32_t remainder = (filterWidth - 1) % 4;
+    if (remainder == 3)
+    {
+      avg += 1.5f * source.Sample(texCoord + Float2{ float(iterEnd) + 1.0f / 3.0f, 0.0f } * invTextureSize);
+      avg += 1.5f * source.Sample(texCoord - Float2{ float(iterEnd) + 1.0f / 3.0f, 0.0f } * invTextureSize);
+    }
+    else if (remainder > 0)
+    {
+      float scale = (remainder == 2) ? 1.0f : 0.0f;
+      avg += scale * source.Sample(texCoord + Float2{ float(iterEnd) + 1.0f, 0.0f } * invTextureSize);
+      avg += scale * source.Sample(texCoord - Float2{ float(iterEnd) + 1.0f, 0.0f } * invTextureSize);
+    }
+
+    return avg / float(filterWidth);
+  }
+
+
+  // cathode-retro-crt-distort-coordinates.hlsli (shared with the library, which uses it to work out which rows of the
+  //  RGB input each output row reads).
+  inline Float2 DistortCRTCoordinates(Float2 texCoord, Float2 distortion)
+  {
+    CathodeRetro::Vec2 distorted = CathodeRetro::Internal::DistortCRTCoordinates(
+      { texCoord.x, texCoord.y },
+      { distortion.x, distortion.y });
+    return { distorted.x, distorted.y };
+  }
+
+
+  // cathode-retro-util-copy.hlsl
+  inline void Copy(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    ForEachTexel(state, rowBegin, rowEnd, [&](Float2 inTexCoord) { return state.inputs[0].Sample(inTexCoord); });
+  }
+
+
+  // cathode-retro-util-downsample-2x.hlsl
+  inline void Downsample2X(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      Float2 filterDir;
+    };
+
+    auto &c = state.Constants<Consts>();
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 inTexCoord) { return Lanczos2xDownsample(state.inputs[0], inTexCoord, c.filterDir); });
+  }
+
+
+  // cathode-retro-util-tonemap-and-downsample.hlsl
+  inline void TonemapAndDownsample(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      Float2 downsampleDir;
+      float minLuminosity;
+      float colorPower;
+    };
+
+    auto &c = state.Constants<Consts>();
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 inTexCoord)
+      {
+        Float4 samp = Lanczos2xDownsample(state.inputs[0], inTexCoord, c.downsampleDir);
+
+        float inLuma = samp.x * 0.30f + samp.y * 0.59f + samp.z * 0.11f;
+        float outLuma = (inLuma - c.minLuminosity) / (1.0f - c.minLuminosity);
+        outLuma = std::pow(Saturate(outLuma), c.colorPower);
+
+        float scale = outLuma / inLuma;
+        return Float4{ samp.x * scale, samp.y * scale, samp.z * scale, samp.w };
+      });
+  }
+
+
+  // cathode-retro-util-gaussian-blur.hlsl
+  inline void GaussianBlur13(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      Float2 blurDir;
+    };
+
+    static constexpr float k_coeffs[] =
+    {
+      3.586488181e-2f, 1.278779997e-1f, 2.589758386e-1f, 1.545625599e-1f, 2.589758386e-1f, 1.278779997e-1f,
+      3.586488181e-2f,
+    };
+    static constexpr float k_offsets[] =
+      { -5.308886854f, -3.374611919f, -1.445310910f, 0.0f, 1.445310910f, 3.374611919f, 5.308886854f };
+
+    auto &c = state.Constants<Consts>();
+    Float2 step = c.blurDir / state.inputs[0].Size();
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 inTexCoord)
+      {
+        Float4 v = {};
+        for (int i = 0; i < 7; i++)
+        {
+          v += state.inputs[0].Sample(inTexCoord + step * k_offsets[i]) * k_coeffs[i];
+        }
+
+        return v;
+      });
+  }
+
+
+  // cathode-retro-generator-gen-phase.hlsl
+  inline void GeneratePhaseTexture(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      float initialFrameStartPhase;
+      float prevFrameStartPhase;
+      float phaseIncrementPerScanline;
+      uint32_t samplesPerColorburstCycle;
+      float instabilityScale;
+      uint32_t noiseSeed;
+      uint32_t signalTextureWidth;
+      uint32_t scanlineCount;
+    };
+
+    auto &c = state.Constants<Consts>();
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 texCoord)
+      {
+        uint32_t scanlineIndex = uint32_t(std::round(texCoord.y * float(c.scanlineCount) - 0.5f));
+
+        Float2 phases = Float2{ c.initialFrameStartPhase, c.prevFrameStartPhase }
+          + c.phaseIncrementPerScanline * float(scanlineIndex);
+
+        // Offset by half a cycle so that it lines up with the *center* of the filter instead of the left edge of it.
+        phases = phases + 0.5f / float(c.samplesPerColorburstCycle);
+
+        float instability = CalculateTrackingInstabilityOffset(
+          scanlineIndex,
+          c.noiseSeed,
+          c.instabilityScale,
+          c.signalTextureWidth);
+        phases = phases + instability * float(c.signalTextureWidth) / float(c.samplesPerColorburstCycle);
+
+        phases = Frac(phases);
+        return Float4{ phases.x, phases.y, 0.0f, 0.0f };
+      });
+  }
+
+
+  // The cbuffer of cathode-retro-generator-rgb-to-svideo-or-composite.hlsl (which is also the start of the cbuffer of
+  //  cathode-retro-generator-rgb-to-signal-with-artifacts.hlsl).
+  struct RGBToSVideoOrCompositeConsts
+  {
+    uint32_t outputTexelsPerColorburstCycle;
+    uint32_t inputWidth;
+    uint32_t outputWidth;
+    uint32_t scanlineCount;
+    float compositeBlend;
+    float instabilityScale;
+    uint32_t noiseSeed;
+    uint32_t sidePaddingTexelCount;
+  };
+
+
+  // Generate the clean signal texel at the given index (the body of RGBToSVideoOrComposite's Main).
+  inline Float4 CleanSignalTexel(
+    const RGBToSVideoOrCompositeConsts &c,
+    const SoftwareTextureView &source,
+    const SoftwareTextureView &scanlinePhases,
+    uint32_t texelX,
+    uint32_t texelY)
+  {
+    // Center the generated texture on the RGB texture, then expand to account for the side padding.
+    Float2 texCoord = (Float2{ float(texelX) * float(c.inputWidth) / float(c.outputWidth), float(texelY) }
+        + Float2{ 0.25f, 0.5f })
+      / Float2{ float(c.inputWidth), float(c.scanlineCount) };
+
+    uint32_t effectiveOutputWidth = c.outputWidth - c.sidePaddingTexelCount;
+    texCoord.x = (texCoord.x - 0.5f) * float(c.outputWidth) / float(effectiveOutputWidth) + 0.5f;
+
+    texCoord.x += CalculateTrackingInstabilityOffset(texelY, c.noiseSeed, c.instabilityScale, c.outputWidth);
+
+    Float4 rgb = source.Sample(texCoord);
+
+    // RGB to YIQ (SMPTE C)
+    float y = rgb.x * 0.3000f + rgb.y *  0.5900f + rgb.z *  0.1100f;
+    float i = rgb.x * 0.5990f + rgb.y * -0.2773f + rgb.z * -0.3217f;
+    float q = rgb.x * 0.2130f + rgb.y * -0.5251f + rgb.z *  0.3121f;
+
+    // Gamma adjustments to counter for the gamma that will be used at decode time.
+    y = std::pow(Saturate(y), 2.2f / 2.0f);
+    float iqSat = Saturate(Length({ i, q }));
+    float iqScale = std::pow(iqSat, 2.2f / 2.0f) / std::max(0.00001f, iqSat);
+    i *= iqScale;
+    q *= iqScale;
+
+    Float2 scanlinePhase = [&]
+    {
+      Float4 p = scanlinePhases.Sample(Float2{ 0.0f, float(texelY) + 0.5f } / float(c.scanlineCount));
+      return Float2{ p.x, p.y };
+    }();
+    Float2 phase = scanlinePhase + float(texelX) / float(c.outputTexelsPerColorburstCycle);
+
+    // QAM modulation of IQ onto the carrier.
+    Float2 chroma = {
+      std::sin(2.0f * k_pi * phase.x) * i - std::cos(2.0f * k_pi * phase.x) * q,
+      std::sin(2.0f * k_pi * phase.y) * i - std::cos(2.0f * k_pi * phase.y) * q };
+
+    if (c.compositeBlend > 0.0f)
+    {
+      return Float4{ y + chroma.x, y + chroma.y, y + chroma.x, y + chroma.y };
+    }
+    else
+    {
+      return Float4{ y, chroma.x, y, chroma.y };
+    }
+  }
+
+
+  // cathode-retro-generator-rgb-to-svideo-or-composite.hlsl
+  inline void RGBToSVideoOrComposite(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    auto &c = state.Constants<RGBToSVideoOrCompositeConsts>();
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 signalTexCoord)
+      {
+        uint32_t texelX = uint32_t(std::floor(signalTexCoord.x * float(c.outputWidth)));
+        uint32_t texelY = uint32_t(std::floor(signalTexCoord.y * float(c.scanlineCount)));
+        return CleanSignalTexel(c, state.inputs[0], state.inputs[1], texelX, texelY);
+      });
+  }
+
+
+#if SOFTWARE_SIMD_WIDTH > 0
+  // A vectorized version of the clean signal generation, which processes SoftwareSIMD::k_width texels at a time. It
+  //  uses the following shortcuts, all of which stay well within what's visible in an 8-bit output:
+  //  - The source only ever gets sampled at one v coordinate per row, so each row of the source is blended vertically
+  //    into a float row (one array per channel) once, and then every output texel is a horizontal lerp of that row.
+  //  - The gamma curves use a polynomial log2/exp2 pow instead of std::pow.
+  //  - The two phases of a row only differ by a constant, so the second carrier is a rotation of the first (one
+  //    polynomial sincos per texel instead of two sin/cos pairs).
+  // This generates the rows [rowBegin, rowEnd) of the signal, handing each group of (up to) k_width texels to
+  //  store(texelY, texelXBase, laneCount, out), where out holds the group's four output channels. It returns false
+  //  (without generating anything) if the call does not look like the one Cathode Retro's signal generator makes, in
+  //  which case the caller needs to use the scalar version instead.
+  template <typename StoreFunc>
+  bool GenerateSignalRowsSIMD(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd, StoreFunc &&store)
+  {
+    using namespace SoftwareSIMD;
+
+    auto &c = state.Constants<RGBToSVideoOrCompositeConsts>();
+    auto &source = state.inputs[0];
+    auto &scanlinePhases = state.inputs[1];
+    if (state.width != c.outputWidth
+      || state.height != c.scanlineCount
+      || source.samplerType != CathodeRetro::SamplerType::LinearClamp)
+    {
+      return false;
+    }
+
+    uint32_t sourceMip = uint32_t(std::max(0, source.mipLevel));
+    uint32_t sourceWidth = source.texture->MipWidth(sourceMip);
+    uint32_t sourceHeight = source.texture->MipHeight(sourceMip);
+    std::vector<float> sourceRow(size_t(sourceWidth) * 3);
+    float *sourceR = sourceRow.data();
+    float *sourceG = sourceR + sourceWidth;
+    float *sourceB = sourceG + sourceWidth;
+
+    uint32_t effectiveOutputWidth = c.outputWidth - c.sidePaddingTexelCount;
+    bool isComposite = (c.compositeBlend > 0.0f);
+
+    for (uint32_t texelY = rowBegin; texelY < rowEnd; texelY++)
+    {
+      // Blend the two source rows that this scanline's v coordinate lands between (the same vertical half of the
+      //  bilinear filter that SampleLevel would do).
+      {
+        float fy = (float(texelY) + 0.5f) / float(c.scanlineCount) * float(sourceHeight) - 0.5f;
+        int32_t yi = FloorToInt(fy);
+        float ty = Saturate(fy - float(yi));
+        uint32_t y0 = uint32_t(std::min(std::max(yi, 0), int32_t(sourceHeight) - 1));
+        uint32_t y1 = uint32_t(std::min(std::max(yi + 1, 0), int32_t(sourceHeight) - 1));
+        for (uint32_t x = 0; x < sourceWidth; x++)
+        {
+          Float4 v = Lerp(source.texture->Load(sourceMip, x, y0), source.texture->Load(sourceMip, x, y1), ty);
+          sourceR[x] = v.x;
+          sourceG[x] = v.y;
+          sourceB[x] = v.z;
+        }
+      }
+
+      // The u coordinate is an affine function of texelX, so fold the whole texCoord calculation (including the
+      //  padding expansion and the instability offset) into a single scale and offset, in units of source texels.
+      //  (The input width cancels out of the scale entirely.)
+      float uScale = 1.0f / float(effectiveOutputWidth);
+      float uOffset = (0.25f / float(c.inputWidth) - 0.5f) * float(c.outputWidth) / float(effectiveOutputWidth) + 0.5f
+        + CalculateTrackingInstabilityOffset(texelY, c.noiseSeed, c.instabilityScale, c.outputWidth);
+      Float fxScale = Splat(uScale * float(sourceWidth));
+      Float fxOffset = Splat(uOffset * float(sourceWidth) - 0.5f);
+
+      Float4 p = scanlinePhases.Sample(Float2{ 0.0f, float(texelY) + 0.5f } / float(c.scanlineCount));
+      Float phaseOffset = Splat(p.x);
+      Float phaseScale = Splat(1.0f / float(c.outputTexelsPerColorburstCycle));
+      Float deltaSin = Splat(std::sin(2.0f * k_pi * (p.y - p.x)));
+      Float deltaCos = Splat(std::cos(2.0f * k_pi * (p.y - p.x)));
+
+      uint32_t columnEnd = state.ColumnEnd();
+      for (uint32_t texelXBase = state.ColumnBegin(); texelXBase < columnEnd; texelXBase += k_width)
+      {
+        Float texelX = Splat(float(texelXBase)) + LaneIndices();
+
+        // Horizontal half of the bilinear filter. Clamping fx before the floor keeps the indices in range (and NaNs
+        //  out of the integer conversion) without changing which texels get read.
+        Float fx = Min(Max(texelX * fxScale + fxOffset, Splat(-1.0f)), Splat(float(sourceWidth)));
+        Float xf = Floor(fx);
+        Float tx = Saturate(fx - xf);
+        Float lastX = Splat(float(sourceWidth - 1));
+        Int x0 = ToInt(Min(Max(xf, Splat(0.0f)), lastX));
+        Int x1 = ToInt(Min(xf + Splat(1.0f), lastX));
+        Float r0 = Gather(sourceR, x0);
+        Float g0 = Gather(sourceG, x0);
+        Float b0 = Gather(sourceB, x0);
+        Float r = r0 + (Gather(sourceR, x1) - r0) * tx;
+        Float g = g0 + (Gather(sourceG, x1) - g0) * tx;
+        Float b = b0 + (Gather(sourceB, x1) - b0) * tx;
+
+        // RGB to YIQ (SMPTE C)
+        Float y = r * Splat(0.3000f) + g * Splat(0.5900f) + b * Splat(0.1100f);
+        Float i = r * Splat(0.5990f) + g * Splat(-0.2773f) + b * Splat(-0.3217f);
+        Float q = r * Splat(0.2130f) + g * Splat(-0.5251f) + b * Splat(0.3121f);
+
+        // Gamma adjustments. pow(s, 1.1) / max(0.00001, s) is s^0.1 * min(1, s / 0.00001), which saves a divide.
+        Float ySat = Saturate(y);
+        y = ySat * Pow(ySat, 0.1f);
+        Float iqSat = Saturate(Sqrt(i * i + q * q));
+        Float iqScale = Pow(iqSat, 0.1f) * Min(Splat(1.0f), iqSat * Splat(100000.0f));
+        i = i * iqScale;
+        q = q * iqScale;
+
+        // QAM modulation of IQ onto the carrier (and its rotated copy for the second phase).
+        Float s0, c0;
+        SinCosTurns(phaseOffset + texelX * phaseScale, &s0, &c0);
+        Float s1 = s0 * deltaCos + c0 * deltaSin;
+        Float c1 = c0 * deltaCos - s0 * deltaSin;
+        Float chromaX = s0 * i - c0 * q;
+        Float chromaY = s1 * i - c1 * q;
+
+        alignas(32) float out[4][k_width];
+        if (isComposite)
+        {
+          Store(out[0], y + chromaX);
+          Store(out[1], y + chromaY);
+          Store(out[2], y + chromaX);
+          Store(out[3], y + chromaY);
+        }
+        else
+        {
+          Store(out[0], y);
+          Store(out[1], chromaX);
+          Store(out[2], y);
+          Store(out[3], chromaY);
+        }
+
+        store(texelY, texelXBase, std::min(k_width, columnEnd - texelXBase), out);
+      }
+    }
+
+    return true;
+  }
+
+
+  inline void RGBToSVideoOrCompositeSIMD(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    using namespace SoftwareSIMD;
+
+    if (state.target->Format() == CathodeRetro::TextureFormat::RGBA_Unorm8)
+    {
+      RGBToSVideoOrComposite(state, rowBegin, rowEnd);
+      return;
+    }
+
+    uint32_t channelCount = SoftwareTexture::ChannelCount(state.target->Format());
+    bool isHalfTarget = SoftwareTexture::IsFloat16(state.target->Format());
+    bool generated = GenerateSignalRowsSIMD(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](uint32_t texelY, uint32_t texelXBase, uint32_t laneCount, const float (&out)[4][k_width])
+      {
+        // Interleave into however many channels the target actually has.
+        size_t outOffset = (size_t(texelY) * state.width + texelXBase) * channelCount;
+        if (isHalfTarget)
+        {
+          uint16_t *outTexel = reinterpret_cast<uint16_t *>(state.target->MipData(state.targetMip)) + outOffset;
+          for (uint32_t lane = 0; lane < laneCount; lane++)
+          {
+            for (uint32_t channel = 0; channel < channelCount; channel++)
+            {
+              *outTexel++ = FloatToHalf(out[channel][lane]);
+            }
+          }
+        }
+        else
+        {
+          float *outTexel = reinterpret_cast<float *>(state.target->MipData(state.targetMip)) + outOffset;
+          for (uint32_t lane = 0; lane < laneCount; lane++)
+          {
+            for (uint32_t channel = 0; channel < channelCount; channel++)
+            {
+              *outTexel++ = out[channel][lane];
+            }
+          }
+        }
+      });
+
+    if (!generated)
+    {
+      RGBToSVideoOrComposite(state, rowBegin, rowEnd);
+    }
+  }
+#endif
+
+
+  // cathode-retro-generator-apply-artifacts.hlsl
+  inline void ApplyArtifacts(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      float ghostVisibility;
+      float ghostDistance;
+      float ghostSpreadScale;
+      float noiseStrength;
+      uint32_t noiseSeed;
+      uint32_t signalTextureWidth;
+      uint32_t scanlineCount;
+      uint32_t samplesPerColorburstCycle;
+    };
+
+    auto &c = state.Constants<Consts>();
+    auto &source = state.inputs[0];
+    Float2 signalSize = { float(c.signalTextureWidth), float(c.scanlineCount) };
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 inputTexCoord)
+      {
+        Float4 signal = source.Sample(inputTexCoord);
+        if (c.ghostVisibility != 0.0f)
+        {
+          Float2 ghostCenterCoord = inputTexCoord
+            + Float2{ c.ghostDistance * float(c.samplesPerColorburstCycle), 0.0f } / signalSize;
+          Float2 ghostSampleSpread =
+            Float2{ c.ghostSpreadScale * float(c.samplesPerColorburstCycle), 0.0f } / signalSize;
+
+          // 9-tap gaussian, as 5 bilinear samples.
+          Float4 ghost = source.Sample(ghostCenterCoord - ghostSampleSpread * 1.174285279339f) * 0.0436893869f;
+          ghost += source.Sample(ghostCenterCoord - ghostSampleSpread * 1.339243613069f) * 0.323030611f;
+          ghost += source.Sample(ghostCenterCoord) * 0.266559988f;
+          ghost += source.Sample(ghostCenterCoord + ghostSampleSpread * 1.339243613069f) * 0.323030611f;
+          ghost += source.Sample(ghostCenterCoord + ghostSampleSpread * 1.174285279339f) * 0.0436893869f;
+
+          signal += ghost * c.ghostVisibility;
+        }
+
+        Float2 pixelIndex = inputTexCoord * Float2{
+          float(c.signalTextureWidth) / (float(c.samplesPerColorburstCycle) * 2.0f / 3.0f),
+          float(c.scanlineCount) };
+        float xFrac = Frac(pixelIndex.x);
+        pixelIndex = { std::floor(pixelIndex.x), std::floor(pixelIndex.y) };
+
+        float noiseL = Noise2D(pixelIndex, float(c.noiseSeed));
+        float noiseR = Noise2D(pixelIndex + Float2{ 1.0f, 0.0f }, float(c.noiseSeed));
+        float noise = Lerp(noiseL, noiseR, xFrac) * 2.0f - 1.0f;
+
+        float n = noise * c.noiseStrength;
+        return (signal + Float4{ n, n, n, n }) / (1.0f + c.ghostVisibility);
+      });
+  }
+
+
+  // cathode-retro-generator-rgb-to-signal-with-artifacts.hlsl
+  // The shader recomputes the clean signal for every ghost tap, but here each row of the clean signal gets generated
+  //  into a scanline buffer once (using the vectorized generation when it's available), and the ghost taps read from
+  //  that instead. Either way, the clean signal never has to be written out to (or read back from) a texture.
+  inline void RGBToSignalWithArtifacts(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      RGBToSVideoOrCompositeConsts signal;
+      float ghostVisibility;
+      float ghostDistance;
+      float ghostSpreadScale;
+      float noiseStrength;
+    };
+
+    auto &c = state.Constants<Consts>();
+    std::vector<Float4> clean(state.width);
+
+    // The two-pass path rounds the clean signal to the signal texture format, so with 16-bit signal precision the
+    //  scanline buffer gets rounded to halfs the same way.
+    bool isHalfTarget = SoftwareTexture::IsFloat16(state.target->Format());
+    auto setClean = [&](uint32_t x, Float4 v)
+    {
+      clean[x] = isHalfTarget
+        ? Float4{
+          HalfToFloat(FloatToHalf(v.x)),
+          HalfToFloat(FloatToHalf(v.y)),
+          HalfToFloat(FloatToHalf(v.z)),
+          HalfToFloat(FloatToHalf(v.w)) }
+        : v;
+    };
+
+    // Read the clean row the same way that ApplyArtifacts' linear, clamped sampler reads the clean signal texture
+    //  (including its snapping to texel centers), so that the two paths give exactly the same output.
+    auto cleanAt = [&](float u)
+    {
+      float fx = u * float(state.width) - 0.5f;
+      int32_t xi = FloorToInt(fx);
+      int32_t lastX = int32_t(state.width) - 1;
+      float t = Saturate(fx - float(xi));
+      uint32_t x0 = uint32_t(std::min(std::max(xi, 0), lastX));
+      uint32_t x1 = uint32_t(std::min(std::max(xi + 1, 0), lastX));
+      SoftwareTextureView::SnapToTexel(t, &x0, &x1);
+      return Lerp(clean[x0], clean[x1], t);
+    };
+
+    auto applyArtifacts = [&](uint32_t texelY)
+    {
+      // (These match the texture coordinates that ForEachTexel would have used, since the noise is sensitive to them.)
+      float invWidth = 1.0f / float(state.width);
+      float v = (float(texelY) + 0.5f) * (1.0f / float(state.height));
+      float ghostOffset = c.ghostDistance * float(c.signal.outputTexelsPerColorburstCycle) / float(state.width);
+      float ghostSampleSpread =
+        c.ghostSpreadScale * float(c.signal.outputTexelsPerColorburstCycle) / float(state.width);
+      for (uint32_t x = state.ColumnBegin(); x < state.ColumnEnd(); x++)
+      {
+        float u = (float(x) + 0.5f) * invWidth;
+        Float4 signal = clean[x];
+        if (c.ghostVisibility != 0.0f)
+        {
+          float ghostCenter = u + ghostOffset;
+
+          // 9-tap gaussian, as 5 bilinear taps.
+          Float4 ghost = cleanAt(ghostCenter - ghostSampleSpread * 1.174285279339f) * 0.0436893869f;
+          ghost += cleanAt(ghostCenter - ghostSampleSpread * 1.339243613069f) * 0.323030611f;
+          ghost += cleanAt(ghostCenter) * 0.266559988f;
+          ghost += cleanAt(ghostCenter + ghostSampleSpread * 1.339243613069f) * 0.323030611f;
+          ghost += cleanAt(ghostCenter + ghostSampleSpread * 1.174285279339f) * 0.0436893869f;
+
+          signal += ghost * c.ghostVisibility;
+        }
+
+        Float2 pixelIndex = Float2{ u, v } * Float2{
+          float(state.width) / (float(c.signal.outputTexelsPerColorburstCycle) * 2.0f / 3.0f),
+          float(state.height) };
+        float xFrac = Frac(pixelIndex.x);
+        pixelIndex = { std::floor(pixelIndex.x), std::floor(pixelIndex.y) };
+
+        float noiseL = Noise2D(pixelIndex, float(c.signal.noiseSeed));
+        float noiseR = Noise2D(pixelIndex + Float2{ 1.0f, 0.0f }, float(c.signal.noiseSeed));
+        float noise = Lerp(noiseL, noiseR, xFrac) * 2.0f - 1.0f;
+
+        float n = noise * c.noiseStrength;
+        state.target->Store(state.targetMip, x, texelY, (signal + Float4{ n, n, n, n }) / (1.0f + c.ghostVisibility));
+      }
+    };
+
+#if SOFTWARE_SIMD_WIDTH > 0
+    // The ghost taps can reach outside of the target's column range, so the clean signal always covers whole rows.
+    SoftwareRenderState wholeRowState = state;
+    wholeRowState.columnCount = 0;
+    bool generated = GenerateSignalRowsSIMD(
+      wholeRowState,
+      rowBegin,
+      rowEnd,
+      [&](uint32_t texelY, uint32_t texelXBase, uint32_t laneCount, const float (&out)[4][SoftwareSIMD::k_width])
+      {
+        for (uint32_t lane = 0; lane < laneCount; lane++)
+        {
+          setClean(texelXBase + lane, Float4{ out[0][lane], out[1][lane], out[2][lane], out[3][lane] });
+        }
+
+        if (texelXBase + laneCount == state.width)
+        {
+          applyArtifacts(texelY);
+        }
+      });
+
+    if (generated)
+    {
+      return;
+    }
+#endif
+
+    for (uint32_t texelY = rowBegin; texelY < rowEnd; texelY++)
+    {
+      for (uint32_t x = 0; x < state.width; x++)
+      {
+        setClean(x, CleanSignalTexel(c.signal, state.inputs[0], state.inputs[1], x, texelY));
+      }
+
+      applyArtifacts(texelY);
+    }
+  }
+
+
+  // cathode-retro-decoder-composite-to-svideo.hlsl
+  inline void CompositeToSVideo(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      uint32_t samplesPerColorburstCycle;
+    };
+
+    auto &c = state.Constants<Consts>();
+    auto &source = state.inputs[0];
+    Float2 invSize = Float2{ 1.0f, 1.0f } / source.Size();
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 inTex)
+      {
+        Float4 centerSample;
+        Float4 luma = BoxFilter(source, invSize, c.samplesPerColorburstCycle, inTex, &centerSample);
+
+        return Float4{ luma.x, centerSample.x - luma.x, luma.y, centerSample.y - luma.y };
+      });
+  }
+
+
+  // cathode-retro-decoder-svideo-to-modulated-chroma.hlsl
+  inline void SVideoToModulatedChroma(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      uint32_t samplesPerColorburstCycle;
+      float tint;
+      uint32_t inputWidth;
+    };
+
+    auto &c = state.Constants<Consts>();
+    auto &source = state.inputs[0];
+    auto &scanlinePhases = state.inputs[1];
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 inTexCoord)
+      {
+        float sampleXIndex = std::floor(inTexCoord.x * float(c.inputWidth));
+
+        Float4 phases = scanlinePhases.Sample({ inTexCoord.y, inTexCoord.y });
+        Float2 relativePhase = Float2{ phases.x, phases.y } + c.tint;
+
+        Float4 signal = source.Sample(inTexCoord);
+
+        Float2 angle = 2.0f * k_pi * (relativePhase + sampleXIndex / float(c.samplesPerColorburstCycle));
+        return Float4{
+          signal.y * std::sin(angle.x),
+          signal.y * -std::cos(angle.x),
+          signal.w * std::sin(angle.y),
+          signal.w * -std::cos(angle.y) };
+      });
+  }
+
+
+  // cathode-retro-decoder-svideo-to-rgb.hlsl
+  inline void SVideoToRGB(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      uint32_t samplesPerColorburstCycle;
+      float saturation;
+      float brightness;
+      float blackLevel;
+      float whiteLevel;
+      float temporalArtifactReduction;
+      uint32_t inputWidth;
+      uint32_t outputWidth;
+    };
+
+    auto &c = state.Constants<Consts>();
+    auto &source = state.inputs[0];
+    auto &modulatedChroma = state.inputs[1];
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 inTexCoord)
+      {
+        inTexCoord.x = (inTexCoord.x - 0.5f) * float(c.outputWidth) / float(c.inputWidth) + 0.5f;
+
+        Float4 signal = source.Sample(inTexCoord);
+        Float2 y = { signal.x, signal.z };
+
+        Float4 iq = BoxFilter(
+          modulatedChroma,
+          { 1.0f / float(c.inputWidth), 0.0f },
+          2 * c.samplesPerColorburstCycle,
+          inTexCoord,
+          nullptr);
+
+        y = (y - c.blackLevel) * (c.brightness / (c.whiteLevel - c.blackLevel));
+        iq = iq * c.saturation;
+
+        float blend = c.temporalArtifactReduction * 0.5f;
+        float outY = Lerp(y.x, y.y, blend);
+        float outI = Lerp(iq.x, iq.z, blend);
+        float outQ = Lerp(iq.y, iq.w, blend);
+
+        outY = std::pow(Saturate(outY), 2.0f / 2.2f);
+        float iqSat = Saturate(Length({ outI, outQ }));
+        float iqScale = std::pow(iqSat, 2.0f / 2.2f) / std::max(0.00001f, iqSat);
+        outI *= iqScale;
+        outQ *= iqScale;
+
+        // YIQ to RGB (SMPTE C)
+        return Float4{
+          outY + outI *  0.946882f + outQ *  0.623557f,
+          outY + outI * -0.274788f + outQ * -0.635691f,
+          outY + outI * -1.108545f + outQ *  1.7090047f,
+          1.0f };
+      });
+  }
+
+
+  // cathode-retro-decoder-composite-to-rgb.hlsl
+  //  This produces the same result as the shader, but a scanline at a time: the luma and modulated chroma of each
+  //  input texel get computed once into a scanline-sized window (rather than once per output texel that needs them,
+  //  which is what the shader has to do), and then the box filter reads from that.
+  inline void CompositeToRGB(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      uint32_t samplesPerColorburstCycle;
+      float tint;
+      float saturation;
+      float brightness;
+      float blackLevel;
+      float whiteLevel;
+      float temporalArtifactReduction;
+      uint32_t inputWidth;
+      uint32_t outputWidth;
+    };
+
+    auto &c = state.Constants<Consts>();
+    auto &source = state.inputs[0];
+    auto &scanlinePhases = state.inputs[1];
+
+    uint32_t sourceMip = uint32_t(std::max(0, source.mipLevel));
+    uint32_t sourceHeight = source.texture->MipHeight(sourceMip);
+    int32_t inputWidth = int32_t(c.inputWidth);
+    int32_t cycle = int32_t(c.samplesPerColorburstCycle);
+    int32_t halfCycle = cycle / 2;
+    int32_t padding = (inputWidth - int32_t(c.outputWidth)) / 2;
+    auto clampX = [&](int32_t x) { return std::min(std::max(x, 0), inputWidth - 1); };
+
+    std::vector<Float2> signal(c.inputWidth);
+    std::vector<Float2> luma(c.inputWidth);
+    std::vector<Float4> modulatedChroma(c.inputWidth);
+    for (uint32_t texelY = rowBegin; texelY < rowEnd; texelY++)
+    {
+      float v = (float(texelY) + 0.5f) / float(state.height);
+      uint32_t sourceY = std::min(uint32_t(v * float(sourceHeight)), sourceHeight - 1);
+      for (int32_t x = 0; x < inputWidth; x++)
+      {
+        Float4 texel = source.texture->Load(sourceMip, uint32_t(x), sourceY);
+        signal[size_t(x)] = { texel.x, texel.y };
+      }
+
+      Float4 phases = scanlinePhases.Sample({ v, v });
+      Float2 relativePhase = Float2{ phases.x, phases.y } + c.tint;
+
+      // Separate the luma from the chroma (CompositeToSVideo) and modulate the chroma (SVideoToModulatedChroma).
+      for (int32_t x = 0; x < inputWidth; x++)
+      {
+        Float2 sum = (signal[size_t(clampX(x - halfCycle))] + signal[size_t(clampX(x + halfCycle))]) * 0.5f;
+        for (int32_t i = 1 - halfCycle; i < halfCycle; i++)
+        {
+          sum = sum + signal[size_t(clampX(x + i))];
+        }
+
+        luma[size_t(x)] = sum / float(cycle);
+        Float2 chroma = signal[size_t(x)] - luma[size_t(x)];
+
+        Float2 angle = 2.0f * k_pi * (relativePhase + float(x) / float(cycle));
+        modulatedChroma[size_t(x)] = Float4{
+          chroma.x * std::sin(angle.x),
+          chroma.x * -std::cos(angle.x),
+          chroma.y * std::sin(angle.y),
+          chroma.y * -std::cos(angle.y) };
+      }
+
+      // Low-pass the modulated chroma to get IQ, then convert to RGB (SVideoToRGB).
+      for (uint32_t texelX = state.ColumnBegin(); texelX < state.ColumnEnd(); texelX++)
+      {
+        int32_t inputX = int32_t(texelX) + padding;
+        Float2 y = luma[size_t(clampX(inputX))];
+
+        Float4 iq = (modulatedChroma[size_t(clampX(inputX - cycle))] + modulatedChroma[size_t(clampX(inputX + cycle))])
+          * 0.5f;
+        for (int32_t i = 1 - cycle; i < cycle; i++)
+        {
+          iq += modulatedChroma[size_t(clampX(inputX + i))];
+        }
+
+        iq = iq / float(2 * cycle);
+
+        y = (y - c.blackLevel) * (c.brightness / (c.whiteLevel - c.blackLevel));
+        iq = iq * c.saturation;
+
+        float blend = c.temporalArtifactReduction * 0.5f;
+        float outY = Lerp(y.x, y.y, blend);
+        float outI = Lerp(iq.x, iq.z, blend);
+        float outQ = Lerp(iq.y, iq.w, blend);
+
+        outY = std::pow(Saturate(outY), 2.0f / 2.2f);
+        float iqSat = Saturate(Length({ outI, outQ }));
+        float iqScale = std::pow(iqSat, 2.0f / 2.2f) / std::max(0.00001f, iqSat);
+        outI *= iqScale;
+        outQ *= iqScale;
+
+        // YIQ to RGB (SMPTE C)
+        state.target->Store(
+          state.targetMip,
+          texelX,
+          texelY,
+          Float4{
+            outY + outI *  0.946882f + outQ *  0.623557f,
+            outY + outI * -0.274788f + outQ * -0.635691f,
+            outY + outI * -1.108545f + outQ *  1.7090047f,
+            1.0f });
+      }
+    }
+  }
+
+
+  // cathode-retro-decoder-filter-rgb.hlsl
+  inline void FilterRGB(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      float blurStrength;
+      float stepSize;
+    };
+
+    auto &c = state.Constants<Consts>();
+    auto &source = state.inputs[0];
+    Float2 step = { c.stepSize / float(state.width), 0.0f };
+    float blurSide = c.blurStrength / 3.0f;
+    float blurCenter = 1.0f - 2.0f * blurSide;
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 inTexCoord)
+      {
+        return source.Sample(inTexCoord - step) * blurSide
+          + source.Sample(inTexCoord) * blurCenter
+          + source.Sample(inTexCoord + step) * blurSide;
+      });
+  }
+
+
+  // cathode-retro-crt-generate-screen-texture.hlsl
+  inline void GenerateScreenTexture(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      Float2 viewScale;
+      Float2 overscanScale;
+      Float2 overscanOffset;
+      Float2 distortion;
+      Float2 maskDistortion;
+      Float2 maskScale;
+      float aspect;
+      float roundedCornerSize;
+    };
+
+    // 64-tap poisson disc, see the shader for the source.
+    static constexpr Float2 k_samplingPattern[] =
+    {
+      {-0.613392f, 0.617481f}, {0.170019f, -0.040254f}, {-0.299417f, 0.791925f}, {0.645680f, 0.493210f},
+      {-0.651784f, 0.717887f}, {0.421003f, 0.027070f}, {-0.817194f, -0.271096f}, {-0.705374f, -0.668203f},
+      {0.977050f, -0.108615f}, {0.063326f, 0.142369f}, {0.203528f, 0.214331f}, {-0.667531f, 0.326090f},
+      {-0.098422f, -0.295755f}, {-0.885922f, 0.215369f}, {0.566637f, 0.605213f}, {0.039766f, -0.396100f},
+      {0.751946f, 0.453352f}, {0.078707f, -0.715323f}, {-0.075838f, -0.529344f}, {0.724479f, -0.580798f},
+      {0.222999f, -0.215125f}, {-0.467574f, -0.405438f}, {-0.248268f, -0.814753f}, {0.354411f, -0.887570f},
+      {0.175817f, 0.382366f}, {0.487472f, -0.063082f}, {-0.084078f, 0.898312f}, {0.488876f, -0.783441f},
+      {0.470016f, 0.217933f}, {-0.696890f, -0.549791f}, {-0.149693f, 0.605762f}, {0.034211f, 0.979980f},
+      {0.503098f, -0.308878f}, {-0.016205f, -0.872921f}, {0.385784f, -0.393902f}, {-0.146886f, -0.859249f},
+      {0.643361f, 0.164098f}, {0.634388f, -0.049471f}, {-0.688894f, 0.007843f}, {0.464034f, -0.188818f},
+      {-0.440840f, 0.137486f}, {0.364483f, 0.511704f}, {0.034028f, 0.325968f}, {0.099094f, -0.308023f},
+      {0.693960f, -0.366253f}, {0.678884f, -0.204688f}, {0.001801f, 0.780328f}, {0.145177f, -0.898984f},
+      {0.062655f, -0.611866f}, {0.315226f, -0.604297f}, {-0.780145f, 0.486251f}, {-0.371868f, 0.882138f},
+      {0.200476f, 0.494430f}, {-0.494552f, -0.711051f}, {0.612476f, 0.705252f}, {-0.578845f, -0.768792f},
+      {-0.772454f, -0.090976f}, {0.504440f, 0.372295f}, {0.155736f, 0.065157f}, {0.391522f, 0.849605f},
+      {-0.620106f, -0.328104f}, {0.789239f, -0.419965f}, {-0.545396f, 0.538133f}, {-0.178564f, -0.596057f},
+    };
+
+    struct Coords
+    {
+      Float2 t;
+      Float2 maskT;
+    };
+
+    auto &c = state.Constants<Consts>();
+    auto &mask = state.inputs[0];
+    auto calcCoords = [&](Float2 inTexCoord)
+    {
+      Coords coords;
+      coords.t = DistortCRTCoordinates((inTexCoord * 2.0f - 1.0f) * c.viewScale, c.distortion);
+      coords.maskT = DistortCRTCoordinates(coords.t, { c.maskDistortion.y, c.maskDistortion.x });
+      coords.t = coords.t * c.overscanScale + c.overscanOffset * 2.0f;
+      return coords;
+    };
+
+    Float2 pixelStepX = { 1.0f / float(state.width), 0.0f };
+    Float2 pixelStepY = { 0.0f, 1.0f / float(state.height) };
+
+    // The shader uses screen-space derivatives, which we get here from central differences over this many texels on
+    //  either side, scaled back down to a single texel. The coordinates of two adjacent texels are close enough that
+    //  the difference between them keeps only about half of its significant bits, and the derivatives feed straight
+    //  into the mip selection.
+    constexpr float k_derivativeSpan = 4.0f;
+    constexpr float k_derivativeScale = 0.5f / k_derivativeSpan;
+
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 inTexCoord)
+      {
+        // The neighboring pixels are still needed for their own random rotations (below).
+        Coords coords[3] = {
+          calcCoords(inTexCoord),
+          calcCoords(inTexCoord + pixelStepX),
+          calcCoords(inTexCoord + pixelStepY) };
+
+        Coords spanX[2] = {
+          calcCoords(inTexCoord - pixelStepX * k_derivativeSpan),
+          calcCoords(inTexCoord + pixelStepX * k_derivativeSpan) };
+        Coords spanY[2] = {
+          calcCoords(inTexCoord - pixelStepY * k_derivativeSpan),
+          calcCoords(inTexCoord + pixelStepY * k_derivativeSpan) };
+        Float2 ddxT = (spanX[1].t - spanX[0].t) * k_derivativeScale;
+        Float2 ddyT = (spanY[1].t - spanY[0].t) * k_derivativeScale;
+        Float2 ddxMaskT = (spanX[1].maskT - spanX[0].maskT) * k_derivativeScale;
+        Float2 ddyMaskT = (spanY[1].maskT - spanY[0].maskT) * k_derivativeScale;
+
+        float edgeDist;
+        {
+          Float2 sq = Float2{ c.aspect, 1.0f } / std::max(1.0f, c.aspect);
+          Float2 upperQuadrantT = Abs(coords[0].maskT);
+
+          Float2 q = upperQuadrantT * sq - sq + c.roundedCornerSize;
+          edgeDist = std::min(std::max(q.x, q.y), 0.0f) + Length(Max(q, { 0.0f, 0.0f })) - c.roundedCornerSize;
+        }
+
+        float maskAlpha = 1.0f - SmoothStep(-Length(ddxMaskT + ddyMaskT), 0.0f, edgeDist);
+        Float2 scaledTexCoord = (inTexCoord * 2.0f - 1.0f) * c.viewScale;
+        if (std::max(std::abs(scaledTexCoord.x), std::abs(scaledTexCoord.y)) > 1.1f)
+        {
+          maskAlpha = 0.0f;
+        }
+
+        // Each of the three pixels gets its own random rotation of the sampling pattern, which (just like on the GPU)
+        //  feeds into the derivatives of the mask texture coordinates and therefore the mip selection.
+        Float2 dxT[3];
+        Float2 dyT[3];
+        for (int p = 0; p < 3; p++)
+        {
+          float angle = Noise2D(coords[p].t * 1000.0f, 10.0f) * 6.28318531f;
+          Float2 rotX = Float2{ std::sin(angle), std::cos(angle) } * 1.414f;
+          Float2 rotY = { -rotX.y, rotX.x };
+          dxT[p] = { Dot(rotX, ddxT), Dot(rotY, ddxT) };
+          dyT[p] = { Dot(rotX, ddyT), Dot(rotY, ddyT) };
+        }
+
+        // The derivatives of the sample coordinates are the differences between the three pixels' sample coordinates,
+        //  but they're taken before adding in each pixel's own coordinates and scaling up to mask texels (which would
+        //  cancel out most of their precision again).
+        Float4 color = {};
+        for (const Float2 &pattern : k_samplingPattern)
+        {
+          Float2 offset[3];
+          for (int p = 0; p < 3; p++)
+          {
+            offset[p] = dxT[p] * pattern.x + dyT[p] * pattern.y;
+          }
+
+          color += mask.SampleGrad(
+            (coords[0].t + offset[0]) * c.maskScale,
+            (ddxT + (offset[1] - offset[0])) * c.maskScale,
+            (ddyT + (offset[2] - offset[0])) * c.maskScale,
+            -2.0f);
+        }
+
+        color = color / float(std::size(k_samplingPattern));
+        return Float4{ color.x, color.y, color.z, maskAlpha };
+      });
+  }
+
+
+  // cathode-retro-crt-generate-distortion-lut.hlsl
+  inline void GenerateDistortionLUT(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      Float2 viewScale;
+      Float2 overscanScale;
+      Float2 overscanOffset;
+      Float2 distortion;
+    };
+
+    auto &c = state.Constants<Consts>();
+
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 inTexCoord)
+      {
+        Float2 t = DistortCRTCoordinates((inTexCoord * 2.0f - 1.0f) * c.viewScale, c.distortion) * c.overscanScale
+          + c.overscanOffset * 2.0f;
+        return Float4{ t.x, t.y, 0.0f, 0.0f };
+      });
+  }
+
+
+  // cathode-retro-crt-generate-slot-mask.hlsl
+  inline void GenerateSlotMask(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      Float2 texSize;
+    };
+
+    auto &c = state.Constants<Consts>();
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 inTexCoord)
+      {
+        Float2 texelIndex = {
+          std::floor(inTexCoord.x * c.texSize.x - 0.5f),
+          std::floor(inTexCoord.y * c.texSize.y - 0.5f) };
+        Float2 t = texelIndex / c.texSize.x * Float2{ 1.0f, 2.0f };
+
+        // Left half and right half each contain a [0..1] square of R, G, B rectangles, with the right one offset
+        //  vertically by half.
+        if (t.x > 0.5f)
+        {
+          t.y = Frac(t.y + 0.5f);
+          t.x = t.x * 2.0f - 1.0f;
+        }
+        else
+        {
+          t.x *= 2.0f;
+        }
+
+        t.x *= 3.0f;
+
+        Float4 color = { 1.0f, 0.0f, 0.0f, 1.0f };
+        if (t.x >= 2.0f)
+        {
+          color = { 0.0f, 0.0f, 1.0f, 1.0f };
+        }
+        else if (t.x >= 1.0f)
+        {
+          color = { 0.0f, 1.0f, 0.0f, 1.0f };
+        }
+
+        t.x = Frac(t.x) / 3.0f;
+
+        Float2 border = { 1.0f / 3.0f * (1.0f / 4.0f), 1.0f / 6.0f };
+        float rounding = border.x / 3.0f;
+        border = border - rounding;
+
+        t = Abs(t - Float2{ 1.0f / 6.0f, 0.5f });
+        t = t - (Float2{ 1.0f / 6.0f, 0.5f } - (border + rounding));
+        t = Max({ 0.0f, 0.0f }, t / rounding);
+
+        float distance = Length(t);
+        float delta = 1.0f / (c.texSize.x * rounding);
+        float mul = Saturate(1.0f - SmoothStep(1.0f - delta * 0.5f, 1.0f + delta * 0.5f, distance));
+
+        return Float4{ color.x * mul, color.y * mul, color.z * mul, 1.0f };
+      });
+  }
+
+
+  // cathode-retro-crt-generate-shadow-mask.hlsl
+  inline void GenerateShadowMask(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 inTexCoord)
+      {
+        Float2 hexGridF = inTexCoord * Float2{ 6.0f, 4.0f };
+
+        bool isOddBlock = (Frac(hexGridF.y * 0.5f) >= 0.5f);
+        if (isOddBlock)
+        {
+          hexGridF.x += 0.5f;
+        }
+
+        int32_t hexIDX = int32_t(std::floor(hexGridF.x));
+        int32_t hexIDY = int32_t(std::floor(hexGridF.y));
+
+        Float2 cellCoord = Frac(hexGridF);
+
+        constexpr float t = 0.5773502691f; // tan(30 degrees)
+        constexpr float c = 0.5f * t;
+
+        if (cellCoord.y < (-t * cellCoord.x) + c)
+        {
+          hexIDY--;
+          hexGridF.x += isOddBlock ? -0.5f : 0.5f;
+          hexIDX -= int32_t(isOddBlock);
+        }
+        else if (cellCoord.y < (t * cellCoord.x) - c)
+        {
+          hexIDY--;
+          hexGridF.x += isOddBlock ? -0.5f : 0.5f;
+          hexIDX += int32_t(!isOddBlock);
+        }
+
+        if (Frac(float(hexIDY) * 0.5f) >= 0.5f)
+        {
+          hexGridF.x++;
+          hexIDX++;
+        }
+
+        Float4 color;
+        uint32_t hx = uint32_t(hexIDX + 1);
+        if ((hx % 3) == 0)
+        {
+          color = { 1.0f, 0.0f, 0.0f, 1.0f };
+        }
+        else if ((hx % 3) == 1)
+        {
+          color = { 0.0f, 1.0f, 0.0f, 1.0f };
+        }
+        else
+        {
+          color = { 0.0f, 0.0f, 1.0f, 1.0f };
+        }
+
+        cellCoord = (hexGridF - Float2{ float(hexIDX), float(hexIDY) }) * Float2{ 1.0f, 1.0f / (1.0f + c) };
+        cellCoord = cellCoord * 2.0f - 1.0f;
+
+        float dist = 1.0f - SmoothStep(0.75f, 0.8f, Length(cellCoord));
+        return Float4{ color.x * dist, color.y * dist, color.z * dist, 1.0f };
+      });
+  }
+
+
+  // cathode-retro-crt-generate-aperture-grille.hlsl
+  inline void GenerateApertureGrille(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      Float2 texSize;
+    };
+
+    auto &c = state.Constants<Consts>();
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 inTexCoord)
+      {
+        float x = std::floor(inTexCoord.x * c.texSize.x - 0.5f) / c.texSize.x;
+
+        x = Frac(x * 2.0f) * 3.0f;
+
+        Float4 color = { 1.0f, 0.0f, 0.0f, 1.0f };
+        if (x >= 2.0f)
+        {
+          color = { 0.0f, 0.0f, 1.0f, 1.0f };
+        }
+        else if (x >= 1.0f)
+        {
+          color = { 0.0f, 1.0f, 0.0f, 1.0f };
+        }
+
+        x = Frac(x) / 3.0f;
+
+        float border = 1.0f / 12.0f;
+        float smoothing = border / 3.0f;
+        border -= smoothing;
+
+        x = std::abs(x - 1.0f / 6.0f);
+        x -= 1.0f / 6.0f - (smoothing + border);
+        x /= smoothing;
+        x = std::max(0.0f, x);
+
+        float delta = 1.0f / (c.texSize.x * smoothing);
+        float mul = Saturate(1.0f - SmoothStep(1.0f - delta * 0.5f, 1.0f + delta * 0.5f, x));
+
+        return Float4{ color.x * mul, color.y * mul, color.z * mul, 1.0f };
+      });
+  }
+
+
+  // cathode-retro-crt-rgb-to-crt.hlsl
+  inline void RGBToCRT(const SoftwareRenderState &state, uint32_t rowBegin, uint32_t rowEnd)
+  {
+    struct Consts
+    {
+      Float4 backgroundColor;
+      float phosphorPersistence;
+      float scanlineCount;
+      float scanlineStrength;
+      float curEvenOddTexelOffset;
+      float prevEvenOddTexelOffset;
+      float diffusionStrength;
+      float maskStrength;
+      float maskDepth;
+    };
+
+    auto &c = state.Constants<Consts>();
+    auto &currentFrame = state.inputs[0];
+    auto &previousFrame = state.inputs[1];
+    auto &screenMaskTexture = state.inputs[2];
+    auto &diffusion = state.inputs[3];
+    auto &distortionLUT = state.inputs[4];
+
+    auto lookUpT = [&](Float2 inTexCoord)
+    {
+      Float4 t = distortionLUT.Sample(inTexCoord);
+      return Float2{ t.x, t.y };
+    };
+
+    float pixelStepY = 1.0f / float(state.height);
+
+    // Reduce the influence of the scanlines as we get small enough that aliasing is unavoidable (this only depends on
+    //  the output resolution, so it's the same for every pixel).
+    float scanlineStrength = Lerp(
+      c.scanlineStrength,
+      0.0f,
+      SmoothStep(1.0f, 1.4f, pixelStepY * c.scanlineCount * 2.0f));
+
+    ForEachTexel(
+      state,
+      rowBegin,
+      rowEnd,
+      [&](Float2 inTexCoord)
+      {
+        Float4 screenMask = screenMaskTexture.Sample(inTexCoord);
+
+        // The derivative comes from the LUT's next row down (or, for the bottom row, the row above it).
+        Float2 t = lookUpT(inTexCoord);
+        Float2 ddyT = (inTexCoord.y + pixelStepY < 1.0f)
+          ? lookUpT(inTexCoord + Float2{ 0.0f, pixelStepY }) - t
+          : t - lookUpT(inTexCoord - Float2{ 0.0f, pixelStepY });
+
+        Float4 diffusionColor = diffusion.Sample(t * 0.5f + 0.5f);
+
+        t.y += c.curEvenOddTexelOffset / c.scanlineCount;
+
+        float scanlineSpaceY = t.y * c.scanlineCount + c.scanlineCount;
+        float pixelLengthInScanlineSpace = Length(ddyT) * c.scanlineCount;
+
+        // Sharpen up the interpolation between scanlines.
+        {
+          float scanlineIndex = (t.y * 0.5f + 0.5f) * c.scanlineCount;
+          float scanlineFrac = Frac(scanlineIndex);
+          scanlineIndex -= scanlineFrac;
+          scanlineFrac -= 0.5f;
+          constexpr float ySharpening = 0.1f;
+          scanlineFrac =
+            Sign(scanlineFrac) * Saturate(std::abs(scanlineFrac) - ySharpening) * 0.5f / (0.5f - ySharpening);
+
+          scanlineIndex += scanlineFrac + 0.5f;
+          t.y = scanlineIndex / c.scanlineCount * 2.0f - 1.0f;
+        }
+
+        Float4 sourceColor;
+        {
+          t = t * 0.5f + 0.5f;
+          sourceColor = currentFrame.Sample(t);
+
+          // Supersampled scanline darkening (see the shader for the derivation of the integral).
+          float scale = std::pow(std::abs(pixelLengthInScanlineSpace), 2.6f) * 7.0f;
+          float ya = scanlineSpaceY - scale;
+          float yb = scanlineSpaceY + scale;
+          float scanline = (0.5f * (yb - ya) + 1.0f / (2.0f * k_pi) * (std::sin(k_pi * ya) - std::sin(k_pi * yb)))
+            / (2.0f * scale);
+
+          sourceColor = sourceColor * Lerp(1.0f - scanlineStrength, 1.0f, scanline);
+
+          Float2 prevT = t;
+          float prevScanline = scanline;
+          if (c.prevEvenOddTexelOffset != c.curEvenOddTexelOffset)
+          {
+            prevT.y += c.prevEvenOddTexelOffset / c.scanlineCount;
+            prevScanline = 1.0f - prevScanline;
+          }
+
+          Float4 prevSourceColor = previousFrame.Sample(prevT) * Lerp(1.0f - scanlineStrength, 1.0f, prevScanline);
+
+          sourceColor = {
+            std::max(prevSourceColor.x * c.phosphorPersistence, sourceColor.x),
+            std::max(prevSourceColor.y * c.phosphorPersistence, sourceColor.y),
+            std::max(prevSourceColor.z * c.phosphorPersistence, sourceColor.z),
+            1.0f };
+
+          sourceColor = sourceColor / (1.0f - scanlineStrength * 0.5f);
+        }
+
+        // Apply the screen mask, then the diffusion, then the edge-of-screen mask.
+        float maskR = Lerp(1.0f, screenMask.x * (3.0f - c.maskDepth) + c.maskDepth, c.maskStrength);
+        float maskG = Lerp(1.0f, screenMask.y * (3.0f - c.maskDepth) + c.maskDepth, c.maskStrength);
+        float maskB = Lerp(1.0f, screenMask.z * (3.0f - c.maskDepth) + c.maskDepth, c.maskStrength);
+
+        Float4 result = {
+          std::max(diffusionColor.x * c.diffusionStrength, sourceColor.x * maskR),
+          std::max(diffusionColor.y * c.diffusionStrength, sourceColor.y * maskG),
+          std::max(diffusionColor.z * c.diffusionStrength, sourceColor.z * maskB),
+          1.0f };
+
+        return Lerp(c.backgroundColor, result, screenMask.w);
+      });
+  }
+
+
+  // Get the kernel that implements the given shader.
+  inline SoftwareKernel KernelForShader(CathodeRetro::ShaderID id)
+  {
+    switch (id)
+    {
+    case CathodeRetro::ShaderID::Util_Copy: return Copy;
+    case CathodeRetro::ShaderID::Util_Downsample2X: return Downsample2X;
+    case CathodeRetro::ShaderID::Util_TonemapAndDownsample: return TonemapAndDownsample;
+    case CathodeRetro::ShaderID::Util_GaussianBlur13: return GaussianBlur13;
+    case CathodeRetro::ShaderID::Generator_GeneratePhaseTexture: return GeneratePhaseTexture;
+#if SOFTWARE_SIMD_WIDTH > 0
+    case CathodeRetro::ShaderID::Generator_RGBToSVideoOrComposite: return RGBToSVideoOrCompositeSIMD;
+#else
+    case CathodeRetro::ShaderID::Generator_RGBToSVideoOrComposite: return RGBToSVideoOrComposite;
+#endif
+    case CathodeRetro::ShaderID::Generator_ApplyArtifacts: return ApplyArtifacts;
+    case CathodeRetro::ShaderID::Generator_RGBToSignalWithArtifacts: return RGBToSignalWithArtifacts;
+    case CathodeRetro::ShaderID::Decoder_CompositeToSVideo: return CompositeToSVideo;
+    case CathodeRetro::ShaderID::Decoder_SVideoToModulatedChroma: return SVideoToModulatedChroma;
+    case CathodeRetro::ShaderID::Decoder_SVideoToRGB: return SVideoToRGB;
+    case CathodeRetro::ShaderID::Decoder_FilterRGB: return FilterRGB;
+    case CathodeRetro::ShaderID::Decoder_CompositeToRGB: return CompositeToRGB;
+    case CathodeRetro::ShaderID::CRT_GenerateScreenTexture: return GenerateScreenTexture;
+    case CathodeRetro::ShaderID::CRT_GenerateDistortionLUT: return GenerateDistortionLUT;
+    case CathodeRetro::ShaderID::CRT_GenerateSlotMask: return GenerateSlotMask;
+    case CathodeRetro::ShaderID::CRT_GenerateShadowMask: return GenerateShadowMask;
+    case CathodeRetro::ShaderID::CRT_GenerateApertureGrille: return GenerateApertureGrille;
+    case CathodeRetro::ShaderID::CRT_RGBToCRT: return RGBToCRT;
+    }
+
+    return nullptr;
+  }
+}
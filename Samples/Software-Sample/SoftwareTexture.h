@@ -0,0 +1,460 @@
+#pragma once
+
+#include <assert.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "CathodeRetro/GraphicsDevice.h"
+
+#include "SoftwareMath.h"
+
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+  #include <immintrin.h>
+  #define SOFTWARE_HAS_F16C 1
+#else
+  #define SOFTWARE_HAS_F16C 0
+#endif
+
+
+// Conversions between 32-bit floats and the 16-bit (IEEE half-precision) floats that the Float16 texture formats
+//  store. These use the F16C instructions when the compiler is targeting them (which it is when building for AVX2),
+//  and otherwise do the same round-to-nearest-even conversion by hand.
+inline float HalfToFloat(uint16_t h)
+{
+#if SOFTWARE_HAS_F16C
+  return _cvtsh_ss(h);
+#else
+  uint32_t sign = uint32_t(h & 0x8000) << 16;
+  uint32_t exponent = (h >> 10) & 0x1f;
+  uint32_t mantissa = h & 0x3ff;
+
+  uint32_t bits;
+  if (exponent == 0x1f)
+  {
+    // Infinity or NaN
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  }
+  else if (exponent != 0)
+  {
+    // A normal number just needs its exponent rebiased (from 15 to 127).
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+  else
+  {
+    // Zero or a denormal, which is the mantissa in units of 2^-24 (exactly representable as a float).
+    float f = float(mantissa) * (1.0f / 16777216.0f);
+    return (sign != 0) ? -f : f;
+  }
+
+  float f;
+  memcpy(&f, &bits, sizeof(f));
+  return f;
+#endif
+}
+
+
+inline uint16_t FloatToHalf(float f)
+{
+#if SOFTWARE_HAS_F16C
+  return uint16_t(_cvtss_sh(f, _MM_FROUND_TO_NEAREST_INT));
+#else
+  uint32_t bits;
+  memcpy(&bits, &f, sizeof(bits));
+  uint16_t sign = uint16_t((bits >> 16) & 0x8000);
+  uint32_t absBits = bits & 0x7fffffff;
+
+  if (absBits >= 0x7f800000)
+  {
+    // Infinity or NaN (keeping NaNs as NaNs)
+    return sign | uint16_t((absBits > 0x7f800000) ? 0x7e00 : 0x7c00);
+  }
+
+  if (absBits >= 0x477ff000)
+  {
+    // Anything that rounds to above the largest half (65504) becomes infinity.
+    return sign | 0x7c00;
+  }
+
+  if (absBits < 0x38800000)
+  {
+    // Below the smallest normal half (2^-14) the result is a denormal, in units of 2^-24. (nearbyint uses the
+    //  default round-to-nearest-even mode.)
+    float a;
+    memcpy(&a, &absBits, sizeof(a));
+    return sign | uint16_t(std::nearbyint(a * 16777216.0f));
+  }
+
+  // Round the mantissa to nearest even (any carry out of the mantissa correctly bumps the exponent), then rebias the
+  //  exponent (from 127 to 15).
+  uint32_t rounded = absBits + 0xfff + ((absBits >> 13) & 1);
+  return sign | uint16_t((rounded - (112u << 23)) >> 13);
+#endif
+}
+
+
+// A "Constant Buffer" class for CathodeRetro: it's just a block of CPU memory that the kernels read their constants
+//  from (laid out exactly the way the HLSL cbuffer would be).
+class SoftwareConstantBuffer : public CathodeRetro::IConstantBuffer
+{
+public:
+  SoftwareConstantBuffer(size_t sizeIn)
+  {
+    // Pad up to a multiple of 16 bytes, just like a GPU constant buffer.
+    data.resize((sizeIn + 15) & ~size_t(15));
+  }
+
+  void Update(const void *dataIn, size_t dataSize) override
+  {
+    assert(dataSize <= data.size());
+    memcpy(data.data(), dataIn, dataSize);
+  }
+
+  const void *Data() const
+    { return data.data(); }
+
+  size_t Size() const
+    { return data.size(); }
+
+private:
+  std::vector<uint8_t> data;
+};
+
+
+// This is a texture stored in CPU memory, in its native format (so an RGBA_Unorm8 texture takes 4 bytes per texel, an
+//  RG_Float32 one takes 8, an RG_Float16 one takes 4, etc), with its mip levels packed one after another in a single
+//  block of memory (which is either owned by the texture or, for a texture placed in a SoftwareRenderTargetMemory,
+//  borrowed from elsewhere).
+//  Since the software device can render into any texture, every texture is also a render target.
+class SoftwareTexture : public CathodeRetro::IRenderTarget
+{
+public:
+  SoftwareTexture(
+    uint32_t widthIn,
+    uint32_t heightIn,
+    uint32_t mipCountIn, // 0 means "all mip levels"
+    CathodeRetro::TextureFormat formatIn,
+    const void *optionalInitialDataTexels)
+    : SoftwareTexture(widthIn, heightIn, mipCountIn, formatIn)
+  {
+    ownedData.resize(CathodeRetro::RenderTargetByteCount(width, height, mipCount, format));
+    data = ownedData.data();
+
+    if (optionalInitialDataTexels != nullptr)
+    {
+      memcpy(data, optionalInitialDataTexels, size_t(width) * height * TexelByteCount(format));
+    }
+  }
+
+
+  // The texel data may be pointing into our own storage, so these can't be copied.
+  SoftwareTexture(const SoftwareTexture &) = delete;
+  void operator=(const SoftwareTexture &) = delete;
+
+
+  // Create a texture whose texels live in the given memory (which must hold RenderTargetByteCount bytes, and outlive
+  //  the texture).
+  static std::unique_ptr<SoftwareTexture> InMemory(
+    uint8_t *memory,
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipCount, // 0 means "all mip levels"
+    CathodeRetro::TextureFormat format)
+  {
+    std::unique_ptr<SoftwareTexture> texture(new SoftwareTexture(width, height, mipCount, format));
+    texture->data = memory;
+    return texture;
+  }
+
+
+  uint32_t Width() const override
+    { return width; }
+
+  uint32_t Height() const override
+    { return height; }
+
+  uint32_t MipCount() const override
+    { return mipCount; }
+
+  CathodeRetro::TextureFormat Format() const override
+    { return format; }
+
+
+  uint32_t MipWidth(uint32_t mip) const
+    { return std::max(1U, width >> mip); }
+
+  uint32_t MipHeight(uint32_t mip) const
+    { return std::max(1U, height >> mip); }
+
+
+  // The raw texel data for the given mip level (rows are tightly packed, top row first).
+  uint8_t *MipData(uint32_t mip)
+    { return data + mipOffsets[mip]; }
+
+  const uint8_t *MipData(uint32_t mip) const
+    { return data + mipOffsets[mip]; }
+
+
+  static uint32_t TexelByteCount(CathodeRetro::TextureFormat format)
+    { return CathodeRetro::TexelByteCount(format); }
+
+  static bool IsFloat16(CathodeRetro::TextureFormat format)
+  {
+    return format == CathodeRetro::TextureFormat::R_Float16
+      || format == CathodeRetro::TextureFormat::RG_Float16
+      || format == CathodeRetro::TextureFormat::RGBA_Float16;
+  }
+
+  // The number of channels that a texel of the given format has.
+  static uint32_t ChannelCount(CathodeRetro::TextureFormat format)
+  {
+    return (format == CathodeRetro::TextureFormat::RGBA_Unorm8)
+      ? 4
+      : TexelByteCount(format) / (IsFloat16(format) ? sizeof(uint16_t) : sizeof(float));
+  }
+
+
+  // Load a single texel. Any channels that the format does not have read as 0 (or 1 for alpha), which matches what
+  //  shaders get when they sample a texture with fewer channels than they ask for.
+  Float4 Load(uint32_t mip, uint32_t x, uint32_t y) const
+  {
+    const uint8_t *texel = MipData(mip) + (size_t(y) * MipWidth(mip) + x) * TexelByteCount(format);
+    const float *f = reinterpret_cast<const float *>(texel);
+    const uint16_t *h = reinterpret_cast<const uint16_t *>(texel);
+    switch (format)
+    {
+    case CathodeRetro::TextureFormat::RGBA_Unorm8:
+      return {
+        float(texel[0]) * (1.0f / 255.0f),
+        float(texel[1]) * (1.0f / 255.0f),
+        float(texel[2]) * (1.0f / 255.0f),
+        float(texel[3]) * (1.0f / 255.0f) };
+    case CathodeRetro::TextureFormat::R_Float32:
+      return { f[0], 0.0f, 0.0f, 1.0f };
+    case CathodeRetro::TextureFormat::RG_Float32:
+      return { f[0], f[1], 0.0f, 1.0f };
+    case CathodeRetro::TextureFormat::RGBA_Float32:
+      return { f[0], f[1], f[2], f[3] };
+    case CathodeRetro::TextureFormat::R_Float16:
+      return { HalfToFloat(h[0]), 0.0f, 0.0f, 1.0f };
+    case CathodeRetro::TextureFormat::RG_Float16:
+      return { HalfToFloat(h[0]), HalfToFloat(h[1]), 0.0f, 1.0f };
+    case CathodeRetro::TextureFormat::RGBA_Float16:
+      return { HalfToFloat(h[0]), HalfToFloat(h[1]), HalfToFloat(h[2]), HalfToFloat(h[3]) };
+    }
+
+    return {};
+  }
+
+
+  // Store a single texel, dropping any channels that the format does not have (and quantizing for unorm formats).
+  void Store(uint32_t mip, uint32_t x, uint32_t y, const Float4 &v)
+  {
+    uint8_t *texel = MipData(mip) + (size_t(y) * MipWidth(mip) + x) * TexelByteCount(format);
+    float *f = reinterpret_cast<float *>(texel);
+    uint16_t *h = reinterpret_cast<uint16_t *>(texel);
+    switch (format)
+    {
+    case CathodeRetro::TextureFormat::RGBA_Unorm8:
+      texel[0] = uint8_t(Saturate(v.x) * 255.0f + 0.5f);
+      texel[1] = uint8_t(Saturate(v.y) * 255.0f + 0.5f);
+      texel[2] = uint8_t(Saturate(v.z) * 255.0f + 0.5f);
+      texel[3] = uint8_t(Saturate(v.w) * 255.0f + 0.5f);
+      break;
+    case CathodeRetro::TextureFormat::RGBA_Float32:
+      f[3] = v.w;
+      f[2] = v.z;
+      [[fallthrough]];
+    case CathodeRetro::TextureFormat::RG_Float32:
+      f[1] = v.y;
+      [[fallthrough]];
+    case CathodeRetro::TextureFormat::R_Float32:
+      f[0] = v.x;
+      break;
+    case CathodeRetro::TextureFormat::RGBA_Float16:
+      h[3] = FloatToHalf(v.w);
+      h[2] = FloatToHalf(v.z);
+      [[fallthrough]];
+    case CathodeRetro::TextureFormat::RG_Float16:
+      h[1] = FloatToHalf(v.y);
+      [[fallthrough]];
+    case CathodeRetro::TextureFormat::R_Float16:
+      h[0] = FloatToHalf(v.x);
+      break;
+    }
+  }
+
+private:
+  // Sets up everything but the texel memory itself.
+  SoftwareTexture(uint32_t widthIn, uint32_t heightIn, uint32_t mipCountIn, CathodeRetro::TextureFormat formatIn)
+    : width(widthIn)
+    , height(heightIn)
+    , mipCount((mipCountIn == 0) ? CathodeRetro::FullMipCount(widthIn, heightIn) : mipCountIn)
+    , format(formatIn)
+  {
+    size_t offset = 0;
+    for (uint32_t mip = 0; mip < mipCount; mip++)
+    {
+      mipOffsets.push_back(offset);
+      offset += size_t(MipWidth(mip)) * MipHeight(mip) * TexelByteCount(format);
+    }
+  }
+
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t mipCount = 0;
+  CathodeRetro::TextureFormat format = CathodeRetro::TextureFormat::RGBA_Unorm8;
+  std::vector<size_t> mipOffsets;
+  std::vector<uint8_t> ownedData;
+  uint8_t *data = nullptr;
+};
+
+
+// A block of CPU memory that render targets can be placed into, so that render targets that are never in use at the
+//  same time can share the same bytes.
+class SoftwareRenderTargetMemory : public CathodeRetro::IRenderTargetMemory
+{
+public:
+  explicit SoftwareRenderTargetMemory(size_t byteCount)
+    : data(byteCount)
+    { }
+
+  std::unique_ptr<CathodeRetro::IRenderTarget> CreateRenderTarget(
+    size_t byteOffset,
+    uint32_t width,
+    uint32_t height,
+    uint32_t mipCount,
+    CathodeRetro::TextureFormat format) override
+  {
+    assert(byteOffset + CathodeRetro::RenderTargetByteCount(width, height, mipCount, format) <= data.size());
+    return SoftwareTexture::InMemory(data.data() + byteOffset, width, height, mipCount, format);
+  }
+
+private:
+  std::vector<uint8_t> data;
+};
+
+
+// This is the software equivalent of a bound shader resource view + sampler: it knows which texture (and optionally
+//  which mip level) to read from and how to filter and address it.
+struct SoftwareTextureView
+{
+  const SoftwareTexture *texture = nullptr;
+  int32_t mipLevel = -1;
+  CathodeRetro::SamplerType samplerType = CathodeRetro::SamplerType::LinearClamp;
+
+
+  // The dimensions of the (most-detailed) mip level that this view can see, which is what GetDimensions/textureSize
+  //  return in the shaders.
+  Float2 Size() const
+  {
+    uint32_t mip = uint32_t(std::max(0, mipLevel));
+    return { float(texture->MipWidth(mip)), float(texture->MipHeight(mip)) };
+  }
+
+
+  // Sample the most detailed visible mip level (shaders that sample mipmapped textures without an explicit mip use
+  //  SampleGrad instead).
+  Float4 Sample(Float2 uv) const
+    { return SampleLevel(uv, uint32_t(std::max(0, mipLevel))); }
+
+
+  // Sample with explicit texture coordinate derivatives, selecting (and, for linear samplers, blending between) mip
+  //  levels the way the hardware would.
+  Float4 SampleGrad(Float2 uv, Float2 ddx, Float2 ddy, float bias = 0.0f) const
+  {
+    if (mipLevel >= 0 || texture->MipCount() == 1)
+    {
+      return Sample(uv);
+    }
+
+    Float2 size = Size();
+    float lod = 0.5f * std::log2(std::max(Dot(ddx * size, ddx * size), Dot(ddy * size, ddy * size))) + bias;
+    lod = (lod > 0.0f) ? std::min(lod, float(texture->MipCount() - 1)) : 0.0f;
+
+    // Hardware computes the LOD in fixed point (typically with 8 fractional bits), and rounding it the same way here
+    //  keeps a difference in the last bits of the derivatives from moving it (and possibly the mip it picks).
+    lod = std::round(lod * 256.0f) * (1.0f / 256.0f);
+
+    if (IsNearest())
+    {
+      return SampleLevel(uv, uint32_t(lod + 0.5f));
+    }
+
+    uint32_t mip0 = uint32_t(lod);
+    uint32_t mip1 = std::min(mip0 + 1, texture->MipCount() - 1);
+    return Lerp(SampleLevel(uv, mip0), SampleLevel(uv, mip1), lod - float(mip0));
+  }
+
+
+  Float4 SampleLevel(Float2 uv, uint32_t mip) const
+  {
+    int32_t w = int32_t(texture->MipWidth(mip));
+    int32_t h = int32_t(texture->MipHeight(mip));
+
+    if (IsNearest())
+    {
+      return texture->Load(mip, Address(FloorToInt(uv.x * float(w)), w), Address(FloorToInt(uv.y * float(h)), h));
+    }
+
+    float fx = uv.x * float(w) - 0.5f;
+    float fy = uv.y * float(h) - 0.5f;
+    int32_t xi = FloorToInt(fx);
+    int32_t yi = FloorToInt(fy);
+    float tx = Saturate(fx - float(xi));
+    float ty = Saturate(fy - float(yi));
+
+    uint32_t x0 = Address(xi, w);
+    uint32_t x1 = Address(xi + 1, w);
+    uint32_t y0 = Address(yi, h);
+    uint32_t y1 = Address(yi + 1, h);
+
+    // Hardware filtering only has a handful of bits of subtexel precision, so a sample that lands (within rounding
+    //  error) on a texel center reads only that texel. Doing the same here keeps a render that's restricted to a band
+    //  of rows (see CathodeRetro::RenderTargetView) from reading the rows around the band, which don't necessarily
+    //  hold anything meaningful (even a zero weight doesn't help if they hold NaNs).
+    SnapToTexel(tx, &x0, &x1);
+    SnapToTexel(ty, &y0, &y1);
+
+    Float4 top = Lerp(texture->Load(mip, x0, y0), texture->Load(mip, x1, y0), tx);
+    Float4 bottom = Lerp(texture->Load(mip, x0, y1), texture->Load(mip, x1, y1), tx);
+    return Lerp(top, bottom, ty);
+  }
+
+
+  // Collapses a linear filter's two texel coordinates into one when the filter weight t is within rounding error of 0
+  //  or 1 (see SampleLevel). Kernels that do their own linear filtering use this too, to read what a sample would.
+  static void SnapToTexel(float t, uint32_t *coord0, uint32_t *coord1)
+  {
+    constexpr float k_epsilon = 1.0f / 512.0f;
+    if (t < k_epsilon)
+    {
+      *coord1 = *coord0;
+    }
+    else if (t > 1.0f - k_epsilon)
+    {
+      *coord0 = *coord1;
+    }
+  }
+
+private:
+  bool IsNearest() const
+  {
+    return samplerType == CathodeRetro::SamplerType::NearestClamp
+      || samplerType == CathodeRetro::SamplerType::NearestWrap;
+  }
+
+
+  uint32_t Address(int32_t coord, int32_t size) const
+  {
+    if (samplerType == CathodeRetro::SamplerType::LinearWrap || samplerType == CathodeRetro::SamplerType::NearestWrap)
+    {
+      coord %= size;
+      return uint32_t((coord < 0) ? coord + size : coord);
+    }
+
+    return uint32_t(std::min(std::max(coord, 0), size - 1));
+  }
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// A very small fork/join thread pool: ParallelFor hands out job indices to the worker threads (and the calling thread,
+//  which also participates) and then blocks until all of them have been run.
+class SoftwareThreadPool
+{
+public:
+  // A thread count of 0 means "one thread per hardware thread".
+  explicit SoftwareThreadPool(uint32_t threadCount = 0)
+  {
+    if (threadCount == 0)
+    {
+      threadCount = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    // The calling thread counts as one of the threads.
+    for (uint32_t i = 1; i < threadCount; i++)
+    {
+      workers.emplace_back([this] { WorkerMain(); });
+    }
+  }
+
+
+  ~SoftwareThreadPool()
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      shutdown = true;
+    }
+
+    wakeCondition.notify_all();
+    for (auto &worker : workers)
+    {
+      worker.join();
+    }
+  }
+
+
+  SoftwareThreadPool(const SoftwareThreadPool &) = delete;
+  void operator=(const SoftwareThreadPool &) = delete;
+
+
+  uint32_t ThreadCount() const
+    { return uint32_t(workers.size()) + 1; }
+
+
+  // Run func(i) for every i in [0, count), spread across all of the threads, and wait for them all to finish.
+  void ParallelFor(uint32_t count, const std::function<void(uint32_t)> &func)
+  {
+    if (workers.empty() || count <= 1)
+    {
+      for (uint32_t i = 0; i < count; i++)
+      {
+        func(i);
+      }
+
+      return;
+    }
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      job = &func;
+      jobCount = count;
+      nextIndex = 0;
+      busyWorkerCount = uint32_t(workers.size());
+      generation++;
+    }
+
+    wakeCondition.notify_all();
+    RunJob(func, count);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this] { return busyWorkerCount == 0; });
+    job = nullptr;
+  }
+
+private:
+  void RunJob(const std::function<void(uint32_t)> &func, uint32_t count)
+  {
+    for (uint32_t i = nextIndex.fetch_add(1); i < count; i = nextIndex.fetch_add(1))
+    {
+      func(i);
+    }
+  }
+
+
+  void WorkerMain()
+  {
+    uint64_t seenGeneration = 0;
+    for (;;)
+    {
+      const std::function<void(uint32_t)> *localJob;
+      uint32_t localCount;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeCondition.wait(lock, [&] { return shutdown || generation != seenGeneration; });
+        if (shutdown)
+        {
+          return;
+        }
+
+        seenGeneration = generation;
+        localJob = job;
+        localCount = jobCount;
+      }
+
+      RunJob(*localJob, localCount);
+
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (--busyWorkerCount == 0)
+        {
+          doneCondition.notify_one();
+        }
+      }
+    }
+  }
+
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wakeCondition;
+  std::condition_variable doneCondition;
+
+  const std::function<void(uint32_t)> *job = nullptr;
+  uint32_t jobCount = 0;
+  std::atomic<uint32_t> nextIndex { 0 };
+  uint32_t busyWorkerCount = 0;
+  uint64_t generation = 0;
+  bool shutdown = false;
+};
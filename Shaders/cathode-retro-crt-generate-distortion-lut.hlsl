@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This shader generates the distortion LUT, which holds the texture coordinate (into the RGB input) that each pixel of
+//  the output maps to once the screen curvature and overscan have been applied. These only depend on the output size
+//  and the screen/overscan settings, so rather than doing the (fairly expensive) distortion for every output pixel of
+//  every frame, the RGBToCRT shader looks them up in this texture, which is regenerated only when those change.
+// The output render target is expected to be an RG float texture at the output resolution. The coordinates it contains
+//  are in [-1..1] range (not [0..1]), the same as what DistortCRTCoordinates returns.
+
+
+#include "cathode-retro-util-language-helpers.hlsli"
+#include "cathode-retro-crt-distort-coordinates.hlsli"
+
+
+CBUFFER consts
+{
+  // $NOTE: These values are the same as the first four in cathode-retro-crt-generate-screen-texture.hlsl, and are
+  //  expected to match.
+
+  // This shader is intended to render a screen of the correct shape regardless of the output render target shape,
+  //  effectively letterboxing or pillarboxing as needed(i.e. rendering a 4:3 screen to a 16:9 render target).
+  //  g_viewScale is the scale value necessary to get the resulting screen scale correct. In the event the output
+  //  render target is wider than the intended screen, the screen needs to be scaled down horizontally to pillarbox,
+  //  usually like (where screenAspectRatio is crtScreenWidth / crtScreenHeight):
+  //    (x: (renderTargetWidth / renderTargetHeight) * (1.0 / screenAspectRatio), y: 1.0)
+  //  if the output render target is taller than the intended screen, it will end up letterboxed using something like:
+  //    (x: 1.0, y: (renderTargetHeight / renderTargetWidth) * screenAspectRatio)
+  // Note that if overscan (where the edges of the screen cover up some of the picture) is being emulated, it
+  //  potentially needs to be taken into account in this value too. See RGBToCRT.h for details if that's the case.
+  float2 g_viewScale;
+
+  // If overscan emulation is intended (where the edges of the screen cover up some of the picture), then this is the
+  //  amount of signal texture scaling needed to account for that. Given an overscan value "overscanAmount" that's
+  //    (overscanLeft + overscanRight, overscanTop + overscanBottom)
+  //  this value should end up being:
+  //    (inputImageSize.xy - overscanAmount.xy) / inputImageSize.xy
+  float2 g_overscanScale;
+
+  // This is the texture coordinate offset to adjust for overscan. Because the input coordinates are [-1..1] instead of
+  //  [0..1], this is the offset needed to recenter the value. Given an "overscanDifference" value:
+  //    (overscanLeft - overscanRight, overscanTop - overscanBottom)
+  //  this value should be:
+  //    overscanDifference.xy/ inputImageSize.xy * 0.5
+  float2 g_overscanOffset;
+
+  // The amount along each axis to apply the virtual-curved screen distortion. Usually a value in [0..1]. "0" indicates
+  //  no curvature (a flat screen) and "1" indicates "quite curved"
+  float2 g_distortion;
+};
+
+
+float4 Main(float2 inTexCoord)
+{
+  // Distort the texture coordinates to get our texture into the correct space for display, then adjust for overscan.
+  float2 t = DistortCRTCoordinates((inTexCoord * 2 - 1) * g_viewScale, g_distortion) * g_overscanScale
+    + g_overscanOffset * 2.0;
+
+  return float4(t, 0, 0);
+}
+
+
+PS_MAIN
\ No newline at end of file
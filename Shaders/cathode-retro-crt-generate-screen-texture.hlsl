@@ -86,7 +86,8 @@ END_CONST_ARRAY
 
 CBUFFER consts
 {
-  // $NOTE: The first four values here are the same as the first four in RGBToCRT.hlsl, and are expected to match.
+  // $NOTE: The first four values here are the same as the ones in cathode-retro-crt-generate-distortion-lut.hlsl,
+  //  and are expected to match.
 
   // This shader is intended to render a screen of the correct shape regardless of the output render target shape,
   //  effectively letterboxing or pillarboxing as needed(i.e. rendering a 4:3 screen to a 16:9 render target).
@@ -4,12 +4,11 @@
 //  could be simplified.
 
 // $TODO: May want to do something like an ubershader version that does exactly the minimum amount of work based on how
-//  many features are actually in use (pulling out the distortion or, more importantly, the sampling of the previous/
-//  diffusion textures when they're unneeded).
+//  many features are actually in use (pulling out the sampling of the previous/diffusion textures when they're
+//  unneeded).
 
 
 #include "cathode-retro-util-language-helpers.hlsli"
-#include "cathode-retro-crt-distort-coordinates.hlsli"
 
 
 // This is the RGB current frame texture - the output of the NTSC decode shaders if decoding was needed.
@@ -31,39 +30,15 @@ DECLARE_TEXTURE2D(g_screenMaskTexture, g_screenMaskSampler);
 // This sampler should be set up with linear texture sampling and should be set to clamp (no wrapping).
 DECLARE_TEXTURE2D(g_diffusionTexture, g_diffusionSampler);
 
+// This texture is the output of the GenerateDistortionLUT shader, containing the (curvature-distorted and overscan-
+//  adjusted) [-1..1] texture coordinate into the RGB input for each output pixel. Like the screen mask texture, it is
+//  expected to have been generated at our output resolution.
+// This sampler should be set up with point sampling and should be set to clamp (no wrapping).
+DECLARE_TEXTURE2D(g_distortionLUT, g_distortionLUTSampler);
+
 
 CBUFFER consts
 {
-  // This shader is intended to render a screen of the correct shape regardless of the output render target shape,
-  //  effectively letterboxing or pillarboxing as needed(i.e. rendering a 4:3 screen to a 16:9 render target).
-  //  g_viewScale is the scale value necessary to get the resulting screen scale correct. In the event the output
-  //  render target is wider than the intended screen, the screen needs to be scaled down horizontally to pillarbox,
-  //  usually like (where screenAspectRatio is crtScreenWidth / crtScreenHeight):
-  //    (x: (renderTargetWidth / renderTargetHeight) * (1.0 / screenAspectRatio), y: 1.0)
-  //  if the output render target is taller than the intended screen, it will end up letterboxed using something like:
-  //    (x: 1.0, y: (renderTargetHeight / renderTargetWidth) * screenAspectRatio)
-  // Note that if overscan (where the edges of the screen cover up some of the picture) is being emulated, it
-  //  potentially needs to be taken into account in this value too. See RGBToCRT.h for details if that's the case.
-  float2 g_viewScale;
-
-  // If overscan emulation is intended (where the edges of the screen cover up some of the picture), then this is the
-  //  amount of signal texture scaling needed to account for that. Given an overscan value "overscanAmount" that's
-  //    (overscanLeft + overscanRight, overscanTop + overscanBottom)
-  //  this value should end up being:
-  //    (inputImageSize.xy - overscanAmount.xy) / inputImageSize.xy
-  float2 g_overscanScale;
-
-  // This is the texture coordinate offset to adjust for overscan. Because the input coordinates are [-1..1] instead of
-  //  [0..1], this is the offset needed to recenter the value. Given an "overscanDifference" value:
-  //    (overscanLeft - overscanRight, overscanTop - overscanBottom)
-  //  this value should be:
-  //    overscanDifference.xy/ inputImageSize.xy * 0.5
-  float2 g_overscanOffset;
-
-  // The amount along each axis to apply the virtual-curved screen distortion. Usually a value in [0..1]. "0" indicates
-  //  no curvature (a flat screen) and "1" indicates "quite curved"
-  float2 g_distortion;
-
   // The RGBA color of the area around the screen.
   float4 g_backgroundColor;
 
@@ -119,9 +94,9 @@ float4 Main(float2 inTexCoord)
   // The screen texture is 1:1 with the output render target so sample it directly off of the input texture coordinates
   float4 screenMask = SAMPLE_TEXTURE(g_screenMaskTexture, g_screenMaskSampler, inTexCoord);
 
-  // Now distort the texture coordinates to get our texture into the correct space for display.
-  float2 t = DistortCRTCoordinates((inTexCoord * 2 - 1) * g_viewScale, g_distortion) * g_overscanScale
-    + g_overscanOffset * 2.0;
+  // Now look up the distorted texture coordinates to get our texture into the correct space for display (these only
+  //  depend on the output size and the screen settings, so they're precalculated, 1:1 with the output pixels).
+  float2 t = SAMPLE_TEXTURE(g_distortionLUT, g_distortionLUTSampler, inTexCoord).xy;
 
   // Use "t" (before we do the even/odd update or the scanline-sharpening) to load our diffusion texture, which is an
   //  approximation of the glass in front of the phosphors scattering light a little bit due to imperfections.
@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This shader decodes a composite signal straight into RGB in a single pass. It does exactly the same work as the
+//  three-pass decode (CompositeToSVideo, then SVideoToModulatedChroma, then SVideoToRGB - see the comments in those
+//  shaders for the details of each step), but rather than writing the separated luma/chroma and the modulated chroma
+//  out to float textures in between, each output texel recomputes the handful of neighboring values that it needs
+//  from the signal texture directly.
+//
+// That's more math (and more texture reads, although they all land in the same small window of the scanline so they
+//  are very cache-friendly) per output texel, but it skips writing and reading back two full-resolution float
+//  textures, which is where most of the decoder's time goes on bandwidth-limited hardware.
+//
+// Like the three-pass decode, this can decode two versions of the signal at once (with two different color phases)
+//  and blend the results together for temporal artifact reduction.
+
+
+#include "cathode-retro-util-language-helpers.hlsli"
+
+
+// This is a 1- or 2-component texture that contains the composite signal (2 components if we're doing temporal
+//  artifact reduction, in which case the second component is the same frame generated with a different phase).
+// This sampler should be set up for nearest filtering and clamped addressing (every read is at a texel center).
+DECLARE_TEXTURE2D(g_sourceTexture, g_sourceSampler);
+
+// This is a 1- or 2-component texture that contains the colorburst phase offsets for each scanline. It's 1 component
+//  if we have no temporal artifact reduction, and 2 if we do.
+// Each phase value in this texture is the phase in (fractional) multiples of the colorburst wavelength.
+// This sampler should be set up for nearest filtering and clamped addressing (no wrapping).
+DECLARE_TEXTURE2D(g_scanlinePhases, g_scanlinePhasesSampler);
+
+
+CBUFFER consts
+{
+  // How many samples (horizontal texels) there are per each color wave cycle. This needs to be an even number.
+  uint g_samplesPerColorburstCycle;
+
+  // A value representing the tint offset (in colorburst wavelengths) from baseline that we want to use.
+  float g_tint;
+
+  // The saturation of the output, pre-scaled by the brightness (see the same value in SVideoToRGB).
+  float g_saturation;
+
+  // The brightness of the output (a user setting).
+  float g_brightness;
+
+  // The luma values of the input signal that represent black and brightest white.
+  float g_blackLevel;
+  float g_whiteLevel;
+
+  // How much to blend in the second version of the signal (0 means there is only one, 1.0 means a 50/50 blend).
+  float g_temporalArtifactReduction;
+
+  // The width of the input signal (including any side padding)
+  uint g_inputWidth;
+
+  // The width of the output RGB image (should be the width of the input signal minus the side padding)
+  uint g_outputWidth;
+};
+
+
+CONST float k_pi = 3.141592653;
+
+
+float2 SignalAt(int x, float v)
+{
+  return SAMPLE_TEXTURE(g_sourceTexture, g_sourceSampler, float2((float(x) + 0.5) / float(g_inputWidth), v)).xy;
+}
+
+
+// This is the CompositeToSVideo box filter: average one colorburst cycle's worth of the signal, centered on the given
+//  texel (which means half of a texel at either end), to get the luma.
+float2 LumaAt(int x, float v)
+{
+  int halfCycle = int(g_samplesPerColorburstCycle / 2U);
+  float2 sum = 0.5 * (SignalAt(x - halfCycle, v) + SignalAt(x + halfCycle, v));
+  for (int i = 1 - halfCycle; i < halfCycle; i++)
+  {
+    sum += SignalAt(x + i, v);
+  }
+
+  return sum / float(g_samplesPerColorburstCycle);
+}
+
+
+float4 Main(float2 inTexCoord)
+{
+  // Find the signal texel that lines up with this output texel (the output is narrower by the side padding).
+  int inputX = int(floor(inTexCoord.x * float(g_outputWidth))) + int(g_inputWidth - g_outputWidth) / 2;
+  float v = inTexCoord.y;
+
+  float2 relativePhase = SAMPLE_TEXTURE(g_scanlinePhases, g_scanlinePhasesSampler, inTexCoord.yy).xy + g_tint;
+
+  float2 Y = LumaAt(inputX, v);
+
+  // Box filter the modulated chroma over two colorburst cycles (again, a half texel at either end), computing each
+  //  modulated chroma sample on the fly: the chroma is what's left of the signal after removing the luma, and it gets
+  //  modulated with the carrier quadrature for that texel. Out-of-range texels clamp to the edge of the scanline, just
+  //  like the three-pass decode's texture reads do.
+  int cycle = int(g_samplesPerColorburstCycle);
+  float4 IQ = float4(0, 0, 0, 0);
+  for (int i = -cycle; i <= cycle; i++)
+  {
+    int x = clamp(inputX + i, 0, int(g_inputWidth) - 1);
+    float2 chroma = SignalAt(x, v) - LumaAt(x, v);
+
+    float2 s, c;
+    sincos(2.0 * k_pi * (float(x) / float(g_samplesPerColorburstCycle) + relativePhase), s, c);
+
+    float weight = (i == -cycle || i == cycle) ? 0.5 : 1.0;
+    IQ += weight * chroma.xxyy * float4(s.x, -c.x, s.y, -c.y);
+  }
+
+  IQ /= float(2 * cycle);
+
+  // Everything from here on is the same as the end of SVideoToRGB.
+  Y = (Y - g_blackLevel) / (g_whiteLevel - g_blackLevel) * g_brightness;
+  IQ *= float4(g_saturation, g_saturation, g_saturation, g_saturation);
+
+  Y.x = lerp(Y.x, Y.y, g_temporalArtifactReduction * 0.5);
+  IQ.xy = lerp(IQ.xy, IQ.zw, g_temporalArtifactReduction * 0.5);
+
+  Y.x = pow(saturate(Y.x), 2.0 / 2.2);
+  float iqSat = saturate(length(IQ.xy));
+  IQ.xy *= pow(iqSat, 2.0 / 2.2) / max(0.00001, iqSat);
+
+  float3 yiq = float3(Y.x, IQ.xy);
+  return float4(
+    dot(yiq, float3(1.0, 0.946882, 0.623557)),
+    dot(yiq, float3(1.0, -0.274788, -0.635691)),
+    dot(yiq, float3(1.0, -1.108545, 1.7090047)),
+    1.0);
+}
+
+
+PS_MAIN
\ No newline at end of file
@@ -0,0 +1,151 @@
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This shader takes an RGB image and turns it into an S-Video or composite signal with ghosting and noise applied, in
+//  a single pass. It does exactly the same work as RGBToSVideoOrComposite followed by ApplyArtifacts (see the comments
+//  in those shaders for the details of each step), but rather than writing the clean signal out to a float texture
+//  for the artifact pass to read back, each output texel recomputes the handful of clean signal texels that its ghost
+//  taps land between straight from the RGB source.
+//
+// That's more math per output texel (eleven clean texels instead of one), but it skips writing and reading back a
+//  full-resolution float texture (and needs no memory for it at all), which is where most of the time goes on
+//  bandwidth-limited hardware.
+
+
+#include "cathode-retro-util-language-helpers.hlsli"
+#include "cathode-retro-util-noise.hlsli"
+#include "cathode-retro-util-tracking-instability.hlsli"
+
+
+// This is the RGB input texture. It is expected to be g_inputWidth x g_scanlineCount in size.
+// This sampler should be set up with linear filtering, and either clamp or border addressing.
+DECLARE_TEXTURE2D(g_sourceTexture, g_sourceSampler);
+
+// This is the scanline phases texture, generated by GeneratePhaseTexture. It is g_scanlineCount x 1 in size, and each
+//  texel component in it represents the phase offset of the NTSC colorburst for the corresponding scanline, in
+//  multiples of the colorburst wavelength.
+// This sampler should be set up for nearest filtering and clamped addressing (every read is at a texel center).
+DECLARE_TEXTURE2D(g_scanlinePhases, g_scanlinePhasesSampler);
+
+
+CBUFFER consts
+{
+  // These are the same as the similarly-named values in RGBToSVideoOrComposite.
+  uint g_outputTexelsPerColorburstCycle;
+  uint g_inputWidth;
+  uint g_outputWidth;
+  uint g_scanlineCount;
+  float g_compositeBlend;
+  float g_instabilityScale;
+  uint g_noiseSeed;
+  uint g_sidePaddingTexelCount;
+
+  // These are the same as the similarly-named values in ApplyArtifacts (the noise seed, signal width, scanline count,
+  //  and samples per colorburst cycle are all shared with the values above).
+  float g_ghostVisibility;
+  float g_ghostDistance;
+  float g_ghostSpreadScale;
+  float g_noiseStrength;
+};
+
+
+CONST float pi = 3.141592653;
+
+
+// Generate the clean signal texel at the given index, exactly as RGBToSVideoOrComposite would have written it.
+float4 CleanSignalAt(int2 signalTexelIndex)
+{
+  float2 texCoord =
+    (float2(signalTexelIndex) * float2(float(g_inputWidth) / float(g_outputWidth), 1) + float2(0.25, 0.5))
+      / float2(g_inputWidth, g_scanlineCount);
+
+  uint effectiveOutputWidth = g_outputWidth - g_sidePaddingTexelCount;
+  texCoord.x = (texCoord.x - 0.5) * float(g_outputWidth) / float(effectiveOutputWidth) + 0.5;
+
+  texCoord.x += CalculateTrackingInstabilityOffset(
+    uint(signalTexelIndex.y),
+    g_noiseSeed,
+    g_instabilityScale,
+    g_outputWidth);
+
+  float3 rgb = SAMPLE_TEXTURE(g_sourceTexture, g_sourceSampler, texCoord).rgb;
+
+  float3 yiq;
+  yiq.r = dot(rgb, float3(0.3000,  0.5900,  0.1100));
+  yiq.g = dot(rgb, float3(0.5990, -0.2773, -0.3217));
+  yiq.b = dot(rgb, float3(0.2130, -0.5251,  0.3121));
+
+  yiq.x = pow(saturate(yiq.x), 2.2 / 2.0);
+  float iqSat = saturate(length(yiq.yz));
+  yiq.yz *= pow(iqSat, 2.2 / 2.0) / max(0.00001, iqSat);
+
+  float2 scanlinePhase = SAMPLE_TEXTURE(
+    g_scanlinePhases,
+    g_scanlinePhasesSampler,
+    (float2(0.0, float(signalTexelIndex.y) + 0.5) / g_scanlineCount)).xy;
+  float2 phase = scanlinePhase + float(signalTexelIndex.x) / float(g_outputTexelsPerColorburstCycle);
+
+  float2 s, c;
+  sincos(2.0 * pi * phase, s, c);
+
+  float2 luma = yiq.xx;
+  float2 chroma = s * yiq.y - c * yiq.z;
+
+  if (g_compositeBlend > 0)
+  {
+    return (luma + chroma).xyxy;
+  }
+  else
+  {
+    return float4(luma, chroma).xzyw;
+  }
+}
+
+
+// This matches what a linear-filtered, clamped read of the clean signal texture at the given u coordinate on the given
+//  scanline would return: a blend of the two clean texels that it lands between.
+float4 CleanSignalLerp(float u, int y)
+{
+  float x = u * float(g_outputWidth) - 0.5;
+  float x0 = floor(x);
+  int lastX = int(g_outputWidth) - 1;
+  return lerp(
+    CleanSignalAt(int2(clamp(int(x0), 0, lastX), y)),
+    CleanSignalAt(int2(clamp(int(x0) + 1, 0, lastX), y)),
+    x - x0);
+}
+
+
+float4 Main(float2 inputTexCoord)
+{
+  int2 signalTexelIndex = int2(floor(inputTexCoord * float2(g_outputWidth, g_scanlineCount)));
+
+  float4 signal = CleanSignalAt(signalTexelIndex);
+  if (g_ghostVisibility != 0)
+  {
+    float ghostCenter = inputTexCoord.x + g_ghostDistance * g_outputTexelsPerColorburstCycle / float(g_outputWidth);
+    float ghostSampleSpread = g_ghostSpreadScale * g_outputTexelsPerColorburstCycle / float(g_outputWidth);
+
+    // The same 5 (bilinear) taps as ApplyArtifacts uses for its 9-tap gaussian.
+    float4 ghost;
+    ghost =  CleanSignalLerp(ghostCenter - ghostSampleSpread * 1.174285279339, signalTexelIndex.y) * 0.0436893869;
+    ghost += CleanSignalLerp(ghostCenter - ghostSampleSpread * 1.339243613069, signalTexelIndex.y) * 0.323030611;
+    ghost += CleanSignalLerp(ghostCenter, signalTexelIndex.y) * 0.266559988;
+    ghost += CleanSignalLerp(ghostCenter + ghostSampleSpread * 1.339243613069, signalTexelIndex.y) * 0.323030611;
+    ghost += CleanSignalLerp(ghostCenter + ghostSampleSpread * 1.174285279339, signalTexelIndex.y) * 0.0436893869;
+
+    signal += ghost * g_ghostVisibility;
+  }
+
+  float2 pixelIndex = inputTexCoord
+    * float2(g_outputWidth / (g_outputTexelsPerColorburstCycle * 2.0 / 3.0), g_scanlineCount);
+  float xFrac = frac(pixelIndex.x);
+  pixelIndex = floor(pixelIndex);
+
+  float noiseL = Noise2D(pixelIndex, float(g_noiseSeed));
+  float noiseR = Noise2D(pixelIndex + float2(1.0, 0.0), float(g_noiseSeed));
+  float noise = lerp(noiseL, noiseR, xFrac) * 2.0 - 1.0;
+
+  return (signal + noise * g_noiseStrength) / (1.0 + g_ghostVisibility);
+}
+
+
+PS_MAIN
\ No newline at end of file